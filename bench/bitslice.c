@@ -0,0 +1,174 @@
+/*
+ * Bit-slicing kernel benchmark.
+ *
+ * Times the work a lockstep multi-port host does in software for each poll of
+ * every port: transposing the commands into pin words, and untransposing the
+ * sampled lines and decoding each port's reply. The kernels are compared with
+ * straightforward bit-at-a-time loops, and the bus time of one lockstep poll
+ * is compared with polling the ports one after the other.
+ *
+ * Usage: bench_bitslice [ports] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <joybus/bitslice.h>
+#include <joybus/commands.h>
+#include <joybus/common/gcn_controller.h>
+
+// Longest turnaround covered by the sample window, in bit times
+#define TURNAROUND_BITS 16
+
+// Samples for a GameCube read reply
+#define NUM_SAMPLES     JOYBUS_BITSLICE_SAMPLES(JOYBUS_CMD_GCN_READ_RX, TURNAROUND_BITS)
+
+// Nominal bit time
+#define BIT_NS          4000
+
+// Typical controller turnaround
+#define TURNAROUND_NS   3000
+
+static uint8_t commands[JOYBUS_BITSLICE_MAX_PORTS][JOYBUS_CMD_GCN_READ_TX];
+static const uint8_t *command_ptrs[JOYBUS_BITSLICE_MAX_PORTS];
+static uint8_t cmd_words[JOYBUS_CMD_GCN_READ_TX * 8];
+
+static uint8_t samples[NUM_SAMPLES];
+static uint8_t streams[JOYBUS_BITSLICE_MAX_PORTS][NUM_SAMPLES / 8];
+static uint8_t *stream_ptrs[JOYBUS_BITSLICE_MAX_PORTS];
+static uint8_t replies[JOYBUS_BITSLICE_MAX_PORTS][JOYBUS_CMD_GCN_READ_RX];
+
+// Keep results alive so the compiler can't drop the work
+static volatile uint8_t sink;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Bit-at-a-time transpose
+static void transpose_naive(const uint8_t *const bytes[], uint8_t ports, uint8_t len, uint8_t *words)
+{
+  for (int i = 0; i < len * 8; i++) {
+    uint8_t word = 0;
+    for (int p = 0; p < ports; p++)
+      word |= ((bytes[p][i / 8] >> (7 - i % 8)) & 1) << p;
+    words[i] = word;
+  }
+}
+
+// Bit-at-a-time untranspose
+static void untranspose_naive(const uint8_t *words, uint8_t ports, uint8_t len, uint8_t *const bytes[])
+{
+  for (int p = 0; p < ports; p++) {
+    for (int i = 0; i < len; i++) {
+      uint8_t byte = 0;
+      for (int bit = 0; bit < 8; bit++)
+        byte = byte << 1 | ((words[i * 8 + bit] >> p) & 1);
+      bytes[p][i] = byte;
+    }
+  }
+}
+
+// Render a GameCube read reply on every port, each with a slightly different turnaround
+static void render_replies(int ports)
+{
+  memset(samples, 0xFF, sizeof(samples));
+  for (int p = 0; p < ports; p++) {
+    uint32_t turnaround = TURNAROUND_NS + p * 700;
+    for (int s = 0; s < NUM_SAMPLES; s++) {
+      uint32_t t = s * (BIT_NS / JOYBUS_BITSLICE_OVERSAMPLE);
+      if (t < turnaround)
+        continue;
+
+      uint32_t bit   = (t - turnaround) / BIT_NS;
+      uint32_t phase = (t - turnaround) % BIT_NS;
+      if (bit >= JOYBUS_CMD_GCN_READ_RX * 8)
+        break;
+
+      int one = (0x5A >> (7 - bit % 8)) & 1;
+      if (phase < (one ? BIT_NS / 4 : BIT_NS * 3 / 4))
+        samples[s] &= ~(1 << p);
+    }
+  }
+}
+
+// Print the time per call of a benchmark body
+#define TIME(label, iterations, body)                                                        \
+  do {                                                                                       \
+    uint64_t start = now_ns();                                                               \
+    for (int it = 0; it < (iterations); it++) {                                              \
+      body;                                                                                  \
+    }                                                                                        \
+    printf("  %-32s %8.1f ns\n", label, (double)(now_ns() - start) / (iterations));          \
+  } while (0)
+
+int main(int argc, char **argv)
+{
+  int ports      = argc > 1 ? atoi(argv[1]) : 4;
+  int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+  if (ports < 1 || ports > JOYBUS_BITSLICE_MAX_PORTS || iterations <= 0) {
+    fprintf(stderr, "usage: %s [ports 1-%d] [iterations]\n", argv[0], JOYBUS_BITSLICE_MAX_PORTS);
+    return 1;
+  }
+
+  for (int p = 0; p < JOYBUS_BITSLICE_MAX_PORTS; p++) {
+    commands[p][0]  = JOYBUS_CMD_GCN_READ;
+    commands[p][1]  = JOYBUS_GCN_ANALOG_MODE_3;
+    commands[p][2]  = p & 1;
+    command_ptrs[p] = commands[p];
+    stream_ptrs[p]  = streams[p];
+  }
+  render_replies(ports);
+
+  printf("GameCube read on %d ports, %d samples per reply window\n\n", ports, NUM_SAMPLES);
+
+  printf("Transmit (bytes to pin words)\n");
+  TIME("naive transpose", iterations, {
+    transpose_naive(command_ptrs, ports, JOYBUS_CMD_GCN_READ_TX, cmd_words);
+    sink = cmd_words[it % sizeof(cmd_words)];
+  });
+  TIME("joybus_bitslice_transpose", iterations, {
+    joybus_bitslice_transpose(command_ptrs, ports, JOYBUS_CMD_GCN_READ_TX, cmd_words);
+    sink = cmd_words[it % sizeof(cmd_words)];
+  });
+
+  printf("\nReceive (samples to replies)\n");
+  TIME("naive untranspose", iterations, {
+    untranspose_naive(samples, ports, NUM_SAMPLES / 8, stream_ptrs);
+    sink = streams[0][it % (NUM_SAMPLES / 8)];
+  });
+  TIME("joybus_bitslice_untranspose", iterations, {
+    joybus_bitslice_untranspose(samples, ports, NUM_SAMPLES / 8, stream_ptrs);
+    sink = streams[0][it % (NUM_SAMPLES / 8)];
+  });
+  TIME("joybus_bitslice_decode, all ports", iterations, {
+    for (int p = 0; p < ports; p++)
+      sink = joybus_bitslice_decode(streams[p], NUM_SAMPLES, replies[p], JOYBUS_CMD_GCN_READ_RX);
+  });
+
+  // Check the decoded replies, so the numbers above are for working code
+  for (int p = 0; p < ports; p++) {
+    for (int i = 0; i < JOYBUS_CMD_GCN_READ_RX; i++) {
+      if (replies[p][i] != 0x5A) {
+        fprintf(stderr, "port %d decoded incorrectly\n", p);
+        return 1;
+      }
+    }
+  }
+
+  // Command and host stop bit, then the turnaround, reply and target stop bit, or the whole sample window in lockstep
+  uint32_t command_ns  = (JOYBUS_CMD_GCN_READ_TX * 8 + 1) * BIT_NS;
+  uint32_t poll_us     = (command_ns + TURNAROUND_NS + (JOYBUS_CMD_GCN_READ_RX * 8 + 1) * BIT_NS) / 1000;
+  uint32_t lockstep_us = (command_ns + NUM_SAMPLES * (BIT_NS / JOYBUS_BITSLICE_OVERSAMPLE)) / 1000;
+  printf("\nBus time\n");
+  printf("  %-32s %8u us\n", "one port", poll_us);
+  printf("  %-32s %8u us\n", "all ports, one after the other", poll_us * ports);
+  printf("  %-32s %8u us\n", "all ports, lockstep", lockstep_us);
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Per-instance RAM footprint report.
+ *
+ * Prints the size of each bus, buffer and target struct for the current build
+ * configuration, along with the total for a multi-port adapter. Build it with
+ * different JOYBUS_COMMAND_BUFFER_SIZE, JOYBUS_RESPONSE_BUFFER_SIZE,
+ * JOYBUS_COMMAND_SLOTS, JOYBUS_USE_BUFFER_POOL and JOYBUS_USE_MAILBOXES
+ * settings to compare configurations.
+ *
+ * Sizes are for the ABI the report was built for, pointers are smaller on
+ * 32-bit microcontrollers.
+ *
+ * Usage: bench_footprint [ports]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <joybus/buffer_pool.h>
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/mailbox.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn_adapter.h>
+#include <joybus/host/gcn_pipeline.h>
+#include <joybus/target/bridge.h>
+#include <joybus/target/capture.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+#include <joybus/target/playback.h>
+#include <joybus/target/relay.h>
+
+#define DEFAULT_PORTS 4
+
+#define REPORT(type) printf("  %-40s %6zu\n", #type, sizeof(type))
+
+int main(int argc, char **argv)
+{
+  int ports = argc > 1 ? atoi(argv[1]) : DEFAULT_PORTS;
+  if (ports < 1) {
+    fprintf(stderr, "usage: %s [ports]\n", argv[0]);
+    return 1;
+  }
+
+  printf("Configuration\n");
+  printf("  %-40s %6d\n", "JOYBUS_COMMAND_BUFFER_SIZE", JOYBUS_COMMAND_BUFFER_SIZE);
+  printf("  %-40s %6d\n", "JOYBUS_RESPONSE_BUFFER_SIZE", JOYBUS_RESPONSE_BUFFER_SIZE);
+  printf("  %-40s %6d\n", "JOYBUS_COMMAND_SLOTS", JOYBUS_COMMAND_SLOTS);
+  printf("  %-40s %6d\n", "JOYBUS_USE_BUFFER_POOL", JOYBUS_USE_BUFFER_POOL);
+  printf("  %-40s %6d\n", "JOYBUS_USE_MAILBOXES", JOYBUS_USE_MAILBOXES);
+
+  printf("\nBus (bytes)\n");
+  REPORT(struct joybus);
+  REPORT(struct joybus_loopback);
+  REPORT(struct joybus_buffers);
+  REPORT(struct joybus_command_slot);
+#if JOYBUS_USE_BUFFER_POOL
+  REPORT(struct joybus_buffer_pool);
+#endif
+  REPORT(struct joybus_alarm);
+#if JOYBUS_USE_MAILBOXES
+  REPORT(struct joybus_mailbox);
+#endif
+
+  printf("\nTargets (bytes)\n");
+  REPORT(struct joybus_target_gcn_controller);
+  REPORT(struct joybus_target_n64_controller);
+  REPORT(struct joybus_target_n64_rumble_pak);
+  REPORT(struct joybus_target_bridge);
+  REPORT(struct joybus_target_relay);
+  REPORT(struct joybus_target_recorder);
+  REPORT(struct joybus_target_playback);
+
+  printf("\nHost (bytes)\n");
+  REPORT(struct joybus_gcn_adapter);
+  REPORT(struct joybus_gcn_pipeline);
+
+  // A host adapter polling GameCube controllers, one bus per port
+  size_t buses = ports * sizeof(struct joybus_loopback);
+#if JOYBUS_USE_BUFFER_POOL
+  // Polls are sequential, so the ports share a set of buffers per command slot
+  size_t buffers = sizeof(struct joybus_buffer_pool) + JOYBUS_COMMAND_SLOTS * sizeof(struct joybus_buffers);
+#else
+  size_t buffers = 0;
+#endif
+
+  printf("\n%d-port adapter (bytes)\n", ports);
+  printf("  %-40s %6zu\n", "buses", buses);
+  printf("  %-40s %6zu\n", "pooled buffers", buffers);
+  printf("  %-40s %6zu\n", "total", buses + buffers);
+
+  return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * Input-to-report latency benchmark.
+ *
+ * Runs a controller target and a host poller over the loopback backend, and
+ * injects input changes at random times relative to the poll schedule. For
+ * each polling strategy it reports:
+ *
+ * - callback latency: input change to the host read callback seeing it
+ * - report latency: input change to the first USB report deadline carrying it
+ * - staleness: age of the newest completed read at each report deadline
+ *
+ * Usage: bench_latency [injections] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+// USB full-speed frame interval, the consumer deadline
+#define REPORT_INTERVAL_NS     1000000ULL
+
+// Input changes are spaced far enough apart that each one is observed
+#define INJECT_MIN_GAP_NS      3000000ULL
+#define INJECT_MAX_GAP_NS      7000000ULL
+
+// Extra margin added to the predicted read duration by the adaptive strategy
+#define ADAPTIVE_GUARD_NS      10000ULL
+
+enum device {
+  DEVICE_GCN,
+  DEVICE_N64,
+};
+
+enum strategy {
+  STRATEGY_FIXED,
+  STRATEGY_DEADLINE,
+  STRATEGY_ADAPTIVE,
+};
+
+static const char *device_names[]   = {"gcn", "n64"};
+static const char *strategy_names[] = {"fixed", "deadline", "adaptive"};
+
+// State of one benchmark run
+struct run {
+  enum device device;
+  enum strategy strategy;
+
+  // Buses and targets
+  struct joybus_loopback host_bus;
+  struct joybus_loopback target_bus;
+  struct joybus_target_gcn_controller gcn;
+  struct joybus_target_n64_controller n64;
+
+  // Host-side read buffers
+  struct joybus_gcn_controller_state gcn_state;
+  struct joybus_n64_controller_state n64_state;
+
+  // Poll schedule
+  uint64_t next_poll_ns;
+  uint64_t poll_start_ns;
+  bool poll_busy;
+
+  // Predicted read duration for the adaptive strategy, and its mean deviation
+  uint64_t duration_avg_ns;
+  uint64_t duration_dev_ns;
+
+  // Latest read seen by the host
+  uint64_t last_read_ns;
+  uint8_t last_value;
+
+  // Outstanding input change
+  uint8_t inject_value;
+  uint64_t inject_ns;
+  bool seen_by_callback;
+  bool seen_by_report;
+
+  // Samples, in nanoseconds
+  uint64_t *callback_latency;
+  uint64_t *report_latency;
+  uint64_t *staleness;
+  int callback_count;
+  int report_count;
+  int staleness_count;
+  int capacity;
+};
+
+// Deterministic xorshift PRNG so runs are reproducible
+static uint64_t rng_state;
+static uint64_t rng_next(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static uint64_t rng_range(uint64_t min, uint64_t max)
+{
+  return min + rng_next() % (max - min);
+}
+
+// Nominal duration of a read transfer, from the wire format
+static uint64_t nominal_read_ns(enum device device)
+{
+  uint32_t tx = device == DEVICE_GCN ? JOYBUS_CMD_GCN_READ_TX : JOYBUS_CMD_N64_READ_TX;
+  uint32_t rx = device == DEVICE_GCN ? JOYBUS_CMD_GCN_READ_RX : JOYBUS_CMD_N64_READ_RX;
+  return (uint64_t)(tx * 8 + 1 + rx * 8 + 1) * 1000000000ULL / JOYBUS_FREQ_NOMINAL;
+}
+
+// How long before the report deadline a read must start
+static uint64_t poll_lead_ns(struct run *run)
+{
+  if (run->strategy == STRATEGY_DEADLINE)
+    return nominal_read_ns(run->device) + JOYBUS_REPLY_TIMEOUT_US * 1000ULL;
+
+  return run->duration_avg_ns + 4 * run->duration_dev_ns + ADAPTIVE_GUARD_NS;
+}
+
+static void read_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct run *run = user_data;
+  uint64_t now    = joybus_loopback_now_ns();
+  run->poll_busy  = false;
+  if (status < 0)
+    return;
+
+  // Track the read duration for the adaptive strategy
+  uint64_t duration = now - run->poll_start_ns;
+  uint64_t dev      = duration > run->duration_avg_ns ? duration - run->duration_avg_ns : run->duration_avg_ns - duration;
+  run->duration_avg_ns += ((int64_t)duration - (int64_t)run->duration_avg_ns) / 8;
+  run->duration_dev_ns += ((int64_t)dev - (int64_t)run->duration_dev_ns) / 8;
+
+  // Record what the host sees
+  run->last_read_ns = now;
+  run->last_value   = run->device == DEVICE_GCN ? run->gcn_state.stick_x : (uint8_t)run->n64_state.stick_x;
+
+  if (!run->seen_by_callback && run->last_value == run->inject_value && run->inject_ns) {
+    run->seen_by_callback                        = true;
+    run->callback_latency[run->callback_count++] = now - run->inject_ns;
+  }
+}
+
+static void start_poll(struct run *run)
+{
+  // Skip this poll if the previous one is still running
+  if (run->poll_busy)
+    return;
+
+  run->poll_busy     = true;
+  run->poll_start_ns = joybus_loopback_now_ns();
+
+  struct joybus *bus = JOYBUS(&run->host_bus);
+  int rc             = run->device == DEVICE_GCN
+                         ? joybus_gcn_read_async(bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &run->gcn_state,
+                                                 read_cb, run)
+                         : joybus_n64_read_async(bus, &run->n64_state, read_cb, run);
+  if (rc < 0)
+    run->poll_busy = false;
+}
+
+static void inject(struct run *run, uint64_t now)
+{
+  // Cycle through small positive stick values, valid for both devices
+  run->inject_value     = run->inject_value % 100 + 1;
+  run->inject_ns        = now;
+  run->seen_by_callback = false;
+  run->seen_by_report   = false;
+
+  if (run->device == DEVICE_GCN) {
+    run->gcn.input.stick_x = run->inject_value;
+  } else {
+    run->n64.input.stick_x = run->inject_value;
+  }
+}
+
+static void report(struct run *run, uint64_t now)
+{
+  // Age of the newest data available to the report
+  if (run->last_read_ns && run->staleness_count < run->capacity)
+    run->staleness[run->staleness_count++] = now - run->last_read_ns;
+
+  // First report carrying the outstanding input change
+  if (run->seen_by_callback && !run->seen_by_report) {
+    run->seen_by_report                      = true;
+    run->report_latency[run->report_count++] = now - run->inject_ns;
+  }
+}
+
+static void run_strategy(struct run *run, int injections)
+{
+  // Wire up a host bus and a controller
+  joybus_loopback_init(&run->host_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&run->target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&run->host_bus, &run->target_bus);
+
+  if (run->device == DEVICE_GCN) {
+    joybus_target_gcn_controller_init(&run->gcn);
+    joybus_target_gcn_controller_input_valid(&run->gcn, true);
+    joybus_attach_target(JOYBUS(&run->target_bus), JOYBUS_TARGET(&run->gcn));
+  } else {
+    joybus_target_n64_controller_init(&run->n64);
+    joybus_attach_target(JOYBUS(&run->target_bus), JOYBUS_TARGET(&run->n64));
+  }
+
+  joybus_enable(JOYBUS(&run->host_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&run->target_bus), JOYBUS_MODE_TARGET);
+
+  // The poll schedule starts at a random phase relative to the report deadlines
+  uint64_t start          = joybus_loopback_now_ns();
+  uint64_t next_report_ns = start + REPORT_INTERVAL_NS;
+  uint64_t next_inject_ns = start + rng_range(INJECT_MIN_GAP_NS, INJECT_MAX_GAP_NS);
+  run->duration_avg_ns    = nominal_read_ns(run->device);
+  run->next_poll_ns       = run->strategy == STRATEGY_FIXED ? start + rng_range(0, REPORT_INTERVAL_NS)
+                                                            : next_report_ns - poll_lead_ns(run);
+
+  while (run->report_count < injections) {
+    // Advance to the next scheduled event
+    uint64_t now = run->next_poll_ns;
+    if (next_report_ns < now)
+      now = next_report_ns;
+    if (next_inject_ns < now)
+      now = next_inject_ns;
+    joybus_loopback_run_until(now);
+
+    if (now == next_inject_ns) {
+      inject(run, now);
+      next_inject_ns = now + rng_range(INJECT_MIN_GAP_NS, INJECT_MAX_GAP_NS);
+    }
+
+    if (now == next_report_ns) {
+      report(run, now);
+      next_report_ns += REPORT_INTERVAL_NS;
+
+      // Aligned strategies schedule the next poll relative to the next deadline
+      if (run->strategy != STRATEGY_FIXED)
+        run->next_poll_ns = next_report_ns - poll_lead_ns(run);
+    }
+
+    if (now == run->next_poll_ns) {
+      start_poll(run);
+
+      // Fixed polls free-run, aligned polls are rescheduled at the next deadline
+      run->next_poll_ns += REPORT_INTERVAL_NS;
+    }
+  }
+
+  joybus_disable(JOYBUS(&run->host_bus));
+  joybus_disable(JOYBUS(&run->target_bus));
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Print min/median/p99 of a set of samples, in microseconds
+static void print_stats(uint64_t *samples, int count)
+{
+  qsort(samples, count, sizeof(*samples), compare_u64);
+  printf(" %7.1f %7.1f %7.1f |", samples[0] / 1000.0, samples[count / 2] / 1000.0, samples[count * 99 / 100] / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+  int injections = argc > 1 ? atoi(argv[1]) : 5000;
+  rng_state      = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+  if (injections <= 0 || rng_state == 0) {
+    fprintf(stderr, "usage: %s [injections] [seed]\n", argv[0]);
+    return 1;
+  }
+
+  // Reports are counted once per deadline, so staleness needs more room
+  int capacity = injections * (INJECT_MAX_GAP_NS / REPORT_INTERVAL_NS + 1);
+
+  printf("%-4s %-9s | %-23s | %-23s | %-23s |\n", "", "", "callback latency (us)", "report latency (us)",
+         "staleness (us)");
+  printf("%-4s %-9s | %7s %7s %7s | %7s %7s %7s | %7s %7s %7s |\n", "dev", "strategy", "min", "median", "p99", "min",
+         "median", "p99", "min", "median", "p99");
+
+  for (int device = DEVICE_GCN; device <= DEVICE_N64; device++) {
+    for (int strategy = STRATEGY_FIXED; strategy <= STRATEGY_ADAPTIVE; strategy++) {
+      struct run *run = calloc(1, sizeof(*run));
+      run->device     = device;
+      run->strategy   = strategy;
+      run->capacity   = capacity;
+
+      run->callback_latency = calloc(capacity, sizeof(uint64_t));
+      run->report_latency   = calloc(capacity, sizeof(uint64_t));
+      run->staleness        = calloc(capacity, sizeof(uint64_t));
+
+      run_strategy(run, injections);
+
+      printf("%-4s %-9s |", device_names[device], strategy_names[strategy]);
+      print_stats(run->callback_latency, run->callback_count);
+      print_stats(run->report_latency, run->report_count);
+      print_stats(run->staleness, run->staleness_count);
+      printf("\n");
+
+      free(run->callback_latency);
+      free(run->report_latency);
+      free(run->staleness);
+      free(run);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,587 @@
+/*
+ * Console load generator.
+ *
+ * Drives a controller target from a virtual console over the loopback
+ * backend, with polling patterns taken from real consoles and some adversarial
+ * ones. For each pattern it reports:
+ *
+ * - whether the target keeps up with the pattern's nominal schedule
+ * - the maximum sustainable poll rate, the fastest schedule at which every
+ *   command is answered exactly as it is when polled at a leisurely rate
+ * - the worst-case time spent in the target's handler for each command, for a
+ *   single byte and over the whole command, measured on the host as the 99.9th
+ *   percentile and the maximum
+ *
+ * The poll rate is limited by wire time, the inter-transfer delay and the
+ * target's handler calls, each of which is charged a fixed cost of virtual
+ * time before a response it commits can go out. The measured handler times
+ * are host CPU times, use them to compare target changes rather than as
+ * absolute figures for a microcontroller.
+ *
+ * Exits with a non-zero status if the target misses the nominal schedule of a
+ * pattern a real console uses, stress patterns beyond what the wire allows are
+ * reported as "over".
+ *
+ * Usage: bench_load [bursts] [seed] [handler_ns]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <joybus/bus.h>
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+// Console frame interval, shared by NTSC GameCube and N64 games
+#define FRAME_US            16683
+
+// Leisurely schedule used for the reference run, and the upper bound of the search
+#define REFERENCE_PERIOD_US 100000
+
+// Handler time histogram resolution and range, longer times land in the last bucket
+#define HISTOGRAM_NS        8
+#define HISTOGRAM_LEN       8192
+
+// Largest number of supported commands on a target
+#define MAX_COMMANDS        8
+
+// Default virtual cost of a handler call, roughly a byte interrupt on a microcontroller
+#define HANDLER_NS          1000
+
+enum device {
+  DEVICE_GCN,
+  DEVICE_N64,
+};
+
+static const char *device_names[] = {"gcn", "n64"};
+
+// A command sent by the virtual console
+struct command {
+  uint8_t tx[JOYBUS_BLOCK_SIZE];
+  uint8_t tx_len;
+  uint8_t rx_len;
+};
+
+// Opcode and lengths of a command supported by a target
+struct command_info {
+  uint8_t command;
+  uint8_t tx_len;
+  uint8_t rx_len;
+};
+
+struct trial;
+
+// Fill in the next command of a pattern
+typedef void (*command_fn)(struct trial *trial, struct command *command);
+
+// A polling pattern
+struct pattern {
+  const char *name;
+  const char *description;
+  enum device device;
+
+  // Console bit rate
+  uint32_t console_freq;
+
+  // Commands sent back to back in each burst, and the nominal start-to-start period of bursts
+  uint8_t burst;
+  uint32_t period_us;
+
+  // Whether missing the nominal schedule is a failure, stress patterns may exceed what the wire allows
+  bool required;
+
+  command_fn next_command;
+};
+
+// Outcome of one transfer, compared against the reference run
+struct outcome {
+  int status;
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+};
+
+// Handler times for one supported command, or for all unsupported ones
+struct handler_stats {
+  uint32_t count;
+  uint32_t completed;
+  uint32_t bytes;
+  uint64_t byte_max_ns;
+  uint64_t command_max_ns;
+
+  // Time spent on each byte, and on each whole command
+  uint32_t byte_hist[HISTOGRAM_LEN];
+  uint32_t command_hist[HISTOGRAM_LEN];
+};
+
+// Wraps the target under test to time its handler
+struct timed_target {
+  struct joybus_target base;
+  struct joybus_target *target;
+  const struct command_info *commands;
+  int command_count;
+  struct handler_stats *stats;
+  uint64_t command_ns;
+};
+
+// State of one run of a pattern
+struct trial {
+  const struct pattern *pattern;
+  uint64_t rng_state;
+  uint32_t index;
+
+  // Buses and targets
+  struct joybus_loopback console_bus;
+  struct joybus_loopback target_bus;
+  struct joybus_target_gcn_controller gcn;
+  struct joybus_target_n64_controller n64;
+  struct joybus_target_n64_rumble_pak rumble;
+  struct timed_target timed;
+
+  // Transfer in progress
+  struct command command;
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+  uint8_t burst_remaining;
+  bool busy;
+  uint64_t done_ns;
+
+  // Outcomes of this run, and of the reference run to compare against
+  struct outcome *outcomes;
+  const struct outcome *reference;
+  int count;
+  bool failed;
+};
+
+static struct handler_stats handler_stats[MAX_COMMANDS + 1];
+static uint64_t seed;
+static uint32_t handler_ns;
+
+static const struct command_info gcn_commands[] = {
+  {JOYBUS_CMD_RESET, JOYBUS_CMD_RESET_TX, JOYBUS_CMD_RESET_RX},
+  {JOYBUS_CMD_IDENTIFY, JOYBUS_CMD_IDENTIFY_TX, JOYBUS_CMD_IDENTIFY_RX},
+  {JOYBUS_CMD_GCN_READ, JOYBUS_CMD_GCN_READ_TX, JOYBUS_CMD_GCN_READ_RX},
+  {JOYBUS_CMD_GCN_READ_ORIGIN, JOYBUS_CMD_GCN_READ_ORIGIN_TX, JOYBUS_CMD_GCN_READ_ORIGIN_RX},
+  {JOYBUS_CMD_GCN_CALIBRATE, JOYBUS_CMD_GCN_CALIBRATE_TX, JOYBUS_CMD_GCN_CALIBRATE_RX},
+  {JOYBUS_CMD_GCN_READ_LONG, JOYBUS_CMD_GCN_READ_LONG_TX, JOYBUS_CMD_GCN_READ_LONG_RX},
+  {JOYBUS_CMD_GCN_PROBE_DEVICE, JOYBUS_CMD_GCN_PROBE_DEVICE_TX, JOYBUS_CMD_GCN_PROBE_DEVICE_RX},
+  {JOYBUS_CMD_GCN_FIX_DEVICE, JOYBUS_CMD_GCN_FIX_DEVICE_TX, JOYBUS_CMD_GCN_FIX_DEVICE_RX},
+};
+
+static const struct command_info n64_commands[] = {
+  {JOYBUS_CMD_RESET, JOYBUS_CMD_RESET_TX, JOYBUS_CMD_RESET_RX},
+  {JOYBUS_CMD_IDENTIFY, JOYBUS_CMD_IDENTIFY_TX, JOYBUS_CMD_IDENTIFY_RX},
+  {JOYBUS_CMD_N64_READ, JOYBUS_CMD_N64_READ_TX, JOYBUS_CMD_N64_READ_RX},
+  {JOYBUS_CMD_N64_PAK_READ, JOYBUS_CMD_N64_PAK_READ_TX, JOYBUS_CMD_N64_PAK_READ_RX},
+  {JOYBUS_CMD_N64_PAK_WRITE, JOYBUS_CMD_N64_PAK_WRITE_TX, JOYBUS_CMD_N64_PAK_WRITE_RX},
+};
+
+#define GCN_COMMAND_COUNT (int)(sizeof(gcn_commands) / sizeof(gcn_commands[0]))
+#define N64_COMMAND_COUNT (int)(sizeof(n64_commands) / sizeof(n64_commands[0]))
+
+// Deterministic xorshift PRNG, restarted for every run so each sees the same commands
+static uint64_t rng_next(struct trial *trial)
+{
+  trial->rng_state ^= trial->rng_state << 13;
+  trial->rng_state ^= trial->rng_state >> 7;
+  trial->rng_state ^= trial->rng_state << 17;
+  return trial->rng_state;
+}
+
+static uint64_t wall_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// Timed target
+// ---------------------------------------------------------------------------
+
+static int histogram_bucket(uint64_t ns)
+{
+  uint64_t bucket = ns / HISTOGRAM_NS;
+  return bucket < HISTOGRAM_LEN ? bucket : HISTOGRAM_LEN - 1;
+}
+
+// Upper bound of the bucket holding the given quantile, capped at the largest value seen
+static uint64_t histogram_quantile(const uint32_t *hist, uint32_t total, uint64_t max, double q)
+{
+  uint64_t target = total * q, seen = 0;
+  for (int i = 0; i < HISTOGRAM_LEN - 1; i++) {
+    seen += hist[i];
+    if (seen > target)
+      return (uint64_t)(i + 1) * HISTOGRAM_NS < max ? (uint64_t)(i + 1) * HISTOGRAM_NS : max;
+  }
+
+  return max;
+}
+
+static int timed_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
+                               joybus_target_response_cb send_response, void *user_data)
+{
+  struct timed_target *timed = (struct timed_target *)target;
+
+  uint64_t start = wall_ns();
+  int rc         = joybus_target_byte_received(timed->target, command, bytes_read, send_response, user_data);
+  uint64_t time  = wall_ns() - start;
+
+  // Supported commands have their own stats, unsupported ones share the last slot
+  if (bytes_read == 1) {
+    int i = 0;
+    while (i < timed->command_count && timed->commands[i].command != command[0])
+      i++;
+
+    timed->stats      = &handler_stats[i];
+    timed->command_ns = 0;
+    timed->stats->count++;
+  }
+
+  struct handler_stats *stats = timed->stats;
+  timed->command_ns          += time;
+  stats->byte_hist[histogram_bucket(time)]++;
+  stats->bytes++;
+  if (time > stats->byte_max_ns)
+    stats->byte_max_ns = time;
+
+  // Last byte the target wants, the command is complete
+  if (rc <= 0) {
+    stats->command_hist[histogram_bucket(timed->command_ns)]++;
+    stats->completed++;
+    if (timed->command_ns > stats->command_max_ns)
+      stats->command_max_ns = timed->command_ns;
+  }
+
+  return rc;
+}
+
+static const struct joybus_target_api timed_api = {
+  .byte_received = timed_byte_received,
+};
+
+// ---------------------------------------------------------------------------
+// Patterns
+// ---------------------------------------------------------------------------
+
+static void set_command(struct command *command, const struct command_info *info)
+{
+  command->tx[0]  = info->command;
+  command->tx_len = info->tx_len;
+  command->rx_len = info->rx_len;
+}
+
+// Pak address with its checksum, or a corrupted one
+static void set_pak_address(struct command *command, uint16_t addr, bool valid)
+{
+  addr &= ~0x1F;
+  addr |= joybus_address_checksum(addr >> 5) ^ (valid ? 0 : 1);
+
+  command->tx[1] = addr >> 8;
+  command->tx[2] = addr & 0xFF;
+}
+
+// Games poll the SI several times a frame, switching rumble on and off now and then
+static void gcn_poll_command(struct trial *trial, struct command *command)
+{
+  set_command(command, &gcn_commands[2]);
+  command->tx[1] = JOYBUS_GCN_ANALOG_MODE_3;
+  command->tx[2] = (trial->index / 120) % 2 ? JOYBUS_GCN_MOTOR_RUMBLE : JOYBUS_GCN_MOTOR_STOP;
+}
+
+// The PIF runs a status query and a read back to back every frame
+static void n64_pif_command(struct trial *trial, struct command *command)
+{
+  set_command(command, trial->index % 2 ? &n64_commands[2] : &n64_commands[1]);
+}
+
+// Overclocked polling only ever reads
+static void n64_read_command(struct trial *trial, struct command *command)
+{
+  set_command(command, &n64_commands[2]);
+}
+
+// Saves write each block of the pak and read it back
+static void n64_pak_command(struct trial *trial, struct command *command)
+{
+  uint16_t block = (trial->index / 2) % 0x800;
+
+  if (trial->index % 2 == 0) {
+    set_command(command, &n64_commands[4]);
+    for (int i = 3; i < JOYBUS_CMD_N64_PAK_WRITE_TX; i++)
+      command->tx[i] = block + i;
+  } else {
+    set_command(command, &n64_commands[3]);
+  }
+
+  set_pak_address(command, block << 5, true);
+}
+
+// Random commands with random arguments, with some unsupported and truncated ones mixed in
+static void random_command(struct trial *trial, struct command *command, const struct command_info *commands, int count)
+{
+  uint32_t pick = rng_next(trial) % 16;
+
+  if (pick < 3) {
+    // Unsupported opcode, the target should stay silent
+    uint8_t opcode;
+    bool supported;
+    do {
+      opcode    = rng_next(trial);
+      supported = false;
+      for (int i = 0; i < count; i++)
+        supported |= commands[i].command == opcode;
+    } while (supported);
+
+    command->tx[0]  = opcode;
+    command->tx_len = 1 + rng_next(trial) % 3;
+    command->rx_len = 1 + rng_next(trial) % 10;
+  } else {
+    set_command(command, &commands[rng_next(trial) % count]);
+
+    // Truncated command, the target never sees the rest of it
+    if (pick == 3)
+      command->tx_len = 1;
+  }
+
+  for (int i = 1; i < command->tx_len; i++)
+    command->tx[i] = rng_next(trial);
+
+  // Most pak accesses have a valid address
+  if (command->tx[0] == JOYBUS_CMD_N64_PAK_READ || command->tx[0] == JOYBUS_CMD_N64_PAK_WRITE) {
+    if (command->tx_len >= 3)
+      set_pak_address(command, command->tx[1] << 8, rng_next(trial) % 8 != 0);
+  }
+}
+
+static void gcn_random_command(struct trial *trial, struct command *command)
+{
+  random_command(trial, command, gcn_commands, GCN_COMMAND_COUNT);
+}
+
+static void n64_random_command(struct trial *trial, struct command *command)
+{
+  random_command(trial, command, n64_commands, N64_COMMAND_COUNT);
+}
+
+static const struct pattern patterns[] = {
+  {"gcn-poll", "4 reads per frame", DEVICE_GCN, JOYBUS_FREQ_GCN_CONSOLE, 1, FRAME_US / 4, true, gcn_poll_command},
+  {"gcn-random", "random mix", DEVICE_GCN, JOYBUS_FREQ_GCN_CONSOLE, 1, 1000, true, gcn_random_command},
+  {"n64-pif", "status + read per frame", DEVICE_N64, JOYBUS_FREQ_N64_CONSOLE, 2, FRAME_US, true, n64_pif_command},
+  {"n64-4khz", "overclocked reads", DEVICE_N64, JOYBUS_FREQ_N64_CONSOLE, 1, 250, false, n64_read_command},
+  {"n64-pak", "8 pak writes/reads per frame", DEVICE_N64, JOYBUS_FREQ_N64_CONSOLE, 8, FRAME_US, true, n64_pak_command},
+  {"n64-random", "random mix", DEVICE_N64, JOYBUS_FREQ_N64_CONSOLE, 1, 2000, true, n64_random_command},
+};
+
+#define PATTERN_COUNT (int)(sizeof(patterns) / sizeof(patterns[0]))
+
+// ---------------------------------------------------------------------------
+// Virtual console
+// ---------------------------------------------------------------------------
+
+static void start_command(struct trial *trial);
+
+static void transfer_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct trial *trial     = user_data;
+  struct outcome *outcome = &trial->outcomes[trial->count];
+
+  outcome->status = status;
+  memcpy(outcome->response, trial->response, sizeof(trial->response));
+
+  // Any difference from the reference run means the target didn't keep up
+  const struct outcome *expected = trial->reference ? &trial->reference[trial->count] : NULL;
+  if (expected && (expected->status != status || memcmp(expected->response, outcome->response, JOYBUS_BLOCK_SIZE)))
+    trial->failed = true;
+
+  trial->count++;
+  trial->done_ns = joybus_loopback_now_ns();
+
+  // The rest of the burst follows straight away
+  if (--trial->burst_remaining > 0) {
+    start_command(trial);
+  } else {
+    trial->busy = false;
+  }
+}
+
+static void start_command(struct trial *trial)
+{
+  trial->pattern->next_command(trial, &trial->command);
+  trial->index++;
+
+  memset(trial->response, 0, sizeof(trial->response));
+  int rc = joybus_transfer(JOYBUS(&trial->console_bus), trial->command.tx, trial->command.tx_len, trial->response,
+                           trial->command.rx_len, transfer_cb, trial);
+  if (rc < 0) {
+    trial->failed = true;
+    trial->busy   = false;
+  }
+}
+
+// Run a pattern with the given burst period, returns true if the target kept up
+static bool run_trial(struct trial *trial, uint32_t period_us, int bursts)
+{
+  const struct pattern *pattern = trial->pattern;
+
+  // Fresh buses and target, in the same state for every run
+  struct joybus_loopback_config console_config = joybus_loopback_config_default();
+  console_config.freq                          = pattern->console_freq;
+  struct joybus_loopback_config target_config = joybus_loopback_config_default();
+  target_config.handler_ns                     = handler_ns;
+  joybus_loopback_init(&trial->console_bus, console_config);
+  joybus_loopback_init(&trial->target_bus, target_config);
+  joybus_loopback_connect(&trial->console_bus, &trial->target_bus);
+
+  if (pattern->device == DEVICE_GCN) {
+    joybus_target_gcn_controller_init(&trial->gcn);
+    joybus_target_gcn_controller_input_valid(&trial->gcn, true);
+    trial->timed.target = JOYBUS_TARGET(&trial->gcn);
+  } else {
+    joybus_target_n64_controller_init(&trial->n64);
+    joybus_target_n64_rumble_pak_init(&trial->rumble);
+    joybus_target_n64_controller_attach_pak(&trial->n64, JOYBUS_TARGET_N64_PAK(&trial->rumble));
+    trial->timed.target = JOYBUS_TARGET(&trial->n64);
+  }
+
+  trial->timed.base.api      = &timed_api;
+  trial->timed.commands      = pattern->device == DEVICE_GCN ? gcn_commands : n64_commands;
+  trial->timed.command_count = pattern->device == DEVICE_GCN ? GCN_COMMAND_COUNT : N64_COMMAND_COUNT;
+  joybus_attach_target(JOYBUS(&trial->target_bus), JOYBUS_TARGET(&trial->timed));
+  joybus_enable(JOYBUS(&trial->console_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&trial->target_bus), JOYBUS_MODE_TARGET);
+
+  trial->rng_state = seed;
+  trial->index     = 0;
+  trial->count     = 0;
+  trial->busy      = false;
+  trial->failed    = false;
+
+  uint64_t next_ns = joybus_loopback_now_ns() + JOYBUS_INTER_TRANSFER_DELAY_US * 1000ULL;
+  trial->done_ns   = 0;
+
+  for (int i = 0; i < bursts && !trial->failed; i++) {
+    joybus_loopback_run_until(next_ns);
+
+    // The previous burst must be over, and the bus ready for the next one
+    if (trial->busy || next_ns < trial->done_ns + JOYBUS_INTER_TRANSFER_DELAY_US * 1000ULL) {
+      trial->failed = true;
+      break;
+    }
+
+    trial->busy            = true;
+    trial->burst_remaining = pattern->burst;
+    start_command(trial);
+
+    next_ns += period_us * 1000ULL;
+  }
+  joybus_loopback_run();
+
+  joybus_disable(JOYBUS(&trial->console_bus));
+  joybus_disable(JOYBUS(&trial->target_bus));
+
+  return !trial->failed;
+}
+
+// Find the shortest burst period the target keeps up with
+static uint32_t min_period_us(struct trial *trial, int bursts)
+{
+  uint32_t lo = 1, hi = REFERENCE_PERIOD_US;
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (run_trial(trial, mid, bursts)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  return hi;
+}
+
+int main(int argc, char **argv)
+{
+  int bursts = argc > 1 ? atoi(argv[1]) : 1000;
+  seed       = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+  handler_ns = argc > 3 ? strtoul(argv[3], NULL, 0) : HANDLER_NS;
+  if (bursts <= 0 || seed == 0) {
+    fprintf(stderr, "usage: %s [bursts] [seed] [handler_ns]\n", argv[0]);
+    return 1;
+  }
+
+  static struct handler_stats pattern_stats[PATTERN_COUNT][MAX_COMMANDS + 1];
+  int missed = 0;
+
+  printf("%-10s | %-28s | %-16s | %-13s |\n", "pattern", "description", "nominal", "max sustained");
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    const struct pattern *pattern = &patterns[p];
+
+    struct trial *trial     = calloc(1, sizeof(*trial));
+    struct outcome *ref     = calloc(bursts * pattern->burst, sizeof(struct outcome));
+    struct outcome *scratch = calloc(bursts * pattern->burst, sizeof(struct outcome));
+    trial->pattern          = pattern;
+
+    memset(handler_stats, 0, sizeof(handler_stats));
+
+    // Reference run, the target has all the time it needs
+    trial->outcomes  = ref;
+    trial->reference = NULL;
+    if (!run_trial(trial, REFERENCE_PERIOD_US, bursts)) {
+      fprintf(stderr, "%s: reference run failed\n", pattern->name);
+      free(scratch);
+      free(ref);
+      free(trial);
+      return 1;
+    }
+
+    trial->outcomes  = scratch;
+    trial->reference = ref;
+    bool nominal_ok  = run_trial(trial, pattern->period_us, bursts);
+    uint32_t period  = min_period_us(trial, bursts);
+    if (!nominal_ok && pattern->required)
+      missed++;
+
+    const char *result = nominal_ok ? "ok" : pattern->required ? "missed" : "over";
+    printf("%-10s | %-28s | %6.0f Hz %-6s | %10.0f Hz |\n", pattern->name, pattern->description,
+           pattern->burst * 1e6 / pattern->period_us, result, pattern->burst * 1e6 / period);
+
+    memcpy(pattern_stats[p], handler_stats, sizeof(handler_stats));
+
+    free(scratch);
+    free(ref);
+    free(trial);
+  }
+
+  // The maximum includes the host preempting the benchmark, the 99.9th percentile is a steadier worst case
+  printf("\n%-10s | %-16s | %8s | %-14s | %-24s |\n", "", "", "", "per byte (ns)", "per command (ns)");
+  printf("%-10s | %-16s | %8s | %14s | %11s %12s |\n", "pattern", "command", "count", "p99.9", "p99.9", "max");
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    const struct pattern *pattern       = &patterns[p];
+    const struct command_info *commands = pattern->device == DEVICE_GCN ? gcn_commands : n64_commands;
+    int count                           = pattern->device == DEVICE_GCN ? GCN_COMMAND_COUNT : N64_COMMAND_COUNT;
+
+    for (int i = 0; i <= count; i++) {
+      struct handler_stats *stats = &pattern_stats[p][i];
+      if (!stats->count)
+        continue;
+
+      char name[32];
+      if (i < count) {
+        snprintf(name, sizeof(name), "%s 0x%02X", device_names[pattern->device], commands[i].command);
+      } else {
+        snprintf(name, sizeof(name), "%s unsupported", device_names[pattern->device]);
+      }
+
+      uint64_t byte_ns    = histogram_quantile(stats->byte_hist, stats->bytes, stats->byte_max_ns, 0.999);
+      uint64_t command_ns = histogram_quantile(stats->command_hist, stats->completed, stats->command_max_ns, 0.999);
+      printf("%-10s | %-16s | %8u | %14llu | %11llu %12llu |\n", pattern->name, name, stats->count,
+             (unsigned long long)byte_ns, (unsigned long long)command_ns, (unsigned long long)stats->command_max_ns);
+    }
+  }
+
+  return missed ? 2 : 0;
+}
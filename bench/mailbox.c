@@ -0,0 +1,174 @@
+/*
+ * Mailbox publish-to-visible latency benchmark.
+ *
+ * A producer thread publishes timestamped GameCube input states to a mailbox,
+ * and a consumer thread spins taking them, standing in for input acquisition
+ * on one core and the Joybus interrupts on the other. The producer waits for
+ * each value to be taken, plus a random gap, before publishing the next one,
+ * so every value is measured. It reports the time from the start of each
+ * publish to the consumer holding the value.
+ *
+ * The threads are pinned to the given CPUs where supported, pin them to
+ * different physical cores for numbers comparable to a dual-core MCU. When
+ * both are given the same CPU, the host has a single CPU online, or a thread
+ * can't be pinned, the threads yield to each other instead of spinning, which
+ * mostly measures the scheduler.
+ *
+ * Usage: bench_mailbox [publishes] [producer cpu] [consumer cpu]
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <joybus/mailbox.h>
+#include <joybus/common/gcn_controller.h>
+
+// Random gap between a value being taken and the next publish
+#define PUBLISH_MAX_GAP_NS 20000ULL
+
+// A published value, an input state stamped with its publish time
+struct stamped_input {
+  uint64_t published_ns;
+  struct joybus_gcn_controller_state input;
+};
+
+static struct joybus_mailbox mailbox;
+static struct stamped_input slots[JOYBUS_MAILBOX_SLOTS];
+
+// Number of values taken so far, for the producer to wait on
+static _Atomic int taken;
+
+static int publishes;
+static uint64_t *latencies;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int producer_cpu, consumer_cpu;
+
+// Set when the threads may share a CPU, so a spinning thread has to yield for the other one to make progress
+static atomic_bool shared_cpu;
+
+// Pin the calling thread to a CPU, if possible, falling back to yielding if it can't be
+static void pin_thread(int cpu)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "warning: could not pin thread to cpu %d, yielding instead of spinning\n", cpu);
+    atomic_store(&shared_cpu, true);
+  }
+#endif
+}
+
+// Wait a little in a spin loop, yielding if the other thread needs this CPU to make progress
+static void spin_wait(void)
+{
+  if (atomic_load_explicit(&shared_cpu, memory_order_relaxed))
+    sched_yield();
+}
+
+static void *producer(void *arg)
+{
+  pin_thread(producer_cpu);
+
+  struct stamped_input value;
+  memset(&value, 0, sizeof(value));
+
+  uint32_t rng = 0x12345678;
+  for (int i = 0; i < publishes; i++) {
+    // Wait for the previous value to be taken, then a little longer
+    while (atomic_load_explicit(&taken, memory_order_acquire) != i)
+      spin_wait();
+    rng ^= rng << 13, rng ^= rng >> 17, rng ^= rng << 5;
+    uint64_t resume = now_ns() + rng % PUBLISH_MAX_GAP_NS;
+    while (now_ns() < resume)
+      ;
+
+    value.input.buttons = i;
+    value.published_ns  = now_ns();
+    joybus_mailbox_put(&mailbox, &value);
+  }
+
+  return NULL;
+}
+
+static void *consumer(void *arg)
+{
+  pin_thread(consumer_cpu);
+
+  struct stamped_input value;
+  for (int i = 0; i < publishes;) {
+    if (!joybus_mailbox_get(&mailbox, &value)) {
+      spin_wait();
+      continue;
+    }
+
+    latencies[i++] = now_ns() - value.published_ns;
+    atomic_store_explicit(&taken, i, memory_order_release);
+  }
+
+  return NULL;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+  publishes    = argc > 1 ? atoi(argv[1]) : 100000;
+  producer_cpu = argc > 2 ? atoi(argv[2]) : 0;
+  consumer_cpu = argc > 3 ? atoi(argv[3]) : 1;
+  if (publishes <= 0) {
+    fprintf(stderr, "usage: %s [publishes] [producer cpu] [consumer cpu]\n", argv[0]);
+    return 1;
+  }
+
+  // Spinning on a single CPU would starve the other thread
+  bool single_cpu = sysconf(_SC_NPROCESSORS_ONLN) < 2;
+  if (single_cpu && producer_cpu != consumer_cpu)
+    fprintf(stderr, "warning: only one cpu online, yielding instead of spinning\n");
+  if (single_cpu || producer_cpu == consumer_cpu)
+    atomic_store(&shared_cpu, true);
+
+  latencies = calloc(publishes, sizeof(*latencies));
+  if (!latencies)
+    return 1;
+
+  joybus_mailbox_init(&mailbox, slots, sizeof(slots[0]));
+
+  pthread_t threads[2];
+  pthread_create(&threads[1], NULL, consumer, NULL);
+  pthread_create(&threads[0], NULL, producer, NULL);
+  pthread_join(threads[0], NULL);
+  pthread_join(threads[1], NULL);
+
+  qsort(latencies, publishes, sizeof(*latencies), compare_u64);
+  printf("Mailbox publish-to-visible latency, %d publishes of %zu bytes, cpu %d -> cpu %d\n", publishes,
+         sizeof(struct stamped_input), producer_cpu, consumer_cpu);
+  printf("  min     %6llu ns\n", (unsigned long long)latencies[0]);
+  printf("  median  %6llu ns\n", (unsigned long long)latencies[publishes / 2]);
+  printf("  p99     %6llu ns\n", (unsigned long long)latencies[(uint64_t)publishes * 99 / 100]);
+  printf("  max     %6llu ns\n", (unsigned long long)latencies[publishes - 1]);
+
+  free(latencies);
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Capture replay benchmark.
+ *
+ * Replays a capture of console traffic against a fresh GameCube or N64
+ * controller target, and reports the time spent in the target's handler for
+ * each command, along with any responses that differ from the capture. Run
+ * it against the same capture with two library versions to compare them.
+ *
+ * Without a capture file, a synthetic session is recorded over the loopback
+ * backend first.
+ *
+ * Usage: bench_replay gcn|n64 [capture] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <joybus/bus.h>
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/target/capture.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+#define CAPTURE_SIZE  (1 << 20)
+
+// Commands in the synthetic session, and the gap between them
+#define SESSION_READS 2000
+#define POLL_US       1000
+
+// Handler times for one command byte
+struct command_stats {
+  uint64_t *samples;
+  int count;
+  int mismatches;
+};
+
+static struct command_stats stats[256];
+static int capacity;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void on_result(const struct joybus_capture_result *result, void *user_data)
+{
+  struct command_stats *s = &stats[result->record.command[0]];
+  if (!s->samples)
+    s->samples = calloc(capacity, sizeof(uint64_t));
+  if (s->count < capacity)
+    s->samples[s->count++] = result->handler_ns;
+  if (!result->match)
+    s->mismatches++;
+}
+
+// Send a command from the synthetic console and wait for it to complete
+static void console_send(struct joybus *bus, const uint8_t *command, uint8_t len, uint8_t response_len)
+{
+  static uint8_t response[JOYBUS_BLOCK_SIZE];
+
+  joybus_loopback_run_until(joybus_loopback_now_ns() + POLL_US * 1000ULL);
+  joybus_transfer(bus, command, len, response, response_len, NULL, NULL);
+  joybus_loopback_run();
+}
+
+// Record a synthetic session against a controller target
+static size_t record_session(bool gcn, struct joybus_target *target, uint8_t *capture)
+{
+  struct joybus_loopback console_bus, target_bus;
+  struct joybus_target_recorder recorder;
+
+  joybus_loopback_init(&console_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&console_bus, &target_bus);
+  joybus_target_recorder_init(&recorder, JOYBUS(&target_bus), target, capture, CAPTURE_SIZE);
+  joybus_attach_target(JOYBUS(&target_bus), JOYBUS_TARGET(&recorder));
+  joybus_enable(JOYBUS(&console_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+
+  struct joybus *bus              = JOYBUS(&console_bus);
+  static const uint8_t identify[] = {JOYBUS_CMD_IDENTIFY};
+  console_send(bus, identify, sizeof(identify), JOYBUS_CMD_IDENTIFY_RX);
+
+  if (gcn) {
+    static const uint8_t origin[] = {JOYBUS_CMD_GCN_READ_ORIGIN};
+    static const uint8_t read[]   = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+    console_send(bus, origin, sizeof(origin), JOYBUS_CMD_GCN_READ_ORIGIN_RX);
+    for (int i = 0; i < SESSION_READS; i++)
+      console_send(bus, read, sizeof(read), JOYBUS_CMD_GCN_READ_RX);
+  } else {
+    static const uint8_t read[] = {JOYBUS_CMD_N64_READ};
+    uint8_t pak_read[JOYBUS_CMD_N64_PAK_READ_TX];
+    uint16_t addr = 0x8000 | joybus_address_checksum(0x8000 >> 5);
+    pak_read[0]   = JOYBUS_CMD_N64_PAK_READ;
+    pak_read[1]   = addr >> 8;
+    pak_read[2]   = addr & 0xFF;
+
+    // Reads, with a pak probe every so often as games do
+    for (int i = 0; i < SESSION_READS; i++) {
+      console_send(bus, read, sizeof(read), JOYBUS_CMD_N64_READ_RX);
+      if (i % 64 == 0)
+        console_send(bus, pak_read, sizeof(pak_read), JOYBUS_CMD_N64_PAK_READ_RX);
+    }
+  }
+
+  joybus_disable(JOYBUS(&console_bus));
+  joybus_disable(JOYBUS(&target_bus));
+
+  return joybus_target_recorder_finish(&recorder);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+  bool gcn       = argc > 1 && strcmp(argv[1], "gcn") == 0;
+  int iterations = argc > 3 ? atoi(argv[3]) : 100;
+  if (argc < 2 || (!gcn && strcmp(argv[1], "n64") != 0) || iterations <= 0) {
+    fprintf(stderr, "usage: %s gcn|n64 [capture] [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  struct joybus_target_gcn_controller gcn_controller;
+  struct joybus_target_n64_controller n64_controller;
+  struct joybus_target_n64_rumble_pak rumble;
+
+  // Fresh controller target, in the state a console session starts from
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  joybus_target_n64_controller_init(&n64_controller);
+  joybus_target_n64_rumble_pak_init(&rumble);
+  joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble));
+  struct joybus_target *target = gcn ? JOYBUS_TARGET(&gcn_controller) : JOYBUS_TARGET(&n64_controller);
+
+  // Load the capture, or record one
+  uint8_t *capture = malloc(CAPTURE_SIZE);
+  size_t len;
+  if (argc > 2 && strcmp(argv[2], "-") != 0) {
+    FILE *file = fopen(argv[2], "rb");
+    if (!file) {
+      perror(argv[2]);
+      return 1;
+    }
+    len = fread(capture, 1, CAPTURE_SIZE, file);
+    fclose(file);
+  } else {
+    len = record_session(gcn, target, capture);
+  }
+
+  // Count the commands to size the sample buffers
+  struct joybus_capture_reader reader;
+  struct joybus_capture_record record;
+  if (joybus_capture_reader_init(&reader, capture, len) < 0) {
+    fprintf(stderr, "invalid capture\n");
+    return 1;
+  }
+  int commands = 0;
+  while (joybus_capture_reader_next(&reader, &record) > 0)
+    commands++;
+  capacity = commands * iterations;
+
+  // Replay from the same starting state each time
+  struct joybus_capture_replay_config config = {
+    .now_ns    = now_ns,
+    .on_result = on_result,
+  };
+
+  int mismatches = 0;
+  for (int i = 0; i < iterations; i++) {
+    joybus_target_gcn_controller_init(&gcn_controller);
+    joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+    joybus_target_n64_controller_init(&n64_controller);
+    joybus_target_n64_rumble_pak_init(&rumble);
+    joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble));
+
+    int rc = joybus_capture_replay(capture, len, target, &config);
+    if (rc < 0) {
+      fprintf(stderr, "invalid capture\n");
+      return 1;
+    }
+    mismatches += rc;
+  }
+
+  printf("%-8s | %8s | %8s %8s %8s %8s | %10s |\n", "command", "count", "min", "median", "p99", "max", "mismatches");
+  for (int cmd = 0; cmd < 256; cmd++) {
+    struct command_stats *s = &stats[cmd];
+    if (!s->count)
+      continue;
+
+    qsort(s->samples, s->count, sizeof(uint64_t), compare_u64);
+    printf("0x%02X     | %8d | %8llu %8llu %8llu %8llu | %10d |\n", cmd, s->count, (unsigned long long)s->samples[0],
+           (unsigned long long)s->samples[s->count / 2], (unsigned long long)s->samples[s->count * 99 / 100],
+           (unsigned long long)s->samples[s->count - 1], s->mismatches);
+    free(s->samples);
+  }
+
+  printf("handler times in ns, %d commands x %d iterations\n", commands, iterations);
+  free(capture);
+
+  return mismatches ? 2 : 0;
+}
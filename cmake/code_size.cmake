@@ -0,0 +1,116 @@
+# Per-function code size report
+#
+# Lists the size of each function in a set of object files, marking the ones
+# placed in RAM with JOYBUS_RAM_FUNC, with flash and RAM totals for each file.
+# Run in script mode:
+#
+#   cmake -DOBJDUMP=<objdump> -DRAM_SECTION=<section> -DTITLE=<title> -DOBJECTS=<objects> -P code_size.cmake
+#
+# where <objects> is a |-separated list of object files.
+#
+# Objects should be built with -ffunction-sections, so functions left in flash
+# land in sections of their own, and with JOYBUS_RAM_FUNC_SECTION set to
+# RAM_SECTION.
+
+cmake_minimum_required(VERSION "3.21")
+
+# Pad a value on the left or right to a fixed width
+function(pad OUT VALUE WIDTH SIDE)
+  string(LENGTH "${VALUE}" len)
+  set(padded "${VALUE}")
+  while(len LESS WIDTH)
+    if(SIDE STREQUAL "LEFT")
+      string(PREPEND padded " ")
+    else()
+      string(APPEND padded " ")
+    endif()
+    math(EXPR len "${len} + 1")
+  endwhile()
+  set(${OUT} "${padded}" PARENT_SCOPE)
+endfunction()
+
+message("${TITLE}")
+
+set(total_flash 0)
+set(total_ram 0)
+
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+foreach(object IN LISTS OBJECTS)
+  execute_process(COMMAND ${OBJDUMP} -t ${object} OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to read symbols from ${object}")
+  endif()
+
+  # Collect "size|name|memory" entries, with the size zero-padded so they sort by size
+  set(entries)
+  string(REPLACE "\n" ";" lines "${symbols}")
+  foreach(line IN LISTS lines)
+    # eg. "0000000000000000 l     F .text.handle_read	00000000000000a2 handle_read"
+    if(NOT line MATCHES "^[0-9a-f]+ ......F ([^ \t]+)\t([0-9a-f]+) (.+)$")
+      continue()
+    endif()
+
+    set(section "${CMAKE_MATCH_1}")
+    set(name "${CMAKE_MATCH_3}")
+    math(EXPR size "0x${CMAKE_MATCH_2}")
+    if(size EQUAL 0)
+      continue()
+    endif()
+
+    pad(sort_key "${size}" 8 LEFT)
+    string(REPLACE " " "0" sort_key "${sort_key}")
+    if(section STREQUAL RAM_SECTION)
+      list(APPEND entries "${sort_key}|${name}|ram")
+    else()
+      list(APPEND entries "${sort_key}|${name}|flash")
+    endif()
+  endforeach()
+
+  if(NOT entries)
+    continue()
+  endif()
+
+  # Print the file's functions, largest first
+  string(REGEX REPLACE "^.*/(src/.*\\.c)\\.o(bj)?$" "\\1" file "${object}")
+  message("")
+  message("  ${file}")
+
+  set(flash 0)
+  set(ram 0)
+  list(SORT entries COMPARE NATURAL ORDER DESCENDING)
+  foreach(entry IN LISTS entries)
+    string(REPLACE "|" ";" fields "${entry}")
+    list(GET fields 0 size)
+    list(GET fields 1 name)
+    list(GET fields 2 memory)
+    math(EXPR size "${size}")
+
+    if(memory STREQUAL "ram")
+      math(EXPR ram "${ram} + ${size}")
+      set(where "  ram")
+    else()
+      math(EXPR flash "${flash} + ${size}")
+      set(where "")
+    endif()
+
+    pad(name "${name}" 48 RIGHT)
+    pad(size "${size}" 6 LEFT)
+    message("    ${name} ${size}${where}")
+  endforeach()
+
+  pad(flash_text "${flash}" 6 LEFT)
+  pad(ram_text "${ram}" 6 LEFT)
+  message("    ------------------------------------------------ ------")
+  message("    flash                                            ${flash_text}")
+  message("    ram                                              ${ram_text}")
+
+  math(EXPR total_flash "${total_flash} + ${flash}")
+  math(EXPR total_ram "${total_ram} + ${ram}")
+endforeach()
+
+pad(total_flash "${total_flash}" 6 LEFT)
+pad(total_ram "${total_ram}" 6 LEFT)
+message("")
+message("  Total flash (bytes)                                ${total_flash}")
+message("  Total ram (bytes)                                  ${total_ram}")
+message("")
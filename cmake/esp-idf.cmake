@@ -13,7 +13,7 @@ else()
 endif()
 
 idf_component_register(
-  SRCS ${SOURCES} ${LIBJOYBUS_ROOT_DIR}/src/backend/esp32/joybus.c
+  SRCS ${SOURCES} ${LIBJOYBUS_ROOT_DIR}/src/backend/esp32/clock.c ${LIBJOYBUS_ROOT_DIR}/src/backend/esp32/joybus.c
   INCLUDE_DIRS ${LIBJOYBUS_ROOT_DIR}/include
   REQUIRES esp_driver_gpio esp_timer esp_hw_support
   PRIV_REQUIRES soc esp_rom ${JOYBUS_RMT_HAL_COMPONENT}
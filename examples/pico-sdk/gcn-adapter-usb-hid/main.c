@@ -196,6 +196,14 @@ int main(void)
   joybus_rp2xxx_init(&rp2xxx_bus, joybus_rp2xxx_config_default(JOYBUS_GPIO));
   joybus_enable(bus, JOYBUS_MODE_HOST);
 
+  // Resend a dropped read before giving up on the controller, and only look for one every 50ms on an empty port
+  struct joybus_retry_policy retry = joybus_retry_policy_default();
+  retry.timeout_retries            = 2;
+  retry.backoff_us                 = 100;
+  retry.breaker_threshold          = 8;
+  retry.breaker_cooldown_us        = 50000;
+  joybus_set_retry_policy(bus, &retry);
+
   // Poll for Joybus data and send HID reports at regular intervals
   struct repeating_timer poll_timer;
   add_repeating_timer_ms(POLL_INTERVAL, poll_task, NULL, &poll_timer);
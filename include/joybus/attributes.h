@@ -20,10 +20,16 @@
  * handler. Places it in RAM instead of executing it in place from flash, so
  * a flash fetch or cache miss cannot add latency to the response. A no-op
  * when JOYBUS_USE_RAM_FUNCS is 0, or on platforms that are not yet wired up.
+ *
+ * On other platforms, defining JOYBUS_RAM_FUNC_SECTION places these functions
+ * in the named section instead, which the code size report uses to tell them
+ * apart.
  */
 #if defined(ESP_PLATFORM) && JOYBUS_USE_RAM_FUNCS
 #include <esp_attr.h>
 #define JOYBUS_RAM_FUNC IRAM_ATTR
+#elif defined(JOYBUS_RAM_FUNC_SECTION) && JOYBUS_USE_RAM_FUNCS
+#define JOYBUS_RAM_FUNC __attribute__((section(JOYBUS_RAM_FUNC_SECTION)))
 #else
 #define JOYBUS_RAM_FUNC
 #endif
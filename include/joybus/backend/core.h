@@ -0,0 +1,281 @@
+/**
+ * @defgroup joybus_backend_core Backend Core
+ * @ingroup joybus_backends
+ *
+ * Portable bus state machine shared by the embedded backends.
+ *
+ * The core owns everything about a transfer that does not depend on the
+ * peripheral: the host and target states, the transfer context, reply and
+ * byte timeouts, the inter-transfer delay, and making sure each transfer
+ * completes exactly once. A backend provides a HAL with the peripheral
+ * primitives (start clocking out a command, listen for a command, send a
+ * reply), and reports peripheral events back to the core from its interrupt
+ * handlers with joybus_core_tx_done(), joybus_core_rx_byte() and
+ * joybus_core_rx_idle().
+ *
+ * When a target handler finishes a command without a reply, the core waits
+ * up to the reply timeout of the bus's timing profile, or
+ * JOYBUS_REPLY_TIMEOUT_US, for a deferred one before listening again,
+ * and starts sending it as soon as it arrives. A byte received while waiting
+ * abandons the reply, and the rest of the frame is dropped.
+ *
+ * The core only touches the peripheral through the HAL, so it runs unchanged
+ * on the build machine against a fake HAL.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+
+struct joybus_core;
+
+/**
+ * State of a backend core.
+ */
+enum joybus_core_state {
+  /// Not enabled
+  JOYBUS_CORE_DISABLED,
+
+  /// Host mode, ready for a transfer
+  JOYBUS_CORE_HOST_IDLE,
+
+  /// Host mode, waiting out the inter-transfer delay before clocking out a command
+  JOYBUS_CORE_HOST_WAIT,
+
+  /// Host mode, clocking out a command
+  JOYBUS_CORE_HOST_TX,
+
+  /// Host mode, receiving a reply
+  JOYBUS_CORE_HOST_RX,
+
+  /// Target mode, receiving a command
+  JOYBUS_CORE_TARGET_RX,
+
+  /// Target mode, dropping the rest of a command until the line goes idle
+  JOYBUS_CORE_TARGET_IGNORE,
+
+  /// Target mode, command received, waiting for the target to provide a deferred reply
+  JOYBUS_CORE_TARGET_DEFER,
+
+  /// Target mode, clocking out a reply
+  JOYBUS_CORE_TARGET_TX,
+};
+
+/**
+ * Peripheral primitives a backend provides to its core.
+ *
+ * Each operation is passed the Joybus instance, and reads the transfer
+ * context (buffers and lengths) from the core. Operations are called from
+ * interrupt context, and must not block except where noted.
+ */
+struct joybus_core_hal {
+  /**
+   * Enter host idle, stopping any reply capture.
+   */
+  void (*host_idle)(struct joybus *bus);
+
+  /**
+   * Start clocking out the command in `write_buf`, and arm reply capture if
+   * `read_len` is non-zero.
+   */
+  void (*host_start)(struct joybus *bus);
+
+  /**
+   * Start listening for a command, stopping any bulk receive. If await_idle is
+   * set, the line has to be idle for JOYBUS_BUS_IDLE_US first, which may
+   * busy-wait.
+   */
+  void (*target_listen)(struct joybus *bus, bool await_idle);
+
+  /**
+   * Receive the next `len` bytes of a command into `read_buf` from
+   * `read_count` on, without reporting each one, and call joybus_core_rx_bulk()
+   * once they have all arrived, eg. with a DMA transfer. Used when the target
+   * asks for the rest of a command with JOYBUS_TARGET_BULK(). Optional, if NULL
+   * the bytes are reported with joybus_core_rx_byte() as usual, and the core
+   * passes each one to the target.
+   */
+  void (*target_receive_bulk)(struct joybus *bus, uint8_t len);
+
+  /**
+   * Drop the rest of the command on the wire, and call joybus_core_rx_idle()
+   * once the line goes idle. Optional, if NULL the core calls target_listen()
+   * with await_idle set instead.
+   */
+  void (*target_ignore)(struct joybus *bus);
+
+  /**
+   * Stage the reply in `write_buf` as soon as the target provides it, so it
+   * can start with minimal latency. Optional.
+   */
+  void (*target_prepare_reply)(struct joybus *bus);
+
+  /**
+   * Start clocking out the staged reply.
+   */
+  void (*target_send_reply)(struct joybus *bus);
+
+  /**
+   * Time to wait for the first reply byte after a command, in microseconds,
+   * or 0 if the peripheral detects the line going idle and reports it with
+   * joybus_core_rx_idle(). Used when the transfer's timing profile doesn't set
+   * a reply timeout.
+   */
+  uint16_t reply_timeout_us;
+
+  /**
+   * Time to wait for each following byte, in microseconds, or 0 if the
+   * peripheral reports the line going idle. Used in target mode, and when the
+   * transfer's timing profile doesn't set a byte timeout.
+   */
+  uint16_t byte_timeout_us;
+
+  /**
+   * How early to wake up for a transfer started with joybus_core_transfer_at(),
+   * in microseconds. The core busy-waits out the rest in the alarm callback,
+   * so interrupt latency doesn't delay the command. Set to cover the alarm's
+   * worst-case latency, or 0 to start the command from the alarm itself.
+   */
+  uint16_t start_lead_us;
+};
+
+/**
+ * A backend core, embedded in each backend's private data.
+ */
+struct joybus_core {
+  /** The peripheral primitives for this core. */
+  const struct joybus_core_hal *hal;
+
+  /** The Joybus instance this core drives. */
+  struct joybus *bus;
+
+  /** Current state, one of joybus_core_state. */
+  volatile uint8_t state;
+
+  /** Command being sent in host mode, or reply being sent in target mode. */
+  const uint8_t *write_buf;
+
+  /** Length of write_buf. */
+  uint8_t write_len;
+
+  /** Reply buffer in host mode, or command buffer in target mode. */
+  uint8_t *read_buf;
+
+  /** Length of read_buf. */
+  uint8_t read_len;
+
+  /** Number of bytes received into read_buf so far. */
+  uint8_t read_count;
+
+  /** Number of bytes received when the target is next called, during a bulk receive. */
+  uint8_t bulk_end;
+
+  // Transfer state
+  joybus_transfer_cb done_callback;
+  void *done_user_data;
+  uint64_t last_transfer_us;
+  uint64_t start_us;
+  uint64_t first_byte_us;
+  uint64_t start_at_us;
+  uint16_t reply_timeout_us;
+  uint16_t byte_timeout_us;
+  struct joybus_alarm transfer_start_alarm;
+  struct joybus_alarm rx_timeout_alarm;
+};
+
+/**
+ * Initialize a backend core.
+ *
+ * @param core the core to initialize
+ * @param bus the Joybus instance the core drives
+ * @param hal the peripheral primitives
+ */
+void joybus_core_init(struct joybus_core *core, struct joybus *bus, const struct joybus_core_hal *hal);
+
+/**
+ * Check whether a core is enabled.
+ *
+ * @param core the core to check
+ * @return true if the core is enabled
+ */
+static inline bool joybus_core_enabled(const struct joybus_core *core)
+{
+  return core->state != JOYBUS_CORE_DISABLED;
+}
+
+/**
+ * Enter the resting state for the bus mode, once the peripheral is set up.
+ *
+ * Host mode enters host idle, target mode waits for the line to go idle and
+ * listens for a command.
+ *
+ * @param core the core to enable
+ */
+void joybus_core_enable(struct joybus_core *core);
+
+/**
+ * Disable a core, dropping any transfer in progress without calling back.
+ *
+ * Call before tearing down the peripheral, so late interrupts are ignored.
+ *
+ * @param core the core to disable
+ */
+void joybus_core_disable(struct joybus_core *core);
+
+/**
+ * Start a host transfer once the minimum gap of its timing profile has passed.
+ *
+ * Implements the transfer operation of the backend API.
+ *
+ * @return 0 on success, -JOYBUS_ERR_DISABLED or -JOYBUS_ERR_BUSY on failure
+ */
+int joybus_core_transfer(struct joybus_core *core, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
+                         uint8_t read_len, joybus_transfer_cb callback, void *user_data);
+
+/**
+ * Start a host transfer at the given time, or once the minimum gap of its
+ * timing profile has passed if that is later.
+ *
+ * Implements the transfer_at operation of the backend API.
+ *
+ * @return 0 on success, -JOYBUS_ERR_DISABLED or -JOYBUS_ERR_BUSY on failure
+ */
+int joybus_core_transfer_at(struct joybus_core *core, uint64_t at_us, const uint8_t *write_buf, uint8_t write_len,
+                            uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data);
+
+/**
+ * Report that the command or reply, including its stop bit, has been sent.
+ *
+ * @param core the core
+ */
+void joybus_core_tx_done(struct joybus_core *core);
+
+/**
+ * Report a received byte.
+ *
+ * @param core the core
+ * @param byte the byte that was received
+ */
+void joybus_core_rx_byte(struct joybus_core *core, uint8_t byte);
+
+/**
+ * Report the bytes requested with ::joybus_core_hal::target_receive_bulk as received.
+ *
+ * @param core the core
+ */
+void joybus_core_rx_bulk(struct joybus_core *core);
+
+/**
+ * Report the line going idle while receiving.
+ *
+ * @param core the core
+ */
+void joybus_core_rx_idle(struct joybus_core *core);
+
+/** @} */
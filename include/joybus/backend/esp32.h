@@ -13,10 +13,11 @@
 #include <stdint.h>
 
 #include <esp_intr_alloc.h>
-#include <esp_timer.h>
 #include <driver/gpio.h>
 
 #include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/backend/core.h>
 
 /**
  * Macro to cast a generic Joybus instance to an ESP32 Joybus instance.
@@ -25,8 +26,8 @@
 
 // Private implementation details - do not access directly
 struct joybus_esp32_data {
-  // Bus state
-  uint8_t state;
+  // Bus state machine
+  struct joybus_core core;
 
   // GPIO configuration
   gpio_num_t gpio;
@@ -47,22 +48,10 @@ struct joybus_esp32_data {
   // TARGET_REPLY_FLOOR_NS in CPU cycles, resolved once at enable
   uint32_t reply_floor_cycles;
 
-  // RX/TX state
-  uint8_t *read_buf;
-  uint8_t read_len;
-  uint8_t read_count;
+  // Peripheral RX/TX progress, the transfer context lives in the core
   uint8_t rx_skip;
-  const uint8_t *write_buf;
-  uint8_t write_len;
   uint8_t write_count;
-
-  // One-shot timer for inter-transfer gap scheduling
-  esp_timer_handle_t transfer_start_timer;
-
-  // Transfer state
-  joybus_transfer_cb done_callback;
-  void *done_user_data;
-  int64_t last_transfer_us;
+  uint32_t cmd_end_cycles;
 };
 
 /**
@@ -115,4 +104,14 @@ static inline struct joybus_esp32_config joybus_esp32_config_default(gpio_num_t
  */
 int joybus_esp32_init(struct joybus_esp32 *esp32_bus, struct joybus_esp32_config config);
 
+/**
+ * Get the ESP32 clock.
+ *
+ * Runs on esp_timer, with alarms fired from a single ISR-dispatched timer, and
+ * counts CPU cycles with the CPU cycle counter.
+ *
+ * @return the ESP32 clock, shared by all ESP32 Joybus instances, or NULL if the alarm timer could not be created
+ */
+struct joybus_clock *joybus_esp32_clock(void);
+
 /** @} */
@@ -14,9 +14,9 @@
 #include "em_timer.h"
 #include "em_usart.h"
 
-#include "sl_sleeptimer.h"
-
 #include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/backend/core.h>
 
 /**
  * Macro to cast a generic Joybus instance to a Gecko Joybus instance.
@@ -31,8 +31,8 @@
 
 // Private implementation details - do not access directly
 struct joybus_gecko_data {
-  // Bus state
-  uint8_t state;
+  // Bus state machine
+  struct joybus_core core;
 
   // GPIO configuration
   GPIO_Port_TypeDef gpio_port;
@@ -42,18 +42,8 @@ struct joybus_gecko_data {
   TIMER_TypeDef *rx_timer;
   USART_TypeDef *tx_usart;
 
-  // RX/TX state
-  uint8_t *read_buf;
-  uint8_t read_len;
-  uint8_t read_count;
-  uint8_t *write_buf;
-  uint8_t write_len;
+  // RX decode state
   bool rx_trailing_bit;
-  sl_sleeptimer_timer_handle_t rx_timeout_timer;
-
-  // Transfer state
-  joybus_transfer_cb done_callback;
-  void *done_user_data;
 
   // RX timings
   uint16_t pulse_period_half;
@@ -134,4 +124,14 @@ static inline struct joybus_gecko_config joybus_gecko_config_default(GPIO_Port_T
  */
 int joybus_gecko_init(struct joybus_gecko *gecko_bus, struct joybus_gecko_config config);
 
+/**
+ * Get the Gecko clock.
+ *
+ * Runs on the sleeptimer, so time has the resolution of the sleeptimer clock
+ * (about 30us with a 32.768kHz clock). There is no cycle counter.
+ *
+ * @return the Gecko clock, shared by all Gecko Joybus instances
+ */
+struct joybus_clock *joybus_gecko_clock(void);
+
 /** @} */
@@ -0,0 +1,199 @@
+/**
+ * @defgroup joybus_backend_loopback Loopback Backend
+ * @ingroup joybus_backends
+ *
+ * In-process Joybus backend for host builds, tests and benchmarks.
+ *
+ * A host-mode loopback instance is connected to a target-mode loopback
+ * instance, and transfers between them are simulated byte by byte with nominal
+ * wire timing on a virtual timeline shared by all loopback instances. Command
+ * bytes are delivered to the attached target as they would "arrive" on the
+ * wire, so host code and targets can be exercised together without hardware.
+ *
+ * Each command and response byte is read from its buffer as it starts on the
+ * wire, response bytes are reported to the per-byte receive callback as they
+ * arrive, and targets may defer their response until the reply timeout.
+ *
+ * Nothing happens in the background: joybus_loopback_run() and
+ * joybus_loopback_run_until() advance virtual time, delivering command bytes
+ * and firing completion callbacks along the way. Since nothing else advances
+ * time, the blocking `_sync` host functions cannot be used with this backend.
+ *
+ * Virtual time is kept by a @ref joybus_virtual_clock, so alarms scheduled on
+ * joybus_loopback_clock() fire in order with the bus events around them.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+
+/**
+ * Macro to cast a generic Joybus instance to a loopback Joybus instance.
+ */
+#define JOYBUS_LOOPBACK(bus) ((struct joybus_loopback *)(bus))
+
+struct joybus_loopback;
+
+// Private implementation details - do not access directly
+struct joybus_loopback_data {
+  // Bus state
+  uint8_t state;
+
+  // The instance on the other end of the wire
+  struct joybus_loopback *peer;
+
+  // Next enabled instance, for event scheduling
+  struct joybus_loopback *next;
+
+  // RX/TX state
+  uint8_t *read_buf;
+  uint8_t read_len;
+  uint8_t read_count;
+  const uint8_t *write_buf;
+  uint8_t write_len;
+  uint8_t write_count;
+
+  // Bytes currently on the wire, sampled from the buffers as each one starts
+  uint8_t tx_byte;
+  uint8_t rx_byte;
+
+  // Response staged by the peer's target
+  const uint8_t *response;
+  uint8_t response_len;
+  bool target_listening;
+  uint8_t target_bulk_end;
+  bool awaiting_response;
+  uint64_t command_end_ns;
+
+  // When the peer's target handler is free again, and when it committed the staged response
+  uint64_t target_busy_ns;
+  uint64_t response_ready_ns;
+
+  // Timeouts of the transfer in flight, and the default from the config
+  uint64_t reply_timeout_ns;
+  uint64_t byte_timeout_ns;
+  uint32_t default_timeout_us;
+
+  // Time a target needs after a transfer before it hears the next command
+  uint64_t recovery_ns;
+
+  // Virtual time each call into the target's handler takes
+  uint64_t handler_ns;
+
+  // Transfer state
+  joybus_transfer_cb done_callback;
+  void *done_user_data;
+  int done_status;
+  uint64_t event_ns;
+  uint64_t done_ns;
+
+  // Wire timestamps of the transfer in flight
+  uint64_t start_ns;
+  uint64_t first_byte_ns;
+};
+
+/**
+ * A loopback Joybus instance.
+ */
+struct joybus_loopback {
+  struct joybus base;
+  struct joybus_loopback_data data;
+};
+
+/**
+ * Configuration for a loopback Joybus instance.
+ */
+struct joybus_loopback_config {
+  /// Transmit frequency, in Hz
+  uint32_t freq;
+
+  /// How long to wait for a reply in host mode, in microseconds, unless the timing profile sets it
+  uint32_t reply_timeout_us;
+
+  /// In target mode, how long after a transfer the target misses commands, in microseconds. Simulates a device that
+  /// needs a longer gap between transfers than the host leaves.
+  uint32_t recovery_us;
+
+  /// In target mode, virtual time each call into the target's handler takes, in nanoseconds. A response committed
+  /// by a handler is only ready once the calls before it have returned, so slower targets reply later.
+  uint32_t handler_ns;
+};
+
+/**
+ * Build a loopback config with default values.
+ *
+ * @return a config with a nominal frequency and the standard reply timeout
+ */
+static inline struct joybus_loopback_config joybus_loopback_config_default(void)
+{
+  return (struct joybus_loopback_config){
+    .freq             = JOYBUS_FREQ_NOMINAL,
+    .reply_timeout_us = JOYBUS_REPLY_TIMEOUT_US,
+    .recovery_us      = 0,
+    .handler_ns       = 0,
+  };
+}
+
+/**
+ * Initialize a loopback Joybus instance.
+ *
+ * @param loopback_bus the loopback Joybus instance to initialize
+ * @param config the configuration to use, eg. from joybus_loopback_config_default()
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_loopback_init(struct joybus_loopback *loopback_bus, struct joybus_loopback_config config);
+
+/**
+ * Connect two loopback instances with a virtual wire.
+ *
+ * Commands sent by whichever instance is enabled in host mode are delivered to
+ * the target attached to the other instance, which must be enabled in target
+ * mode.
+ *
+ * @param a the first loopback instance
+ * @param b the second loopback instance
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_loopback_connect(struct joybus_loopback *a, struct joybus_loopback *b);
+
+/**
+ * Get the current virtual time.
+ *
+ * @return the virtual time, in nanoseconds
+ */
+uint64_t joybus_loopback_now_ns(void);
+
+/**
+ * Get the virtual clock shared by all loopback instances.
+ *
+ * This is also the `clock` of every loopback Joybus instance.
+ *
+ * @return the loopback clock
+ */
+struct joybus_clock *joybus_loopback_clock(void);
+
+/**
+ * Run until every enabled loopback instance is idle.
+ *
+ * Completion callbacks that start new transfers and pending alarms keep the
+ * simulation running, use joybus_loopback_run_until() to drive a poller or
+ * alarm that never stops.
+ *
+ * @return the number of transfers completed
+ */
+int joybus_loopback_run(void);
+
+/**
+ * Run until the given virtual time, processing every event due before it.
+ *
+ * @param time_ns the virtual time to advance to, in nanoseconds
+ * @return the number of transfers completed
+ */
+int joybus_loopback_run_until(uint64_t time_ns);
+
+/** @} */
@@ -10,9 +10,10 @@
 #pragma once
 
 #include <hardware/pio.h>
-#include <pico/time.h>
 
 #include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/backend/core.h>
 
 /**
  * Macro to cast a generic Joybus instance to a RP2xxx Joybus instance.
@@ -21,8 +22,8 @@
 
 // Private implementation details - do not access directly
 struct joybus_rp2xxx_data {
-  // Bus state
-  uint8_t state;
+  // Bus state machine
+  struct joybus_core core;
 
   // GPIO configuration
   uint gpio;
@@ -36,19 +37,8 @@ struct joybus_rp2xxx_data {
   uint dma_chan_tx;
   uint dma_chan_rx;
 
-  // RX/TX state
-  uint8_t *read_buf;
-  uint8_t read_len;
-  uint8_t read_count;
-  uint8_t *write_buf;
-  uint8_t write_len;
-  alarm_id_t rx_timeout_alarm;
-
-  // Transfer state
-  joybus_transfer_cb done_callback;
-  void *done_user_data;
-  absolute_time_t last_transfer_time;
-  alarm_id_t transfer_start_alarm;
+  // Set while the RX DMA channel is taking a bulk receive
+  bool rx_bulk;
 };
 
 /**
@@ -97,4 +87,14 @@ static inline struct joybus_rp2xxx_config joybus_rp2xxx_config_default(uint8_t g
  */
 int joybus_rp2xxx_init(struct joybus_rp2xxx *rp2xxx_bus, struct joybus_rp2xxx_config config);
 
+/**
+ * Get the RP2xxx clock.
+ *
+ * Runs on the microsecond timer, with alarms fired from the pico_time default
+ * alarm pool. There is no cycle counter.
+ *
+ * @return the RP2xxx clock, shared by all RP2xxx Joybus instances
+ */
+struct joybus_clock *joybus_rp2xxx_clock(void);
+
 /** @} */
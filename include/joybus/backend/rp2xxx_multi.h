@@ -0,0 +1,170 @@
+/**
+ * @defgroup joybus_backend_rp2xxx_multi RP2xxx Multi-Port Host
+ * @ingroup joybus_backends
+ *
+ * Raspberry Pi RP2040/RP2350 host engine polling several ports in lockstep.
+ *
+ * One PIO state machine drives up to JOYBUS_RP2XXX_MULTI_MAX_PORTS data lines
+ * on consecutive GPIOs, sending the same command bit on every line at once
+ * and sampling every line for the replies. A GameCube read on four ports
+ * takes about the bus time of one read, instead of four.
+ *
+ * Commands are transposed into pin words with joybus_bitslice_transpose(),
+ * and the sampled lines are untransposed and decoded per port with
+ * joybus_bitslice_untranspose() and joybus_bitslice_decode(), in the RX DMA
+ * interrupt. Each port's reply is decoded independently, so controllers
+ * don't need to reply in step.
+ *
+ * The engine is separate from the regular RP2xxx buses and needs a PIO
+ * instance of its own.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <hardware/pio.h>
+
+#include <joybus/bitslice.h>
+#include <joybus/bus.h>
+
+/// Maximum number of ports, limited by the PIO set instruction
+#define JOYBUS_RP2XXX_MULTI_MAX_PORTS      4
+
+/// Longest command, in bytes
+#ifndef JOYBUS_RP2XXX_MULTI_MAX_WRITE
+#define JOYBUS_RP2XXX_MULTI_MAX_WRITE      3
+#endif
+
+/// Longest reply, in bytes
+#ifndef JOYBUS_RP2XXX_MULTI_MAX_READ
+#define JOYBUS_RP2XXX_MULTI_MAX_READ       10
+#endif
+
+/// Longest target turnaround to wait for, in bit times
+#ifndef JOYBUS_RP2XXX_MULTI_TURNAROUND_BITS
+#define JOYBUS_RP2XXX_MULTI_TURNAROUND_BITS 16
+#endif
+
+/// Number of line samples for the longest reply
+#define JOYBUS_RP2XXX_MULTI_SAMPLES \
+  JOYBUS_BITSLICE_SAMPLES(JOYBUS_RP2XXX_MULTI_MAX_READ, JOYBUS_RP2XXX_MULTI_TURNAROUND_BITS)
+
+struct joybus_rp2xxx_multi;
+
+/**
+ * Function type for multi-port transfer completion callbacks.
+ *
+ * Called from the RX DMA interrupt once every port's reply has been decoded.
+ *
+ * @param multi the engine the transfer ran on
+ * @param statuses for each port, 0 on success or -JOYBUS_ERR_TIMEOUT if the port didn't reply in full
+ * @param user_data the user_data passed to joybus_rp2xxx_multi_transfer()
+ */
+typedef void (*joybus_rp2xxx_multi_cb)(struct joybus_rp2xxx_multi *multi, const int *statuses, void *user_data);
+
+// Private implementation details - do not access directly
+struct joybus_rp2xxx_multi_data {
+  // GPIO configuration
+  uint gpio;
+  uint8_t ports;
+
+  // PIO instance and state machine
+  PIO pio;
+  uint pio_sm;
+  uint pio_offset;
+
+  // DMA channels feeding pin words and draining samples
+  uint dma_chan_tx;
+  uint dma_chan_rx;
+
+  // Whether the engine is enabled, and whether a transfer is in flight
+  bool enabled;
+  volatile bool busy;
+
+  // Transfer in flight
+  uint8_t *read_bufs[JOYBUS_RP2XXX_MULTI_MAX_PORTS];
+  uint8_t read_len;
+  uint16_t num_samples;
+  joybus_rp2xxx_multi_cb callback;
+  void *user_data;
+
+  // Pin words for the command, line samples and per-port sample streams for the reply
+  uint8_t words[JOYBUS_RP2XXX_MULTI_MAX_WRITE * 8];
+  uint8_t samples[JOYBUS_RP2XXX_MULTI_SAMPLES];
+  uint8_t streams[JOYBUS_RP2XXX_MULTI_MAX_PORTS][JOYBUS_RP2XXX_MULTI_SAMPLES / 8];
+  int statuses[JOYBUS_RP2XXX_MULTI_MAX_PORTS];
+};
+
+/**
+ * A RP2xxx multi-port host engine.
+ */
+struct joybus_rp2xxx_multi {
+  struct joybus_rp2xxx_multi_data data;
+};
+
+/**
+ * Configuration for a RP2xxx multi-port host engine.
+ */
+struct joybus_rp2xxx_multi_config {
+  /// First GPIO pin, port N uses GPIO `gpio + N`
+  uint8_t gpio;
+
+  /// Number of ports, up to JOYBUS_RP2XXX_MULTI_MAX_PORTS
+  uint8_t ports;
+
+  /// PIO instance to use, not shared with regular RP2xxx buses (eg. pio1)
+  PIO pio;
+
+  /// Transmit frequency, in Hz
+  uint32_t freq;
+};
+
+/**
+ * Build a RP2xxx multi-port config with default values.
+ *
+ * @param gpio the first GPIO pin
+ * @param ports the number of ports
+ * @return a config with the given pins, the pio1 instance, and a nominal frequency
+ */
+static inline struct joybus_rp2xxx_multi_config joybus_rp2xxx_multi_config_default(uint8_t gpio, uint8_t ports)
+{
+  return (struct joybus_rp2xxx_multi_config){
+    .gpio  = gpio,
+    .ports = ports,
+    .pio   = pio1,
+    .freq  = JOYBUS_FREQ_NOMINAL,
+  };
+}
+
+/**
+ * Initialize and enable a RP2xxx multi-port host engine.
+ *
+ * @param multi the engine to initialize
+ * @param config the configuration to use, eg. from joybus_rp2xxx_multi_config_default()
+ * @return 0 on success, -JOYBUS_ERR_INVALID if the port count is out of range
+ */
+int joybus_rp2xxx_multi_init(struct joybus_rp2xxx_multi *multi, struct joybus_rp2xxx_multi_config config);
+
+/**
+ * Send a command on every port at once, and read the replies.
+ *
+ * Every port sends a command of the same length, and expects a reply of the
+ * same length.
+ *
+ * @param multi the engine to use
+ * @param write_bufs the command for each port
+ * @param write_len the length of each command, up to JOYBUS_RP2XXX_MULTI_MAX_WRITE
+ * @param read_bufs a buffer for each port's reply
+ * @param read_len the length of each reply, up to JOYBUS_RP2XXX_MULTI_MAX_READ
+ * @param callback called when every reply has been decoded
+ * @param user_data passed to the callback
+ * @return 0 if the transfer started, -JOYBUS_ERR_DISABLED if the engine isn't initialized, -JOYBUS_ERR_BUSY if a
+ *         transfer is in flight, -JOYBUS_ERR_INVALID for an empty command, or -JOYBUS_ERR_NO_SPACE if a command or
+ *         reply is too long
+ */
+int joybus_rp2xxx_multi_transfer(struct joybus_rp2xxx_multi *multi, const uint8_t *const write_bufs[],
+                                 uint8_t write_len, uint8_t *const read_bufs[], uint8_t read_len,
+                                 joybus_rp2xxx_multi_cb callback, void *user_data);
+
+/** @} */
@@ -0,0 +1,90 @@
+/**
+ * @defgroup joybus_bitslice Bit Slicing
+ * @ingroup joybus
+ *
+ * Bit-slicing kernels for driving several Joybus ports in lockstep.
+ *
+ * A backend that drives up to JOYBUS_BITSLICE_MAX_PORTS data lines from one
+ * engine, eg. a single PIO state machine on consecutive pins, sends the same
+ * bit position of every port's command at once. Commands are transposed into
+ * pin words, one per bit time with bit `p` holding port `p`'s bit, and the
+ * engine clocks them out with the usual Joybus pulse timing.
+ *
+ * Targets don't reply in lockstep, each one starts after its own turnaround
+ * and runs off its own clock. The engine oversamples all lines at
+ * JOYBUS_BITSLICE_OVERSAMPLE samples per bit instead, and the samples are
+ * untransposed back into one sample stream per port and decoded
+ * independently, resynchronizing on the falling edge of every bit.
+ *
+ * All kernels are portable C, see `bench/bitslice.c` for their cost.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/// Maximum number of ports driven in lockstep, one bit of each pin word
+#define JOYBUS_BITSLICE_MAX_PORTS  8
+
+/// Number of line samples taken per bit when receiving, enough to decode targets running 10% off the nominal rate
+#define JOYBUS_BITSLICE_OVERSAMPLE 8
+
+/**
+ * Number of line samples needed to receive a reply.
+ *
+ * Covers the reply and its stop bit, plus up to @p turnaround_bits bit times
+ * before the target starts replying. Rounded up to a multiple of 8, the
+ * sample streams are untransposed 8 samples at a time.
+ *
+ * @param len the number of bytes in the reply
+ * @param turnaround_bits the longest turnaround to wait for, in bit times
+ */
+#define JOYBUS_BITSLICE_SAMPLES(len, turnaround_bits) \
+  ((((len) * 8 + 1 + (turnaround_bits)) * JOYBUS_BITSLICE_OVERSAMPLE + 7) & ~7)
+
+/**
+ * Transpose per-port bytes into pin words.
+ *
+ * Word `i` holds bit `7 - i % 8` of byte `i / 8` of every port, in bit `p`
+ * for port `p`, so words come out in transmit order, MSB first. Bits of
+ * ports at or above @p ports are zero.
+ *
+ * @param bytes a buffer of @p len bytes for each port
+ * @param ports the number of ports, up to JOYBUS_BITSLICE_MAX_PORTS
+ * @param len the number of bytes per port
+ * @param words buffer for `len * 8` pin words
+ */
+void joybus_bitslice_transpose(const uint8_t *const bytes[], uint8_t ports, uint8_t len, uint8_t *words);
+
+/**
+ * Untranspose pin words back into per-port bytes.
+ *
+ * The inverse of joybus_bitslice_transpose(): bit `p` of word `i` lands in
+ * bit `7 - i % 8` of byte `i / 8` of port `p`. Used on sampled lines, each
+ * port gets its stream of samples packed MSB first.
+ *
+ * @param words `len * 8` pin words
+ * @param ports the number of ports, up to JOYBUS_BITSLICE_MAX_PORTS
+ * @param len the number of bytes per port
+ * @param bytes a buffer of @p len bytes for each port
+ */
+void joybus_bitslice_untranspose(const uint8_t *words, uint8_t ports, uint8_t len, uint8_t *const bytes[]);
+
+/**
+ * Decode a reply from a port's oversampled line.
+ *
+ * Finds each bit by its falling edge and reads the line in the middle of the
+ * bit, so the target's turnaround and bit rate don't need to match the
+ * sampling clock.
+ *
+ * @param samples the port's line samples, JOYBUS_BITSLICE_OVERSAMPLE per bit, packed MSB first
+ * @param num_samples the number of samples
+ * @param reply buffer for the reply
+ * @param len the number of bytes expected
+ * @return the number of complete bytes decoded, less than @p len if the samples ran out
+ */
+uint8_t joybus_bitslice_decode(const uint8_t *samples, uint16_t num_samples, uint8_t *reply, uint8_t len);
+
+/** @} */
@@ -0,0 +1,89 @@
+/**
+ * @defgroup joybus_buffer_pool Buffer Pool
+ * @ingroup joybus
+ *
+ * Command and response buffers shared by several Joybus instances.
+ *
+ * Available when the build defines `JOYBUS_USE_BUFFER_POOL=1`. Instead of
+ * embedding its own buffers, each Joybus instance leases a
+ * ::joybus_buffers from its pool: a host-mode instance one per command slot,
+ * for as long as a host function is prepared or in flight, and a target-mode
+ * instance one while it is enabled. An 8-port host that polls its ports one
+ * after another needs a single buffer, or two to prepare each poll while the
+ * previous one is on the wire.
+ *
+ * When the pool is exhausted, host functions and joybus_enable() fail with
+ * `-JOYBUS_ERR_NO_SPACE`. Transfers with caller-provided buffers, such as
+ * joybus_transfer(), don't need a lease.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <joybus/bus.h>
+
+#if JOYBUS_USE_BUFFER_POOL
+
+/// Maximum number of buffers in a pool
+#define JOYBUS_BUFFER_POOL_MAX 32
+
+/**
+ * A pool of buffers.
+ */
+struct joybus_buffer_pool {
+  /// The buffers in the pool
+  struct joybus_buffers *buffers;
+
+  /// Number of buffers in the pool
+  uint8_t count;
+
+  /// Bitmask of the buffers not currently leased
+  uint32_t free_mask;
+};
+
+/**
+ * Initialize a buffer pool.
+ *
+ * @param pool the pool to initialize
+ * @param buffers the buffers to share, which must stay valid while the pool is in use
+ * @param count the number of buffers, up to JOYBUS_BUFFER_POOL_MAX
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_buffer_pool_init(struct joybus_buffer_pool *pool, struct joybus_buffers *buffers, uint8_t count);
+
+/**
+ * Get the number of buffers not currently leased.
+ *
+ * @param pool the pool to check
+ * @return the number of free buffers
+ */
+uint8_t joybus_buffer_pool_available(const struct joybus_buffer_pool *pool);
+
+/**
+ * Attach a buffer pool to a Joybus instance.
+ *
+ * Drops the instance's hold on any buffers and makes it take them from the
+ * pool instead. No buffers are leased here: each command slot leases one when
+ * a host command is built, and an instance enabled in target mode leases one
+ * for received commands until it's disabled.
+ *
+ * Call after initializing the backend, and before enabling the instance.
+ *
+ * @param bus the Joybus instance
+ * @param pool the pool to lease from
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_attach_buffer_pool(struct joybus *bus, struct joybus_buffer_pool *pool);
+
+// Take a free buffer from a pool, or NULL if it is exhausted, the caller holds the clock lock - internal use only
+struct joybus_buffers *joybus_buffer_pool_take(struct joybus_buffer_pool *pool);
+
+// Return a buffer to its pool, the caller holds the clock lock - internal use only
+void joybus_buffer_pool_give(struct joybus_buffer_pool *pool, struct joybus_buffers *buffers);
+
+#endif
+
+/** @} */
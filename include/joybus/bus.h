@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include <joybus/clock.h>
+#include <joybus/errors.h>
 #include <joybus/target.h>
 
 struct joybus;
@@ -43,10 +46,10 @@ struct joybus;
 /// Joybus frequency of a GameCube Game Boy Advance cable (DOL-011).
 #define JOYBUS_FREQ_GCN_GBA_CABLE       262144 // CPU-AGB @ 16.777216MHz / 64
 
-/// Minimum delay between Joybus transfers, in microseconds
+/// Default minimum delay between Joybus transfers, in microseconds, see joybus_timing
 #define JOYBUS_INTER_TRANSFER_DELAY_US  80
 
-/// Timeout for waiting for a reply from a target, in microseconds
+/// Default timeout for waiting for a reply from a target, in microseconds, see joybus_timing
 #define JOYBUS_REPLY_TIMEOUT_US         64
 
 /// Minimum line-high time to consider the bus idle, in microseconds
@@ -58,6 +61,70 @@ struct joybus;
 /// Size of a Joybus N64 pak read/write block
 #define JOYBUS_PAK_BLOCK_SIZE           32
 
+/**
+ * Size of the command buffer of each Joybus instance, in bytes.
+ *
+ * Holds commands built by the host functions, one per command slot, and
+ * commands received in target mode. Override to shrink per-bus RAM when only
+ * short commands are used, eg. 3 for GameCube controllers. Host functions that
+ * need a larger buffer fail with `-JOYBUS_ERR_NO_SPACE`, and longer commands
+ * received in target mode are ignored. N64 pak writes need 35 bytes.
+ */
+#ifndef JOYBUS_COMMAND_BUFFER_SIZE
+#define JOYBUS_COMMAND_BUFFER_SIZE      JOYBUS_BLOCK_SIZE
+#endif
+
+/**
+ * Size of the response buffer of each Joybus instance, in bytes.
+ *
+ * Holds responses that the host functions decode before handing them over,
+ * which need 8 bytes for GameCube controller reads and 33 bytes for the N64
+ * rumble pak functions. Override to shrink per-bus RAM.
+ */
+#ifndef JOYBUS_RESPONSE_BUFFER_SIZE
+#define JOYBUS_RESPONSE_BUFFER_SIZE     JOYBUS_BLOCK_SIZE
+#endif
+
+#if JOYBUS_COMMAND_BUFFER_SIZE < 3 || JOYBUS_COMMAND_BUFFER_SIZE > JOYBUS_BLOCK_SIZE
+#error "JOYBUS_COMMAND_BUFFER_SIZE must be between 3 and JOYBUS_BLOCK_SIZE"
+#endif
+
+#if JOYBUS_RESPONSE_BUFFER_SIZE < 8 || JOYBUS_RESPONSE_BUFFER_SIZE > JOYBUS_BLOCK_SIZE
+#error "JOYBUS_RESPONSE_BUFFER_SIZE must be between 8 and JOYBUS_BLOCK_SIZE"
+#endif
+
+/**
+ * Whether Joybus instances lease their command and response buffers from a
+ * shared pool, instead of embedding their own. Disabled by default.
+ *
+ * A host-mode instance only holds buffers while a host function is prepared or
+ * in flight, one set per command slot, and a target-mode instance holds them
+ * while enabled, so a multi-port host only needs as many buffers as it has
+ * transfers prepared or in flight at once. See
+ * joybus_attach_buffer_pool(). Must be set the same way for the whole build.
+ */
+#ifndef JOYBUS_USE_BUFFER_POOL
+#define JOYBUS_USE_BUFFER_POOL          0
+#endif
+
+/**
+ * Number of command slots of each Joybus instance in host mode, 1 or 2.
+ *
+ * Each host function builds its command in a slot of its own, so with two
+ * slots the next command can be fully prepared while the previous one is still
+ * on the wire. It is queued, and starts as soon as the inter-transfer delay
+ * after the previous transfer has passed. Set to 1 to save a set of buffers
+ * per instance, host functions then fail with `-JOYBUS_ERR_BUSY` while another
+ * is in flight.
+ */
+#ifndef JOYBUS_COMMAND_SLOTS
+#define JOYBUS_COMMAND_SLOTS            2
+#endif
+
+#if JOYBUS_COMMAND_SLOTS < 1 || JOYBUS_COMMAND_SLOTS > 2
+#error "JOYBUS_COMMAND_SLOTS must be 1 or 2"
+#endif
+
 /**
  * Macro to cast a backend-specific Joybus instance to a generic Joybus instance.
  */
@@ -87,14 +154,72 @@ enum joybus_mode {
  */
 typedef void (*joybus_transfer_cb)(struct joybus *bus, int status, void *user_data);
 
+/**
+ * Function type for per-byte receive callbacks.
+ *
+ * Invoked in host mode as each response byte lands in the read buffer, before
+ * the transfer completes. Runs in interrupt context on most backends, and must
+ * return well within one byte time.
+ *
+ * @param bus the Joybus associated with the transfer
+ * @param idx the index of the byte that was just received
+ * @param user_data the user_data passed to joybus_set_rx_byte_cb()
+ */
+typedef void (*joybus_rx_byte_cb)(struct joybus *bus, uint8_t idx, void *user_data);
+
 // API for a Joybus backend - internal use only
 struct joybus_api {
   int (*enable)(struct joybus *bus);
   int (*disable)(struct joybus *bus);
   int (*transfer)(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
                   joybus_transfer_cb callback, void *user_data);
+  int (*transfer_at)(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf, uint8_t write_len,
+                     uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data);
 };
 
+/**
+ * The only backend in the build, to call it directly instead of through the
+ * API of each instance. Unset by default.
+ *
+ * Define as the backend's function prefix (`rp2xxx`, `esp32`, `gecko` or
+ * `loopback`) when a build only links one backend. joybus_enable(),
+ * joybus_transfer() and the other bus functions then make direct calls into
+ * it, which the compiler can inline, and with LTO fold the host functions into
+ * the backend's transfer entry. Leave unset for builds with several backends.
+ * Must be set the same way for the whole build.
+ *
+ * Every bus passed to the bus functions must then have been initialized by
+ * that backend. A bus with any other API, such as a test double, would be
+ * driven as if it belonged to the static backend, so debug builds assert()
+ * that it doesn't happen.
+ */
+#ifdef JOYBUS_STATIC_BACKEND
+#define JOYBUS_BACKEND_FUNC_(backend, func) joybus_##backend##_##func
+#define JOYBUS_BACKEND_FUNC(backend, func)  JOYBUS_BACKEND_FUNC_(backend, func)
+
+// Call a backend API function, checking that the bus belongs to the static backend - internal use only
+#define JOYBUS_BACKEND_CALL(bus, func) \
+  (assert((bus)->api == &JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, api)), \
+   JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, func))
+
+// Linkage of the backend API, visible to the bus functions - internal use only
+#define JOYBUS_BACKEND_API
+
+extern const struct joybus_api JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, api);
+int JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, enable)(struct joybus *bus);
+int JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, disable)(struct joybus *bus);
+int JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, transfer)(struct joybus *bus, const uint8_t *write_buf,
+                                                         uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
+                                                         joybus_transfer_cb callback, void *user_data);
+int JOYBUS_BACKEND_FUNC(JOYBUS_STATIC_BACKEND, transfer_at)(struct joybus *bus, uint64_t at_us,
+                                                            const uint8_t *write_buf, uint8_t write_len,
+                                                            uint8_t *read_buf, uint8_t read_len,
+                                                            joybus_transfer_cb callback, void *user_data);
+#else
+#define JOYBUS_BACKEND_CALL(bus, func) (bus)->api->func
+#define JOYBUS_BACKEND_API             static
+#endif
+
 struct joybus_host_op {
   joybus_transfer_cb callback;
   void *user_data;
@@ -102,6 +227,158 @@ struct joybus_host_op {
   uint8_t arg;
 };
 
+/**
+ * Command and response buffers for one Joybus instance.
+ */
+struct joybus_buffers {
+  /** Command buffer. */
+  uint8_t command[JOYBUS_COMMAND_BUFFER_SIZE];
+
+  /** Response buffer. */
+  uint8_t response[JOYBUS_RESPONSE_BUFFER_SIZE];
+};
+
+#if JOYBUS_USE_BUFFER_POOL
+struct joybus_buffer_pool;
+#endif
+
+// State of a command slot - internal use only
+enum joybus_command_slot_state {
+  JOYBUS_COMMAND_SLOT_FREE,
+  JOYBUS_COMMAND_SLOT_PREPARING,
+  JOYBUS_COMMAND_SLOT_QUEUED,
+  JOYBUS_COMMAND_SLOT_ACTIVE,
+  JOYBUS_COMMAND_SLOT_COMPLETING,
+};
+
+// A host function's command and the transfer built from it - internal use only
+struct joybus_command_slot {
+  struct joybus_buffers *buffers;
+  struct joybus_host_op op;
+  joybus_transfer_cb callback;
+  void *user_data;
+  uint8_t *read_buf;
+  uint8_t write_len;
+  uint8_t read_len;
+  uint8_t seq;
+  uint8_t state;
+  uint8_t timeout_retries;
+  uint8_t checksum_retries;
+};
+
+/**
+ * Timing profile for host transfers.
+ *
+ * The defaults suit any OEM device, but many devices accept a much shorter gap
+ * between transfers, and a poll of an empty port doesn't need to wait as long
+ * for a reply that never comes. A profile can be set for a bus, and so for the
+ * device attached to it, with joybus_set_timing(), or for a single transfer
+ * with joybus_transfer_timed(). joybus_calibrate_gap() measures the shortest
+ * gap a device reliably accepts.
+ */
+struct joybus_timing {
+  /** Minimum gap between the end of the previous transfer and the start of this one, in microseconds. */
+  uint16_t min_gap_us;
+
+  /**
+   * Time to wait for the first reply byte after the command, in microseconds, or 0 for the backend default. In
+   * target mode, how long to wait for a deferred reply, or 0 for JOYBUS_REPLY_TIMEOUT_US.
+   */
+  uint16_t reply_timeout_us;
+
+  /** Time to wait for each following reply byte, in microseconds, or 0 for the backend default. */
+  uint16_t byte_timeout_us;
+};
+
+/**
+ * Get the default timing profile.
+ *
+ * @return a profile with the standard inter-transfer delay, and the backend's default timeouts
+ */
+static inline struct joybus_timing joybus_timing_default(void)
+{
+  return (struct joybus_timing){
+    .min_gap_us       = JOYBUS_INTER_TRANSFER_DELAY_US,
+    .reply_timeout_us = 0,
+    .byte_timeout_us  = 0,
+  };
+}
+
+/**
+ * Retry policy for the host functions.
+ *
+ * A dropped or garbled reply is usually a one-off, so resending the command
+ * recovers in a transfer or two instead of a full re-identify. Timeouts are
+ * resent with an extra gap that doubles each time, to let a busy device catch
+ * up, and checksum errors are resent straight away. Retries run in
+ * transfer-completion context, the host function's callback only runs once
+ * they are used up.
+ *
+ * The circuit breaker stops polling an empty port from eating bus time. Once
+ * `breaker_threshold` host functions in a row have timed out, host functions
+ * fail straight away with `-JOYBUS_ERR_NO_DEVICE`, and only one is let through
+ * every `breaker_cooldown_us`, without retries, to look for a device. Any
+ * reply closes the breaker again.
+ *
+ * Applies to the host functions, not to raw joybus_transfer() calls. The
+ * default policy disables all of this.
+ */
+struct joybus_retry_policy {
+  /** Number of times to resend a command whose reply fails its checksum. */
+  uint8_t checksum_retries;
+
+  /** Number of times to resend a command that timed out. */
+  uint8_t timeout_retries;
+
+  /** Extra gap before the first resend after a timeout, in microseconds, doubling with each one after that. */
+  uint16_t backoff_us;
+
+  /** Upper bound of the extra gap, in microseconds, or 0 for no bound. */
+  uint16_t max_backoff_us;
+
+  /** Number of host functions in a row that time out before the port is treated as empty, or 0 to never. */
+  uint8_t breaker_threshold;
+
+  /** Time between looks for a device once the port is treated as empty, in microseconds. */
+  uint32_t breaker_cooldown_us;
+};
+
+/**
+ * Get the default retry policy.
+ *
+ * @return a policy with no retries and no circuit breaker
+ */
+static inline struct joybus_retry_policy joybus_retry_policy_default(void)
+{
+  return (struct joybus_retry_policy){
+    .checksum_retries    = 0,
+    .timeout_retries     = 0,
+    .backoff_us          = 0,
+    .max_backoff_us      = 0,
+    .breaker_threshold   = 0,
+    .breaker_cooldown_us = 0,
+  };
+}
+
+/**
+ * Wire timestamps of a host transfer.
+ *
+ * Taken by the backend on the bus clock, so they compare directly with
+ * joybus_clock_now_us() on the instance's `clock`. A target samples its state
+ * as the command arrives, so the first reply byte is the best estimate of when
+ * the state was read.
+ */
+struct joybus_timestamps {
+  /** When the command started going out, in microseconds. */
+  uint64_t start_us;
+
+  /** When the first reply byte was received, in microseconds, or 0 if none arrived. */
+  uint64_t first_byte_us;
+
+  /** When the transfer completed, in microseconds. */
+  uint64_t complete_us;
+};
+
 /**
  * A Joybus instance.
  */
@@ -115,14 +392,91 @@ struct joybus {
   /** The frequency of the bus, in Hz. */
   uint32_t freq;
 
+  /** The clock used for bus timing, set by the backend. */
+  struct joybus_clock *clock;
+
   /** The target device attached to this Joybus instance, if any. */
   struct joybus_target *target;
 
-  uint8_t command_buffer[JOYBUS_BLOCK_SIZE];
-  uint8_t response_buffer[JOYBUS_BLOCK_SIZE];
-  struct joybus_host_op host_op;
+  /**
+   * Whether the backend reads each command byte from the write buffer just
+   * before it goes out on the wire, so later bytes can still be filled in
+   * once a transfer has started. Set by the backend.
+   */
+  bool streams_write_buf;
+
+  /** Per-byte receive callback, if any. */
+  joybus_rx_byte_cb rx_byte_callback;
+
+  /** User data for the per-byte receive callback. */
+  void *rx_byte_user_data;
+
+  /**
+   * Wire timestamps of the last completed host transfer, set by the backend
+   * before the completion callback runs.
+   */
+  struct joybus_timestamps timestamps;
+
+  /** Timing profile for host transfers, see joybus_set_timing(). */
+  struct joybus_timing timing;
+
+  // Timing profile for the transfer being started, if not the bus profile - internal use only
+  const struct joybus_timing *transfer_timing;
+
+  /** Retry policy for the host functions, see joybus_set_retry_policy(). */
+  struct joybus_retry_policy retry;
+
+  // Host functions in a row that timed out, and when the open circuit breaker next lets one through
+  uint8_t breaker_failures;
+  uint64_t breaker_retry_us;
+
+  // Command buffer for target mode
+  uint8_t *command_buffer;
+
+#if JOYBUS_USE_BUFFER_POOL
+  struct joybus_buffer_pool *pool;
+  struct joybus_buffers *target_buffers;
+#else
+  struct joybus_buffers buffers[JOYBUS_COMMAND_SLOTS];
+#endif
+
+  // Command slots for host mode
+  struct joybus_command_slot slots[JOYBUS_COMMAND_SLOTS];
+  uint8_t slot_seq;
 };
 
+#if JOYBUS_USE_BUFFER_POOL
+// Lease buffers for target mode, if the Joybus instance doesn't already hold some - internal use only
+int joybus_buffers_acquire(struct joybus *bus);
+
+// Return the target mode buffers to the pool - internal use only
+void joybus_buffers_release(struct joybus *bus);
+
+#else
+static inline int joybus_buffers_acquire(struct joybus *bus)
+{
+  bus->command_buffer = bus->buffers[0].command;
+  return 0;
+}
+
+static inline void joybus_buffers_release(struct joybus *bus)
+{
+}
+#endif
+
+// Claim a command slot for a host function to build its command in - internal use only
+int joybus_command_slot_acquire(struct joybus *bus, struct joybus_command_slot **slot);
+
+// Start the transfer built in a command slot, or queue it behind the one in flight - internal use only
+int joybus_command_slot_submit(struct joybus *bus, struct joybus_command_slot *slot, uint8_t write_len,
+                               uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data);
+
+// Resend a completing slot's command if the retry policy allows another try for the error - internal use only
+bool joybus_command_slot_retry(struct joybus *bus, struct joybus_command_slot *slot, int status);
+
+// Drop all prepared and queued commands, and close the circuit breaker - internal use only
+void joybus_command_slots_reset(struct joybus *bus);
+
 /**
  * Enable the Joybus instance in the given mode.
  *
@@ -136,7 +490,20 @@ struct joybus {
 static inline int joybus_enable(struct joybus *bus, enum joybus_mode mode)
 {
   bus->mode = mode;
-  return bus->api->enable(bus);
+  joybus_command_slots_reset(bus);
+
+  // Targets keep their buffers while enabled, to receive commands into
+  if (mode == JOYBUS_MODE_TARGET) {
+    int rc = joybus_buffers_acquire(bus);
+    if (rc < 0)
+      return rc;
+  }
+
+  int rc = JOYBUS_BACKEND_CALL(bus, enable)(bus);
+  if (rc < 0)
+    joybus_buffers_release(bus);
+
+  return rc;
 }
 
 /**
@@ -146,7 +513,15 @@ static inline int joybus_enable(struct joybus *bus, enum joybus_mode mode)
  */
 static inline int joybus_disable(struct joybus *bus)
 {
-  return bus->api->disable(bus);
+  int rc = JOYBUS_BACKEND_CALL(bus, disable)(bus);
+
+  // Commands in flight or queued are dropped along with their callbacks
+  joybus_command_slots_reset(bus);
+
+  if (bus->mode == JOYBUS_MODE_TARGET)
+    joybus_buffers_release(bus);
+
+  return rc;
 }
 
 /**
@@ -168,7 +543,76 @@ static inline int joybus_disable(struct joybus *bus)
 static inline int joybus_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
                                   uint8_t read_len, joybus_transfer_cb callback, void *user_data)
 {
-  return bus->api->transfer(bus, write_buf, write_len, read_buf, read_len, callback, user_data);
+  return JOYBUS_BACKEND_CALL(bus, transfer)(bus, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+/**
+ * Perform a Joybus "write then read" transfer, starting at a given time.
+ *
+ * Like joybus_transfer(), but the command starts going out at @p at_us on the
+ * bus clock, eg. to line polls up with USB start-of-frame or video timing.
+ * Backends wake up a little early and busy-wait the rest of the way, so the
+ * start doesn't pick up the jitter of the timer interrupt. A time that has
+ * already passed starts the transfer right away, and the transfer never starts
+ * before the inter-transfer delay after the previous one has passed. The
+ * actual start time is available from joybus_last_timestamps() afterwards.
+ *
+ * @param bus the Joybus instance to use
+ * @param at_us when to start the command, in microseconds on the bus clock
+ * @param write_buf the buffer containing the command to send
+ * @param write_len the number of bytes to write
+ * @param read_buf the buffer to store the response in
+ * @param read_len the number of bytes to read
+ * @param callback invoked once when the transfer completes
+ * @param user_data user data to pass to the callback
+ * @return 0 if the transfer was scheduled, -JOYBUS_ERR_NOT_SUPPORTED if the backend can't schedule transfers, or
+ *         another negative joybus_error
+ */
+static inline int joybus_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf, uint8_t write_len,
+                                     uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                                     void *user_data)
+{
+#ifndef JOYBUS_STATIC_BACKEND
+  if (!bus->api->transfer_at)
+    return -JOYBUS_ERR_NOT_SUPPORTED;
+#endif
+
+  return JOYBUS_BACKEND_CALL(bus, transfer_at)(bus, at_us, write_buf, write_len, read_buf, read_len, callback,
+                                               user_data);
+}
+
+/**
+ * Perform a Joybus "write then read" transfer, with its own timing profile.
+ *
+ * Like joybus_transfer(), but with @p timing used for this transfer instead of
+ * the bus profile, eg. to poll an empty port with a short reply timeout. The
+ * profile is copied, so it doesn't have to outlive the call.
+ *
+ * @param bus the Joybus instance to use
+ * @param timing the timing profile for this transfer
+ * @param write_buf the buffer containing the command to send
+ * @param write_len the number of bytes to write
+ * @param read_buf the buffer to store the response in
+ * @param read_len the number of bytes to read
+ * @param callback invoked once when the transfer completes
+ * @param user_data user data to pass to the callback
+ * @return 0 if the transfer was started, a negative joybus_error otherwise
+ */
+static inline int joybus_transfer_timed(struct joybus *bus, const struct joybus_timing *timing,
+                                        const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
+                                        uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  bus->transfer_timing = timing;
+  int rc = JOYBUS_BACKEND_CALL(bus, transfer)(bus, write_buf, write_len, read_buf, read_len, callback, user_data);
+  bus->transfer_timing = NULL;
+
+  return rc;
+}
+
+// Get the timing profile for the transfer being started, for backends - internal use only
+static inline const struct joybus_timing *joybus_transfer_timing(const struct joybus *bus)
+{
+  return bus->transfer_timing ? bus->transfer_timing : &bus->timing;
 }
 
 /**
@@ -189,6 +633,88 @@ static inline int joybus_transfer(struct joybus *bus, const uint8_t *write_buf,
 int joybus_transfer_sync(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
                          uint8_t read_len);
 
+/**
+ * Set a callback to be notified of each response byte as it arrives.
+ *
+ * Lets host code act on a response before the transfer completes, eg. to
+ * relay it onwards. Supported by every backend, the callback is invoked from
+ * the backend core as each byte is reported.
+ *
+ * @param bus the Joybus instance to use
+ * @param callback the callback, or NULL to disable
+ * @param user_data user data to pass to the callback
+ */
+static inline void joybus_set_rx_byte_cb(struct joybus *bus, joybus_rx_byte_cb callback, void *user_data)
+{
+  bus->rx_byte_callback  = callback;
+  bus->rx_byte_user_data = user_data;
+}
+
+/**
+ * Get the wire timestamps of the last completed host transfer.
+ *
+ * Read them in the completion callback, they are replaced when the next
+ * transfer completes. Lets the caller tell how old a controller state is by
+ * the time it is used, eg. when it goes out in a USB report.
+ *
+ * @param bus the Joybus instance to use
+ * @return the timestamps of the last completed transfer
+ */
+static inline const struct joybus_timestamps *joybus_last_timestamps(const struct joybus *bus)
+{
+  return &bus->timestamps;
+}
+
+/**
+ * Set the timing profile for host transfers.
+ *
+ * Applies to every transfer started afterwards, including those made by the
+ * host functions. In target mode only the reply timeout is used, as the time
+ * to wait for a deferred reply. The profile is copied.
+ *
+ * @param bus the Joybus instance to use
+ * @param timing the timing profile, eg. from joybus_timing_default()
+ */
+static inline void joybus_set_timing(struct joybus *bus, const struct joybus_timing *timing)
+{
+  bus->timing = *timing;
+}
+
+/**
+ * Get the timing profile for host transfers.
+ *
+ * @param bus the Joybus instance to use
+ * @return the current timing profile
+ */
+static inline const struct joybus_timing *joybus_get_timing(const struct joybus *bus)
+{
+  return &bus->timing;
+}
+
+/**
+ * Set the retry policy for the host functions.
+ *
+ * Applies to every host function started afterwards. The policy is copied.
+ *
+ * @param bus the Joybus instance to use
+ * @param policy the retry policy, eg. from joybus_retry_policy_default()
+ */
+static inline void joybus_set_retry_policy(struct joybus *bus, const struct joybus_retry_policy *policy)
+{
+  bus->retry = *policy;
+}
+
+/**
+ * Check whether the circuit breaker treats the port as empty.
+ *
+ * @param bus the Joybus instance to use
+ * @return true if host functions are failing straight away with -JOYBUS_ERR_NO_DEVICE
+ */
+static inline bool joybus_breaker_open(const struct joybus *bus)
+{
+  return bus->retry.breaker_threshold && bus->breaker_failures >= bus->retry.breaker_threshold;
+}
+
 /**
  * Attach a target to handle commands received in target mode.
  *
@@ -0,0 +1,200 @@
+/**
+ * @defgroup joybus_clock Clocks and Alarms
+ * @ingroup joybus
+ *
+ * Time source shared by the backends.
+ *
+ * A clock provides a monotonic microsecond time, an optional CPU cycle counter,
+ * and any number of one-shot alarms. Alarms are kept in a queue ordered by
+ * expiry time, so each clock implementation only has to drive a single
+ * hardware alarm for the earliest one.
+ *
+ * Each embedded backend provides a clock for its platform, and the loopback
+ * backend provides a virtual clock that only advances as the simulation runs.
+ * The clock used by a Joybus instance is available from its `clock` field.
+ *
+ * Alarm callbacks run in interrupt context on most platforms, so they must not
+ * block. An alarm scheduled for a time that has already passed fires right
+ * away, before joybus_alarm_schedule() returns.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct joybus_clock;
+struct joybus_alarm;
+
+/**
+ * Function type for alarm callbacks.
+ *
+ * @param alarm the alarm that fired
+ * @param user_data user data passed to joybus_alarm_init()
+ */
+typedef void (*joybus_alarm_cb)(struct joybus_alarm *alarm, void *user_data);
+
+/**
+ * A one-shot alarm.
+ */
+struct joybus_alarm {
+  /// Callback to invoke when the alarm fires
+  joybus_alarm_cb callback;
+
+  /// User data for the callback
+  void *user_data;
+
+  /// Expiry time, in microseconds
+  uint64_t at_us;
+
+  /// Whether the alarm is waiting to fire
+  bool pending;
+
+  // Next alarm in the clock's queue - internal use only
+  struct joybus_alarm *next;
+};
+
+// API for a clock implementation - internal use only
+struct joybus_clock_api {
+  // Current time, in microseconds
+  uint64_t (*now_us)(struct joybus_clock *clock);
+
+  // Current CPU cycle count, or NULL if there is no cycle counter
+  uint32_t (*cycles)(struct joybus_clock *clock);
+
+  // Arm the hardware alarm to call joybus_clock_run_alarms() at the given time, replacing any earlier setting.
+  // Returns non-zero without arming if the time has already passed.
+  int (*set_alarm)(struct joybus_clock *clock, uint64_t at_us);
+
+  // Enter and leave a critical section guarding the alarm queue, or NULL if not needed
+  uint32_t (*lock)(struct joybus_clock *clock);
+  void (*unlock)(struct joybus_clock *clock, uint32_t state);
+};
+
+/**
+ * A clock.
+ */
+struct joybus_clock {
+  /** The implementation of this clock. */
+  const struct joybus_clock_api *api;
+
+  // Pending alarms, earliest first - internal use only
+  struct joybus_alarm *alarms;
+};
+
+/**
+ * Get the current time.
+ *
+ * @param clock the clock to use
+ * @return the current time, in microseconds
+ */
+static inline uint64_t joybus_clock_now_us(struct joybus_clock *clock)
+{
+  return clock->api->now_us(clock);
+}
+
+/**
+ * Get the current CPU cycle count.
+ *
+ * The count wraps around, so only use it to measure short intervals.
+ *
+ * @param clock the clock to use
+ * @return the current cycle count, or 0 if the clock has no cycle counter
+ */
+static inline uint32_t joybus_clock_cycles(struct joybus_clock *clock)
+{
+  return clock->api->cycles ? clock->api->cycles(clock) : 0;
+}
+
+/**
+ * Enter a critical section, guarding against the clock's alarm callbacks.
+ *
+ * Keep critical sections short, interrupts may be disabled until
+ * joybus_clock_unlock() is called.
+ *
+ * @param clock the clock to use
+ * @return state to pass to joybus_clock_unlock()
+ */
+static inline uint32_t joybus_clock_lock(struct joybus_clock *clock)
+{
+  return clock->api->lock ? clock->api->lock(clock) : 0;
+}
+
+/**
+ * Leave a critical section entered with joybus_clock_lock().
+ *
+ * @param clock the clock to use
+ * @param state the state returned by joybus_clock_lock()
+ */
+static inline void joybus_clock_unlock(struct joybus_clock *clock, uint32_t state)
+{
+  if (clock->api->unlock)
+    clock->api->unlock(clock, state);
+}
+
+/**
+ * Initialize an alarm.
+ *
+ * @param alarm the alarm to initialize
+ * @param callback the callback to invoke when the alarm fires
+ * @param user_data user data to pass to the callback
+ */
+void joybus_alarm_init(struct joybus_alarm *alarm, joybus_alarm_cb callback, void *user_data);
+
+/**
+ * Schedule an alarm to fire at the given time.
+ *
+ * An alarm that is already pending is rescheduled.
+ *
+ * @param clock the clock to use
+ * @param alarm the alarm to schedule
+ * @param at_us the time to fire at, in microseconds
+ */
+void joybus_alarm_schedule(struct joybus_clock *clock, struct joybus_alarm *alarm, uint64_t at_us);
+
+/**
+ * Schedule an alarm to fire after a delay.
+ *
+ * @param clock the clock to use
+ * @param alarm the alarm to schedule
+ * @param delay_us the delay, in microseconds
+ */
+static inline void joybus_alarm_schedule_in(struct joybus_clock *clock, struct joybus_alarm *alarm, uint32_t delay_us)
+{
+  joybus_alarm_schedule(clock, alarm, joybus_clock_now_us(clock) + delay_us);
+}
+
+/**
+ * Cancel a pending alarm.
+ *
+ * Does nothing if the alarm is not pending.
+ *
+ * @param clock the clock the alarm was scheduled on
+ * @param alarm the alarm to cancel
+ */
+void joybus_alarm_cancel(struct joybus_clock *clock, struct joybus_alarm *alarm);
+
+/**
+ * Check whether an alarm is waiting to fire.
+ *
+ * @param alarm the alarm to check
+ * @return true if the alarm is pending
+ */
+static inline bool joybus_alarm_pending(const struct joybus_alarm *alarm)
+{
+  return alarm->pending;
+}
+
+/**
+ * Fire every alarm that is due, and arm the hardware alarm for the next one.
+ *
+ * Called by clock implementations when their hardware alarm fires.
+ *
+ * @param clock the clock to service
+ */
+void joybus_clock_run_alarms(struct joybus_clock *clock);
+
+/** @} */
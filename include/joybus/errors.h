@@ -31,6 +31,12 @@ enum joybus_error {
 
   /// Expected device not detected
   JOYBUS_ERR_NO_DEVICE,
+
+  /// Invalid argument or malformed data
+  JOYBUS_ERR_INVALID,
+
+  /// Not enough space in a buffer
+  JOYBUS_ERR_NO_SPACE,
 };
 
 /** @} */
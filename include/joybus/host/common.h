@@ -54,4 +54,16 @@ int joybus_reset(struct joybus *bus, struct joybus_id *response);
  */
 int joybus_reset_async(struct joybus *bus, struct joybus_id *response, joybus_transfer_cb callback, void *user_data);
 
+/**
+ * Build the lookup tables for remapping a 16-bit button field.
+ *
+ * Each table entry is the union of the output masks of the input bits set in
+ * its index, so a remapped field is `lut[0][buttons & 0xFF] | lut[1][buttons >> 8]`.
+ * Used by the GameCube input pipeline and the protocol bridge.
+ *
+ * @param lut the tables to fill, for the low and high byte of the input
+ * @param button_map the output button mask for each input button bit
+ */
+void joybus_build_button_lut(uint16_t lut[2][256], const uint16_t button_map[16]);
+
 /** @} */
@@ -39,6 +39,46 @@ int joybus_gcn_read_async(struct joybus *bus, enum joybus_gcn_analog_mode analog
                           enum joybus_gcn_motor_state motor_state, struct joybus_gcn_controller_state *response,
                           joybus_transfer_cb callback, void *user_data);
 
+/**
+ * A GameCube controller input state, with the wire timestamps of the read that returned it.
+ */
+struct joybus_gcn_sample {
+  /** The input state. */
+  struct joybus_gcn_controller_state state;
+
+  /** When the state was read. */
+  struct joybus_timestamps timestamps;
+};
+
+/**
+ * Read the current input state of a GameCube controller, along with when it was read.
+ *
+ * @param bus the Joybus instance to use
+ * @param analog_mode the analog mode to use
+ * @param motor_state the motor state to use
+ * @param sample buffer to store the input state and timestamps in
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_gcn_read_sample(struct joybus *bus, enum joybus_gcn_analog_mode analog_mode,
+                           enum joybus_gcn_motor_state motor_state, struct joybus_gcn_sample *sample);
+
+/**
+ * Read the current input state of a GameCube controller, along with when it was read, asynchronously.
+ *
+ * The timestamps are filled in whether or not the read succeeds.
+ *
+ * @param bus the Joybus instance to use
+ * @param analog_mode the analog mode to use
+ * @param motor_state the motor state to use
+ * @param sample buffer to store the input state and timestamps in
+ * @param callback a callback function to call when the transfer is complete
+ * @param user_data user data to pass to the callback function
+ * @return 0 if the transfer was started, a negative joybus_error otherwise
+ */
+int joybus_gcn_read_sample_async(struct joybus *bus, enum joybus_gcn_analog_mode analog_mode,
+                                 enum joybus_gcn_motor_state motor_state, struct joybus_gcn_sample *sample,
+                                 joybus_transfer_cb callback, void *user_data);
+
 /**
  * Read the origin (neutral) state of a GameCube controller.
  *
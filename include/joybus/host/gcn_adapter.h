@@ -0,0 +1,178 @@
+/**
+ * @defgroup joybus_host_gcn_adapter GameCube Adapter
+ * @ingroup joybus_host
+ *
+ * 4-port GameCube controller adapter engine, compatible with the official
+ * Wii U / Switch adapter (WUP-028).
+ *
+ * Each port is driven by its own Joybus instance in host mode. Call
+ * joybus_gcn_adapter_poll() once per USB polling interval to start the next
+ * operation on every port, detection and origin reads are handled along the
+ * way. The ports poll in parallel, so a full cycle of four GameCube reads
+ * takes well under the 1 ms interval of the official adapter.
+ *
+ * joybus_gcn_adapter_build_report() writes the 37-byte input report straight
+ * from the latest controller states into the USB endpoint buffer, and
+ * joybus_gcn_adapter_handle_output_report() takes the rumble output report,
+ * whose motor states are sent with the next read on each port.
+ *
+ * When the build defines `JOYBUS_USE_MAILBOXES=1`, completed reads are
+ * handed to the report through a mailbox per port, so the reports can be
+ * built on a different core than the Joybus interrupts run on without ever
+ * seeing a half-written input state.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+#include <joybus/identify.h>
+#include <joybus/mailbox.h>
+#include <joybus/common/gcn_controller.h>
+
+/// Number of controller ports on the adapter
+#define JOYBUS_GCN_ADAPTER_PORTS                4
+
+/// Report ID of the input report
+#define JOYBUS_GCN_ADAPTER_REPORT_INPUT         0x21
+
+/// Report ID of the rumble output report
+#define JOYBUS_GCN_ADAPTER_REPORT_RUMBLE        0x11
+
+/// Report ID of the initialization output report
+#define JOYBUS_GCN_ADAPTER_REPORT_INIT          0x13
+
+/// Length of the input report, including the report ID
+#define JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN     37
+
+/// Length of the rumble output report, including the report ID
+#define JOYBUS_GCN_ADAPTER_RUMBLE_REPORT_LEN    5
+
+/**
+ * Port status flags, the first byte of each port in the input report.
+ */
+#define JOYBUS_GCN_ADAPTER_STATUS_POWERED       0x04 ///< Rumble power is available
+#define JOYBUS_GCN_ADAPTER_STATUS_WIRED         0x10 ///< A wired controller is connected
+#define JOYBUS_GCN_ADAPTER_STATUS_WIRELESS      0x20 ///< A wireless controller is connected
+
+/**
+ * State of a single adapter port.
+ */
+struct joybus_gcn_adapter_port {
+  /// The Joybus instance driving this port, NULL if unpopulated
+  struct joybus *bus;
+
+  /// Current step of the port's detection/polling sequence
+  uint8_t state;
+
+  /// Whether an operation is in flight on the port's bus
+  volatile bool busy;
+
+  /// Motor state to send with the next read
+  enum joybus_gcn_motor_state motor_state;
+
+  /// Controller ID, from the last identify command
+  struct joybus_id id;
+
+  /// Controller origin, from the last origin read
+  struct joybus_gcn_controller_state origin;
+
+  /// Controller input, from the last read
+  struct joybus_gcn_controller_state input;
+
+#if JOYBUS_USE_MAILBOXES
+  /// Completed reads, for the input report
+  struct joybus_mailbox input_mailbox;
+  struct joybus_gcn_controller_state input_slots[JOYBUS_MAILBOX_SLOTS];
+
+  /// Controller input, from the last read taken by the input report
+  struct joybus_gcn_controller_state report_input;
+#endif
+};
+
+/**
+ * A 4-port GameCube adapter.
+ */
+struct joybus_gcn_adapter {
+  /// Controller ports
+  struct joybus_gcn_adapter_port ports[JOYBUS_GCN_ADAPTER_PORTS];
+
+  /// Whether rumble power is available
+  bool powered;
+};
+
+/**
+ * Initialize a GameCube adapter.
+ *
+ * The buses must already be enabled in host mode.
+ *
+ * @param adapter the adapter to initialize
+ * @param buses the Joybus instance for each port, NULL for unpopulated ports
+ */
+void joybus_gcn_adapter_init(struct joybus_gcn_adapter *adapter, struct joybus *buses[JOYBUS_GCN_ADAPTER_PORTS]);
+
+/**
+ * Start the next operation on every idle port.
+ *
+ * Disconnected ports are probed with an identify command, newly connected
+ * ports get their origin read, and connected ports are read. Call this at the
+ * USB polling interval, eg. from a 1 ms timer.
+ *
+ * @param adapter the adapter to poll
+ */
+void joybus_gcn_adapter_poll(struct joybus_gcn_adapter *adapter);
+
+/**
+ * Check if a controller is connected to a port.
+ *
+ * @param adapter the adapter to check
+ * @param port the port to check
+ * @return true if a controller is connected and being read
+ */
+bool joybus_gcn_adapter_connected(struct joybus_gcn_adapter *adapter, uint8_t port);
+
+/**
+ * Set whether rumble power is available.
+ *
+ * Reported to the USB host in each port's status, hosts only send rumble
+ * commands when it is set.
+ *
+ * @param adapter the adapter to update
+ * @param powered true if rumble power is available
+ */
+static inline void joybus_gcn_adapter_set_powered(struct joybus_gcn_adapter *adapter, bool powered)
+{
+  adapter->powered = powered;
+}
+
+/**
+ * Build the input report for all four ports.
+ *
+ * Writes the report directly into @p report, typically the USB endpoint
+ * buffer, from the latest input states.
+ *
+ * @param adapter the adapter to build the report for
+ * @param report buffer of at least JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN bytes
+ * @return the length of the report
+ */
+uint8_t joybus_gcn_adapter_build_report(struct joybus_gcn_adapter *adapter,
+                                        uint8_t report[JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN]);
+
+/**
+ * Handle an output report from the USB host.
+ *
+ * Rumble reports update the motor state sent with the next read on each port.
+ * Initialization reports are accepted and ignored.
+ *
+ * @param adapter the adapter the report is for
+ * @param report the output report, starting with the report ID
+ * @param len the length of the report
+ * @return 0 on success, -JOYBUS_ERR_NOT_SUPPORTED for unknown or truncated reports
+ */
+int joybus_gcn_adapter_handle_output_report(struct joybus_gcn_adapter *adapter, const uint8_t *report, uint16_t len);
+
+/** @} */
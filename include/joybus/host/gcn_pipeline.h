@@ -0,0 +1,181 @@
+/**
+ * @defgroup joybus_host_gcn_pipeline GameCube Input Pipeline
+ * @ingroup joybus_host
+ *
+ * Batched post-processing of GameCube controller input for multi-port hosts.
+ *
+ * Input states for every port are kept in structure-of-arrays form, one array
+ * per field, indexed by port. Origin correction, deadzone and range scaling
+ * are folded into a 256-entry lookup table per port and axis, and button
+ * remapping into a pair of 256-entry tables shared by all ports. Processing a
+ * poll is then a handful of table lookups in fixed-length, branch-free loops
+ * that the compiler is free to unroll and vectorize.
+ *
+ * The axis tables depend only on the configuration and the origin, so they are
+ * built once at init and rebuilt for a single port when its origin changes.
+ *
+ * Processed sticks are centered at 0x80 and span 0x01-0xFF, processed triggers
+ * rest at 0x00 and span 0x00-0xFF. XOR a value with 0x80 to get the signed
+ * representation used by most USB HID reports.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/common/gcn_controller.h>
+
+/// Number of ports processed by a pipeline, override to match the number of buses
+#ifndef JOYBUS_GCN_PIPELINE_PORTS
+#define JOYBUS_GCN_PIPELINE_PORTS 4
+#endif
+
+/**
+ * Analog axes handled by the pipeline.
+ *
+ * The order matches the layout of ::joybus_gcn_controller_state, axis `n` lives
+ * at byte offset `n + 2`.
+ */
+enum joybus_gcn_axis {
+  JOYBUS_GCN_AXIS_STICK_X,
+  JOYBUS_GCN_AXIS_STICK_Y,
+  JOYBUS_GCN_AXIS_SUBSTICK_X,
+  JOYBUS_GCN_AXIS_SUBSTICK_Y,
+  JOYBUS_GCN_AXIS_TRIGGER_LEFT,
+  JOYBUS_GCN_AXIS_TRIGGER_RIGHT,
+  JOYBUS_GCN_AXIS_COUNT,
+};
+
+/**
+ * Input state of every port, in structure-of-arrays layout.
+ */
+struct joybus_gcn_input_soa {
+  /// Button state of each port
+  uint16_t buttons[JOYBUS_GCN_PIPELINE_PORTS];
+
+  /// Analog axis values of each port, indexed by ::joybus_gcn_axis then port
+  uint8_t axes[JOYBUS_GCN_AXIS_COUNT][JOYBUS_GCN_PIPELINE_PORTS];
+};
+
+/**
+ * Processing parameters for a group of analog axes.
+ */
+struct joybus_gcn_pipeline_axis_config {
+  /// Deflection from the origin that is still reported as rest
+  uint8_t deadzone;
+
+  /// Deflection from the origin that maps to full scale, must be greater than the deadzone
+  uint8_t range;
+};
+
+/**
+ * Configuration for a GameCube input pipeline.
+ */
+struct joybus_gcn_pipeline_config {
+  /// Main stick processing parameters
+  struct joybus_gcn_pipeline_axis_config stick;
+
+  /// C-stick processing parameters
+  struct joybus_gcn_pipeline_axis_config substick;
+
+  /// Analog trigger processing parameters
+  struct joybus_gcn_pipeline_axis_config trigger;
+
+  /// Output button mask for each input button bit, eg. `button_map[0]` for JOYBUS_GCN_BUTTON_A
+  uint16_t button_map[16];
+};
+
+/**
+ * A GameCube input pipeline.
+ */
+struct joybus_gcn_pipeline {
+  /// Button remapping tables, for the low and high input button bytes
+  uint16_t button_lut[2][256];
+
+  /// Axis tables, indexed by ::joybus_gcn_axis, port, then raw axis value
+  uint8_t axis_lut[JOYBUS_GCN_AXIS_COUNT][JOYBUS_GCN_PIPELINE_PORTS][256];
+
+  /// Origin each port's axis tables were built for
+  uint8_t origin[JOYBUS_GCN_AXIS_COUNT][JOYBUS_GCN_PIPELINE_PORTS];
+
+  /// The configuration the tables were built from
+  struct joybus_gcn_pipeline_config config;
+};
+
+/**
+ * Build a pipeline config with default values.
+ *
+ * Ranges approximate the travel of an OEM controller, with a small deadzone
+ * on each axis and an identity button mapping.
+ *
+ * @return a config with default values
+ */
+static inline struct joybus_gcn_pipeline_config joybus_gcn_pipeline_config_default(void)
+{
+  struct joybus_gcn_pipeline_config config = {
+    .stick    = {.deadzone = 4, .range = 100},
+    .substick = {.deadzone = 4, .range = 90},
+    .trigger  = {.deadzone = 16, .range = 200},
+  };
+
+  for (int i = 0; i < 16; i++)
+    config.button_map[i] = 1 << i;
+
+  return config;
+}
+
+/**
+ * Initialize a pipeline, building all tables for a centered origin.
+ *
+ * @param pipeline the pipeline to initialize
+ * @param config the configuration to use, eg. from joybus_gcn_pipeline_config_default()
+ */
+void joybus_gcn_pipeline_init(struct joybus_gcn_pipeline *pipeline, struct joybus_gcn_pipeline_config config);
+
+/**
+ * Set the origin of a port, rebuilding its axis tables if the origin changed.
+ *
+ * Call this after each origin read or calibration. Calling it with an unchanged
+ * origin is cheap, so it is also safe to call on every poll.
+ *
+ * @param pipeline the pipeline to update
+ * @param port the port the origin belongs to
+ * @param origin the origin state read from the controller
+ * @return true if the port's tables were rebuilt
+ */
+bool joybus_gcn_pipeline_set_origin(struct joybus_gcn_pipeline *pipeline, uint8_t port,
+                                    const struct joybus_gcn_controller_state *origin);
+
+/**
+ * Store a port's input state into a structure-of-arrays batch.
+ *
+ * @param soa the batch to store the input state in
+ * @param port the port the input state belongs to
+ * @param state the input state read from the controller
+ */
+static inline void joybus_gcn_input_soa_store(struct joybus_gcn_input_soa *soa, uint8_t port,
+                                              const struct joybus_gcn_controller_state *state)
+{
+  soa->buttons[port]                             = state->buttons;
+  soa->axes[JOYBUS_GCN_AXIS_STICK_X][port]       = state->stick_x;
+  soa->axes[JOYBUS_GCN_AXIS_STICK_Y][port]       = state->stick_y;
+  soa->axes[JOYBUS_GCN_AXIS_SUBSTICK_X][port]    = state->substick_x;
+  soa->axes[JOYBUS_GCN_AXIS_SUBSTICK_Y][port]    = state->substick_y;
+  soa->axes[JOYBUS_GCN_AXIS_TRIGGER_LEFT][port]  = state->trigger_left;
+  soa->axes[JOYBUS_GCN_AXIS_TRIGGER_RIGHT][port] = state->trigger_right;
+}
+
+/**
+ * Process a batch of raw input states for all ports.
+ *
+ * @param pipeline the pipeline to use
+ * @param in the raw input states
+ * @param out the processed input states, may alias @p in
+ */
+void joybus_gcn_pipeline_process(const struct joybus_gcn_pipeline *pipeline, const struct joybus_gcn_input_soa *in,
+                                 struct joybus_gcn_input_soa *out);
+
+/** @} */
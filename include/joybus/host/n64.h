@@ -32,11 +32,47 @@ int joybus_n64_read(struct joybus *bus, struct joybus_n64_controller_state *resp
 int joybus_n64_read_async(struct joybus *bus, struct joybus_n64_controller_state *response,
                           joybus_transfer_cb callback, void *user_data);
 
+/**
+ * An N64 controller input state, with the wire timestamps of the read that returned it.
+ */
+struct joybus_n64_sample {
+  /** The input state. */
+  struct joybus_n64_controller_state state;
+
+  /** When the state was read. */
+  struct joybus_timestamps timestamps;
+};
+
+/**
+ * Read the current input state of an N64 controller or mouse, along with when it was read.
+ *
+ * @param bus the Joybus instance to use
+ * @param sample buffer to store the input state and timestamps in
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_n64_read_sample(struct joybus *bus, struct joybus_n64_sample *sample);
+
+/**
+ * Read the current input state of an N64 controller or mouse, along with when it was read, asynchronously.
+ *
+ * The timestamps are filled in whether or not the read succeeds.
+ *
+ * @param bus the Joybus instance to use
+ * @param sample buffer to store the input state and timestamps in
+ * @param callback a callback function to call when the transfer is complete
+ * @param user_data user data to pass to the callback function
+ * @return 0 if the transfer was started, a negative joybus_error otherwise
+ */
+int joybus_n64_read_sample_async(struct joybus *bus, struct joybus_n64_sample *sample, joybus_transfer_cb callback,
+                                 void *user_data);
+
 /**
  * Write a block of data to the pak attached to an N64 controller.
  *
  * The response buffer will be populated with a checksum of the written data
- * (see joybus_data_checksum)
+ * (see joybus_data_checksum). A checksum that doesn't match the data, eg. with
+ * no pak inserted, is resent if the retry policy allows, and otherwise
+ * reported as -JOYBUS_ERR_CHECKSUM.
  *
  * @param bus the Joybus instance to use
  * @param addr the address to read from, must be 32-byte aligned
@@ -50,7 +86,9 @@ int joybus_n64_pak_write(struct joybus *bus, uint16_t addr, const void *data, ui
  * Write a block of data to the pak attached to an N64 controller, asynchronously.
  *
  * The response buffer will be populated with a checksum of the written data
- * (see joybus_data_checksum).
+ * (see joybus_data_checksum). A checksum that doesn't match the data, eg. with
+ * no pak inserted, is resent if the retry policy allows, and otherwise
+ * reported as -JOYBUS_ERR_CHECKSUM.
  *
  * @param bus the Joybus instance to use
  * @param addr the address to write to, must be 32-byte aligned
@@ -68,7 +106,8 @@ int joybus_n64_pak_write_async(struct joybus *bus, uint16_t addr, const uint8_t
  * Read a block of data from the pak attached to an N64 controller.
  *
  * The response buffer will be populated with 32 bytes of data read from the pak,
- * followed by a checksum.
+ * followed by a checksum. A checksum that doesn't match the data is resent if
+ * the retry policy allows, and otherwise reported as -JOYBUS_ERR_CHECKSUM.
  *
  * @param bus the Joybus instance to use
  * @param addr the address to read from, must be 32-byte aligned
@@ -81,7 +120,8 @@ int joybus_n64_pak_read(struct joybus *bus, uint16_t addr, uint8_t response[JOYB
  * Read a block of data from the pak attached to an N64 controller, asynchronously.
  *
  * The response buffer will be populated with 32 bytes of data read from the pak,
- * followed by a checksum.
+ * followed by a checksum. A checksum that doesn't match the data is resent if
+ * the retry policy allows, and otherwise reported as -JOYBUS_ERR_CHECKSUM.
  *
  * @param bus the Joybus to use
  * @param addr the address to read from, must be 32-byte aligned
@@ -8,6 +8,17 @@
 #pragma once
 
 #include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/host/sequence.h>
+
+/**
+ * State of a rumble pak probe.
+ */
+struct joybus_n64_rumble_pak_probe {
+  // Private implementation details - do not access directly
+  struct joybus_sequence seq;
+  uint8_t block[JOYBUS_CMD_N64_PAK_READ_RX];
+};
 
 /**
  * Initialize a rumble pak.
@@ -21,11 +32,13 @@ int joybus_n64_rumble_pak_init(struct joybus *bus);
  * Initialize a rumble pak, asynchronously.
  *
  * @param bus the bus with a controller with a rumble pak attached
+ * @param probe the probe state, which must stay valid until the callback runs
  * @param callback a callback function to call when the transfer is complete
  * @param user_data user data to pass to the callback function
  * @return 0 if the transfer was started, a negative joybus_error otherwise
  */
-int joybus_n64_rumble_pak_init_async(struct joybus *bus, joybus_transfer_cb callback, void *user_data);
+int joybus_n64_rumble_pak_init_async(struct joybus *bus, struct joybus_n64_rumble_pak_probe *probe,
+                                     joybus_transfer_cb callback, void *user_data);
 
 /**
  * Start the motor on a rumble pak.
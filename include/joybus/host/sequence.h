@@ -0,0 +1,123 @@
+/**
+ * @defgroup joybus_host_sequence Command Sequences
+ * @ingroup joybus_host
+ *
+ * Run host operations that take several transfers, eg. pak probes, dumps, or
+ * handshakes, as a table of steps.
+ *
+ * Each step starts one transfer, usually with a host function, passing
+ * joybus_sequence_cb() as the callback and the sequence as the user data.
+ * When the transfer completes successfully the next step in the table runs,
+ * in transfer-completion context, and can check the result of the transfer
+ * before starting the next one. A failed transfer ends the sequence with its
+ * error. The sequence completes once the table runs out, or a step returns
+ * JOYBUS_SEQUENCE_DONE.
+ *
+ * All the state of a sequence lives in the joybus_sequence and the context
+ * supplied by the caller, nothing is allocated and nothing is kept on the bus.
+ * Several sequences can run on the same bus at once, their transfers queue up
+ * in the command slots like those of any other host functions.
+ *
+ * @code
+ * struct dump {
+ *   uint16_t addr;
+ *   uint8_t block[JOYBUS_CMD_N64_PAK_READ_RX];
+ * };
+ *
+ * static int read_block(struct joybus *bus, struct joybus_sequence *seq)
+ * {
+ *   struct dump *dump = seq->context;
+ *   return joybus_n64_pak_read_async(bus, dump->addr, dump->block, joybus_sequence_cb, seq);
+ * }
+ *
+ * static int next_block(struct joybus *bus, struct joybus_sequence *seq)
+ * {
+ *   struct dump *dump = seq->context;
+ *   // ... use dump->block
+ *   dump->addr += JOYBUS_PAK_BLOCK_SIZE;
+ *   if (dump->addr == 0x8000)
+ *     return JOYBUS_SEQUENCE_DONE;
+ *
+ *   joybus_sequence_goto(seq, 1);
+ *   return read_block(bus, seq);
+ * }
+ *
+ * static const joybus_sequence_step dump_steps[] = {read_block, next_block, NULL};
+ * @endcode
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <joybus/bus.h>
+
+/// Returned by a step to complete the sequence successfully without starting another transfer
+#define JOYBUS_SEQUENCE_DONE 1
+
+struct joybus_sequence;
+
+/**
+ * Function type for a sequence step.
+ *
+ * @param bus the Joybus the sequence runs on
+ * @param seq the sequence, with the caller's context
+ * @return 0 if a transfer was started with joybus_sequence_cb() as its callback, JOYBUS_SEQUENCE_DONE to complete
+ *         the sequence, or a negative joybus_error to fail it
+ */
+typedef int (*joybus_sequence_step)(struct joybus *bus, struct joybus_sequence *seq);
+
+/**
+ * A running sequence.
+ */
+struct joybus_sequence {
+  /// The context passed to joybus_sequence_start(), for the steps to use
+  void *context;
+
+  // Private implementation details - do not access directly
+  const joybus_sequence_step *steps;
+  uint8_t next;
+  joybus_transfer_cb callback;
+  void *user_data;
+};
+
+/**
+ * Start a sequence.
+ *
+ * Runs the first step, which must start a transfer.
+ *
+ * @param bus the Joybus instance to use
+ * @param seq the sequence state, which must stay valid until the callback runs
+ * @param steps the step table, ending with NULL
+ * @param context the caller's context for the steps
+ * @param callback a callback function to call when the sequence completes
+ * @param user_data user data to pass to the callback function
+ * @return 0 if the sequence was started, the first step's error, or -JOYBUS_ERR_INVALID if the first step didn't
+ *         start a transfer
+ */
+int joybus_sequence_start(struct joybus *bus, struct joybus_sequence *seq, const joybus_sequence_step *steps,
+                          void *context, joybus_transfer_cb callback, void *user_data);
+
+/**
+ * Transfer completion callback for the transfers started by steps.
+ *
+ * @param bus the Joybus the transfer ran on
+ * @param status the transfer status
+ * @param user_data the sequence
+ */
+void joybus_sequence_cb(struct joybus *bus, int status, void *user_data);
+
+/**
+ * Pick the step to run after the current one's transfer, instead of the next one in the table.
+ *
+ * @param seq the sequence
+ * @param step the index of the step in the table
+ */
+static inline void joybus_sequence_goto(struct joybus_sequence *seq, uint8_t step)
+{
+  seq->next = step;
+}
+
+/** @} */
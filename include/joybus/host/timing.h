@@ -0,0 +1,91 @@
+/**
+ * @defgroup joybus_host_timing Timing Calibration
+ * @ingroup joybus_host
+ *
+ * Measure the shortest gap between transfers a device reliably accepts.
+ *
+ * The calibration sends a command back-to-back with shrinking gaps, binary
+ * searching between no gap at all and the gap in the bus timing profile, which
+ * is assumed to work. A gap passes if JOYBUS_CALIBRATE_TRIALS transfers in a
+ * row complete without an error. Each candidate is preceded by a transfer at
+ * the last gap known to work, so a device that missed a command has recovered
+ * before the next candidate is tried.
+ *
+ * Only the transfer status is checked, so pick a command with a reply that
+ * would time out if the device missed it, eg. a controller read. Once done,
+ * apply the result with some margin:
+ *
+ * @code
+ * struct joybus_timing timing = *joybus_get_timing(bus);
+ * timing.min_gap_us           = min_gap_us + 5;
+ * joybus_set_timing(bus, &timing);
+ * @endcode
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+
+/// Number of back-to-back transfers a candidate gap has to pass
+#ifndef JOYBUS_CALIBRATE_TRIALS
+#define JOYBUS_CALIBRATE_TRIALS 8
+#endif
+
+/**
+ * State of a gap calibration.
+ */
+struct joybus_gap_calibration {
+  /// The shortest gap that passed, in microseconds, valid once the calibration completes successfully
+  uint16_t min_gap_us;
+
+  // Private implementation details - do not access directly
+  struct joybus *bus;
+  const uint8_t *command;
+  uint8_t write_len;
+  uint8_t read_len;
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+  struct joybus_timing timing;
+  uint16_t lo_us;
+  uint16_t hi_us;
+  uint8_t trial;
+  joybus_transfer_cb callback;
+  void *user_data;
+};
+
+/**
+ * Measure the shortest gap between transfers the attached device reliably accepts.
+ *
+ * @param bus the Joybus instance to use
+ * @param command the command to send, eg. a controller read
+ * @param write_len the length of the command
+ * @param read_len the length of the reply
+ * @param min_gap_us set to the shortest gap that passed, in microseconds
+ * @return 0 on success, a negative joybus_error if the device doesn't reply even at the bus profile's gap
+ */
+int joybus_calibrate_gap(struct joybus *bus, const uint8_t *command, uint8_t write_len, uint8_t read_len,
+                         uint16_t *min_gap_us);
+
+/**
+ * Measure the shortest gap between transfers the attached device reliably accepts, asynchronously.
+ *
+ * The command is sent many times, and the calibration keeps the bus busy
+ * until the callback runs.
+ *
+ * @param bus the Joybus instance to use
+ * @param cal the calibration state, which must stay valid until the callback runs
+ * @param command the command to send, which must stay valid until the callback runs
+ * @param write_len the length of the command
+ * @param read_len the length of the reply, up to JOYBUS_BLOCK_SIZE
+ * @param callback a callback function to call when the calibration is complete
+ * @param user_data user data to pass to the callback function
+ * @return 0 if the calibration was started, a negative joybus_error otherwise
+ */
+int joybus_calibrate_gap_async(struct joybus *bus, struct joybus_gap_calibration *cal, const uint8_t *command,
+                               uint8_t write_len, uint8_t read_len, joybus_transfer_cb callback, void *user_data);
+
+/** @} */
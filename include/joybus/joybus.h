@@ -1,6 +1,8 @@
 #pragma once
 
+#include <joybus/buffer_pool.h>
 #include <joybus/bus.h>
+#include <joybus/clock.h>
 #include <joybus/commands.h>
 #include <joybus/checksum.h>
 #include <joybus/errors.h>
@@ -8,9 +10,18 @@
 #include <joybus/common/gcn_controller.h>
 #include <joybus/common/n64_controller.h>
 #include <joybus/target.h>
+#include <joybus/virtual_clock.h>
 #include <joybus/host/common.h>
 #include <joybus/host/gcn.h>
+#include <joybus/host/gcn_adapter.h>
+#include <joybus/host/gcn_pipeline.h>
 #include <joybus/host/n64.h>
 #include <joybus/host/n64_rumble_pak.h>
+#include <joybus/host/sequence.h>
+#include <joybus/host/timing.h>
+#include <joybus/target/bridge.h>
+#include <joybus/target/capture.h>
 #include <joybus/target/gcn_controller.h>
 #include <joybus/target/n64_controller.h>
+#include <joybus/target/playback.h>
+#include <joybus/target/relay.h>
@@ -0,0 +1,559 @@
+/**
+ * @defgroup joybus_cpp C++ Interface
+ * @ingroup joybus
+ *
+ * Header-only C++20 layer over the host API.
+ *
+ * - Commands are built at compile time, and carry their reply length in their
+ *   type, see libjoybus::commands.
+ * - Controller states are read through typed views, see
+ *   libjoybus::gcn_controller_view and libjoybus::n64_controller_view.
+ * - Transfers and host functions can be `co_await`ed from a libjoybus::task.
+ *   Each awaitable starts the async C function with a callback that resumes
+ *   the coroutine, so a chain of `co_await`s runs as the same callback chain
+ *   written by hand, with no virtual calls. Like a callback, the code after a
+ *   `co_await` runs in transfer-completion context, which is an interrupt on
+ *   most backends, so it must not block.
+ * - A coroutine frame lives in a libjoybus::frame supplied by the caller as the
+ *   first argument of the coroutine. A task can't be written without one, so
+ *   nothing is allocated.
+ *
+ * @code
+ * libjoybus::task poll(libjoybus::frame_base &, struct joybus *bus, struct joybus_gcn_controller_state &state)
+ * {
+ *   struct joybus_id id;
+ *   if (int rc = co_await libjoybus::identify(bus, id); rc < 0)
+ *     co_return rc;
+ *
+ *   struct joybus_gcn_controller_state origin;
+ *   if (int rc = co_await libjoybus::gcn_read_origin(bus, origin); rc < 0)
+ *     co_return rc;
+ *
+ *   co_return co_await libjoybus::gcn_read(bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, state);
+ * }
+ *
+ * static libjoybus::frame<256> frame;
+ * static libjoybus::task task;
+ *
+ * task = poll(frame, bus, state);
+ * task.start(done_cb, nullptr);
+ * @endcode
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/identify.h>
+#include <joybus/host/common.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+}
+
+namespace libjoybus {
+
+/**
+ * A command, with the length of its reply.
+ */
+template <std::size_t TX, std::size_t RX>
+struct command {
+  /// Length of the command, in bytes
+  static constexpr std::size_t write_len = TX;
+
+  /// Length of the reply, in bytes
+  static constexpr std::size_t read_len = RX;
+
+  /// The command bytes
+  std::array<std::uint8_t, TX> bytes;
+};
+
+/**
+ * Compile-time builders for the commands in commands.h.
+ */
+namespace commands {
+
+/// Build an identify command
+constexpr command<JOYBUS_CMD_IDENTIFY_TX, JOYBUS_CMD_IDENTIFY_RX> identify() noexcept
+{
+  return {{JOYBUS_CMD_IDENTIFY}};
+}
+
+/// Build a reset command
+constexpr command<JOYBUS_CMD_RESET_TX, JOYBUS_CMD_RESET_RX> reset() noexcept
+{
+  return {{JOYBUS_CMD_RESET}};
+}
+
+/// Build an N64 controller read command
+constexpr command<JOYBUS_CMD_N64_READ_TX, JOYBUS_CMD_N64_READ_RX> n64_read() noexcept
+{
+  return {{JOYBUS_CMD_N64_READ}};
+}
+
+/// Build a GameCube controller read command
+constexpr command<JOYBUS_CMD_GCN_READ_TX, JOYBUS_CMD_GCN_READ_RX> gcn_read(joybus_gcn_analog_mode analog_mode,
+                                                                           joybus_gcn_motor_state motor_state) noexcept
+{
+  return {{JOYBUS_CMD_GCN_READ, static_cast<std::uint8_t>(analog_mode), static_cast<std::uint8_t>(motor_state)}};
+}
+
+/// Build a GameCube controller origin read command
+constexpr command<JOYBUS_CMD_GCN_READ_ORIGIN_TX, JOYBUS_CMD_GCN_READ_ORIGIN_RX> gcn_read_origin() noexcept
+{
+  return {{JOYBUS_CMD_GCN_READ_ORIGIN}};
+}
+
+/// Build a GameCube controller calibrate command
+constexpr command<JOYBUS_CMD_GCN_CALIBRATE_TX, JOYBUS_CMD_GCN_CALIBRATE_RX> gcn_calibrate() noexcept
+{
+  return {{JOYBUS_CMD_GCN_CALIBRATE, 0, 0}};
+}
+
+/// Build a GameCube controller full precision read command
+constexpr command<JOYBUS_CMD_GCN_READ_LONG_TX, JOYBUS_CMD_GCN_READ_LONG_RX>
+gcn_read_long(joybus_gcn_motor_state motor_state) noexcept
+{
+  return {{JOYBUS_CMD_GCN_READ_LONG, 0, static_cast<std::uint8_t>(motor_state)}};
+}
+
+} // namespace commands
+
+/**
+ * GameCube controller buttons and flags.
+ */
+enum class gcn_button : std::uint16_t {
+  a           = JOYBUS_GCN_BUTTON_A,
+  b           = JOYBUS_GCN_BUTTON_B,
+  x           = JOYBUS_GCN_BUTTON_X,
+  y           = JOYBUS_GCN_BUTTON_Y,
+  start       = JOYBUS_GCN_BUTTON_START,
+  left        = JOYBUS_GCN_BUTTON_LEFT,
+  right       = JOYBUS_GCN_BUTTON_RIGHT,
+  down        = JOYBUS_GCN_BUTTON_DOWN,
+  up          = JOYBUS_GCN_BUTTON_UP,
+  z           = JOYBUS_GCN_BUTTON_Z,
+  r           = JOYBUS_GCN_BUTTON_R,
+  l           = JOYBUS_GCN_BUTTON_L,
+  need_origin = JOYBUS_GCN_NEED_ORIGIN,
+  use_origin  = JOYBUS_GCN_USE_ORIGIN,
+};
+
+/**
+ * A read-only view of a GameCube controller state.
+ */
+class gcn_controller_view {
+public:
+  /// View a state, which must outlive the view
+  constexpr explicit gcn_controller_view(const joybus_gcn_controller_state &state) noexcept : state_(&state) {}
+
+  /// Whether a button is pressed, or a flag set
+  constexpr bool pressed(gcn_button button) const noexcept
+  {
+    return state_->buttons & static_cast<std::uint16_t>(button);
+  }
+
+  /// The buttons, without the status flags
+  constexpr std::uint16_t buttons() const noexcept { return state_->buttons & JOYBUS_GCN_BUTTON_MASK; }
+
+  constexpr std::uint8_t stick_x() const noexcept { return state_->stick_x; }
+  constexpr std::uint8_t stick_y() const noexcept { return state_->stick_y; }
+  constexpr std::uint8_t substick_x() const noexcept { return state_->substick_x; }
+  constexpr std::uint8_t substick_y() const noexcept { return state_->substick_y; }
+  constexpr std::uint8_t trigger_left() const noexcept { return state_->trigger_left; }
+  constexpr std::uint8_t trigger_right() const noexcept { return state_->trigger_right; }
+  constexpr std::uint8_t analog_a() const noexcept { return state_->analog_a; }
+  constexpr std::uint8_t analog_b() const noexcept { return state_->analog_b; }
+
+  /// The underlying C state
+  constexpr const joybus_gcn_controller_state &raw() const noexcept { return *state_; }
+
+private:
+  const joybus_gcn_controller_state *state_;
+};
+
+/**
+ * N64 controller buttons and flags.
+ */
+enum class n64_button : std::uint16_t {
+  right   = JOYBUS_N64_BUTTON_RIGHT,
+  left    = JOYBUS_N64_BUTTON_LEFT,
+  down    = JOYBUS_N64_BUTTON_DOWN,
+  up      = JOYBUS_N64_BUTTON_UP,
+  start   = JOYBUS_N64_BUTTON_START,
+  z       = JOYBUS_N64_BUTTON_Z,
+  b       = JOYBUS_N64_BUTTON_B,
+  a       = JOYBUS_N64_BUTTON_A,
+  c_right = JOYBUS_N64_BUTTON_C_RIGHT,
+  c_left  = JOYBUS_N64_BUTTON_C_LEFT,
+  c_down  = JOYBUS_N64_BUTTON_C_DOWN,
+  c_up    = JOYBUS_N64_BUTTON_C_UP,
+  r       = JOYBUS_N64_BUTTON_R,
+  l       = JOYBUS_N64_BUTTON_L,
+  reset   = JOYBUS_N64_RST,
+};
+
+/**
+ * A read-only view of an N64 controller state.
+ */
+class n64_controller_view {
+public:
+  /// View a state, which must outlive the view
+  constexpr explicit n64_controller_view(const joybus_n64_controller_state &state) noexcept : state_(&state) {}
+
+  /// Whether a button is pressed, or a flag set
+  constexpr bool pressed(n64_button button) const noexcept
+  {
+    return state_->buttons & static_cast<std::uint16_t>(button);
+  }
+
+  /// The buttons, without the status flags
+  constexpr std::uint16_t buttons() const noexcept { return state_->buttons & JOYBUS_N64_BUTTON_MASK; }
+
+  constexpr std::int8_t stick_x() const noexcept { return state_->stick_x; }
+  constexpr std::int8_t stick_y() const noexcept { return state_->stick_y; }
+
+  /// The underlying C state
+  constexpr const joybus_n64_controller_state &raw() const noexcept { return *state_; }
+
+private:
+  const joybus_n64_controller_state *state_;
+};
+
+/**
+ * Storage for a coroutine frame.
+ *
+ * Holds one frame at a time, it is free again once the task using it is
+ * destroyed. Pass a libjoybus::frame of the right size.
+ */
+class frame_base {
+public:
+  frame_base(const frame_base &)            = delete;
+  frame_base &operator=(const frame_base &) = delete;
+
+  /// Whether a task's frame is in the storage
+  bool busy() const noexcept { return busy_; }
+
+protected:
+  frame_base(std::byte *storage, std::size_t size) noexcept : storage_(storage), size_(size) {}
+
+private:
+  friend class task;
+
+  // Room in front of the frame to find the storage again when it is freed
+  static constexpr std::size_t header = alignof(std::max_align_t);
+
+  void *claim(std::size_t size) noexcept
+  {
+    if (busy_ || size > size_ - header)
+      return nullptr;
+
+    busy_ = true;
+    *reinterpret_cast<frame_base **>(storage_) = this;
+    return storage_ + header;
+  }
+
+  static void release(void *ptr) noexcept
+  {
+    (*reinterpret_cast<frame_base **>(static_cast<std::byte *>(ptr) - header))->busy_ = false;
+  }
+
+  std::byte *storage_;
+  std::size_t size_;
+  bool busy_ = false;
+};
+
+/**
+ * Storage for a coroutine frame of up to N bytes.
+ */
+template <std::size_t N>
+class frame : public frame_base {
+public:
+  frame() noexcept : frame_base(storage_, sizeof(storage_)) {}
+
+private:
+  alignas(std::max_align_t) std::byte storage_[N + alignof(std::max_align_t)];
+};
+
+/**
+ * A coroutine running host transfers, with a joybus_error status as its result.
+ *
+ * The coroutine takes a libjoybus::frame_base as its first argument, which holds
+ * its frame, and its other arguments must be trivially copyable, eg. pointers
+ * and references. It starts when start() is called, and `co_return`s 0 or a
+ * negative joybus_error.
+ */
+class task {
+public:
+  /// Function type for task completion callbacks
+  using callback = void (*)(int status, void *user_data);
+
+  struct promise_type {
+    int status       = 0;
+    bool done        = false;
+    callback on_done = nullptr;
+    void *user_data  = nullptr;
+
+    // Called with the coroutine's arguments, only the frame is used. Variadic rather than a template, which GCC
+    // can't pair up with the operator delete below
+    static void *operator new(std::size_t size, frame_base &frame, ...) noexcept { return frame.claim(size); }
+
+    static void operator delete(void *ptr) noexcept { frame_base::release(ptr); }
+
+    static task get_return_object_on_allocation_failure() noexcept { return task(); }
+
+    task get_return_object() noexcept { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept
+    {
+      struct finish {
+        bool await_ready() noexcept { return false; }
+
+        // The coroutine is suspended by now, so the callback may destroy the task
+        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+        {
+          promise_type &promise = handle.promise();
+          promise.done          = true;
+          if (promise.on_done)
+            promise.on_done(promise.status, promise.user_data);
+        }
+
+        void await_resume() noexcept {}
+      };
+
+      return finish{};
+    }
+
+    void return_value(int rc) noexcept { status = rc; }
+
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+
+  task() noexcept = default;
+
+  task(task &&other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)), started_(std::exchange(other.started_, false))
+  {
+  }
+
+  task &operator=(task &&other) noexcept
+  {
+    if (this != &other) {
+      destroy();
+      handle_  = std::exchange(other.handle_, nullptr);
+      started_ = std::exchange(other.started_, false);
+    }
+    return *this;
+  }
+
+  ~task() { destroy(); }
+
+  /**
+   * Start the coroutine.
+   *
+   * Runs it up to its first transfer. The callback runs once the coroutine
+   * `co_return`s, which is before this returns if it never waits on the bus,
+   * eg. because its first transfer failed to start.
+   *
+   * @param on_done called with the coroutine's result, or nullptr
+   * @param user_data passed to the callback
+   * @return 0 if the coroutine started, -JOYBUS_ERR_NO_SPACE if its frame didn't fit, or -JOYBUS_ERR_BUSY if it
+   *         already started
+   */
+  int start(callback on_done = nullptr, void *user_data = nullptr) noexcept
+  {
+    if (!handle_)
+      return -JOYBUS_ERR_NO_SPACE;
+    if (started_)
+      return -JOYBUS_ERR_BUSY;
+
+    started_                    = true;
+    handle_.promise().on_done   = on_done;
+    handle_.promise().user_data = user_data;
+    handle_.resume();
+
+    return 0;
+  }
+
+  /// Whether the coroutine has finished
+  bool done() const noexcept { return handle_ && handle_.promise().done; }
+
+  /// The coroutine's result, once done
+  int status() const noexcept { return handle_ ? handle_.promise().status : -JOYBUS_ERR_NO_SPACE; }
+
+private:
+  explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+  void destroy() noexcept
+  {
+    if (handle_)
+      handle_.destroy();
+    handle_  = nullptr;
+    started_ = false;
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+  bool started_ = false;
+};
+
+/**
+ * View a C response struct as the reply buffer of a transfer.
+ *
+ * @param response the response, eg. a joybus_n64_controller_state
+ * @return a buffer of the size of the response
+ */
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::span<std::uint8_t, sizeof(T)> reply_buffer(T &response) noexcept
+{
+  return std::span<std::uint8_t, sizeof(T)>(reinterpret_cast<std::uint8_t *>(&response), sizeof(T));
+}
+
+namespace detail {
+
+// Awaitable for an async C function, started with a callback and user data that resume the coroutine
+template <typename Start>
+class async_op {
+public:
+  explicit async_op(Start start) noexcept : start_(std::move(start)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> handle) noexcept
+  {
+    handle_ = handle;
+
+    // The callback may run before this returns, so only write the status if the function failed to start
+    int rc = start_(&async_op::complete, this);
+    if (rc < 0) {
+      status_ = rc;
+      return false;
+    }
+
+    return true;
+  }
+
+  int await_resume() const noexcept { return status_; }
+
+private:
+  static void complete(struct joybus *bus, int status, void *user_data)
+  {
+    auto *op    = static_cast<async_op *>(user_data);
+    op->status_ = status;
+    op->handle_.resume();
+  }
+
+  Start start_;
+  std::coroutine_handle<> handle_;
+  int status_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * Await a raw transfer of a command built with libjoybus::commands.
+ *
+ * The command is copied into the awaitable, the reply buffer must stay valid
+ * until the transfer completes.
+ *
+ * @return an awaitable giving 0 on success, or a negative joybus_error
+ */
+template <std::size_t TX, std::size_t RX>
+auto transfer(struct joybus *bus, const command<TX, RX> &cmd,
+              std::type_identity_t<std::span<std::uint8_t, RX>> reply) noexcept
+{
+  return detail::async_op([bus, cmd, reply](joybus_transfer_cb callback, void *user_data) {
+    return joybus_transfer(bus, cmd.bytes.data(), TX, reply.data(), RX, callback, user_data);
+  });
+}
+
+/**
+ * Await a raw transfer of a command in a buffer.
+ *
+ * Both buffers must stay valid until the transfer completes.
+ *
+ * @return an awaitable giving 0 on success, or a negative joybus_error
+ */
+inline auto transfer(struct joybus *bus, std::span<const std::uint8_t> write, std::span<std::uint8_t> read) noexcept
+{
+  return detail::async_op([bus, write, read](joybus_transfer_cb callback, void *user_data) {
+    return joybus_transfer(bus, write.data(), static_cast<std::uint8_t>(write.size()), read.data(),
+                           static_cast<std::uint8_t>(read.size()), callback, user_data);
+  });
+}
+
+/// Await joybus_identify_async()
+inline auto identify(struct joybus *bus, joybus_id &id) noexcept
+{
+  return detail::async_op([bus, &id](joybus_transfer_cb callback, void *user_data) {
+    return joybus_identify_async(bus, &id, callback, user_data);
+  });
+}
+
+/// Await joybus_reset_async()
+inline auto reset(struct joybus *bus, joybus_id &id) noexcept
+{
+  return detail::async_op([bus, &id](joybus_transfer_cb callback, void *user_data) {
+    return joybus_reset_async(bus, &id, callback, user_data);
+  });
+}
+
+/// Await joybus_gcn_read_async()
+inline auto gcn_read(struct joybus *bus, joybus_gcn_analog_mode analog_mode, joybus_gcn_motor_state motor_state,
+                     joybus_gcn_controller_state &state) noexcept
+{
+  return detail::async_op([=, &state](joybus_transfer_cb callback, void *user_data) {
+    return joybus_gcn_read_async(bus, analog_mode, motor_state, &state, callback, user_data);
+  });
+}
+
+/// Await joybus_gcn_read_origin_async()
+inline auto gcn_read_origin(struct joybus *bus, joybus_gcn_controller_state &origin) noexcept
+{
+  return detail::async_op([bus, &origin](joybus_transfer_cb callback, void *user_data) {
+    return joybus_gcn_read_origin_async(bus, &origin, callback, user_data);
+  });
+}
+
+/// Await joybus_gcn_calibrate_async()
+inline auto gcn_calibrate(struct joybus *bus, joybus_gcn_controller_state &origin) noexcept
+{
+  return detail::async_op([bus, &origin](joybus_transfer_cb callback, void *user_data) {
+    return joybus_gcn_calibrate_async(bus, &origin, callback, user_data);
+  });
+}
+
+/// Await joybus_gcn_read_long_async()
+inline auto gcn_read_long(struct joybus *bus, joybus_gcn_motor_state motor_state,
+                          joybus_gcn_controller_state &state) noexcept
+{
+  return detail::async_op([bus, motor_state, &state](joybus_transfer_cb callback, void *user_data) {
+    return joybus_gcn_read_long_async(bus, motor_state, &state, callback, user_data);
+  });
+}
+
+/// Await joybus_n64_read_async()
+inline auto n64_read(struct joybus *bus, joybus_n64_controller_state &state) noexcept
+{
+  return detail::async_op([bus, &state](joybus_transfer_cb callback, void *user_data) {
+    return joybus_n64_read_async(bus, &state, callback, user_data);
+  });
+}
+
+} // namespace libjoybus
+
+/** @} */
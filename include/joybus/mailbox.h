@@ -0,0 +1,116 @@
+/**
+ * @defgroup joybus_mailbox Mailbox
+ * @ingroup joybus
+ *
+ * Lock-free latest-value register for handing data between cores.
+ *
+ * A mailbox holds the latest value published by a single producer, for a
+ * single consumer, typically on another core: eg. input acquisition on one
+ * core publishing input states for the Joybus interrupts on the other, or the
+ * other way around for motor states and completed host reads. Values
+ * published while the consumer is busy replace each other, the consumer only
+ * ever sees the latest.
+ *
+ * The mailbox is a triple buffer. The producer writes into a back slot, then
+ * swaps it with the middle slot, the consumer swaps the middle slot with its
+ * front slot when it takes a value. Both sides are wait-free, neither ever
+ * spins or blocks on the other, so both can be called from interrupt
+ * handlers. The only shared state is a single atomic byte, which needs
+ * atomic exchange: lock-free on ESP32 and Cortex-M3 and up, provided by the
+ * SDK's atomics support on Cortex-M0+ such as the RP2040, where the rp2xxx
+ * backend links `pico_atomic` for it.
+ *
+ * The controller targets and the GameCube adapter use mailboxes for their
+ * cross-core state when the build defines `JOYBUS_USE_MAILBOXES=1`.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// C++ has no _Atomic, std::atomic has the same layout for a byte
+#ifdef __cplusplus
+extern "C++" {
+#include <atomic>
+}
+#define JOYBUS_ATOMIC(type) std::atomic<type>
+#else
+#include <stdatomic.h>
+#define JOYBUS_ATOMIC(type) _Atomic type
+#endif
+
+/**
+ * Whether the controller targets and the GameCube adapter hand their state
+ * between cores through mailboxes. Disabled by default, enable it when input
+ * is acquired on a different core than the Joybus interrupts run on. Must be
+ * set the same way for the whole build.
+ */
+#ifndef JOYBUS_USE_MAILBOXES
+#define JOYBUS_USE_MAILBOXES 0
+#endif
+
+/// Number of value slots a mailbox needs
+#define JOYBUS_MAILBOX_SLOTS 3
+
+/**
+ * A mailbox.
+ */
+struct joybus_mailbox {
+  /// Storage for JOYBUS_MAILBOX_SLOTS values
+  uint8_t *slots;
+
+  /// Size of each value in bytes
+  uint8_t size;
+
+  /// Slot the producer writes next, owned by the producer
+  uint8_t back;
+
+  /// Slot holding the value last taken, owned by the consumer
+  uint8_t front;
+
+  /// Slot holding the latest published value, and whether it is newer than the front slot
+  JOYBUS_ATOMIC(uint8_t) middle;
+};
+
+/**
+ * Initialize a mailbox.
+ *
+ * @param mailbox the mailbox to initialize
+ * @param slots storage for JOYBUS_MAILBOX_SLOTS values, which must stay valid while the mailbox is in use
+ * @param size the size of each value in bytes
+ */
+void joybus_mailbox_init(struct joybus_mailbox *mailbox, void *slots, uint8_t size);
+
+/**
+ * Publish a value, replacing any value the consumer has not taken yet.
+ *
+ * Only call from the producer.
+ *
+ * @param mailbox the mailbox to publish to
+ * @param value the value to publish, `size` bytes
+ */
+void joybus_mailbox_put(struct joybus_mailbox *mailbox, const void *value);
+
+/**
+ * Take the latest value, if one was published since the last take.
+ *
+ * Only call from the consumer.
+ *
+ * @param mailbox the mailbox to take from
+ * @param value buffer for the value, `size` bytes, left untouched if there is no new value
+ * @return true if a new value was copied to @p value
+ */
+bool joybus_mailbox_get(struct joybus_mailbox *mailbox, void *value);
+
+/**
+ * Check whether a value was published since the last take.
+ *
+ * @param mailbox the mailbox to check
+ * @return true if joybus_mailbox_get() would return a new value
+ */
+bool joybus_mailbox_pending(struct joybus_mailbox *mailbox);
+
+/** @} */
@@ -18,6 +18,26 @@
  * allows the backend to start transmitting the response *immediately* after
  * the last byte is received.
  *
+ * Long commands, such as N64 pak writes, can be taken in one go. A handler
+ * that knows how many bytes are left returns JOYBUS_TARGET_BULK() with the
+ * count. A backend that can receive the rest of the command without an
+ * interrupt per byte, eg. by DMA, then calls the handler once more when the
+ * last byte has arrived, instead of for every byte in between. Backends
+ * without bulk reception, and callers that deliver commands a byte at a time
+ * like the capture replay, still call the handler for each byte. A handler
+ * returning JOYBUS_TARGET_BULK() has to cope with both, and should do its
+ * per-byte work as the bytes arrive when it can, eg. a pak write folds each
+ * byte into its data CRC, so little is left after the last one.
+ * Targets that wrap another should likewise not rely on seeing every byte.
+ *
+ * A handler may also return 0 without calling the response callback, and call
+ * it later from another context, eg. once the response has been fetched from
+ * elsewhere. The response must then start before the host gives up waiting,
+ * and each byte is read from the response buffer as it is sent, so later bytes
+ * can still be filled in while earlier ones go out. Deferred responses are
+ * supported by every backend, which wait for them up to the reply timeout of
+ * the bus's timing profile, see joybus_set_timing().
+ *
  * To create your own target, define a struct whose first member is a
  * ::joybus_target (so it can be cast through ::JOYBUS_TARGET), point its api
  * at a ::joybus_target_api table, and attach it to a bus with
@@ -39,6 +59,15 @@ struct joybus_target;
 /// Macro to cast a concrete Joybus target instance to a generic Joybus target instance.
 #define JOYBUS_TARGET(target) ((struct joybus_target *)(target))
 
+/// Flag set in the return value of a byte handler by JOYBUS_TARGET_BULK()
+#define JOYBUS_TARGET_BULK_FLAG 0x100
+
+/**
+ * Return value of a byte handler expecting exactly @p n more bytes, and only
+ * needing to be called again once they have all arrived.
+ */
+#define JOYBUS_TARGET_BULK(n)   (JOYBUS_TARGET_BULK_FLAG | (n))
+
 /**
  * Callback type for sending responses from target command handlers.
  *
@@ -60,7 +89,8 @@ struct joybus_target_api {
    * @param byte_idx the index of the byte that was just received
    * @param send_response a callback function to send the response
    * @param user_data user data to pass to the response callback
-   * @return positive number of bytes still expected, 0 if no more bytes expected, a negative joybus_error on failure
+   * @return positive number of bytes still expected, optionally as JOYBUS_TARGET_BULK(), 0 if no more bytes expected,
+   *         a negative joybus_error on failure
    */
   int (*byte_received)(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
                        joybus_target_response_cb send_response, void *user_data);
@@ -85,7 +115,8 @@ struct joybus_target {
  * @param byte_idx the index of the byte that was just received
  * @param send_response a callback function to send the response
  * @param user_data user data to pass to the response callback
- * @return positive number of bytes still expected, 0 if no more bytes expected, a negative joybus_error on failure
+ * @return positive number of bytes still expected, optionally as JOYBUS_TARGET_BULK(), 0 if no more bytes expected,
+ *         a negative joybus_error on failure
  */
 static inline int joybus_target_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
                                               joybus_target_response_cb send_response, void *user_data)
@@ -97,6 +128,28 @@ static inline int joybus_target_byte_received(struct joybus_target *target, cons
   return target->api->byte_received(target, command, byte_idx, send_response, user_data);
 }
 
+/**
+ * Get the number of bytes still expected from the return value of a byte handler.
+ *
+ * @param rc the return value of joybus_target_byte_received()
+ * @return the number of bytes still expected, or @p rc itself if it is 0 or an error
+ */
+static inline int joybus_target_bytes_expected(int rc)
+{
+  return rc > 0 ? rc & ~JOYBUS_TARGET_BULK_FLAG : rc;
+}
+
+/**
+ * Check whether the return value of a byte handler asks for the rest of the command in one go.
+ *
+ * @param rc the return value of joybus_target_byte_received()
+ * @return true if the handler returned JOYBUS_TARGET_BULK()
+ */
+static inline bool joybus_target_bulk(int rc)
+{
+  return rc > 0 && (rc & JOYBUS_TARGET_BULK_FLAG);
+}
+
 /**
  * Check if a target is currently attached to a bus.
  *
@@ -0,0 +1,188 @@
+/**
+ * @defgroup joybus_target_bridge Protocol Bridge
+ * @ingroup joybus_target
+ *
+ * Bridge between an N64 controller and a GameCube console, or a GameCube
+ * controller and an N64 console.
+ *
+ * One Joybus instance in host mode reads the real controller, and a second
+ * instance in target mode answers the console through a GameCube or N64
+ * controller target. The bridge sits between the console bus and that
+ * controller target: it forwards every command, and timestamps the console's
+ * reads to track its polling period.
+ *
+ * Rather than reading the controller as fast as possible, the bridge predicts
+ * the console's next poll and schedules a single upstream read to complete
+ * just before it, so the data served to the console is at most
+ * ::joybus_target_bridge_config::max_age_us old. Until the polling period is
+ * known, the controller is read once after each console poll.
+ *
+ * Buttons and the main stick are translated through lookup tables built at
+ * init. When bridging an N64 controller, the C buttons drive the C-stick and
+ * L/R drive the analog triggers. When bridging a GameCube controller, the
+ * C-stick drives the C buttons.
+ *
+ * Call joybus_target_bridge_poll() regularly from the main loop, or from a
+ * timer armed for joybus_target_bridge_next_read_us(), to start upstream reads
+ * when they are due.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+#include <joybus/target.h>
+#include <joybus/common/gcn_controller.h>
+#include <joybus/common/n64_controller.h>
+
+/// Macro to cast from a generic Joybus target to a bridge
+#define JOYBUS_TARGET_BRIDGE(target) ((struct joybus_target_bridge *)(target))
+
+/**
+ * Bridging direction.
+ */
+enum joybus_target_bridge_mode {
+  /// N64 controller on a GameCube console, the target is a ::joybus_target_gcn_controller
+  JOYBUS_TARGET_BRIDGE_N64_TO_GCN,
+
+  /// GameCube controller on an N64 console, the target is a ::joybus_target_n64_controller
+  JOYBUS_TARGET_BRIDGE_GCN_TO_N64,
+};
+
+/**
+ * Bridge configuration.
+ */
+struct joybus_target_bridge_config {
+  /// Bridging direction
+  enum joybus_target_bridge_mode mode;
+
+  /// Maximum age of the data served to the console, in microseconds
+  uint32_t max_age_us;
+
+  /// Destination button mask for each source button bit
+  uint16_t button_map[16];
+
+  /// N64 stick value at full deflection, from 1 to 127
+  uint8_t n64_range;
+
+  /// GameCube stick displacement from center at full deflection, from 1 to 127
+  uint8_t gcn_range;
+
+  /// GameCube C-stick displacement that presses a C button
+  uint8_t substick_threshold;
+};
+
+/**
+ * Protocol bridge, attached to the console bus in place of the controller target.
+ */
+struct joybus_target_bridge {
+  /// Base target interface
+  struct joybus_target base;
+
+  /// Joybus instance reading the controller, in host mode
+  struct joybus *host_bus;
+
+  /// Controller target answering the console
+  struct joybus_target *target;
+
+  /// Bridge configuration
+  struct joybus_target_bridge_config config;
+
+  /// Latest controller state, read from the host bus
+  union {
+    struct joybus_gcn_controller_state gcn;
+    struct joybus_n64_controller_state n64;
+  } upstream;
+
+  /// Button translation tables, indexed by the low and high source button bytes
+  uint16_t button_lut[2][256];
+
+  /// Main stick translation table, indexed by the raw source axis byte
+  uint8_t axis_lut[256];
+
+  /// Time of the last console poll
+  uint64_t last_poll_us;
+
+  /// Estimated console polling period, 0 until known
+  uint32_t period_us;
+
+  /// Consecutive console polls that didn't fit the estimated period
+  uint8_t outliers;
+
+  /// Whether the console polled since the last upstream read started
+  bool polled;
+
+  /// Estimated duration of an upstream read
+  uint32_t read_us;
+
+  /// Start time of the last upstream read
+  uint64_t read_start_us;
+
+  /// Completion time of the last successful upstream read, 0 if none
+  uint64_t data_us;
+
+  /// Time the next upstream read is due
+  volatile uint64_t next_read_us;
+
+  /// Whether an upstream read is in flight
+  volatile bool read_busy;
+
+  /// Number of upstream reads started
+  uint32_t reads;
+
+  /// Number of console polls seen
+  uint32_t polls;
+
+  /// Number of console polls served data older than the maximum age
+  uint32_t stale_polls;
+
+  /// Age of the data served to the last console poll
+  uint32_t last_age_us;
+};
+
+/**
+ * Get the default bridge configuration for a direction.
+ *
+ * @param mode the bridging direction
+ * @return the default configuration
+ */
+struct joybus_target_bridge_config joybus_target_bridge_config_default(enum joybus_target_bridge_mode mode);
+
+/**
+ * Initialize a bridge.
+ *
+ * Attach the bridge to the console bus, not @p target. The host bus must
+ * already be enabled in host mode, and the bridge keeps time on its clock.
+ *
+ * @param bridge the bridge to initialize
+ * @param host_bus the Joybus instance reading the controller
+ * @param target the controller target answering the console, matching the configured mode
+ * @param config the bridge configuration
+ * @return 0 on success, -JOYBUS_ERR_INVALID if a stick range is out of bounds
+ */
+int joybus_target_bridge_init(struct joybus_target_bridge *bridge, struct joybus *host_bus,
+                              struct joybus_target *target, struct joybus_target_bridge_config config);
+
+/**
+ * Start an upstream read if one is due.
+ *
+ * @param bridge the bridge to poll
+ */
+void joybus_target_bridge_poll(struct joybus_target_bridge *bridge);
+
+/**
+ * Get the time the next upstream read is due.
+ *
+ * @param bridge the bridge to check
+ * @return the due time in microseconds, UINT64_MAX while a read is in flight or waiting on the console
+ */
+static inline uint64_t joybus_target_bridge_next_read_us(struct joybus_target_bridge *bridge)
+{
+  return bridge->next_read_us;
+}
+
+/** @} */
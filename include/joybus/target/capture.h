@@ -0,0 +1,224 @@
+/**
+ * @defgroup joybus_target_capture Traffic Capture and Replay
+ * @ingroup joybus_target
+ *
+ * Record the commands a console sends to a target, and the target's responses,
+ * then replay them against a target later.
+ *
+ * The recorder sits between the console bus and a target, so it works with
+ * any backend: it passes every command byte on to the target, and appends
+ * each command, its response and a timestamp to a capture buffer.
+ *
+ * The replay driver feeds each recorded command to a target byte by byte,
+ * through joybus_target_byte_received(), as the backend would have. It reports
+ * the response and the time spent in the target's handler for every command,
+ * so captures of real console sessions can be used as regression tests for
+ * both behaviour and performance.
+ *
+ * A capture starts with an 8-byte header: the magic "JBCP", the format
+ * version, and three reserved bytes. Each record then holds the time since the
+ * previous command started in microseconds as a little-endian 32-bit value,
+ * the command and response lengths as one byte each, the command bytes and the
+ * response bytes.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+#include <joybus/target.h>
+
+/// Capture format version
+#define JOYBUS_CAPTURE_VERSION    1
+
+/// Size of the capture header
+#define JOYBUS_CAPTURE_HEADER_LEN 8
+
+/// Size of a record without its command and response bytes
+#define JOYBUS_CAPTURE_RECORD_LEN 6
+
+/// Macro to cast from a generic Joybus target to a recorder
+#define JOYBUS_TARGET_RECORDER(target) ((struct joybus_target_recorder *)(target))
+
+/**
+ * A recorded command and its response.
+ */
+struct joybus_capture_record {
+  /// Time the command started, in microseconds since the start of the capture
+  uint64_t time_us;
+
+  /// The command
+  const uint8_t *command;
+  uint8_t command_len;
+
+  /// The response, empty if the target didn't respond
+  const uint8_t *response;
+  uint8_t response_len;
+};
+
+/**
+ * Recorder, attached to the console bus in place of the recorded target.
+ */
+struct joybus_target_recorder {
+  /// Base target interface
+  struct joybus_target base;
+
+  /// The target being recorded
+  struct joybus_target *target;
+
+  /// Console bus the recorder is attached to, timestamps are taken on its clock
+  struct joybus *bus;
+
+  /// Capture buffer
+  uint8_t *buf;
+  size_t size;
+
+  /// Number of bytes captured
+  size_t len;
+
+  /// Start time of the capture, and of the previous command
+  uint64_t start_us;
+  uint64_t last_us;
+
+  /// Command in progress, written out when the next one starts
+  uint8_t command[JOYBUS_BLOCK_SIZE];
+  uint8_t command_len;
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+  uint8_t response_len;
+  uint64_t command_us;
+  bool pending;
+
+  /// Response callback for the command in progress
+  joybus_target_response_cb send_response;
+  void *response_user_data;
+
+  /// Number of commands recorded
+  uint32_t records;
+
+  /// Number of commands dropped because the buffer was full
+  uint32_t dropped;
+};
+
+/**
+ * Initialize a recorder and write the capture header.
+ *
+ * The console bus must already be initialized, so its clock is set.
+ *
+ * @param recorder the recorder to initialize
+ * @param bus the console bus the recorder will be attached to
+ * @param target the target to record
+ * @param buf the buffer to capture into
+ * @param size the size of the buffer
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_target_recorder_init(struct joybus_target_recorder *recorder, struct joybus *bus,
+                                struct joybus_target *target, uint8_t *buf, size_t size);
+
+/**
+ * Write out the command in progress and finish the capture.
+ *
+ * Call once the console bus has been disabled.
+ *
+ * @param recorder the recorder to finish
+ * @return the length of the capture
+ */
+size_t joybus_target_recorder_finish(struct joybus_target_recorder *recorder);
+
+/**
+ * Capture reader.
+ */
+struct joybus_capture_reader {
+  /// The capture
+  const uint8_t *buf;
+  size_t len;
+
+  /// Read position
+  size_t pos;
+
+  /// Start time of the previous record
+  uint64_t time_us;
+};
+
+/**
+ * Start reading a capture.
+ *
+ * @param reader the reader to initialize
+ * @param buf the capture
+ * @param len the length of the capture
+ * @return 0 on success, a negative joybus_error if the header is invalid
+ */
+int joybus_capture_reader_init(struct joybus_capture_reader *reader, const uint8_t *buf, size_t len);
+
+/**
+ * Read the next record.
+ *
+ * The record points into the capture buffer.
+ *
+ * @param reader the reader to use
+ * @param record the record to fill in
+ * @return 1 if a record was read, 0 at the end of the capture, a negative joybus_error if it is malformed
+ */
+int joybus_capture_reader_next(struct joybus_capture_reader *reader, struct joybus_capture_record *record);
+
+/**
+ * Result of replaying one command.
+ */
+struct joybus_capture_result {
+  /// The recorded command and response
+  struct joybus_capture_record record;
+
+  /// Response sent by the target during replay
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+  uint8_t response_len;
+
+  /// Whether the response matched the recorded one
+  bool match;
+
+  /// Time spent in the target's handler over the whole command, in nanoseconds
+  uint64_t handler_ns;
+};
+
+/**
+ * Callback type for replay results.
+ *
+ * @param result the result of replaying a command
+ * @param user_data user data from the replay config
+ */
+typedef void (*joybus_capture_result_cb)(const struct joybus_capture_result *result, void *user_data);
+
+/**
+ * Replay configuration.
+ */
+struct joybus_capture_replay_config {
+  /// Monotonic nanosecond clock, to time the target's handler, or NULL
+  uint64_t (*now_ns)(void);
+
+  /// Called before each command with its recorded time, eg. to sleep until then or advance a simulated clock, or NULL
+  /// to replay as fast as possible
+  void (*wait_until_us)(uint64_t time_us, void *user_data);
+
+  /// Called with the result of each command, or NULL
+  joybus_capture_result_cb on_result;
+
+  /// User data for the callbacks
+  void *user_data;
+};
+
+/**
+ * Replay a capture against a target.
+ *
+ * @param buf the capture
+ * @param len the length of the capture
+ * @param target the target to replay against
+ * @param config the replay configuration
+ * @return the number of responses that didn't match the capture, a negative joybus_error if it is malformed
+ */
+int joybus_capture_replay(const uint8_t *buf, size_t len, struct joybus_target *target,
+                          const struct joybus_capture_replay_config *config);
+
+/** @} */
@@ -12,9 +12,38 @@
 #include <stdbool.h>
 
 #include <joybus/identify.h>
+#include <joybus/mailbox.h>
 #include <joybus/target.h>
 #include <joybus/common/gcn_controller.h>
 
+/**
+ * Whether to support WaveBird receivers. Enabled by default. Define as 0 for
+ * wired-only products to compile out the probe device and fix device
+ * handlers, the wireless ID API and the wireless branches of the other
+ * handlers.
+ */
+#ifndef JOYBUS_USE_GCN_WAVEBIRD
+#define JOYBUS_USE_GCN_WAVEBIRD 1
+#endif
+
+/**
+ * Whether to support the "read long" command. Enabled by default. No games
+ * are known to use it, define as 0 to compile it out.
+ */
+#ifndef JOYBUS_USE_GCN_READ_LONG
+#define JOYBUS_USE_GCN_READ_LONG 1
+#endif
+
+/**
+ * Whether to pack read responses for every analog mode. Enabled by default.
+ * Most games use analog mode 3, which is sent straight from the input state.
+ * Define as 0 to compile out the packing and its buffer, read responses then
+ * use the analog mode 3 layout whatever mode the console asks for.
+ */
+#ifndef JOYBUS_USE_GCN_ANALOG_MODES
+#define JOYBUS_USE_GCN_ANALOG_MODES 1
+#endif
+
 struct joybus_target_gcn_controller;
 
 /// Macro to cast from a generic Joybus target to a GameCube controller target
@@ -51,8 +80,10 @@ struct joybus_target_gcn_controller {
   /// Current input state
   struct joybus_gcn_controller_state input;
 
+#if JOYBUS_USE_GCN_ANALOG_MODES
   /// Packed input state buffer
   uint8_t packed_input[8];
+#endif
 
   /// Whether the input state is valid
   bool input_valid;
@@ -62,6 +93,20 @@ struct joybus_target_gcn_controller {
 
   /// Callback for controller motor state change events
   joybus_target_gcn_controller_motor_cb on_motor_state_change;
+
+#if JOYBUS_USE_MAILBOXES
+  /// Input states published from another core
+  struct joybus_mailbox input_mailbox;
+  struct joybus_gcn_controller_state input_slots[JOYBUS_MAILBOX_SLOTS];
+
+  /// Origins published from another core
+  struct joybus_mailbox origin_mailbox;
+  struct joybus_gcn_controller_state origin_slots[JOYBUS_MAILBOX_SLOTS];
+
+  /// Motor states for another core
+  struct joybus_mailbox motor_mailbox;
+  uint8_t motor_slots[JOYBUS_MAILBOX_SLOTS];
+#endif
 };
 
 /**
@@ -82,6 +127,7 @@ static inline void joybus_target_gcn_controller_init(struct joybus_target_gcn_co
   joybus_target_gcn_controller_init_with_type(controller, JOYBUS_DEVICE_GCN_CONTROLLER);
 }
 
+#if JOYBUS_USE_GCN_WAVEBIRD
 /**
  * Initialize a GameCube controller target as a WaveBird receiver.
  *
@@ -91,6 +137,7 @@ static inline void joybus_target_gcn_controller_init_wavebird(struct joybus_targ
 {
   joybus_target_gcn_controller_init_with_type(controller, JOYBUS_DEVICE_GCN_WAVEBIRD);
 }
+#endif
 
 /**
  * Set the reset callback for the controller.
@@ -124,9 +171,15 @@ void joybus_target_gcn_controller_set_motor_cb(struct joybus_target_gcn_controll
  */
 static inline bool joybus_target_gcn_controller_is_wireless(struct joybus_target_gcn_controller *controller)
 {
+#if JOYBUS_USE_GCN_WAVEBIRD
   return controller->id.type & JOYBUS_TYPE_GCN_WIRELESS;
+#else
+  return false;
+#endif
 }
 
+#if JOYBUS_USE_GCN_WAVEBIRD
+
 /**
  * Set the wireless ID of the controller.
  *
@@ -164,6 +217,7 @@ static inline bool joybus_target_gcn_controller_wireless_id_fixed(struct joybus_
 {
   return controller->id.type & JOYBUS_TYPE_GCN_WIRELESS_ID_FIXED;
 }
+#endif
 
 /**
  * Mark the input state as valid.
@@ -190,4 +244,50 @@ static inline void joybus_target_gcn_controller_input_valid(struct joybus_target
 void joybus_target_gcn_controller_set_origin(struct joybus_target_gcn_controller *controller,
                                              struct joybus_gcn_controller_state *new_origin);
 
+#if JOYBUS_USE_MAILBOXES
+/**
+ * Publish a new input state from another core.
+ *
+ * The controller picks up the latest published state when the next command
+ * starts, and marks the input state valid. The "need origin" and "use origin"
+ * flags in the published buttons are ignored, the controller keeps track of
+ * those itself. Only call from a single core.
+ *
+ * @param controller the controller to publish to
+ * @param input the new input state
+ */
+void joybus_target_gcn_controller_publish_input(struct joybus_target_gcn_controller *controller,
+                                                const struct joybus_gcn_controller_state *input);
+
+/**
+ * Publish a new origin from another core.
+ *
+ * The controller applies the latest published origin when the next command
+ * starts, like joybus_target_gcn_controller_set_origin(). Only call from a
+ * single core.
+ *
+ * @param controller the controller to publish to
+ * @param origin the new origin
+ */
+void joybus_target_gcn_controller_publish_origin(struct joybus_target_gcn_controller *controller,
+                                                 const struct joybus_gcn_controller_state *origin);
+
+/**
+ * Take the latest motor state requested by the console, from another core.
+ *
+ * Motor states are published alongside the motor state change callback, use
+ * this instead of the callback to drive the motor from another core. Only
+ * call from a single core.
+ *
+ * @param controller the controller to take the motor state from
+ * @param state set to the latest motor state, left untouched if it hasn't changed
+ * @return true if the motor state changed since the last call
+ */
+static inline bool joybus_target_gcn_controller_take_motor_state(struct joybus_target_gcn_controller *controller,
+                                                                 uint8_t *state)
+{
+  return joybus_mailbox_get(&controller->motor_mailbox, state);
+}
+#endif
+
 /** @} */
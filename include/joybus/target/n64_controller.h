@@ -10,11 +10,23 @@
 #pragma once
 
 #include <joybus/bus.h>
+#include <joybus/commands.h>
 #include <joybus/identify.h>
+#include <joybus/mailbox.h>
 #include <joybus/target.h>
 #include <joybus/common/n64_controller.h>
 #include <joybus/target/n64_pak.h>
 
+/**
+ * Whether to support attaching paks. Enabled by default. Define as 0 for
+ * products without a pak slot to compile out the pak API and the pak paths
+ * of the pak read and pak write handlers. The controller then answers pak
+ * commands like an OEM controller with nothing plugged in.
+ */
+#ifndef JOYBUS_USE_N64_PAKS
+#define JOYBUS_USE_N64_PAKS 1
+#endif
+
 struct joybus_target_n64_controller;
 
 /// Macro to cast from a generic Joybus target to an N64 controller target
@@ -46,14 +58,25 @@ struct joybus_target_n64_controller {
   /// Callback for controller reset events
   joybus_target_n64_controller_reset_cb on_reset;
 
+#if JOYBUS_USE_N64_PAKS
   /// Currently attached pak (if any)
   struct joybus_target_n64_pak *pak;
+#endif
 
   /// CRC for data transfer commands
   uint8_t crc;
 
-  /// Response buffer
-  uint8_t response[JOYBUS_BLOCK_SIZE];
+  /// Number of pak write payload bytes folded into crc so far
+  uint8_t crc_len;
+
+  /// Response buffer, sized for the largest response (a pak read)
+  uint8_t response[JOYBUS_CMD_N64_PAK_READ_RX];
+
+#if JOYBUS_USE_MAILBOXES
+  /// Input states published from another core
+  struct joybus_mailbox input_mailbox;
+  struct joybus_n64_controller_state input_slots[JOYBUS_MAILBOX_SLOTS];
+#endif
 };
 
 /**
@@ -75,6 +98,7 @@ void joybus_target_n64_controller_init(struct joybus_target_n64_controller *cont
 void joybus_target_n64_controller_set_reset_cb(struct joybus_target_n64_controller *controller,
                                                joybus_target_n64_controller_reset_cb callback);
 
+#if JOYBUS_USE_N64_PAKS
 /**
  * Attach an pak to the controller.
  *
@@ -90,6 +114,7 @@ void joybus_target_n64_controller_attach_pak(struct joybus_target_n64_controller
  * @param controller the controller to detach the pak from
  */
 void joybus_target_n64_controller_detach_pak(struct joybus_target_n64_controller *controller);
+#endif
 
 /**
  * Sample the current stick position as the controller's neutral origin.
@@ -97,4 +122,18 @@ void joybus_target_n64_controller_detach_pak(struct joybus_target_n64_controller
  * @param controller the controller to calibrate
  */
 void joybus_target_n64_controller_calibrate(struct joybus_target_n64_controller *controller);
+
+#if JOYBUS_USE_MAILBOXES
+/**
+ * Publish a new input state from another core.
+ *
+ * The controller picks up the latest published state when the next command
+ * starts. Only call from a single core.
+ *
+ * @param controller the controller to publish to
+ * @param input the new input state
+ */
+void joybus_target_n64_controller_publish_input(struct joybus_target_n64_controller *controller,
+                                                const struct joybus_n64_controller_state *input);
+#endif
 /** @} */
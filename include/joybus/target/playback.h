@@ -0,0 +1,233 @@
+/**
+ * @defgroup joybus_target_playback Input Playback
+ * @ingroup joybus_target
+ *
+ * Frame-accurate playback of a pre-recorded input stream, for automated game
+ * testing.
+ *
+ * The playback target sits between the console bus and a GameCube or N64
+ * controller target, and replaces the controller's input with the next frame
+ * of the stream each time the console reads it. Every other command is left to
+ * the controller target.
+ *
+ * Streams are delta and run-length encoded, see @ref joybus_playback_stream,
+ * and are decoded straight from memory: a file mapped with mmap() on Linux, or
+ * memory-mapped flash on microcontrollers. Decoding only keeps the previous
+ * frame and the stream position, so a run of any length needs the same
+ * RAM.
+ *
+ * Decoding happens outside the command handler: call
+ * joybus_target_playback_fill() regularly from the main loop to decode frames
+ * ahead into a small ring. The command handler only takes the next frame off
+ * the ring. If the ring runs dry, the previous frame is repeated and counted as
+ * an underrun, which breaks frame accuracy.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <joybus/target.h>
+
+/**
+ * @defgroup joybus_playback_stream Stream Format
+ *
+ * A stream starts with an 8-byte header: the magic "JBPS", the format version,
+ * the ::joybus_playback_device, and two reserved bytes.
+ *
+ * Each frame is the controller's input state in wire format, a
+ * ::joybus_n64_controller_state or a ::joybus_gcn_controller_state. Frames are
+ * encoded as a sequence of records, each starting with a tag byte:
+ *
+ * - `0x00`-`0x7F`: repeat the previous frame `tag + 1` times
+ * - `0x80`: one frame that differs from the previous one, followed by a
+ *   little-endian mask of the changed bytes (bit n for byte n), one byte long
+ *   for N64 frames and two for GameCube frames, then the new value of each
+ *   changed byte, in order
+ * - `0xFF`: end of stream
+ *
+ * The frame before the first one is all zeros.
+ *
+ * @{
+ */
+
+/// Stream format version
+#define JOYBUS_PLAYBACK_VERSION    1
+
+/// Size of the stream header
+#define JOYBUS_PLAYBACK_HEADER_LEN 8
+
+/// Largest frame, the GameCube input state
+#define JOYBUS_PLAYBACK_FRAME_MAX  10
+
+/// Record tag for a changed frame
+#define JOYBUS_PLAYBACK_TAG_DELTA  0x80
+
+/// Record tag for the end of the stream
+#define JOYBUS_PLAYBACK_TAG_END    0xFF
+
+/// Longest run of repeated frames in a single record
+#define JOYBUS_PLAYBACK_RUN_MAX    128
+
+/**
+ * Controller type a stream was recorded from.
+ */
+enum joybus_playback_device {
+  /// N64 controller, 4-byte frames
+  JOYBUS_PLAYBACK_N64,
+
+  /// GameCube controller, 10-byte frames
+  JOYBUS_PLAYBACK_GCN,
+};
+
+/**
+ * Stream encoder, writing into a caller-provided buffer.
+ */
+struct joybus_playback_encoder {
+  /// Output buffer
+  uint8_t *buf;
+
+  /// Size of the output buffer
+  size_t size;
+
+  /// Number of bytes written
+  size_t len;
+
+  /// Size of each frame
+  uint8_t frame_len;
+
+  /// Previous frame
+  uint8_t prev[JOYBUS_PLAYBACK_FRAME_MAX];
+
+  /// Repeats of the previous frame not yet written
+  uint8_t run;
+};
+
+/**
+ * Start encoding a stream.
+ *
+ * @param encoder the encoder to initialize
+ * @param device the controller type the frames are for
+ * @param buf the buffer to write the stream to
+ * @param size the size of the buffer
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_playback_encoder_init(struct joybus_playback_encoder *encoder, enum joybus_playback_device device,
+                                 uint8_t *buf, size_t size);
+
+/**
+ * Append a frame to the stream.
+ *
+ * @param encoder the encoder to use
+ * @param frame the controller input state, in wire format
+ * @return 0 on success, a negative joybus_error on failure
+ */
+int joybus_playback_encoder_add(struct joybus_playback_encoder *encoder, const void *frame);
+
+/**
+ * Finish the stream.
+ *
+ * @param encoder the encoder to use
+ * @return the length of the stream on success, a negative joybus_error on failure
+ */
+int joybus_playback_encoder_finish(struct joybus_playback_encoder *encoder);
+
+/** @} */
+
+/// Macro to cast from a generic Joybus target to a playback target
+#define JOYBUS_TARGET_PLAYBACK(target) ((struct joybus_target_playback *)(target))
+
+/// Number of decoded frames kept ready, must be a power of two
+#ifndef JOYBUS_TARGET_PLAYBACK_RING_LEN
+#define JOYBUS_TARGET_PLAYBACK_RING_LEN 8
+#endif
+
+/**
+ * Input playback target, attached to the console bus in place of the controller target.
+ */
+struct joybus_target_playback {
+  /// Base target interface
+  struct joybus_target base;
+
+  /// Controller target answering the console, matching the stream's device
+  struct joybus_target *target;
+
+  /// Controller type the stream was recorded from
+  enum joybus_playback_device device;
+
+  /// Size of each frame
+  uint8_t frame_len;
+
+  /// The stream
+  const uint8_t *stream;
+  size_t stream_len;
+
+  /// Decoder position in the stream
+  size_t pos;
+
+  /// Last decoded frame
+  uint8_t prev[JOYBUS_PLAYBACK_FRAME_MAX];
+
+  /// Repeats of the last decoded frame still to come
+  uint8_t run;
+
+  /// Whether the decoder reached the end of the stream
+  bool decoded;
+
+  /// Whether the stream turned out to be malformed
+  bool corrupt;
+
+  /// Decoded frames, ready to be played
+  uint8_t ring[JOYBUS_TARGET_PLAYBACK_RING_LEN][JOYBUS_PLAYBACK_FRAME_MAX];
+
+  /// Ring write and read counters, written by the decoder and the command handler respectively
+  volatile uint8_t head;
+  volatile uint8_t tail;
+
+  /// Number of frames played
+  uint32_t frames;
+
+  /// Number of console reads that found the ring empty before the end of the stream
+  uint32_t underruns;
+};
+
+/**
+ * Initialize a playback target and decode the first frames.
+ *
+ * The stream must stay valid, and unchanged, for as long as the target is in
+ * use.
+ *
+ * @param playback the playback target to initialize
+ * @param target the controller target answering the console, a ::joybus_target_gcn_controller or a
+ *   ::joybus_target_n64_controller matching the stream's device
+ * @param stream the encoded stream
+ * @param len the length of the stream
+ * @return 0 on success, a negative joybus_error if the stream header is invalid
+ */
+int joybus_target_playback_init(struct joybus_target_playback *playback, struct joybus_target *target,
+                                const uint8_t *stream, size_t len);
+
+/**
+ * Decode frames ahead until the ring is full.
+ *
+ * @param playback the playback target
+ * @return the number of frames decoded
+ */
+int joybus_target_playback_fill(struct joybus_target_playback *playback);
+
+/**
+ * Check whether every frame of the stream has been played.
+ *
+ * @param playback the playback target
+ * @return true once the stream is exhausted
+ */
+static inline bool joybus_target_playback_finished(struct joybus_target_playback *playback)
+{
+  return playback->decoded && playback->head == playback->tail;
+}
+
+/** @} */
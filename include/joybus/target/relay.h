@@ -0,0 +1,180 @@
+/**
+ * @defgroup joybus_target_relay Passthrough Relay
+ * @ingroup joybus_target
+ *
+ * Cut-through relay between a console and a real controller, for inspecting
+ * and modifying the traffic between them.
+ *
+ * The relay is attached to a Joybus instance in target mode wired to the
+ * console, and forwards commands through a second instance in host mode wired
+ * to the controller. The controller's response is relayed back to the console,
+ * optionally rewritten byte by byte on the way.
+ *
+ * A store-and-forward relay can't meet the console's reply timeout: the
+ * command would have to be received in full before being sent on, and the
+ * response received in full before being sent back. Instead, the relay starts
+ * the downstream command while the console's command is still arriving, as
+ * early as the console and controller bit rates allow, and starts replying to
+ * the console as soon as the first ::joybus_target_relay_config::reply_lag
+ * response bytes have arrived. The remaining bytes are rewritten and sent on as
+ * they come in.
+ *
+ * Even so, the console sees a turnaround of roughly two byte times rather than
+ * the few microseconds of a real controller, which most consoles tolerate. The
+ * relay measures the turnaround of every command and counts the ones that miss
+ * ::joybus_target_relay_config::reply_deadline_us.
+ *
+ * Cut-through needs a host backend that reads each command byte from the
+ * write buffer just before it goes out, see ::joybus::streams_write_buf. Only
+ * the loopback backend does. The rp2xxx backend hands the whole command to
+ * DMA, which fills the PIO FIFO ahead of the wire, and the esp32 and gecko_sdk
+ * backends encode a byte or two ahead. Waiting for the whole command before
+ * forwarding it would put the turnaround well past the console's reply
+ * timeout, so the relay refuses host instances on those backends.
+ *
+ * The host instance must support per-byte receive callbacks, see
+ * joybus_set_rx_byte_cb(). The relay sets the reply timeout of the console
+ * instance's timing profile to the reply deadline, so it waits as long for the
+ * deferred reply as the console does, and gives up on its own when the
+ * controller doesn't answer.
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/bus.h>
+#include <joybus/target.h>
+
+/// Macro to cast from a generic Joybus target to a relay
+#define JOYBUS_TARGET_RELAY(target) ((struct joybus_target_relay *)(target))
+
+/**
+ * Function type for the response rewrite hook.
+ *
+ * Called once for each response byte, in order, before it is sent to the
+ * console. Bytes up to `idx + reply_lag - 1` of the controller's response are
+ * available, along with the whole command.
+ *
+ * @param command the command sent by the console
+ * @param response the controller's response so far
+ * @param idx the index of the response byte to rewrite
+ * @param user_data user data from the relay config
+ * @return the byte to send to the console
+ */
+typedef uint8_t (*joybus_target_relay_rewrite_fn)(const uint8_t *command, const uint8_t *response, uint8_t idx,
+                                                  void *user_data);
+
+/**
+ * Relay configuration.
+ */
+struct joybus_target_relay_config {
+  /// Bit rate of the console's commands, in Hz
+  uint32_t console_freq;
+
+  /// Number of response bytes received from the controller before replying to the console
+  uint8_t reply_lag;
+
+  /// Longest acceptable turnaround, match to the console's reply timeout
+  uint32_t reply_deadline_us;
+
+  /// Response rewrite hook, or NULL to relay responses unchanged
+  joybus_target_relay_rewrite_fn rewrite;
+
+  /// User data for the rewrite hook
+  void *user_data;
+};
+
+/**
+ * Passthrough relay, attached to the console bus.
+ */
+struct joybus_target_relay {
+  /// Base target interface
+  struct joybus_target base;
+
+  /// Joybus instance wired to the console, in target mode
+  struct joybus *console_bus;
+
+  /// Joybus instance wired to the controller, in host mode
+  struct joybus *host_bus;
+
+  /// Relay configuration
+  struct joybus_target_relay_config config;
+
+  /// Command bytes to wait for before forwarding, indexed by command length
+  uint8_t forward_at[JOYBUS_BLOCK_SIZE + 1];
+
+  /// Command being relayed, owned by the console bus
+  const uint8_t *command;
+
+  /// Command and response lengths of the command being relayed
+  uint8_t tx_len;
+  uint8_t rx_len;
+
+  /// Response callback for the command being relayed
+  joybus_target_response_cb send_response;
+  void *response_user_data;
+
+  /// Response from the controller
+  uint8_t response[JOYBUS_BLOCK_SIZE];
+
+  /// Response sent to the console
+  uint8_t reply[JOYBUS_BLOCK_SIZE];
+
+  /// Number of response bytes received from the controller
+  uint8_t received;
+
+  /// Number of response bytes rewritten
+  uint8_t rewritten;
+
+  /// Whether the reply to the console has started
+  bool replying;
+
+  /// End time of the console's command
+  uint64_t command_end_us;
+
+  /// Number of commands relayed
+  uint32_t relayed;
+
+  /// Number of commands the controller didn't answer, or that couldn't be forwarded
+  uint32_t dropped;
+
+  /// Number of replies that started after the deadline
+  uint32_t late_replies;
+
+  /// Turnaround of the last reply, from the end of the console's command
+  uint32_t last_turnaround_us;
+
+  /// Longest turnaround seen
+  uint32_t max_turnaround_us;
+};
+
+/**
+ * Get the default relay configuration.
+ *
+ * Assumes the slowest console, and replies after the first response byte.
+ *
+ * @return the default configuration
+ */
+struct joybus_target_relay_config joybus_target_relay_config_default(void);
+
+/**
+ * Initialize a relay.
+ *
+ * Attaches the relay to the console bus and registers a receive callback on the
+ * host bus. The host bus must be enabled in host mode, and the console bus in
+ * target mode.
+ *
+ * @param relay the relay to initialize
+ * @param console_bus the Joybus instance wired to the console
+ * @param host_bus the Joybus instance wired to the controller
+ * @param config the relay configuration
+ * @return 0 on success, -JOYBUS_ERR_NOT_SUPPORTED if the host instance doesn't stream its write buffer
+ */
+int joybus_target_relay_init(struct joybus_target_relay *relay, struct joybus *console_bus, struct joybus *host_bus,
+                             struct joybus_target_relay_config config);
+
+/** @} */
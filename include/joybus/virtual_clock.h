@@ -0,0 +1,93 @@
+/**
+ * @defgroup joybus_virtual_clock Virtual Clock
+ * @ingroup joybus_clock
+ *
+ * Deterministic clock for simulations and tests.
+ *
+ * Time only moves when joybus_virtual_clock_advance_to() is called, and alarms
+ * fire in expiry order at their own time as the clock passes them, so a
+ * simulation sees the same sequence of events on every run. Time is kept in
+ * nanoseconds, and the cycle counter runs at a configurable CPU frequency.
+ *
+ * The loopback backend runs on a virtual clock, see joybus_loopback_clock().
+ *
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <joybus/clock.h>
+
+/**
+ * Macro to cast a generic clock to a virtual clock.
+ */
+#define JOYBUS_VIRTUAL_CLOCK(clock) ((struct joybus_virtual_clock *)(clock))
+
+/**
+ * A virtual clock.
+ */
+struct joybus_virtual_clock {
+  /// Base clock interface
+  struct joybus_clock base;
+
+  /// Current time, in nanoseconds
+  uint64_t now_ns;
+
+  /// Simulated CPU frequency, in MHz
+  uint32_t cpu_mhz;
+};
+
+/**
+ * Initialize a virtual clock at time zero.
+ *
+ * @param clock the clock to initialize
+ * @param cpu_mhz the simulated CPU frequency for the cycle counter, in MHz
+ */
+void joybus_virtual_clock_init(struct joybus_virtual_clock *clock, uint32_t cpu_mhz);
+
+/**
+ * Get the current time in nanoseconds.
+ *
+ * @param clock the clock to use
+ * @return the current time, in nanoseconds
+ */
+static inline uint64_t joybus_virtual_clock_now_ns(const struct joybus_virtual_clock *clock)
+{
+  return clock->now_ns;
+}
+
+/**
+ * Get the expiry time of the earliest pending alarm.
+ *
+ * @param clock the clock to use
+ * @param at_ns set to the expiry time, in nanoseconds
+ * @return true if an alarm is pending
+ */
+bool joybus_virtual_clock_next_alarm(const struct joybus_virtual_clock *clock, uint64_t *at_ns);
+
+/**
+ * Advance the clock, firing alarms along the way.
+ *
+ * Each alarm fires with the clock set to its expiry time, including alarms
+ * scheduled by other alarm callbacks. Time never moves backwards.
+ *
+ * @param clock the clock to advance
+ * @param time_ns the time to advance to, in nanoseconds
+ */
+void joybus_virtual_clock_advance_to(struct joybus_virtual_clock *clock, uint64_t time_ns);
+
+/**
+ * Advance the clock by a delay, firing alarms along the way.
+ *
+ * @param clock the clock to advance
+ * @param delay_ns the delay, in nanoseconds
+ */
+static inline void joybus_virtual_clock_advance(struct joybus_virtual_clock *clock, uint64_t delay_ns)
+{
+  joybus_virtual_clock_advance_to(clock, clock->now_ns + delay_ns);
+}
+
+/** @} */
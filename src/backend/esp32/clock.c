@@ -0,0 +1,83 @@
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <joybus/clock.h>
+#include <joybus/backend/esp32.h>
+
+// Use lower latency interrupt dispatch method if available
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define TIMER_DISPATCH ESP_TIMER_ISR
+#else
+#define TIMER_DISPATCH ESP_TIMER_TASK
+#endif
+
+static struct joybus_clock clock_instance;
+static esp_timer_handle_t hardware_alarm;
+static portMUX_TYPE clock_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR hardware_alarm_fired(void *arg)
+{
+  joybus_clock_run_alarms(&clock_instance);
+}
+
+static uint64_t IRAM_ATTR esp32_clock_now_us(struct joybus_clock *clock)
+{
+  return esp_timer_get_time();
+}
+
+static uint32_t IRAM_ATTR esp32_clock_cycles(struct joybus_clock *clock)
+{
+  return esp_cpu_get_cycle_count();
+}
+
+static int IRAM_ATTR esp32_clock_set_alarm(struct joybus_clock *clock, uint64_t at_us)
+{
+  int64_t wait_us = (int64_t)(at_us - esp_timer_get_time());
+  if (wait_us <= 0)
+    return 1;
+
+  esp_timer_stop(hardware_alarm);
+  esp_timer_start_once(hardware_alarm, (uint64_t)wait_us);
+
+  return 0;
+}
+
+static uint32_t IRAM_ATTR esp32_clock_lock(struct joybus_clock *clock)
+{
+  portENTER_CRITICAL_SAFE(&clock_lock);
+  return 0;
+}
+
+static void IRAM_ATTR esp32_clock_unlock(struct joybus_clock *clock, uint32_t state)
+{
+  portEXIT_CRITICAL_SAFE(&clock_lock);
+}
+
+static const DRAM_ATTR struct joybus_clock_api esp32_clock_api = {
+  .now_us    = esp32_clock_now_us,
+  .cycles    = esp32_clock_cycles,
+  .set_alarm = esp32_clock_set_alarm,
+  .lock      = esp32_clock_lock,
+  .unlock    = esp32_clock_unlock,
+};
+
+struct joybus_clock *joybus_esp32_clock(void)
+{
+  // Create the alarm timer on first use, esp_timer_create() can't be called from an ISR
+  if (!hardware_alarm) {
+    esp_timer_create_args_t hardware_alarm_args = {
+      .callback        = hardware_alarm_fired,
+      .dispatch_method = TIMER_DISPATCH,
+      .name            = "joybus_clock",
+    };
+
+    if (esp_timer_create(&hardware_alarm_args, &hardware_alarm) != ESP_OK)
+      return NULL;
+
+    clock_instance.api = &esp32_clock_api;
+  }
+
+  return &clock_instance;
+}
@@ -3,18 +3,18 @@
  */
 
 #include <joybus/bus.h>
+#include <joybus/clock.h>
 #include <joybus/errors.h>
 #include <joybus/target.h>
+#include <joybus/backend/core.h>
 #include <joybus/backend/esp32.h>
 
 #include <esp_attr.h>
 #include <esp_clk_tree.h>
-#include <esp_cpu.h>
 #include <esp_idf_version.h>
 #include <esp_intr_alloc.h>
 #include <esp_rom_gpio.h>
 #include <esp_rom_sys.h>
-#include <esp_timer.h>
 #include <esp_private/periph_ctrl.h>
 #include <hal/rmt_ll.h>
 #include <soc/clk_tree_defs.h>
@@ -37,31 +37,12 @@
 #define JOYBUS_RMT_TX_CANDIDATES      SOC_RMT_TX_CANDIDATES_PER_GROUP
 #endif
 
-// Internal bus state
-enum {
-  BUS_STATE_DISABLED,
-  BUS_STATE_HOST_IDLE,
-  BUS_STATE_HOST_TX_WAIT,
-  BUS_STATE_HOST_TX,
-  BUS_STATE_HOST_RX,
-  BUS_STATE_TARGET_RX,
-  BUS_STATE_TARGET_TX,
-  BUS_STATE_TARGET_ERROR,
-};
-
 // 8 bits = 8 RMT symbols = 1 byte
 #define SYMBOLS_PER_BYTE  8
 
 // RX capture ring buffer size
 #define RX_RING SOC_RMT_MEM_WORDS_PER_CHANNEL
 
-// Use lower latency interrupt dispatch method if available
-#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
-#define TIMER_DISPATCH ESP_TIMER_ISR
-#else
-#define TIMER_DISPATCH ESP_TIMER_TASK
-#endif
-
 // Fire the "byte received" interrupt this many symbols early, so we decode the
 // captured bits while the last ones arrive instead of after the byte completes
 #if defined(CONFIG_IDF_TARGET_ESP32H2)
@@ -113,7 +94,7 @@ static inline IRAM_ATTR void encode_byte(struct joybus_esp32_data *data, uint16_
   uint16_t offset = (uint16_t)(byte_idx * SYMBOLS_PER_BYTE % TX_MEM_SYMS);
 
   // Grab the byte value we are encoding
-  uint8_t value = data->write_buf[byte_idx];
+  uint8_t value = data->core.write_buf[byte_idx];
 
   // Encode each bit
   for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
@@ -124,7 +105,7 @@ static inline IRAM_ATTR void encode_byte(struct joybus_esp32_data *data, uint16_
 static inline IRAM_ATTR void encode_stop(struct joybus_esp32_data *data)
 {
   // Find our position in the ring buffer
-  uint16_t offset = (uint16_t)(data->write_len * SYMBOLS_PER_BYTE % TX_MEM_SYMS);
+  uint16_t offset = (uint16_t)(data->core.write_len * SYMBOLS_PER_BYTE % TX_MEM_SYMS);
 
   // Encode the stop symbol
   RMTMEM[data->rmt_tx_ch][offset].val = data->sym_stop;
@@ -147,7 +128,7 @@ static IRAM_ATTR void start_write(struct joybus *bus)
   volatile rmt_symbol_word_t *mem = RMTMEM[data->rmt_tx_ch];
 
   // Write the first byte's first symbol, fire immediately, then fill the rest of the byte
-  uint8_t v0 = data->write_buf[0];
+  uint8_t v0 = data->core.write_buf[0];
   for (uint16_t off = 0; off < SYMBOLS_PER_BYTE; off++) {
     mem[off].val = (v0 & (0x80 >> off)) ? data->sym_one : data->sym_zero;
     if (off == 0)
@@ -156,7 +137,7 @@ static IRAM_ATTR void start_write(struct joybus *bus)
   data->write_count = 1;
 
   // Encode the next byte (or stop symbol) and enable TX_THRES interrupt to stream the rest
-  if (data->write_len > 1) {
+  if (data->core.write_len > 1) {
     encode_byte(data, data->write_count);
     data->write_count++;
 
@@ -169,16 +150,6 @@ static IRAM_ATTR void start_write(struct joybus *bus)
   }
 }
 
-// Target's send_response callback: stage the reply. Its buffer is long-lived, so we stream straight from it
-static void IRAM_ATTR handle_command_response(const uint8_t *response, uint8_t len, void *user_data)
-{
-  struct joybus_esp32_data *data = &JOYBUS_ESP32((struct joybus *)user_data)->data;
-
-  // Just save the buffer pointer and length for later
-  data->write_buf = response;
-  data->write_len = len;
-}
-
 // Frequency-independent bit decode: '1' is short low + long high, '0' the reverse
 static inline uint8_t decode_bit(rmt_symbol_word_t sym)
 {
@@ -224,16 +195,16 @@ static inline IRAM_ATTR uint8_t decode_byte(struct joybus_esp32_data *data, int
   return byte;
 }
 
-// Enter target RX mode: reset the read state and start capturing the next command.
-static IRAM_ATTR void enter_target_rx_mode(struct joybus *bus)
+// Enter target RX mode: start capturing the next command
+static IRAM_ATTR void hal_target_listen(struct joybus *bus, bool await_idle)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
-  data->read_buf   = bus->command_buffer;
-  data->read_len   = JOYBUS_BLOCK_SIZE;
-  data->read_count = 0;
-  data->write_buf  = NULL;
-  data->write_len  = 0;
+  // RX_DONE already waits for an idle line before we get here, so await_idle needs no busy-wait
+
+  // Stop any capture in progress
+  rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
+  rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch));
 
   // Configure RMT RX for a fresh frame, firing the byte-received interrupt RX_DECODE_HIDE
   // symbols early so the decode of the already-captured bits overlaps the last bits arriving
@@ -246,13 +217,32 @@ static IRAM_ATTR void enter_target_rx_mode(struct joybus *bus)
 
   // Enable RX
   rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, true);
+}
+
+// Drop the rest of a command, RX keeps capturing and RX_DONE reports the line going idle
+static IRAM_ATTR void hal_target_ignore(struct joybus *bus)
+{
+}
+
+// Start sending the target's reply, straight from its long-lived buffer
+static IRAM_ATTR void hal_target_send_reply(struct joybus *bus)
+{
+  struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
+
+  // Ensure we never reply (much) faster than an OEM controller
+  while ((int32_t)(joybus_clock_cycles(bus->clock) - (data->cmd_end_cycles + data->reply_floor_cycles)) < 0)
+    ;
+
+  start_write(bus);
 
-  // Transition state
-  data->state = BUS_STATE_TARGET_RX;
+  // Stop capturing and clear interrupt status
+  rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
+  rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch));
+  rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch));
 }
 
-// Kick off a transfer initiated by joybus_transfer
-static IRAM_ATTR void transfer_start(struct joybus *bus)
+// Kick off a transfer once the core's inter-transfer delay has passed
+static IRAM_ATTR void hal_host_start(struct joybus *bus)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
@@ -262,12 +252,9 @@ static IRAM_ATTR void transfer_start(struct joybus *bus)
                                         RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch));
 
   // Prepare to receive a response
-  if (data->read_len > 0) {
-    // Reset the receive state
-    data->read_count = 0;
-
+  if (data->core.read_len > 0) {
     // Skip the command bytes in the RX capture, so we only decode the reply
-    data->rx_skip = data->write_len;
+    data->rx_skip = data->core.write_len;
 
     // Arm RX before transmitting, so the capture is already running when the
     // reply arrives. RX records our own command, the stop bit, and the reply
@@ -285,55 +272,29 @@ static IRAM_ATTR void transfer_start(struct joybus *bus)
 
   // Start the write
   start_write(bus);
-
-  // Transition state
-  data->state = BUS_STATE_HOST_TX;
 }
 
-// Finish a host transfer and return to host idle state
-static IRAM_ATTR void transfer_finish(struct joybus *bus, int status)
+// Return to host idle, stopping the reply capture
+static IRAM_ATTR void hal_host_idle(struct joybus *bus)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
-  // A transfer finishes once. Bail if it already returned to idle so the callback fires only once.
-  if (data->state == BUS_STATE_HOST_IDLE)
-    return;
-
-  // Return to idle BEFORE the callback, since apps could kick off a new transfer from inside done_callback
-  data->state = BUS_STATE_HOST_IDLE;
-
-  // Disable RX
   rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
-
-  // Record the completion time for enforcing minimum interval between transfers
-  data->last_transfer_us = esp_timer_get_time();
-
-  // Call the transfer complete callback with status
-  if (data->done_callback)
-    data->done_callback(bus, status, data->done_user_data);
 }
 
-// Handle host tx complete (all command bytes sent)
-static inline IRAM_ATTR void host_tx_complete(struct joybus *bus)
-{
-  struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
-
-  // We've finished sending a command, check if we need to receive a response
-  if (data->read_len > 0) {
-    // RX is already capturing, so just switch to the receive state
-    data->state = BUS_STATE_HOST_RX;
-  } else {
-    // No reply expected, go idle and call the transfer complete callback
-    transfer_finish(bus, 0);
-  }
-}
-
-// Handle target tx complete (all response bytes sent)
-static inline IRAM_ATTR void target_tx_complete(struct joybus *bus)
-{
-  // Switch back to target RX mode
-  enter_target_rx_mode(bus);
-}
+// The RMT detects the line going idle, so reply and byte timeouts come from RX_DONE rather than alarms
+static const struct joybus_core_hal esp32_hal = {
+  .host_idle         = hal_host_idle,
+  .host_start        = hal_host_start,
+  .target_listen     = hal_target_listen,
+  .target_ignore     = hal_target_ignore,
+  .target_send_reply = hal_target_send_reply,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+  .start_lead_us     = 20, // Covers esp_timer's ISR dispatch
+#else
+  .start_lead_us     = 100, // Covers esp_timer's task dispatch, when no other task is hogging the CPU
+#endif
+};
 
 // Handle a host RX "byte received" interrupt: skip our own captured command, then stream the reply.
 static inline IRAM_ATTR void host_byte_received(struct joybus *bus)
@@ -348,13 +309,8 @@ static inline IRAM_ATTR void host_byte_received(struct joybus *bus)
 
   // Decode the next reply byte. The reply starts one symbol past the command and its stop bit, so
   // every reply byte lands one symbol early, the same interrupt timing decode_byte handles
-  int base_sym = (data->write_len * SYMBOLS_PER_BYTE + 1) + data->read_count * SYMBOLS_PER_BYTE;
-  data->read_buf[data->read_count] = decode_byte(data, base_sym);
-  data->read_count++;
-
-  // Whole reply captured
-  if (data->read_count == data->read_len)
-    transfer_finish(bus, 0);
+  int base_sym = (data->core.write_len * SYMBOLS_PER_BYTE + 1) + data->core.read_count * SYMBOLS_PER_BYTE;
+  joybus_core_rx_byte(&data->core, decode_byte(data, base_sym));
 }
 
 // Handle target byte received
@@ -362,61 +318,19 @@ static inline IRAM_ATTR void target_byte_received(struct joybus *bus)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
-  // Save the received byte in the buffer
-  data->read_buf[data->read_count] = decode_byte(data, data->read_count * SYMBOLS_PER_BYTE);
-  uint32_t cmd_end = esp_cpu_get_cycle_count();
-  data->read_count++;
-
-  // Call the target handler to prepare a response if needed
-  int rc = joybus_target_byte_received(bus->target, data->read_buf, data->read_count, handle_command_response, bus);
-  if (rc == 0) {
-    // No more bytes expected
-    if (data->write_len > 0) {
-      // A response is expected - switch to target TX mode and kick off the write
-      data->state = BUS_STATE_TARGET_TX;
-
-      // Ensure we never reply (much) faster than an OEM controller
-      while ((int32_t)(esp_cpu_get_cycle_count() - (cmd_end + data->reply_floor_cycles)) < 0)
-        ;
-
-      start_write(bus);
-
-      // Stop capturing and clear interrupt status
-      rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
-      rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch));
-      rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch));
-    } else {
-      // No response to send
-      // Stop capturing and clear interrupt status
-      rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
-      rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch));
+  // Decode the byte, and note when the command could have ended for the reply floor
+  uint8_t byte         = decode_byte(data, data->core.read_count * SYMBOLS_PER_BYTE);
+  data->cmd_end_cycles = joybus_clock_cycles(bus->clock);
+  joybus_core_rx_byte(&data->core, byte);
 
-      // Switch back to target read mode
-      enter_target_rx_mode(bus);
-    }
-  } else if (rc > 0) {
-    // More bytes expected
-    // After the first byte, switch to 8-symbol captures
-    if (data->read_count == 1) {
-      rmt_ll_rx_set_limit(&RMT, data->rmt_rx_ch, SYMBOLS_PER_BYTE);
-      rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, true);
-      rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_THRES(data->rmt_rx_ch));
-    }
-  } else {
-    // Error handling command, or command not supported
-    // RX_DONE will re-enable RX after the bus becomes idle
-    data->state = BUS_STATE_TARGET_ERROR;
+  // After the first byte, switch to 8-symbol captures if more bytes are expected
+  if (data->core.state == JOYBUS_CORE_TARGET_RX && data->core.read_count == 1) {
+    rmt_ll_rx_set_limit(&RMT, data->rmt_rx_ch, SYMBOLS_PER_BYTE);
+    rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, true);
+    rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_THRES(data->rmt_rx_ch));
   }
 }
 
-// Transfer start timer callback
-static void IRAM_ATTR transfer_start_timer_cb(void *arg)
-{
-  struct joybus *bus = (struct joybus *)arg;
-
-  transfer_start(bus);
-}
-
 // RMT interrupt handler
 static void IRAM_ATTR rmt_irq_handler(void *arg)
 {
@@ -424,15 +338,10 @@ static void IRAM_ATTR rmt_irq_handler(void *arg)
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
   uint32_t status                = RMT.int_st.val;
 
-  // Handle TX done interrupt
+  // Handle TX done interrupt, the command or reply has been sent
   if (status & RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch)) {
     rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch));
-
-    if (data->state == BUS_STATE_HOST_TX) {
-      host_tx_complete(bus);
-    } else if (data->state == BUS_STATE_TARGET_TX) {
-      target_tx_complete(bus);
-    }
+    joybus_core_tx_done(&data->core);
   }
 
   // Handle RX threshold (byte received) interrupt
@@ -441,9 +350,9 @@ static void IRAM_ATTR rmt_irq_handler(void *arg)
 
     // The host counts these ticks from the start of capture, during both command TX and the reply,
     // so it runs in HOST_TX and HOST_RX. The command ticks are skipped inside host_byte_received.
-    if (data->state == BUS_STATE_HOST_TX || data->state == BUS_STATE_HOST_RX) {
+    if (data->core.state == JOYBUS_CORE_HOST_TX || data->core.state == JOYBUS_CORE_HOST_RX) {
       host_byte_received(bus);
-    } else if (data->state == BUS_STATE_TARGET_RX) {
+    } else if (data->core.state == JOYBUS_CORE_TARGET_RX || data->core.state == JOYBUS_CORE_TARGET_DEFER) {
       target_byte_received(bus);
     }
   }
@@ -453,7 +362,7 @@ static void IRAM_ATTR rmt_irq_handler(void *arg)
     rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_TX_THRES(data->rmt_tx_ch));
 
     // Refill with the next byte; after the last one, append the stop and stop refilling
-    if (data->write_count < data->write_len) {
+    if (data->write_count < data->core.write_len) {
       encode_byte(data, data->write_count);
       data->write_count++;
     } else {
@@ -465,14 +374,7 @@ static void IRAM_ATTR rmt_irq_handler(void *arg)
   // Handle RX done interrupt (line went idle -> frame ended)
   if (status & RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch)) {
     rmt_ll_clear_interrupt_status(&RMT, RMT_LL_EVENT_RX_DONE(data->rmt_rx_ch));
-
-    if (data->state == BUS_STATE_TARGET_RX || data->state == BUS_STATE_TARGET_ERROR) {
-      // The bus became idle without a complete command, listen for the next one
-      enter_target_rx_mode(bus);
-    } else if (data->state == BUS_STATE_HOST_RX) {
-      // The reply frame ended before all bytes were streamed in: finish with a timeout
-      transfer_finish(bus, -JOYBUS_ERR_TIMEOUT);
-    }
+    joybus_core_rx_idle(&data->core);
   }
 }
 
@@ -551,10 +453,10 @@ static void enable_tx(struct joybus *bus, uint32_t rmt_clk_freq)
   rmt_ll_enable_interrupt(&RMT, RMT_LL_EVENT_TX_DONE(data->rmt_tx_ch), true);
 }
 
-static int joybus_esp32_enable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_esp32_enable(struct joybus *bus)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
-  if (data->state != BUS_STATE_DISABLED)
+  if (joybus_core_enabled(&data->core))
     return 0;
 
   // Configure Joybus GPIO as a single bidirectional open-drain pin
@@ -592,21 +494,6 @@ static int joybus_esp32_enable(struct joybus *bus)
     return -JOYBUS_ERR_NOT_SUPPORTED;
   }
 
-  // Setup transfer start timer
-  esp_timer_create_args_t transfer_start_args = {
-    .callback        = transfer_start_timer_cb,
-    .arg             = bus,
-    .dispatch_method = TIMER_DISPATCH,
-    .name            = "joybus_transfer_start",
-  };
-
-  if (esp_timer_create(&transfer_start_args, &data->transfer_start_timer) != 0) {
-    esp_intr_free(data->rmt_intr);
-    data->rmt_intr = NULL;
-    joybus_rmt_claimed_channels &= ~claim_mask;
-    return -JOYBUS_ERR_NOT_SUPPORTED;
-  }
-
   // Enable the RMT bus clock and bring the peripheral out of reset
   PERIPH_RCC_ATOMIC()
   {
@@ -628,21 +515,20 @@ static int joybus_esp32_enable(struct joybus *bus)
   enable_tx(bus, rmt_clk_freq);
 
   // Enter the appropriate initial state based on the bus mode
-  if (bus->mode == JOYBUS_MODE_TARGET) {
-    enter_target_rx_mode(bus);
-  } else {
-    data->state = BUS_STATE_HOST_IDLE;
-  }
+  joybus_core_enable(&data->core);
 
   return 0;
 }
 
-static int joybus_esp32_disable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_esp32_disable(struct joybus *bus)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
-  if (data->state == BUS_STATE_DISABLED)
+  if (!joybus_core_enabled(&data->core))
     return 0;
 
+  // Drop any transfer in progress and stop the pending transfer start
+  joybus_core_disable(&data->core);
+
   // Disable the RMT TX/RX channels
   rmt_ll_rx_enable(&RMT, data->rmt_rx_ch, false);
   rmt_ll_tx_stop(&RMT, data->rmt_tx_ch);
@@ -658,77 +544,63 @@ static int joybus_esp32_disable(struct joybus *bus)
     data->rmt_intr = NULL;
   }
 
-  // Stop and free timer resources
-  if (data->transfer_start_timer) {
-    esp_timer_stop(data->transfer_start_timer);
-    esp_timer_delete(data->transfer_start_timer);
-    data->transfer_start_timer = NULL;
-  }
-
   // Release this bus's channels back to the pool
   joybus_rmt_claimed_channels &= ~((1u << data->rmt_tx_ch) | (1u << data->rmt_rx_mem_ch));
 
-  data->state = BUS_STATE_DISABLED;
-
   return 0;
 }
 
-static int joybus_esp32_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
-                                 uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+JOYBUS_BACKEND_API int joybus_esp32_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len,
+                                             uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                                             void *user_data)
 {
   struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
-  if (data->state == BUS_STATE_DISABLED)
-    return -JOYBUS_ERR_DISABLED;
-
-  if (data->state != BUS_STATE_HOST_IDLE)
-    return -JOYBUS_ERR_BUSY;
+  return joybus_core_transfer(&data->core, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
 
-  // Save the transfer context
-  data->write_buf      = write_buf;
-  data->write_len      = write_len;
-  data->read_buf       = read_buf;
-  data->read_len       = read_len;
-  data->read_count     = 0;
-  data->done_callback  = callback;
-  data->done_user_data = user_data;
-
-  int64_t wait_us = (int64_t)JOYBUS_INTER_TRANSFER_DELAY_US - (esp_timer_get_time() - data->last_transfer_us);
-  if (wait_us <= 0) {
-    // Kick off the transfer immediately if we are not in an inter-transfer delay
-    transfer_start(bus);
-  } else {
-    // Otherwise, set up the timer to kick off the transfer later
-    data->state = BUS_STATE_HOST_TX_WAIT;
-    esp_timer_start_once(data->transfer_start_timer, (uint64_t)wait_us);
-  }
+JOYBUS_BACKEND_API int joybus_esp32_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf,
+                                                uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
+                                                joybus_transfer_cb callback, void *user_data)
+{
+  struct joybus_esp32_data *data = &JOYBUS_ESP32(bus)->data;
 
-  return 0;
+  return joybus_core_transfer_at(&data->core, at_us, write_buf, write_len, read_buf, read_len, callback, user_data);
 }
 
-static const struct joybus_api esp32_api = {
-  .enable   = joybus_esp32_enable,
-  .disable  = joybus_esp32_disable,
-  .transfer = joybus_esp32_transfer,
+JOYBUS_BACKEND_API const struct joybus_api joybus_esp32_api = {
+  .enable      = joybus_esp32_enable,
+  .disable     = joybus_esp32_disable,
+  .transfer    = joybus_esp32_transfer,
+  .transfer_at = joybus_esp32_transfer_at,
 };
 
 int joybus_esp32_init(struct joybus_esp32 *esp32_bus, struct joybus_esp32_config config)
 {
   // Save the bus API and common configuration
-  struct joybus *bus = JOYBUS(esp32_bus);
-  bus->api           = &esp32_api;
-  bus->target        = NULL;
-  bus->freq          = config.freq;
+  struct joybus *bus     = JOYBUS(esp32_bus);
+  bus->api               = &joybus_esp32_api;
+  bus->target            = NULL;
+  bus->streams_write_buf = false;
+  bus->freq              = config.freq;
+  bus->clock             = joybus_esp32_clock();
+  bus->rx_byte_callback  = NULL;
+  bus->timing            = joybus_timing_default();
+  bus->transfer_timing   = NULL;
+  bus->retry             = joybus_retry_policy_default();
+
+  if (!bus->clock)
+    return -JOYBUS_ERR_NOT_SUPPORTED;
 
   // Save the ESP32-specific configuration and initialize state
   struct joybus_esp32_data *data = &esp32_bus->data;
-  data->state                    = BUS_STATE_DISABLED;
   data->gpio                     = config.gpio;
   data->rmt_tx_ch                = config.rmt_tx_ch;
   data->rmt_rx_ch                = config.rmt_rx_ch;
   data->rmt_intr                 = NULL;
-  data->transfer_start_timer     = NULL;
-  data->last_transfer_us         = 0;
+
+  // Set up the bus state machine
+  joybus_core_init(&data->core, bus, &esp32_hal);
 
   return 0;
 }
@@ -0,0 +1,65 @@
+#include "em_core.h"
+
+#include "sl_sleeptimer.h"
+
+#include <joybus/clock.h>
+#include <joybus/backend/gecko.h>
+
+static struct joybus_clock clock_instance;
+static sl_sleeptimer_timer_handle_t hardware_alarm;
+
+static inline uint32_t sl_sleeptimer_us_to_tick(uint64_t time_us)
+{
+  uint64_t ticks = time_us * sl_sleeptimer_get_timer_frequency();
+  ticks += 1000000 - 1; // ceil: ensure at least the requested delay
+  ticks /= 1000000;
+  return (uint32_t)ticks;
+}
+
+static void hardware_alarm_fired(sl_sleeptimer_timer_handle_t *handle, void *user_data)
+{
+  joybus_clock_run_alarms(&clock_instance);
+}
+
+static uint64_t gecko_clock_now_us(struct joybus_clock *clock)
+{
+  return sl_sleeptimer_get_tick_count64() * 1000000 / sl_sleeptimer_get_timer_frequency();
+}
+
+static int gecko_clock_set_alarm(struct joybus_clock *clock, uint64_t at_us)
+{
+  uint64_t now_us = gecko_clock_now_us(clock);
+  if (at_us <= now_us)
+    return 1;
+
+  sl_sleeptimer_restart_timer(&hardware_alarm, sl_sleeptimer_us_to_tick(at_us - now_us), hardware_alarm_fired, NULL,
+                              0, SL_SLEEPTIMER_NO_HIGH_PRECISION_HF_CLOCKS_REQUIRED_FLAG);
+
+  return 0;
+}
+
+static uint32_t gecko_clock_lock(struct joybus_clock *clock)
+{
+  return CORE_EnterCritical();
+}
+
+static void gecko_clock_unlock(struct joybus_clock *clock, uint32_t state)
+{
+  CORE_ExitCritical(state);
+}
+
+static const struct joybus_clock_api gecko_clock_api = {
+  .now_us    = gecko_clock_now_us,
+  .set_alarm = gecko_clock_set_alarm,
+  .lock      = gecko_clock_lock,
+  .unlock    = gecko_clock_unlock,
+};
+
+struct joybus_clock *joybus_gecko_clock(void)
+{
+  // Safe to call more than once
+  sl_sleeptimer_init();
+
+  clock_instance.api = &gecko_clock_api;
+  return &clock_instance;
+}
@@ -26,30 +26,18 @@
 #include "dmadrv.h"
 
 #include <joybus/bus.h>
+#include <joybus/clock.h>
 #include <joybus/errors.h>
 #include <joybus/target.h>
+#include <joybus/backend/core.h>
 #include <joybus/backend/gecko.h>
 
-enum {
-  BUS_STATE_DISABLED,
-  BUS_STATE_HOST_IDLE,
-  BUS_STATE_HOST_TX,
-  BUS_STATE_HOST_RX,
-  BUS_STATE_TARGET_TX,
-  BUS_STATE_TARGET_RX,
-};
-
 // Line coding
 static const uint8_t BIT_0       = 0b0001;
 static const uint8_t BIT_1       = 0b0111;
 static const uint8_t HOST_STOP   = 0b01111111;
 static const uint8_t TARGET_STOP = 0b00111111;
 
-static void enter_target_read_mode(struct joybus *bus, bool await_idle);
-static void enter_idle_mode(struct joybus *bus, bool await_idle);
-static void handle_command_response(const uint8_t *buffer, uint8_t length, void *user_data);
-static bool ldma_tx_handler(unsigned int chan, unsigned int iteration, void *user_data);
-
 // Get the clock for the given TIMER
 static inline CMU_Clock_TypeDef get_timer_clock(TIMER_TypeDef *timer)
 {
@@ -217,126 +205,26 @@ idle_detected:
   TIMER_Enable(data->rx_timer, false);
 }
 
-// Handle transfer timeouts
-void transfer_timeout(sl_sleeptimer_timer_handle_t *handle, void *user_data)
-{
-  struct joybus *bus             = (struct joybus *)user_data;
-  struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
-
-  // Timeout occurred, switch back to idle/read mode
-  enter_idle_mode(bus, true);
-
-  // Call the transfer complete callback with an error
-  if (data->done_callback)
-    data->done_callback(bus, -JOYBUS_ERR_TIMEOUT, data->done_user_data);
-}
-
-// Handle target rx byte timeouts
-void target_rx_timeout(sl_sleeptimer_timer_handle_t *handle, void *user_data)
-{
-  struct joybus *bus             = (struct joybus *)user_data;
-  struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
-
-  // Timeout occurred, switch back to idle/read mode
-  enter_idle_mode(bus, true);
-}
-
-static inline uint32_t sl_sleeptimer_us_to_tick(uint32_t time_us)
-{
-  uint64_t ticks = (uint64_t)time_us * sl_sleeptimer_get_timer_frequency();
-  ticks += 1000000 - 1; // ceil: ensure at least the requested delay
-  ticks /= 1000000;
-  return (uint32_t)ticks;
-}
-
 // LDMA interrupt handler for RX, called when a 16 timings have been captured
 static bool ldma_rx_handler(unsigned int chan, unsigned int iteration, void *user_data)
 {
   struct joybus *bus             = (struct joybus *)user_data;
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
-  if (data->state == BUS_STATE_HOST_RX) {
-    // Process the received pulses into the byte buffer
-    decode_pulses(bus, &data->read_buf[iteration - 1], data->rx_edge_timings[data->rx_current_buffer], iteration - 1);
-    data->rx_current_buffer ^= 1;
-
-    if (iteration == data->read_len) {
-      // No more bytes expected
-      // Stop input capture
-      TIMER_Enable(data->rx_timer, false);
-
-      // Switch back to idle/read mode
-      enter_idle_mode(bus, true);
-
-      // Call the transfer complete callback with a success status
-      if (data->done_callback)
-        data->done_callback(bus, 0, data->done_user_data);
-
-      // Cancel rx timeout
-      sl_sleeptimer_stop_timer(&data->rx_timeout_timer);
-    } else {
-      // More bytes expected
-      // After the first byte, switch to full 16-edge captures
-      if (iteration == 1) {
-        data->rx_descriptors[0].xfer.xferCnt = EDGES_PER_BYTE - 1;
-
-        sl_sleeptimer_start_timer(&data->rx_timeout_timer, sl_sleeptimer_us_to_tick(60), transfer_timeout, bus, 0,
-                                  SL_SLEEPTIMER_NO_HIGH_PRECISION_HF_CLOCKS_REQUIRED_FLAG);
-      } else {
-        // Reset rx timeout for the next byte
-        sl_sleeptimer_restart_timer(&data->rx_timeout_timer, sl_sleeptimer_us_to_tick(60), transfer_timeout, bus, 0,
-                                    SL_SLEEPTIMER_NO_HIGH_PRECISION_HF_CLOCKS_REQUIRED_FLAG);
-      }
-    }
-  } else if (data->state == BUS_STATE_TARGET_RX) {
-    // Process the received pulses into the byte buffer
-    decode_pulses(bus, &data->read_buf[iteration - 1], data->rx_edge_timings[data->rx_current_buffer], iteration - 1);
-    data->rx_current_buffer ^= 1;
-
-    // Handle the received byte
-    int rc = joybus_target_byte_received(bus->target, data->read_buf, iteration, handle_command_response, bus);
-    if (rc == 0) {
-      // No more bytes expected
-      // Start the response transfer if there is one
-      if (data->write_len > 0) {
-        // Prepare and start the response transfer
-        LDMA->REQDIS_CLR = 1 << data->tx_dma_channel;
-        data->state      = BUS_STATE_TARGET_TX;
-
-        // Stop input capture
-        TIMER_Enable(data->rx_timer, false);
-      } else {
-        // Stop input capture
-        TIMER_Enable(data->rx_timer, false);
-
-        // No response to send, switch back to read mode or idle
-        enter_idle_mode(bus, false);
-      }
-
-      // Cancel rx timeout
-      sl_sleeptimer_stop_timer(&data->rx_timeout_timer);
-    } else if (rc > 0) {
-      // More bytes expected
-      // After the first byte, switch to 16-edge captures
-      if (iteration == 1)
-        data->rx_descriptors[0].xfer.xferCnt = EDGES_PER_BYTE - 1;
-
-      // Reset rx timeout for the next byte
-      sl_sleeptimer_restart_timer(&data->rx_timeout_timer, sl_sleeptimer_us_to_tick(60), target_rx_timeout, bus, 0,
-                                  SL_SLEEPTIMER_NO_HIGH_PRECISION_HF_CLOCKS_REQUIRED_FLAG);
-
-    } else {
-      // Error handling command, or command not supported
-      // Stop input capture
-      TIMER_Enable(data->rx_timer, false);
-
-      // Switch back to idle/read mode
-      enter_idle_mode(bus, true);
-
-      // Cancel rx timeout
-      sl_sleeptimer_stop_timer(&data->rx_timeout_timer);
-    }
-  }
+  if (data->core.state != JOYBUS_CORE_HOST_RX && data->core.state != JOYBUS_CORE_TARGET_RX &&
+      data->core.state != JOYBUS_CORE_TARGET_DEFER)
+    return true;
+
+  // Process the received pulses into a byte, and hand it to the core
+  uint8_t byte;
+  decode_pulses(bus, &byte, data->rx_edge_timings[data->rx_current_buffer], iteration - 1);
+  data->rx_current_buffer ^= 1;
+  joybus_core_rx_byte(&data->core, byte);
+
+  // After the first byte, switch to full 16-edge captures if more bytes are expected
+  if (iteration == 1 && data->core.read_count == 1 &&
+      (data->core.state == JOYBUS_CORE_HOST_RX || data->core.state == JOYBUS_CORE_TARGET_RX))
+    data->rx_descriptors[0].xfer.xferCnt = EDGES_PER_BYTE - 1;
 
   return true;
 }
@@ -348,13 +236,13 @@ static bool ldma_tx_handler(unsigned int chan, unsigned int iteration, void *use
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
   // Encode the next byte, if there is one
-  if (data->tx_buffered_bytes < data->write_len) {
-    encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->write_buf[data->tx_buffered_bytes]);
+  if (data->tx_buffered_bytes < data->core.write_len) {
+    encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->core.write_buf[data->tx_buffered_bytes]);
     data->tx_current_buffer ^= 1;
     data->tx_buffered_bytes++;
   }
 
-  if (iteration == data->write_len) {
+  if (iteration == data->core.write_len) {
     // Wait for TX buffer to be empty
     while (!(data->tx_usart->STATUS & USART_STATUS_TXBL))
       ;
@@ -363,42 +251,77 @@ static bool ldma_tx_handler(unsigned int chan, unsigned int iteration, void *use
     while (!GPIO_PinInGet(data->gpio_port, data->gpio_pin))
       ;
 
-    if (data->state == BUS_STATE_HOST_TX) {
-      // We've finished sending a command (host mode), check if we need to receive a response
-      if (data->read_len > 0) {
-        // Immediately flip into read mode, we've already pre-armed the RX LDMA
-        data->state = BUS_STATE_HOST_RX;
-        TIMER_Enable(data->rx_timer, true);
-
-        // Start the RX timeout timer
-        sl_sleeptimer_start_timer(&data->rx_timeout_timer, sl_sleeptimer_us_to_tick(100), transfer_timeout, bus, 0,
-                                  SL_SLEEPTIMER_NO_HIGH_PRECISION_HF_CLOCKS_REQUIRED_FLAG);
-      } else {
-        // No reply expected, go idle and call the transfer complete callback
-        data->state = BUS_STATE_HOST_IDLE;
-        if (data->done_callback)
-          data->done_callback(bus, 0, data->done_user_data);
-      }
-    } else if (data->state == BUS_STATE_TARGET_TX) {
-      // After sending a command response, flip back into read mode to listen
-      // for the next command.
-      enter_idle_mode(bus, false);
-    }
+    // Immediately flip into read mode if a reply is expected, we've already pre-armed the RX LDMA
+    if (data->core.state == JOYBUS_CORE_HOST_TX && data->core.read_len > 0)
+      TIMER_Enable(data->rx_timer, true);
+
+    joybus_core_tx_done(&data->core);
   }
 
   return true;
 }
 
+// Prepare an SI write operation by pre-encoding the first one or two bytes
+static void prepare_write(struct joybus *bus)
+{
+  struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
+  uint8_t length                 = data->core.write_len;
+
+  // With ping-pong looped descriptors, we need to start with the correct descriptor/buffer
+  // If the length is odd, we need to start with the second descriptor/buffer
+  data->tx_initial_buffer = data->tx_current_buffer = length % 2;
+
+  // Set the loop count for the LDMA transfer
+  data->tx_config.ldmaLoopCnt = length - 1;
+
+  // Encode the first byte
+  encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->core.write_buf[0]);
+  data->tx_current_buffer ^= 1;
+  data->tx_buffered_bytes = 1;
+
+  // Encode the next byte, if there is one
+  if (length > 1) {
+    encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->core.write_buf[1]);
+    data->tx_current_buffer ^= 1;
+    data->tx_buffered_bytes = 2;
+  }
+
+  LDMA->REQDIS_SET = 1 << data->tx_dma_channel;
+  DMADRV_LdmaStartTransfer(data->tx_dma_channel, &data->tx_config, &data->tx_descriptors[data->tx_initial_buffer],
+                           ldma_tx_handler, bus);
+}
+
+// Stop input capture and return to host idle
+static void hal_host_idle(struct joybus *bus)
+{
+  TIMER_Enable(JOYBUS_GECKO(bus)->data.rx_timer, false);
+}
+
+// Kick off a host transfer once the core's inter-transfer delay has passed
+static void hal_host_start(struct joybus *bus)
+{
+  struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
+
+  // Clear any stale RX captures
+  while (TIMER_CaptureGet(data->rx_timer, 0))
+    ;
+
+  // Arm the RX DMA channel to receive the response
+  DMADRV_LdmaStartTransfer(data->rx_dma_channel, &data->rx_config, &data->rx_descriptors[data->rx_current_buffer],
+                           ldma_rx_handler, bus);
+
+  // Kick off the write
+  prepare_write(bus);
+  LDMA->REQDIS_CLR = 1 << data->tx_dma_channel;
+}
+
 // Kick off an SI read operation
-static void enter_target_read_mode(struct joybus *bus, bool await_idle)
+static void hal_target_listen(struct joybus *bus, bool await_idle)
 {
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
-  data->read_buf   = bus->command_buffer;
-  data->read_len   = JOYBUS_BLOCK_SIZE;
-  data->read_count = 0;
-  data->write_buf  = NULL;
-  data->write_len  = 0;
+  // Stop any capture in progress
+  TIMER_Enable(data->rx_timer, false);
 
   data->rx_current_buffer              = 0;
   data->rx_descriptors[0].xfer.xferCnt = EDGES_PER_BYTE + 2 - 1;
@@ -417,60 +340,32 @@ static void enter_target_read_mode(struct joybus *bus, bool await_idle)
 
   // Start the timer to begin capturing
   TIMER_Enable(data->rx_timer, true);
-
-  // Transition state
-  data->state = BUS_STATE_TARGET_RX;
 }
 
-// Return to the resting state for the bus mode: target read mode, or host idle
-static void enter_idle_mode(struct joybus *bus, bool await_idle)
-{
-  if (bus->mode == JOYBUS_MODE_TARGET) {
-    enter_target_read_mode(bus, await_idle);
-  } else {
-    JOYBUS_GECKO(bus)->data.state = BUS_STATE_HOST_IDLE;
-  }
-}
-
-// Prepare an SI write operation by pre-encoding the first one or two bytes
-static inline void prepare_write(struct joybus *bus, const uint8_t *buffer, uint8_t length)
+// Start the reply transfer prepared by prepare_write
+static void hal_target_send_reply(struct joybus *bus)
 {
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
-  // Save the transfer state
-  data->write_buf = (uint8_t *)buffer;
-  data->write_len = length;
-
-  // With ping-pong looped descriptors, we need to start with the correct descriptor/buffer
-  // If the length is odd, we need to start with the second descriptor/buffer
-  data->tx_initial_buffer = data->tx_current_buffer = length % 2;
-
-  // Set the loop count for the LDMA transfer
-  data->tx_config.ldmaLoopCnt = length - 1;
-
-  // Encode the first byte
-  encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->write_buf[0]);
-  data->tx_current_buffer ^= 1;
-  data->tx_buffered_bytes = 1;
-
-  // Encode the next byte, if there is one
-  if (length > 1) {
-    encode_byte(data->tx_encoded_bytes[data->tx_current_buffer], data->write_buf[1]);
-    data->tx_current_buffer ^= 1;
-    data->tx_buffered_bytes = 2;
-  }
+  LDMA->REQDIS_CLR = 1 << data->tx_dma_channel;
 
-  LDMA->REQDIS_SET = 1 << data->tx_dma_channel;
-  DMADRV_LdmaStartTransfer(data->tx_dma_channel, &data->tx_config, &data->tx_descriptors[data->tx_initial_buffer],
-                           ldma_tx_handler, bus);
+  // Stop input capture
+  TIMER_Enable(data->rx_timer, false);
 }
 
-// Callback for handling a command response from the attached target
-static void handle_command_response(const uint8_t *buffer, uint8_t length, void *user_data)
-{
-  struct joybus *bus = (struct joybus *)user_data;
-  prepare_write(bus, buffer, length);
-}
+// The reply timeout runs from the end of the stop bit, so allows for the target's turnaround. There's no bulk receive,
+// each byte is decoded from its edge timings in the per-byte interrupt, and capturing a whole payload's timings would
+// only move the decoding of every byte after the last one
+static const struct joybus_core_hal gecko_hal = {
+  .host_idle            = hal_host_idle,
+  .host_start           = hal_host_start,
+  .target_listen        = hal_target_listen,
+  .target_prepare_reply = prepare_write,
+  .target_send_reply    = hal_target_send_reply,
+  .reply_timeout_us     = 100,
+  .byte_timeout_us      = 60,
+  // No start lead, the sleeptimer ticks at 32.768kHz so spinning on it wouldn't gain any precision
+};
 
 // Enable the RX peripheral and LDMA channel
 static int enable_rx(struct joybus *bus)
@@ -602,9 +497,11 @@ static int disable_tx(struct joybus *bus)
   return 0;
 }
 
-static int joybus_gecko_enable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_gecko_enable(struct joybus *bus)
 {
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
+  if (joybus_core_enabled(&data->core))
+    return 0;
 
   // Initialize LDMA
   DMADRV_Init();
@@ -620,24 +517,21 @@ static int joybus_gecko_enable(struct joybus *bus)
   enable_rx(bus);
   enable_tx(bus);
 
-  // Initialize sleeptimer for timeouts
-  sl_sleeptimer_init();
-
-  if (bus->mode == JOYBUS_MODE_TARGET) {
-    enter_target_read_mode(bus, true);
-  } else {
-    data->state = BUS_STATE_HOST_IDLE;
-  }
+  // Start in the appropriate mode
+  joybus_core_enable(&data->core);
 
   return 0;
 }
 
-static int joybus_gecko_disable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_gecko_disable(struct joybus *bus)
 {
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
-  if (data->state == BUS_STATE_DISABLED)
+  if (!joybus_core_enabled(&data->core))
     return 0;
 
+  // Drop any transfer in progress and stop pending timers
+  joybus_core_disable(&data->core);
+
   // Disable RX and TX
   disable_rx(bus);
   disable_tx(bus);
@@ -645,59 +539,46 @@ static int joybus_gecko_disable(struct joybus *bus)
   // Reset GPIO pin to input
   GPIO_PinModeSet(data->gpio_port, data->gpio_pin, gpioModeInput, 0);
 
-  data->state = BUS_STATE_DISABLED;
-
   return 0;
 }
 
-static int joybus_gecko_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
-                                 uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+JOYBUS_BACKEND_API int joybus_gecko_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len,
+                                             uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                                             void *user_data)
 {
   struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
-  if (data->state == BUS_STATE_DISABLED)
-    return -JOYBUS_ERR_DISABLED;
-
-  if (data->state != BUS_STATE_HOST_IDLE)
-    return -JOYBUS_ERR_BUSY;
-
-  // Save the reply context
-  data->read_buf       = read_buf;
-  data->read_len       = read_len;
-  data->read_count     = 0;
-  data->done_callback  = callback;
-  data->done_user_data = user_data;
-
-  // Mark transfer as started
-  data->state = BUS_STATE_HOST_TX;
-
-  // Clear any stale RX captures
-  while (TIMER_CaptureGet(data->rx_timer, 0))
-    ;
-
-  // Arm the RX DMA channel to receive the response
-  DMADRV_LdmaStartTransfer(data->rx_dma_channel, &data->rx_config, &data->rx_descriptors[data->rx_current_buffer],
-                           ldma_rx_handler, bus);
+  return joybus_core_transfer(&data->core, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
 
-  // Kick off the write
-  prepare_write(bus, write_buf, write_len);
-  LDMA->REQDIS_CLR = 1 << data->tx_dma_channel;
+JOYBUS_BACKEND_API int joybus_gecko_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf,
+                                                uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
+                                                joybus_transfer_cb callback, void *user_data)
+{
+  struct joybus_gecko_data *data = &JOYBUS_GECKO(bus)->data;
 
-  return 0;
+  return joybus_core_transfer_at(&data->core, at_us, write_buf, write_len, read_buf, read_len, callback, user_data);
 }
 
-static const struct joybus_api gecko_api = {
-  .enable   = joybus_gecko_enable,
-  .disable  = joybus_gecko_disable,
-  .transfer = joybus_gecko_transfer,
+JOYBUS_BACKEND_API const struct joybus_api joybus_gecko_api = {
+  .enable      = joybus_gecko_enable,
+  .disable     = joybus_gecko_disable,
+  .transfer    = joybus_gecko_transfer,
+  .transfer_at = joybus_gecko_transfer_at,
 };
 
 int joybus_gecko_init(struct joybus_gecko *gecko_bus, struct joybus_gecko_config config)
 {
-  struct joybus *bus = JOYBUS(gecko_bus);
-  bus->api           = &gecko_api;
-  bus->freq          = config.freq;
-  bus->target        = NULL;
+  struct joybus *bus     = JOYBUS(gecko_bus);
+  bus->api               = &joybus_gecko_api;
+  bus->freq              = config.freq;
+  bus->clock             = joybus_gecko_clock();
+  bus->target            = NULL;
+  bus->streams_write_buf = false;
+  bus->rx_byte_callback  = NULL;
+  bus->timing            = joybus_timing_default();
+  bus->transfer_timing   = NULL;
+  bus->retry             = joybus_retry_policy_default();
 
   // Save the joybus configuration
   struct joybus_gecko_data *data = &gecko_bus->data;
@@ -705,7 +586,9 @@ int joybus_gecko_init(struct joybus_gecko *gecko_bus, struct joybus_gecko_config
   data->gpio_pin                 = config.gpio_pin;
   data->rx_timer                 = config.rx_timer;
   data->tx_usart                 = config.tx_usart;
-  data->state                    = BUS_STATE_DISABLED;
+
+  // Set up the bus state machine
+  joybus_core_init(&data->core, bus, &gecko_hal);
 
   return 0;
 }
@@ -0,0 +1,467 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+#include <joybus/virtual_clock.h>
+#include <joybus/backend/loopback.h>
+
+enum {
+  BUS_STATE_DISABLED,
+  BUS_STATE_HOST_IDLE,
+  BUS_STATE_HOST_TX,
+  BUS_STATE_HOST_RX,
+  BUS_STATE_HOST_DONE,
+  BUS_STATE_TARGET_RX,
+  BUS_STATE_TARGET_TX,
+};
+
+// Delay between the host stop bit and the first reply bit, roughly matching an OEM controller
+#define REPLY_DELAY_NS 2000
+
+// Simulated CPU frequency for the virtual clock's cycle counter
+#define CPU_MHZ        125
+
+// Virtual clock shared by all loopback instances
+static struct joybus_virtual_clock virtual_clock;
+static bool virtual_clock_initialized;
+
+// Enabled loopback instances
+static struct joybus_loopback *instances;
+
+static struct joybus_virtual_clock *loopback_clock(void)
+{
+  if (!virtual_clock_initialized) {
+    joybus_virtual_clock_init(&virtual_clock, CPU_MHZ);
+    virtual_clock_initialized = true;
+  }
+
+  return &virtual_clock;
+}
+
+// Time taken to clock out a number of bits at the bus frequency
+static inline uint64_t bits_ns(struct joybus *bus, uint32_t bits)
+{
+  return (uint64_t)bits * 1000000000ULL / bus->freq;
+}
+
+static void link_instance(struct joybus_loopback *loopback_bus)
+{
+  loopback_bus->data.next = instances;
+  instances               = loopback_bus;
+}
+
+static void unlink_instance(struct joybus_loopback *loopback_bus)
+{
+  for (struct joybus_loopback **link = &instances; *link; link = &(*link)->data.next) {
+    if (*link == loopback_bus) {
+      *link = loopback_bus->data.next;
+      return;
+    }
+  }
+}
+
+// Start clocking out the staged response, the first reply bit follows the delay after start_ns
+static void start_response(struct joybus_loopback_data *data, uint64_t start_ns)
+{
+  struct joybus *peer = JOYBUS(data->peer);
+
+  // Anything beyond the read length is ignored by the host
+  if (data->response_len > data->read_len)
+    data->response_len = data->read_len;
+
+  data->awaiting_response = false;
+  data->read_count        = 0;
+  data->state             = BUS_STATE_HOST_RX;
+
+  if (data->response_len == 0) {
+    // Nothing to clock out, the host gives up after the reply timeout
+    data->done_status = -JOYBUS_ERR_TIMEOUT;
+    data->event_ns    = start_ns + data->reply_timeout_ns;
+    data->state       = BUS_STATE_HOST_DONE;
+    return;
+  }
+
+  // Sample the first byte as it starts on the wire
+  data->rx_byte  = data->response[0];
+  data->event_ns = start_ns + REPLY_DELAY_NS + bits_ns(peer, 8);
+}
+
+static void handle_command_response(const uint8_t *buffer, uint8_t length, void *user_data)
+{
+  struct joybus_loopback_data *data = (struct joybus_loopback_data *)user_data;
+
+  // Stage the response, it is clocked out once the command has been sent and the handler has returned
+  uint64_t now_ns         = joybus_virtual_clock_now_ns(&virtual_clock);
+  data->response          = buffer;
+  data->response_len      = length;
+  data->response_ready_ns = now_ns > data->target_busy_ns ? now_ns : data->target_busy_ns;
+
+  // Deferred response, the host is already waiting for it
+  if (data->state == BUS_STATE_HOST_RX && data->awaiting_response) {
+    uint64_t start_ns = data->response_ready_ns > data->command_end_ns ? data->response_ready_ns : data->command_end_ns;
+
+    // Too late, the host has given up by the time the first bit arrives
+    if (start_ns + REPLY_DELAY_NS > data->command_end_ns + data->reply_timeout_ns)
+      return;
+
+    start_response(data, start_ns);
+  }
+}
+
+// Handle a command byte finishing on the wire
+static void host_byte_sent(struct joybus_loopback *loopback_bus)
+{
+  struct joybus *bus                = JOYBUS(loopback_bus);
+  struct joybus_loopback_data *data = &loopback_bus->data;
+  struct joybus *peer               = JOYBUS(data->peer);
+
+  // Deliver the byte to the target, as the peer backend would
+  uint8_t idx = data->write_count++;
+  if (data->target_listening && idx >= JOYBUS_COMMAND_BUFFER_SIZE) {
+    // Command too long for the target's buffer, the target ignores it
+    data->target_listening = false;
+    data->response         = NULL;
+  } else if (data->target_listening) {
+    peer->command_buffer[idx] = data->tx_byte;
+
+    // The target only hears the last byte of a bulk receive, like a backend receiving the rest by DMA
+    int rc = 1;
+    if (data->write_count >= data->target_bulk_end) {
+      // The handler runs once the byte is in, after any earlier call that hasn't returned yet
+      uint64_t call_ns     = data->event_ns > data->target_busy_ns ? data->event_ns : data->target_busy_ns;
+      data->target_busy_ns = call_ns + data->peer->data.handler_ns;
+
+      rc = joybus_target_byte_received(peer->target, peer->command_buffer, data->write_count, handle_command_response,
+                                       data);
+    }
+
+    if (joybus_target_bulk(rc)) {
+      data->target_bulk_end = data->write_count + joybus_target_bytes_expected(rc);
+      if (data->target_bulk_end > JOYBUS_COMMAND_BUFFER_SIZE)
+        rc = -JOYBUS_ERR_NO_SPACE;
+    }
+
+    if (rc < 0) {
+      // Error handling command, or command not supported, the target stays silent
+      data->target_listening = false;
+      data->response         = NULL;
+    } else if (rc == 0) {
+      // No more bytes expected
+      data->target_listening = false;
+    }
+  }
+
+  // Sample the next command byte as it starts on the wire
+  if (data->write_count < data->write_len) {
+    data->tx_byte   = data->write_buf[data->write_count];
+    data->event_ns += bits_ns(bus, 8);
+    return;
+  }
+
+  // Command and stop bit sent, work out when and how the transfer completes
+  data->command_end_ns = data->event_ns + bits_ns(bus, 1);
+
+  if (data->read_len == 0) {
+    // No response expected
+    data->done_status = 0;
+    data->event_ns    = data->command_end_ns;
+    data->state       = BUS_STATE_HOST_DONE;
+  } else if (data->response && !data->target_listening) {
+    // Response already staged, the target starts clocking it out as soon as its handler has returned
+    uint64_t start_ns = data->response_ready_ns > data->command_end_ns ? data->response_ready_ns : data->command_end_ns;
+
+    // Too late, the host has given up by the time the first bit arrives
+    if (start_ns + REPLY_DELAY_NS > data->command_end_ns + data->reply_timeout_ns) {
+      data->response_len = 0;
+      start_ns           = data->command_end_ns;
+    }
+
+    start_response(data, start_ns);
+  } else {
+    // No response yet, wait for a deferred one until the reply timeout
+    data->awaiting_response = true;
+    data->done_status       = -JOYBUS_ERR_TIMEOUT;
+    data->event_ns          = data->command_end_ns + data->reply_timeout_ns;
+    data->state             = BUS_STATE_HOST_RX;
+  }
+}
+
+// Handle a response byte finishing on the wire
+static void host_byte_received(struct joybus_loopback *loopback_bus)
+{
+  struct joybus *bus                = JOYBUS(loopback_bus);
+  struct joybus_loopback_data *data = &loopback_bus->data;
+  struct joybus *peer               = JOYBUS(data->peer);
+
+  // Reply timeout expired while waiting for a deferred response
+  if (data->awaiting_response) {
+    data->awaiting_response = false;
+    data->state             = BUS_STATE_HOST_DONE;
+    return;
+  }
+
+  // Store the byte and notify the per-byte callback
+  uint8_t idx         = data->read_count++;
+  data->read_buf[idx] = data->rx_byte;
+  if (idx == 0)
+    data->first_byte_ns = data->event_ns;
+  if (bus->rx_byte_callback)
+    bus->rx_byte_callback(bus, idx, bus->rx_byte_user_data);
+
+  // Sample the next response byte as it starts on the wire
+  if (data->read_count < data->response_len) {
+    data->rx_byte   = data->response[data->read_count];
+    data->event_ns += bits_ns(peer, 8);
+    return;
+  }
+
+  if (data->read_count == data->read_len) {
+    // Full response received, plus the target's stop bit
+    data->done_status = 0;
+    data->event_ns   += bits_ns(peer, 1);
+  } else {
+    // Short response, the host gives up after the byte timeout
+    data->done_status = -JOYBUS_ERR_TIMEOUT;
+    data->event_ns   += data->byte_timeout_ns;
+  }
+
+  data->state = BUS_STATE_HOST_DONE;
+}
+
+// Handle the end of a transfer, successful or not
+static void host_transfer_complete(struct joybus_loopback *loopback_bus)
+{
+  struct joybus *bus                = JOYBUS(loopback_bus);
+  struct joybus_loopback_data *data = &loopback_bus->data;
+
+  // Switch back to idle mode and record the completion time for the gap before the next transfer
+  data->state   = BUS_STATE_HOST_IDLE;
+  data->done_ns = data->event_ns;
+
+  // Publish the wire timestamps on the microsecond bus clock
+  bus->timestamps.start_us      = data->start_ns / 1000;
+  bus->timestamps.first_byte_us = data->first_byte_ns / 1000;
+  bus->timestamps.complete_us   = data->event_ns / 1000;
+
+  // Call the transfer complete callback
+  if (data->done_callback)
+    data->done_callback(bus, data->done_status, data->done_user_data);
+}
+
+// Find the instance with the earliest pending event at or before the limit
+static struct joybus_loopback *next_event(uint64_t limit_ns)
+{
+  struct joybus_loopback *next = NULL;
+
+  for (struct joybus_loopback *lb = instances; lb; lb = lb->data.next) {
+    if (lb->data.state != BUS_STATE_HOST_TX && lb->data.state != BUS_STATE_HOST_RX &&
+        lb->data.state != BUS_STATE_HOST_DONE)
+      continue;
+
+    if (lb->data.event_ns <= limit_ns && (!next || lb->data.event_ns < next->data.event_ns))
+      next = lb;
+  }
+
+  return next;
+}
+
+// Process events in time order up to the limit
+static int run_events(uint64_t limit_ns)
+{
+  struct joybus_virtual_clock *vclock = loopback_clock();
+  int completed                       = 0;
+
+  for (;;) {
+    struct joybus_loopback *lb = next_event(limit_ns);
+
+    // Alarms due before the next bus event fire first
+    uint64_t alarm_ns;
+    if (joybus_virtual_clock_next_alarm(vclock, &alarm_ns) && alarm_ns <= limit_ns &&
+        (!lb || alarm_ns < lb->data.event_ns)) {
+      joybus_virtual_clock_advance_to(vclock, alarm_ns);
+      continue;
+    }
+
+    if (!lb)
+      break;
+
+    joybus_virtual_clock_advance_to(vclock, lb->data.event_ns);
+
+    if (lb->data.state == BUS_STATE_HOST_TX) {
+      host_byte_sent(lb);
+    } else if (lb->data.state == BUS_STATE_HOST_RX) {
+      host_byte_received(lb);
+    } else {
+      host_transfer_complete(lb);
+      completed++;
+    }
+  }
+
+  return completed;
+}
+
+JOYBUS_BACKEND_API int joybus_loopback_enable(struct joybus *bus)
+{
+  struct joybus_loopback_data *data = &JOYBUS_LOOPBACK(bus)->data;
+  if (data->state != BUS_STATE_DISABLED)
+    return 0;
+
+  // Start in the appropriate mode
+  data->state = bus->mode == JOYBUS_MODE_HOST ? BUS_STATE_HOST_IDLE : BUS_STATE_TARGET_RX;
+
+  // Take part in event scheduling
+  link_instance(JOYBUS_LOOPBACK(bus));
+
+  return 0;
+}
+
+JOYBUS_BACKEND_API int joybus_loopback_disable(struct joybus *bus)
+{
+  struct joybus_loopback_data *data = &JOYBUS_LOOPBACK(bus)->data;
+  if (data->state == BUS_STATE_DISABLED)
+    return 0;
+
+  // Drop any in-flight transfer without calling back
+  unlink_instance(JOYBUS_LOOPBACK(bus));
+  data->state = BUS_STATE_DISABLED;
+
+  return 0;
+}
+
+// Start a transfer at the given virtual time, or once the inter-transfer delay has passed if that is later
+static int start_transfer(struct joybus *bus, uint64_t at_ns, const uint8_t *write_buf, uint8_t write_len,
+                          uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  struct joybus_loopback_data *data = &JOYBUS_LOOPBACK(bus)->data;
+
+  if (data->state == BUS_STATE_DISABLED)
+    return -JOYBUS_ERR_DISABLED;
+
+  if (data->state != BUS_STATE_HOST_IDLE)
+    return -JOYBUS_ERR_BUSY;
+
+  // Save the transfer context
+  data->write_buf       = write_buf;
+  data->write_len       = write_len;
+  data->write_count     = 0;
+  data->read_buf        = read_buf;
+  data->read_len        = read_len;
+  data->response        = NULL;
+  data->response_len    = 0;
+  data->target_bulk_end = 0;
+  data->done_callback   = callback;
+  data->done_user_data  = user_data;
+
+  data->awaiting_response = false;
+
+  // Take the timeouts from the transfer's timing profile, falling back to the config
+  const struct joybus_timing *timing = joybus_transfer_timing(bus);
+  uint32_t reply_timeout_us = timing->reply_timeout_us ? timing->reply_timeout_us : data->default_timeout_us;
+  uint32_t byte_timeout_us  = timing->byte_timeout_us ? timing->byte_timeout_us : data->default_timeout_us;
+  data->reply_timeout_ns    = reply_timeout_us * 1000ULL;
+  data->byte_timeout_ns     = byte_timeout_us * 1000ULL;
+
+  // The first byte starts once the minimum gap has passed, virtual time has no jitter to make up for
+  uint64_t now_ns   = joybus_virtual_clock_now_ns(&virtual_clock);
+  uint64_t ready_ns = data->done_ns ? data->done_ns + timing->min_gap_us * 1000ULL : 0;
+  uint64_t start_ns = now_ns > ready_ns ? now_ns : ready_ns;
+  if (at_ns > start_ns)
+    start_ns = at_ns;
+
+  // Only an enabled target-mode peer hears the command, once it has recovered from the last transfer
+  struct joybus_loopback *peer = data->peer;
+  bool listening                = peer && peer->data.state == BUS_STATE_TARGET_RX;
+  data->target_listening        = listening && (!data->done_ns || start_ns >= data->done_ns + peer->data.recovery_ns);
+
+  // Mark transfer as started
+  data->state = BUS_STATE_HOST_TX;
+
+  data->tx_byte       = write_buf[0];
+  data->event_ns      = start_ns + bits_ns(bus, 8);
+  data->start_ns      = start_ns;
+  data->first_byte_ns = 0;
+
+  return 0;
+}
+
+JOYBUS_BACKEND_API int joybus_loopback_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len,
+                                                uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                                                void *user_data)
+{
+  return start_transfer(bus, 0, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+JOYBUS_BACKEND_API int joybus_loopback_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf,
+                                                   uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
+                                                   joybus_transfer_cb callback, void *user_data)
+{
+  return start_transfer(bus, at_us * 1000, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+JOYBUS_BACKEND_API const struct joybus_api joybus_loopback_api = {
+  .enable      = joybus_loopback_enable,
+  .disable     = joybus_loopback_disable,
+  .transfer    = joybus_loopback_transfer,
+  .transfer_at = joybus_loopback_transfer_at,
+};
+
+int joybus_loopback_init(struct joybus_loopback *loopback_bus, struct joybus_loopback_config config)
+{
+  // Stop scheduling events for an instance that is being re-initialized
+  unlink_instance(loopback_bus);
+
+  // Save the bus API
+  struct joybus *bus     = JOYBUS(loopback_bus);
+  bus->api               = &joybus_loopback_api;
+  bus->freq              = config.freq;
+  bus->clock             = &loopback_clock()->base;
+  bus->target            = NULL;
+  bus->streams_write_buf = true;
+  bus->rx_byte_callback  = NULL;
+  bus->timing            = joybus_timing_default();
+  bus->transfer_timing   = NULL;
+  bus->retry             = joybus_retry_policy_default();
+
+  // Start from a clean state
+  memset(&loopback_bus->data, 0, sizeof(loopback_bus->data));
+  loopback_bus->data.state              = BUS_STATE_DISABLED;
+  loopback_bus->data.default_timeout_us = config.reply_timeout_us;
+  loopback_bus->data.recovery_ns        = config.recovery_us * 1000ULL;
+  loopback_bus->data.handler_ns         = config.handler_ns;
+
+  return 0;
+}
+
+int joybus_loopback_connect(struct joybus_loopback *a, struct joybus_loopback *b)
+{
+  a->data.peer = b;
+  b->data.peer = a;
+
+  return 0;
+}
+
+uint64_t joybus_loopback_now_ns(void)
+{
+  return joybus_virtual_clock_now_ns(loopback_clock());
+}
+
+struct joybus_clock *joybus_loopback_clock(void)
+{
+  return &loopback_clock()->base;
+}
+
+int joybus_loopback_run(void)
+{
+  return run_events(UINT64_MAX);
+}
+
+int joybus_loopback_run_until(uint64_t time_ns)
+{
+  int completed = run_events(time_ns);
+
+  // Advance to the requested time even if nothing was due
+  joybus_virtual_clock_advance_to(&virtual_clock, time_ns);
+
+  return completed;
+}
@@ -0,0 +1,55 @@
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+#include <joybus/clock.h>
+#include <joybus/backend/rp2xxx.h>
+
+static struct joybus_clock clock_instance;
+static alarm_id_t hardware_alarm;
+
+static int64_t __not_in_flash_func(hardware_alarm_fired)(alarm_id_t id, void *user_data)
+{
+  hardware_alarm = 0;
+  joybus_clock_run_alarms(&clock_instance);
+
+  return 0;
+}
+
+static uint64_t __not_in_flash_func(rp2xxx_clock_now_us)(struct joybus_clock *clock)
+{
+  return time_us_64();
+}
+
+static int __not_in_flash_func(rp2xxx_clock_set_alarm)(struct joybus_clock *clock, uint64_t at_us)
+{
+  if (hardware_alarm > 0)
+    cancel_alarm(hardware_alarm);
+
+  // With fire_if_past disabled, a time that has already passed is reported as 0
+  hardware_alarm = add_alarm_at(from_us_since_boot(at_us), hardware_alarm_fired, NULL, false);
+
+  return hardware_alarm == 0;
+}
+
+static uint32_t __not_in_flash_func(rp2xxx_clock_lock)(struct joybus_clock *clock)
+{
+  return save_and_disable_interrupts();
+}
+
+static void __not_in_flash_func(rp2xxx_clock_unlock)(struct joybus_clock *clock, uint32_t state)
+{
+  restore_interrupts(state);
+}
+
+static const struct joybus_clock_api rp2xxx_clock_api = {
+  .now_us    = rp2xxx_clock_now_us,
+  .set_alarm = rp2xxx_clock_set_alarm,
+  .lock      = rp2xxx_clock_lock,
+  .unlock    = rp2xxx_clock_unlock,
+};
+
+struct joybus_clock *joybus_rp2xxx_clock(void)
+{
+  clock_instance.api = &rp2xxx_clock_api;
+  return &clock_instance;
+}
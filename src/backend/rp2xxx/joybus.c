@@ -2,26 +2,20 @@
 
 #include <hardware/clocks.h>
 #include <hardware/dma.h>
+#include <hardware/irq.h>
 #include <hardware/pio.h>
 #include <pico/stdlib.h>
 
 #include <joybus/bus.h>
+#include <joybus/clock.h>
 #include <joybus/errors.h>
 #include <joybus/target.h>
+#include <joybus/backend/core.h>
 #include <joybus/backend/rp2xxx.h>
 
 #include "joybus_host.pio.h"
 #include "joybus_target.pio.h"
 
-enum {
-  BUS_STATE_DISABLED,
-  BUS_STATE_HOST_IDLE,
-  BUS_STATE_HOST_TX,
-  BUS_STATE_HOST_RX,
-  BUS_STATE_TARGET_RX,
-  BUS_STATE_TARGET_TX,
-};
-
 // Global state to track loaded PIO programs and bus instances
 static struct {
   uint host_offset;
@@ -30,6 +24,10 @@ static struct {
   struct joybus *bus_instances[NUM_PIO_STATE_MACHINES];
 } pio_state[NUM_PIOS] = {0};
 
+// Bus instances by RX DMA channel, for the bulk receive completion interrupt
+static struct joybus *dma_rx_instances[NUM_DMA_CHANNELS] = {0};
+static bool dma_irq_installed                            = false;
+
 // Load the PIO program for the bus mode. The mode is fixed at init, so this
 // only needs to run once.
 static void configure_state_machine(struct joybus *bus)
@@ -54,195 +52,161 @@ static void configure_state_machine(struct joybus *bus)
   data->pio_configured = true;
 }
 
-// Enter either host idle mode or target read mode, depending on the bus mode
-static inline void enter_idle_mode(struct joybus *bus, bool await_idle)
+// Wait for the line to stay high for JOYBUS_BUS_IDLE_US
+static void await_bus_idle(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  if (bus->mode == JOYBUS_MODE_TARGET) {
-    // Wait for bus idle
-    if (await_idle) {
-      absolute_time_t high_since = get_absolute_time();
-      while (absolute_time_diff_us(high_since, get_absolute_time()) < JOYBUS_BUS_IDLE_US) {
-        if (!gpio_get(data->gpio)) {
-          high_since = get_absolute_time();
-        }
-      }
+  uint64_t high_since = joybus_clock_now_us(bus->clock);
+  while (joybus_clock_now_us(bus->clock) - high_since < JOYBUS_BUS_IDLE_US) {
+    if (!gpio_get(data->gpio)) {
+      high_since = joybus_clock_now_us(bus->clock);
     }
-
-    // Reset read state
-    data->read_buf   = bus->command_buffer;
-    data->read_len   = JOYBUS_BLOCK_SIZE;
-    data->read_count = 0;
-
-    // Make sure the PIO program is loaded
-    configure_state_machine(bus);
-
-    // Restart the state machine
-    // TODO: Consider performing the state machine reset only when strictly needed
-    pio_sm_set_enabled(data->pio, data->pio_sm, false);
-    pio_sm_clear_fifos(data->pio, data->pio_sm);
-    dma_channel_abort(data->dma_chan_tx);
-    pio_sm_restart(data->pio, data->pio_sm);
-    pio_sm_exec(data->pio, data->pio_sm, pio_encode_jmp(pio_state[PIO_NUM(data->pio)].target_offset));
-    pio_sm_set_enabled(data->pio, data->pio_sm, true);
-
-    // Transition state
-    data->state = BUS_STATE_TARGET_RX;
-  } else {
-    // Make sure the PIO program is loaded
-    configure_state_machine(bus);
-
-    // Enter host idle mode
-    // TODO: Consider performing the state machine reset only when strictly needed
-    pio_sm_set_enabled(data->pio, data->pio_sm, false);
-    dma_channel_abort(data->dma_chan_rx);
-    pio_sm_restart(data->pio, data->pio_sm);
-    pio_sm_exec(data->pio, data->pio_sm,
-                pio_encode_jmp(pio_state[PIO_NUM(data->pio)].host_offset + joybus_host_offset_transmit));
-    pio_sm_set_enabled(data->pio, data->pio_sm, true);
-
-    // Transition state
-    data->state = BUS_STATE_HOST_IDLE;
   }
 }
 
-static inline void handle_command_response(const uint8_t *buffer, uint8_t length, void *user_data)
+// Enter host idle mode, waiting for a command to transmit
+static void hal_host_idle(struct joybus *bus)
 {
-  struct joybus *bus              = (struct joybus *)user_data;
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Arm the DMA transfer as soon as we have a response
-  dma_channel_set_read_addr(data->dma_chan_tx, (const void *)buffer, false);
-  dma_channel_set_transfer_count(data->dma_chan_tx, length, false);
-  dma_channel_start(data->dma_chan_tx);
+  // Make sure the PIO program is loaded
+  configure_state_machine(bus);
+
+  // TODO: Consider performing the state machine reset only when strictly needed
+  pio_sm_set_enabled(data->pio, data->pio_sm, false);
+  pio_sm_clear_fifos(data->pio, data->pio_sm);
+  pio_sm_restart(data->pio, data->pio_sm);
+  pio_sm_exec(data->pio, data->pio_sm,
+              pio_encode_jmp(pio_state[PIO_NUM(data->pio)].host_offset + joybus_host_offset_transmit));
+  pio_sm_set_enabled(data->pio, data->pio_sm, true);
 }
 
-// Start a pre-armed transfer
-int64_t transfer_start(alarm_id_t id, void *user_data)
+// Kick off the TX DMA channel to send the command, the reply lands in the RX FIFO
+static void hal_host_start(struct joybus *bus)
 {
-  struct joybus *bus              = (struct joybus *)user_data;
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Kick off the TX DMA channel to send the command
-  dma_channel_set_read_addr(data->dma_chan_tx, (const void *)data->write_buf, false);
-  dma_channel_set_transfer_count(data->dma_chan_tx, data->write_len, true);
-
-  // Arm the RX DMA channel to receive the response
-  dma_channel_set_write_addr(data->dma_chan_rx, (void *)data->read_buf, false);
-  dma_channel_set_transfer_count(data->dma_chan_rx, data->read_len, true);
-
-  return 0;
+  dma_channel_set_read_addr(data->dma_chan_tx, (const void *)data->core.write_buf, false);
+  dma_channel_set_transfer_count(data->dma_chan_tx, data->core.write_len, true);
 }
 
-// Handle transfer timeouts
-int64_t transfer_timeout(alarm_id_t id, void *user_data)
+// Enter target read mode
+static void hal_target_listen(struct joybus *bus, bool await_idle)
 {
-  struct joybus *bus              = (struct joybus *)user_data;
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Timeout occurred, switch back to idle/read mode
-  enter_idle_mode(bus, true);
+  if (await_idle)
+    await_bus_idle(bus);
 
-  // Record the completion time for enforcing minimum delay between transfers
-  data->last_transfer_time = get_absolute_time();
+  // Make sure the PIO program is loaded
+  configure_state_machine(bus);
 
-  // Call the transfer complete callback with an error
-  if (data->done_callback)
-    data->done_callback(bus, -JOYBUS_ERR_TIMEOUT, data->done_user_data);
+  // Stop any bulk receive, acknowledging the completion interrupt the abort may raise
+  data->rx_bulk = false;
+  dma_channel_abort(data->dma_chan_rx);
+  dma_channel_acknowledge_irq0(data->dma_chan_rx);
 
-  return 0;
+  // Restart the state machine
+  // TODO: Consider performing the state machine reset only when strictly needed
+  pio_sm_set_enabled(data->pio, data->pio_sm, false);
+  pio_sm_clear_fifos(data->pio, data->pio_sm);
+  dma_channel_abort(data->dma_chan_tx);
+  pio_sm_restart(data->pio, data->pio_sm);
+  pio_sm_exec(data->pio, data->pio_sm, pio_encode_jmp(pio_state[PIO_NUM(data->pio)].target_offset));
+  pio_interrupt_clear(data->pio, data->pio_sm);
+  pio_set_irq0_source_enabled(data->pio, pis_interrupt0 + data->pio_sm, true);
+  pio_sm_set_enabled(data->pio, data->pio_sm, true);
 }
 
-// Handle target rx byte timeouts
-int64_t target_rx_timeout(alarm_id_t id, void *user_data)
+// Take the rest of a command by DMA, with the per-byte PIO interrupt masked until it's in
+static void hal_target_receive_bulk(struct joybus *bus, uint8_t len)
 {
-  struct joybus *bus              = (struct joybus *)user_data;
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Timeout occurred, switch back to idle/read mode
-  enter_idle_mode(bus, true);
+  // Bytes already waiting in the RX FIFO are picked up by the DMA, so stop draining it first
+  data->rx_bulk = true;
+  pio_set_irq0_source_enabled(data->pio, pis_interrupt0 + data->pio_sm, false);
 
-  return 0;
+  dma_channel_set_write_addr(data->dma_chan_rx, data->core.read_buf + data->core.read_count, false);
+  dma_channel_set_transfer_count(data->dma_chan_rx, len, true);
 }
 
-// Handle host tx complete (all command bytes sent)
-static inline void host_tx_complete(struct joybus *bus)
+// Arm the DMA transfer as soon as we have a reply
+static void hal_target_prepare_reply(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Add a timeout alarm
-  data->rx_timeout_alarm = add_alarm_in_us(JOYBUS_REPLY_TIMEOUT_US, transfer_timeout, bus, true);
-
-  // Update the state machine for the next interrupt
-  data->state = BUS_STATE_HOST_RX;
+  dma_channel_set_read_addr(data->dma_chan_tx, (const void *)data->core.write_buf, false);
+  dma_channel_set_transfer_count(data->dma_chan_tx, data->core.write_len, false);
+  dma_channel_start(data->dma_chan_tx);
 }
 
-// Handle host byte received
-static inline void host_byte_received(struct joybus *bus)
+// Start transmitting the pre-armed reply
+static void hal_target_send_reply(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  // Cancel the transfer timeout
-  cancel_alarm(data->rx_timeout_alarm);
-
-  // Track the received byte
-  data->read_count++;
+  pio_sm_exec(data->pio, data->pio_sm,
+              pio_encode_jmp(pio_state[PIO_NUM(data->pio)].target_offset + joybus_target_offset_transmit));
+}
 
-  if (data->read_count < data->read_len) {
-    // Set a new timeout for the next byte
-    data->rx_timeout_alarm = add_alarm_in_us(JOYBUS_REPLY_TIMEOUT_US, transfer_timeout, bus, true);
-  } else if (data->read_count == data->read_len) {
-    // All bytes received, switch back to idle/read mode
-    enter_idle_mode(bus, false);
+static const struct joybus_core_hal rp2xxx_hal = {
+  .host_idle            = hal_host_idle,
+  .host_start           = hal_host_start,
+  .target_listen        = hal_target_listen,
+  .target_prepare_reply = hal_target_prepare_reply,
+  .target_send_reply    = hal_target_send_reply,
+  .target_receive_bulk  = hal_target_receive_bulk,
+  .reply_timeout_us     = JOYBUS_REPLY_TIMEOUT_US,
+  .byte_timeout_us      = JOYBUS_REPLY_TIMEOUT_US,
+  .start_lead_us        = 5, // Covers the alarm pool interrupt, the command then starts within a few cycles
+};
 
-    // Record the completion time for enforcing minimum interval between transfers
-    data->last_transfer_time = get_absolute_time();
+// Pass each received byte to the core, more than one may have landed before the interrupt was serviced
+static inline void drain_rx_fifo(struct joybus *bus)
+{
+  struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
+  uint8_t state                   = data->core.state;
 
-    // Call the transfer complete callback with a success status
-    if (data->done_callback)
-      data->done_callback(bus, 0, data->done_user_data);
-  }
+  while (data->core.state == state && !data->rx_bulk && !pio_sm_is_rx_fifo_empty(data->pio, data->pio_sm))
+    joybus_core_rx_byte(&data->core, pio_sm_get(data->pio, data->pio_sm) & 0xFF);
 }
 
-// Handle target byte received
-static inline void target_byte_received(struct joybus *bus)
+// Report a completed bulk receive to the core
+static inline void finish_rx_bulk(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
+  if (!data->rx_bulk)
+    return;
 
-  // Cancel the transfer timeout (only armed after the first byte)
-  if (data->read_count > 0)
-    cancel_alarm(data->rx_timeout_alarm);
-
-  // Save the received byte in the buffer
-  data->read_buf[data->read_count] = pio_sm_get(data->pio, data->pio_sm) & 0xFF;
-  data->read_count++;
-
-  // Call the target handler to prepare a response if needed
-  int rc = joybus_target_byte_received(bus->target, data->read_buf, data->read_count, handle_command_response, bus);
-  if (rc == 0) {
-    // No more bytes expected, start transmitting the response
-    pio_sm_exec(data->pio, data->pio_sm,
-                pio_encode_jmp(pio_state[PIO_NUM(data->pio)].target_offset + joybus_target_offset_transmit));
-
-    data->state = BUS_STATE_TARGET_TX;
-  } else if (rc > 0) {
-    // More bytes expected
-    // Set a timeout for the next byte
-    data->rx_timeout_alarm = add_alarm_in_us(JOYBUS_REPLY_TIMEOUT_US, target_rx_timeout, bus, true);
-  } else {
-    // Error handling command, or command not supported, switch back to idle/read mode
-    enter_idle_mode(bus, true);
-  }
+  // The DMA finishes as soon as the last byte is pushed, wait for the PIO to fire the byte IRQ after its last bit, so
+  // the core sees the byte when it would have without the DMA and a reply doesn't start early
+  uint offset = pio_state[PIO_NUM(data->pio)].target_offset;
+  uint pc;
+  do {
+    pc = pio_sm_get_pc(data->pio, data->pio_sm) - offset;
+  } while (pc >= joybus_target_offset_rx_irq - 2 && pc <= joybus_target_offset_rx_irq);
+
+  // Drop the byte IRQs raised during the transfer, and take them again for the rest of the transaction
+  data->rx_bulk = false;
+  pio_interrupt_clear(data->pio, data->pio_sm);
+  pio_set_irq0_source_enabled(data->pio, pis_interrupt0 + data->pio_sm, true);
+
+  joybus_core_rx_bulk(&data->core);
 }
 
-// Handle target tx complete (all response bytes sent)
-static inline void target_tx_complete(struct joybus *bus)
+// DMA IRQ handler, fired when a bulk receive completes
+static void __isr __not_in_flash_func(dma_irq_handler)(void)
 {
-  struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
+  for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+    struct joybus *bus = dma_rx_instances[ch];
+    if (!bus || !dma_channel_get_irq0_status(ch))
+      continue;
 
-  // Switch back to idle/read mode
-  enter_idle_mode(bus, false);
+    dma_channel_acknowledge_irq0(ch);
+    finish_rx_bulk(bus);
+  }
 }
 
 // PIO IRQ handler
@@ -266,20 +230,17 @@ static void __isr __not_in_flash_func(pio_irq_handler)(void)
     if (!bus)
       continue;
 
-    // Handle the interrupt based on the bus state
+    // The PIO programs fire the IRQ when a command or reply has been sent, and after each byte received
     struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
-    switch (data->state) {
-      case BUS_STATE_HOST_TX:
-        host_tx_complete(bus);
-        break;
-      case BUS_STATE_HOST_RX:
-        host_byte_received(bus);
+    switch (data->core.state) {
+      case JOYBUS_CORE_HOST_TX:
+      case JOYBUS_CORE_TARGET_TX:
+        joybus_core_tx_done(&data->core);
         break;
-      case BUS_STATE_TARGET_RX:
-        target_byte_received(bus);
-        break;
-      case BUS_STATE_TARGET_TX:
-        target_tx_complete(bus);
+      case JOYBUS_CORE_HOST_RX:
+      case JOYBUS_CORE_TARGET_RX:
+      case JOYBUS_CORE_TARGET_DEFER:
+        drain_rx_fifo(bus);
         break;
       default:
         break;
@@ -287,10 +248,10 @@ static void __isr __not_in_flash_func(pio_irq_handler)(void)
   }
 }
 
-static int joybus_rp2xxx_enable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_rp2xxx_enable(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
-  if (data->state != BUS_STATE_DISABLED)
+  if (joybus_core_enabled(&data->core))
     return 0;
 
   // Claim a state machine
@@ -315,7 +276,7 @@ static int joybus_rp2xxx_enable(struct joybus *bus)
   irq_set_enabled(PIO_IRQ_NUM(data->pio, 0), true);
   pio_set_irq0_source_enabled(data->pio, pis_interrupt0 + data->pio_sm, true);
 
-  // Allocate DMA channels
+  // Allocate DMA channels for TX and for bulk receives, other received bytes are read from the RX FIFO as they arrive
   data->dma_chan_tx = dma_claim_unused_channel(true);
   data->dma_chan_rx = dma_claim_unused_channel(true);
 
@@ -331,86 +292,95 @@ static int joybus_rp2xxx_enable(struct joybus *bus)
   io_rw_8 *txf_msb = (io_rw_8 *)&data->pio->txf[data->pio_sm] + 3;
   dma_channel_set_write_addr(data->dma_chan_tx, (void *)txf_msb, false);
 
-  // Configure DMA for RX
+  // Configure RX DMA to read bulk receives from the RX FIFO into the command buffer
   dma_channel_config dma_config_rx = dma_channel_get_default_config(data->dma_chan_rx);
   channel_config_set_transfer_data_size(&dma_config_rx, DMA_SIZE_8);
   channel_config_set_read_increment(&dma_config_rx, false);
   channel_config_set_write_increment(&dma_config_rx, true);
   channel_config_set_dreq(&dma_config_rx, PIO_DREQ_NUM(data->pio, data->pio_sm, false));
   dma_channel_set_config(data->dma_chan_rx, &dma_config_rx, false);
-  dma_channel_set_read_addr(data->dma_chan_rx, &data->pio->rxf[data->pio_sm], false);
+
+  // The ISR shifts left with an 8-bit autopush, so each byte sits in the LSB of the RX FIFO
+  io_ro_8 *rxf_lsb = (io_ro_8 *)&data->pio->rxf[data->pio_sm];
+  dma_channel_set_read_addr(data->dma_chan_rx, (const void *)rxf_lsb, false);
+
+  // Report bulk receives from the shared DMA IRQ
+  dma_rx_instances[data->dma_chan_rx] = bus;
+  dma_channel_set_irq0_enabled(data->dma_chan_rx, true);
+  if (!dma_irq_installed) {
+    irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    dma_irq_installed = true;
+  }
 
   // Start in the appropriate mode
-  enter_idle_mode(bus, true);
+  joybus_core_enable(&data->core);
 
   return 0;
 }
 
-static int joybus_rp2xxx_disable(struct joybus *bus)
+JOYBUS_BACKEND_API int joybus_rp2xxx_disable(struct joybus *bus)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
-  if (data->state == BUS_STATE_DISABLED)
+  if (!joybus_core_enabled(&data->core))
     return 0;
 
-  // TODO: Handle peripheral teardown (DMA channels, IRQ cleanup, etc.)
+  // Drop any transfer in progress and stop pending timers
+  joybus_core_disable(&data->core);
 
-  data->state = BUS_STATE_DISABLED;
+  // TODO: Handle peripheral teardown (DMA channels, IRQ cleanup, etc.)
 
   return 0;
 }
 
-static int joybus_rp2xxx_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
-                                  uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+JOYBUS_BACKEND_API int joybus_rp2xxx_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len,
+                                              uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                                              void *user_data)
 {
   struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  if (data->state == BUS_STATE_DISABLED)
-    return -JOYBUS_ERR_DISABLED;
-
-  if (data->state != BUS_STATE_HOST_IDLE)
-    return -JOYBUS_ERR_BUSY;
-
-  // Save the transfer context
-  data->write_buf      = (uint8_t *)write_buf;
-  data->write_len      = write_len;
-  data->read_buf       = read_buf;
-  data->read_len       = read_len;
-  data->read_count     = 0;
-  data->done_callback  = callback;
-  data->done_user_data = user_data;
-
-  // Mark transfer as started
-  data->state = BUS_STATE_HOST_TX;
+  return joybus_core_transfer(&data->core, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
 
-  // Schedule the transfer to start at last_completion + the minimum intra-transfer delay
-  // If the time has already passed, the callback fires immediately
-  absolute_time_t ready_time = delayed_by_us(data->last_transfer_time, JOYBUS_INTER_TRANSFER_DELAY_US);
-  data->transfer_start_alarm = add_alarm_at(ready_time, transfer_start, bus, true);
+JOYBUS_BACKEND_API int joybus_rp2xxx_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf,
+                                                 uint8_t write_len, uint8_t *read_buf, uint8_t read_len,
+                                                 joybus_transfer_cb callback, void *user_data)
+{
+  struct joybus_rp2xxx_data *data = &JOYBUS_RP2XXX(bus)->data;
 
-  return 0;
+  return joybus_core_transfer_at(&data->core, at_us, write_buf, write_len, read_buf, read_len, callback, user_data);
 }
 
-static const struct joybus_api rp2xxx_api = {
-  .enable   = joybus_rp2xxx_enable,
-  .disable  = joybus_rp2xxx_disable,
-  .transfer = joybus_rp2xxx_transfer,
+JOYBUS_BACKEND_API const struct joybus_api joybus_rp2xxx_api = {
+  .enable      = joybus_rp2xxx_enable,
+  .disable     = joybus_rp2xxx_disable,
+  .transfer    = joybus_rp2xxx_transfer,
+  .transfer_at = joybus_rp2xxx_transfer_at,
 };
 
 int joybus_rp2xxx_init(struct joybus_rp2xxx *rp2xxx_bus, struct joybus_rp2xxx_config config)
 {
   // Save the bus API
-  struct joybus *bus = JOYBUS(rp2xxx_bus);
-  bus->api           = &rp2xxx_api;
-  bus->freq          = config.freq;
-  bus->target        = NULL;
+  struct joybus *bus     = JOYBUS(rp2xxx_bus);
+  bus->api               = &joybus_rp2xxx_api;
+  bus->freq              = config.freq;
+  bus->clock             = joybus_rp2xxx_clock();
+  bus->target            = NULL;
+  bus->streams_write_buf = false;
+  bus->rx_byte_callback  = NULL;
+  bus->timing            = joybus_timing_default();
+  bus->transfer_timing   = NULL;
+  bus->retry             = joybus_retry_policy_default();
 
   // Save the joybus configuration
   struct joybus_rp2xxx_data *data = &rp2xxx_bus->data;
   data->gpio                      = config.gpio;
   data->pio                       = config.pio;
   data->pio_configured            = false;
-  data->state                     = BUS_STATE_DISABLED;
-  data->last_transfer_time        = nil_time;
+  data->rx_bulk                   = false;
+
+  // Set up the bus state machine
+  joybus_core_init(&data->core, bus, &rp2xxx_hal);
 
   return 0;
 }
@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <string.h>
+
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
+
+#include <joybus/bitslice.h>
+#include <joybus/errors.h>
+#include <joybus/backend/rp2xxx_multi.h>
+
+#include "joybus_host_multi.pio.h"
+
+// The PIO program samples the lines as often as the decoder expects
+static_assert(joybus_host_multi_SAMPLES_PER_BIT == JOYBUS_BITSLICE_OVERSAMPLE, "sample rate mismatch");
+
+// Engines by RX DMA channel, for the DMA interrupt handler
+static struct joybus_rp2xxx_multi *instances[NUM_DMA_CHANNELS];
+
+// Decode every port's reply once the sample window has closed
+static void __not_in_flash_func(complete_transfer)(struct joybus_rp2xxx_multi *multi)
+{
+  struct joybus_rp2xxx_multi_data *data = &multi->data;
+
+  // Split the samples into one stream per port
+  uint8_t *streams[JOYBUS_RP2XXX_MULTI_MAX_PORTS];
+  for (uint8_t p = 0; p < data->ports; p++)
+    streams[p] = data->streams[p];
+  joybus_bitslice_untranspose(data->samples, data->ports, data->num_samples / 8, streams);
+
+  // Decode each reply on its own, ports without a full reply time out
+  for (uint8_t p = 0; p < data->ports; p++) {
+    uint8_t len       = joybus_bitslice_decode(streams[p], data->num_samples, data->read_bufs[p], data->read_len);
+    data->statuses[p] = len == data->read_len ? 0 : -JOYBUS_ERR_TIMEOUT;
+  }
+
+  data->busy = false;
+  if (data->callback)
+    data->callback(multi, data->statuses, data->user_data);
+}
+
+// DMA IRQ handler, shared with other users of DMA_IRQ_1
+static void __isr __not_in_flash_func(dma_irq_handler)(void)
+{
+  for (uint chan = 0; chan < NUM_DMA_CHANNELS; chan++) {
+    if (!instances[chan] || !dma_channel_get_irq1_status(chan))
+      continue;
+
+    dma_channel_acknowledge_irq1(chan);
+    complete_transfer(instances[chan]);
+  }
+}
+
+int joybus_rp2xxx_multi_init(struct joybus_rp2xxx_multi *multi, struct joybus_rp2xxx_multi_config config)
+{
+  if (config.ports < 1 || config.ports > JOYBUS_RP2XXX_MULTI_MAX_PORTS)
+    return -JOYBUS_ERR_INVALID;
+
+  // Start from a clean state
+  struct joybus_rp2xxx_multi_data *data = &multi->data;
+  memset(data, 0, sizeof(*data));
+  data->gpio  = config.gpio;
+  data->ports = config.ports;
+  data->pio   = config.pio;
+
+  // Load the PIO program and claim a state machine
+  data->pio_offset = pio_add_program(data->pio, &joybus_host_multi_program);
+  data->pio_sm     = pio_claim_unused_sm(data->pio, true);
+  for (uint8_t p = 0; p < data->ports; p++)
+    pio_gpio_init(data->pio, data->gpio + p);
+  joybus_host_multi_program_init(data->pio, data->pio_sm, data->pio_offset, data->gpio, data->ports, config.freq);
+
+  // Configure TX DMA to write pin words to the MSB of the TX FIFO, they are shifted out MSB first
+  data->dma_chan_tx                = dma_claim_unused_channel(true);
+  dma_channel_config dma_config_tx = dma_channel_get_default_config(data->dma_chan_tx);
+  channel_config_set_transfer_data_size(&dma_config_tx, DMA_SIZE_8);
+  channel_config_set_read_increment(&dma_config_tx, true);
+  channel_config_set_write_increment(&dma_config_tx, false);
+  channel_config_set_dreq(&dma_config_tx, PIO_DREQ_NUM(data->pio, data->pio_sm, true));
+  io_rw_8 *txf_msb = (io_rw_8 *)&data->pio->txf[data->pio_sm] + 3;
+  dma_channel_configure(data->dma_chan_tx, &dma_config_tx, (void *)txf_msb, data->words, 0, false);
+
+  // Configure RX DMA to read samples from the LSB of the RX FIFO
+  data->dma_chan_rx                = dma_claim_unused_channel(true);
+  dma_channel_config dma_config_rx = dma_channel_get_default_config(data->dma_chan_rx);
+  channel_config_set_transfer_data_size(&dma_config_rx, DMA_SIZE_8);
+  channel_config_set_read_increment(&dma_config_rx, false);
+  channel_config_set_write_increment(&dma_config_rx, true);
+  channel_config_set_dreq(&dma_config_rx, PIO_DREQ_NUM(data->pio, data->pio_sm, false));
+  dma_channel_configure(data->dma_chan_rx, &dma_config_rx, data->samples, &data->pio->rxf[data->pio_sm], 0, false);
+
+  // Complete transfers when the last sample lands
+  instances[data->dma_chan_rx] = multi;
+  dma_channel_set_irq1_enabled(data->dma_chan_rx, true);
+  irq_add_shared_handler(DMA_IRQ_1, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_1, true);
+
+  data->enabled = true;
+  return 0;
+}
+
+int joybus_rp2xxx_multi_transfer(struct joybus_rp2xxx_multi *multi, const uint8_t *const write_bufs[],
+                                 uint8_t write_len, uint8_t *const read_bufs[], uint8_t read_len,
+                                 joybus_rp2xxx_multi_cb callback, void *user_data)
+{
+  struct joybus_rp2xxx_multi_data *data = &multi->data;
+
+  if (!data->enabled)
+    return -JOYBUS_ERR_DISABLED;
+  if (data->busy)
+    return -JOYBUS_ERR_BUSY;
+  if (write_len == 0)
+    return -JOYBUS_ERR_INVALID;
+  if (write_len > JOYBUS_RP2XXX_MULTI_MAX_WRITE || read_len > JOYBUS_RP2XXX_MULTI_MAX_READ)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  // Transpose the commands into pin words, setting a line's pin direction drives it low for a zero
+  joybus_bitslice_transpose(write_bufs, data->ports, write_len, data->words);
+  uint8_t mask = (1 << data->ports) - 1;
+  for (uint8_t i = 0; i < write_len * 8; i++)
+    data->words[i] = ~data->words[i] & mask;
+
+  // Save the transfer state
+  memcpy(data->read_bufs, read_bufs, data->ports * sizeof(read_bufs[0]));
+  data->read_len    = read_len;
+  data->num_samples = JOYBUS_BITSLICE_SAMPLES(read_len, JOYBUS_RP2XXX_MULTI_TURNAROUND_BITS);
+  data->callback    = callback;
+  data->user_data   = user_data;
+  data->busy        = true;
+
+  // Arm the sample DMA, then hand the sample count and the pin words to the state machine
+  dma_channel_transfer_to_buffer_now(data->dma_chan_rx, data->samples, data->num_samples);
+  pio_sm_put(data->pio, data->pio_sm, data->num_samples - 1);
+  dma_channel_transfer_from_buffer_now(data->dma_chan_tx, data->words, write_len * 8);
+
+  return 0;
+}
@@ -0,0 +1,372 @@
+#include <joybus/attributes.h>
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+#include <joybus/backend/core.h>
+
+// Listen for the next command
+JOYBUS_RAM_FUNC
+static void target_listen(struct joybus_core *core, bool await_idle)
+{
+  struct joybus *bus = core->bus;
+
+  // Reset the read state
+  core->read_buf   = bus->command_buffer;
+  core->read_len   = JOYBUS_COMMAND_BUFFER_SIZE;
+  core->read_count = 0;
+  core->bulk_end   = 0;
+  core->write_buf  = NULL;
+  core->write_len  = 0;
+
+  // Transition state before the peripheral can report anything
+  core->state = JOYBUS_CORE_TARGET_RX;
+  core->hal->target_listen(bus, await_idle);
+}
+
+// Drop the rest of a command the target can't handle
+JOYBUS_RAM_FUNC
+static void target_ignore(struct joybus_core *core)
+{
+  joybus_alarm_cancel(core->bus->clock, &core->rx_timeout_alarm);
+
+  if (!core->hal->target_ignore) {
+    target_listen(core, true);
+    return;
+  }
+
+  core->state = JOYBUS_CORE_TARGET_IGNORE;
+  core->hal->target_ignore(core->bus);
+}
+
+// Finish a host transfer and return to host idle
+JOYBUS_RAM_FUNC
+static void transfer_finish(struct joybus_core *core, int status)
+{
+  struct joybus *bus = core->bus;
+
+  // A transfer finishes once, late events from the peripheral are ignored
+  if (core->state != JOYBUS_CORE_HOST_TX && core->state != JOYBUS_CORE_HOST_RX)
+    return;
+
+  joybus_alarm_cancel(bus->clock, &core->rx_timeout_alarm);
+
+  // Return to idle before the callback, which may start the next transfer
+  core->state = JOYBUS_CORE_HOST_IDLE;
+  core->hal->host_idle(bus);
+
+  // Record the completion time for enforcing the minimum delay between transfers
+  core->last_transfer_us = joybus_clock_now_us(bus->clock);
+
+  // Publish the wire timestamps before the callback, which may start the next transfer
+  bus->timestamps.start_us      = core->start_us;
+  bus->timestamps.first_byte_us = core->first_byte_us;
+  bus->timestamps.complete_us   = core->last_transfer_us;
+
+  if (core->done_callback)
+    core->done_callback(bus, status, core->done_user_data);
+}
+
+// Target's send_response callback
+JOYBUS_RAM_FUNC
+static void handle_command_response(const uint8_t *buffer, uint8_t length, void *user_data)
+{
+  struct joybus_core *core = (struct joybus_core *)user_data;
+
+  // Too late, the core has given up on the reply and is waiting for the next command
+  bool deferred = core->state == JOYBUS_CORE_TARGET_DEFER;
+  if (!deferred && (core->state != JOYBUS_CORE_TARGET_RX || core->read_count == 0))
+    return;
+
+  // The target's buffer is long-lived, so the reply is sent straight from it
+  core->write_buf = buffer;
+  core->write_len = length;
+
+  if (core->hal->target_prepare_reply)
+    core->hal->target_prepare_reply(core->bus);
+
+  // Deferred reply, the host is already waiting for it
+  if (deferred) {
+    joybus_alarm_cancel(core->bus->clock, &core->rx_timeout_alarm);
+    core->state = JOYBUS_CORE_TARGET_TX;
+    core->hal->target_send_reply(core->bus);
+  }
+}
+
+// Start a transfer once the inter-transfer delay has passed
+JOYBUS_RAM_FUNC
+static void transfer_start(struct joybus_alarm *alarm, void *user_data)
+{
+  struct joybus_core *core = (struct joybus_core *)user_data;
+
+  if (core->state != JOYBUS_CORE_HOST_WAIT)
+    return;
+
+  // A scheduled transfer wakes up early, spin until its start time so the command goes out on the microsecond
+  if (core->start_at_us) {
+    while (joybus_clock_now_us(core->bus->clock) < core->start_at_us) {
+      // Busy-wait
+    }
+  }
+
+  core->state         = JOYBUS_CORE_HOST_TX;
+  core->start_us      = joybus_clock_now_us(core->bus->clock);
+  core->first_byte_us = 0;
+  core->hal->host_start(core->bus);
+}
+
+// Handle reply and byte timeouts, in either mode
+JOYBUS_RAM_FUNC
+static void rx_timeout(struct joybus_alarm *alarm, void *user_data)
+{
+  struct joybus_core *core = (struct joybus_core *)user_data;
+
+  if (core->state == JOYBUS_CORE_TARGET_RX) {
+    // Targets just wait for the next command
+    target_listen(core, true);
+  } else if (core->state == JOYBUS_CORE_TARGET_DEFER) {
+    // No reply in time for the host, or the command has none, the line is already idle
+    target_listen(core, false);
+  } else {
+    transfer_finish(core, -JOYBUS_ERR_TIMEOUT);
+  }
+}
+
+void joybus_core_init(struct joybus_core *core, struct joybus *bus, const struct joybus_core_hal *hal)
+{
+  core->hal              = hal;
+  core->bus              = bus;
+  core->state            = JOYBUS_CORE_DISABLED;
+  core->write_buf        = NULL;
+  core->write_len        = 0;
+  core->read_buf         = NULL;
+  core->read_len         = 0;
+  core->read_count       = 0;
+  core->bulk_end         = 0;
+  core->done_callback    = NULL;
+  core->done_user_data   = NULL;
+  core->last_transfer_us = 0;
+  core->start_us         = 0;
+  core->first_byte_us    = 0;
+  core->start_at_us      = 0;
+  core->reply_timeout_us = hal->reply_timeout_us;
+  core->byte_timeout_us  = hal->byte_timeout_us;
+
+  joybus_alarm_init(&core->transfer_start_alarm, transfer_start, core);
+  joybus_alarm_init(&core->rx_timeout_alarm, rx_timeout, core);
+}
+
+void joybus_core_enable(struct joybus_core *core)
+{
+  if (core->bus->mode == JOYBUS_MODE_TARGET) {
+    target_listen(core, true);
+  } else {
+    core->state = JOYBUS_CORE_HOST_IDLE;
+    core->hal->host_idle(core->bus);
+  }
+}
+
+void joybus_core_disable(struct joybus_core *core)
+{
+  core->state = JOYBUS_CORE_DISABLED;
+
+  // Stop any pending timers
+  joybus_alarm_cancel(core->bus->clock, &core->rx_timeout_alarm);
+  joybus_alarm_cancel(core->bus->clock, &core->transfer_start_alarm);
+}
+
+// Save the transfer context and schedule the command to start, on the dot if precise is set
+JOYBUS_RAM_FUNC
+static int schedule_transfer(struct joybus_core *core, uint64_t at_us, bool precise, const uint8_t *write_buf,
+                             uint8_t write_len, uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback,
+                             void *user_data)
+{
+  if (core->state == JOYBUS_CORE_DISABLED)
+    return -JOYBUS_ERR_DISABLED;
+
+  if (core->state != JOYBUS_CORE_HOST_IDLE)
+    return -JOYBUS_ERR_BUSY;
+
+  // Save the transfer context
+  core->write_buf      = write_buf;
+  core->write_len      = write_len;
+  core->read_buf       = read_buf;
+  core->read_len       = read_len;
+  core->read_count     = 0;
+  core->done_callback  = callback;
+  core->done_user_data = user_data;
+
+  // Take the timeouts from the transfer's timing profile, falling back to the peripheral's defaults
+  const struct joybus_timing *timing = joybus_transfer_timing(core->bus);
+  core->reply_timeout_us = timing->reply_timeout_us ? timing->reply_timeout_us : core->hal->reply_timeout_us;
+  core->byte_timeout_us  = timing->byte_timeout_us ? timing->byte_timeout_us : core->hal->byte_timeout_us;
+
+  // Never start before last completion + the minimum gap
+  uint64_t ready_us = core->last_transfer_us + timing->min_gap_us;
+  if (at_us < ready_us)
+    at_us = ready_us;
+
+  // A precise start wakes up early by the HAL's lead time, and spins the rest of the way
+  uint64_t wake_us = at_us;
+  if (precise)
+    wake_us = at_us > core->hal->start_lead_us ? at_us - core->hal->start_lead_us : 0;
+
+  // If the time has already passed, the transfer starts immediately
+  core->start_at_us = precise ? at_us : 0;
+  core->state       = JOYBUS_CORE_HOST_WAIT;
+  joybus_alarm_schedule(core->bus->clock, &core->transfer_start_alarm, wake_us);
+
+  return 0;
+}
+
+JOYBUS_RAM_FUNC
+int joybus_core_transfer(struct joybus_core *core, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
+                         uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  return schedule_transfer(core, 0, false, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+JOYBUS_RAM_FUNC
+int joybus_core_transfer_at(struct joybus_core *core, uint64_t at_us, const uint8_t *write_buf, uint8_t write_len,
+                            uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  return schedule_transfer(core, at_us, true, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_core_tx_done(struct joybus_core *core)
+{
+  struct joybus *bus = core->bus;
+
+  if (core->state == JOYBUS_CORE_HOST_TX) {
+    if (core->read_len == 0) {
+      // No reply expected
+      transfer_finish(core, 0);
+      return;
+    }
+
+    // Wait for the reply, the peripheral is already capturing
+    core->state = JOYBUS_CORE_HOST_RX;
+    if (core->reply_timeout_us)
+      joybus_alarm_schedule_in(bus->clock, &core->rx_timeout_alarm, core->reply_timeout_us);
+  } else if (core->state == JOYBUS_CORE_TARGET_TX) {
+    // Reply sent, listen for the next command
+    target_listen(core, false);
+  }
+}
+
+// Pass the command received so far to the target, and act on what it wants next
+JOYBUS_RAM_FUNC
+static void target_received(struct joybus_core *core)
+{
+  struct joybus *bus = core->bus;
+
+  // Call the target handler to prepare a reply if needed
+  int rc = joybus_target_byte_received(bus->target, core->read_buf, core->read_count, handle_command_response, core);
+  if (rc == 0) {
+    if (core->write_len > 0) {
+      // No more bytes expected, start sending the reply
+      core->state = JOYBUS_CORE_TARGET_TX;
+      core->hal->target_send_reply(bus);
+    } else {
+      // No reply yet, wait for a deferred one until the host gives up
+      uint16_t defer_us = bus->timing.reply_timeout_us ? bus->timing.reply_timeout_us : JOYBUS_REPLY_TIMEOUT_US;
+      joybus_alarm_schedule_in(bus->clock, &core->rx_timeout_alarm, defer_us);
+      core->state = JOYBUS_CORE_TARGET_DEFER;
+    }
+  } else if (rc > 0) {
+    uint8_t expected = joybus_target_bytes_expected(rc);
+    if (joybus_target_bulk(rc)) {
+      // Command too long for the buffer, ignore it
+      if (expected > core->read_len - core->read_count) {
+        target_ignore(core);
+        return;
+      }
+
+      // Only call the target again once the rest has arrived, if the peripheral can take it in one go. Otherwise the
+      // target is still called for each byte, so it can spread its work over the payload
+      if (core->hal->target_receive_bulk) {
+        core->bulk_end = core->read_count + expected;
+        core->hal->target_receive_bulk(bus, expected);
+        if (core->hal->byte_timeout_us)
+          joybus_alarm_schedule_in(bus->clock, &core->rx_timeout_alarm, core->hal->byte_timeout_us * expected);
+        return;
+      }
+    }
+
+    // More bytes expected, set a timeout for the next one
+    if (core->hal->byte_timeout_us)
+      joybus_alarm_schedule_in(bus->clock, &core->rx_timeout_alarm, core->hal->byte_timeout_us);
+  } else {
+    // Error handling command, or command not supported
+    target_ignore(core);
+  }
+}
+
+JOYBUS_RAM_FUNC
+void joybus_core_rx_byte(struct joybus_core *core, uint8_t byte)
+{
+  struct joybus *bus = core->bus;
+
+  if (core->state == JOYBUS_CORE_HOST_RX) {
+    joybus_alarm_cancel(bus->clock, &core->rx_timeout_alarm);
+
+    // The first byte is the closest the host gets to when the target sampled its state
+    if (core->read_count == 0)
+      core->first_byte_us = joybus_clock_now_us(bus->clock);
+
+    // Store the byte and notify per-byte listeners, eg. a relay forwarding the reply as it arrives
+    uint8_t idx         = core->read_count++;
+    core->read_buf[idx] = byte;
+    if (bus->rx_byte_callback)
+      bus->rx_byte_callback(bus, idx, bus->rx_byte_user_data);
+
+    if (core->read_count == core->read_len) {
+      // Whole reply received
+      transfer_finish(core, 0);
+    } else if (core->byte_timeout_us) {
+      // Set a new timeout for the next byte
+      joybus_alarm_schedule_in(bus->clock, &core->rx_timeout_alarm, core->byte_timeout_us);
+    }
+  } else if (core->state == JOYBUS_CORE_TARGET_RX) {
+    // Cancel the byte timeout, only armed after the first byte
+    if (core->read_count > 0)
+      joybus_alarm_cancel(bus->clock, &core->rx_timeout_alarm);
+
+    // Command too long for the buffer, ignore it
+    if (core->read_count == core->read_len) {
+      target_ignore(core);
+      return;
+    }
+
+    core->read_buf[core->read_count++] = byte;
+    target_received(core);
+  } else if (core->state == JOYBUS_CORE_TARGET_DEFER) {
+    // The line should be quiet until the deferred reply, give up on it and drop whatever this is
+    target_ignore(core);
+  }
+}
+
+JOYBUS_RAM_FUNC
+void joybus_core_rx_bulk(struct joybus_core *core)
+{
+  if (core->state != JOYBUS_CORE_TARGET_RX || core->read_count >= core->bulk_end)
+    return;
+
+  joybus_alarm_cancel(core->bus->clock, &core->rx_timeout_alarm);
+
+  core->read_count = core->bulk_end;
+  target_received(core);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_core_rx_idle(struct joybus_core *core)
+{
+  if (core->state == JOYBUS_CORE_HOST_RX) {
+    // The reply ended before all bytes arrived
+    transfer_finish(core, -JOYBUS_ERR_TIMEOUT);
+  } else if (core->state == JOYBUS_CORE_TARGET_RX || core->state == JOYBUS_CORE_TARGET_IGNORE) {
+    // The line went idle without a complete command, listen for the next one
+    target_listen(core, false);
+  }
+}
@@ -0,0 +1,81 @@
+#include <joybus/attributes.h>
+#include <joybus/bitslice.h>
+
+// Read sample k of a packed sample stream
+#define SAMPLE(samples, k) (((samples)[(k) >> 3] >> (7 - ((k) & 7))) & 1)
+
+// Transpose an 8x8 bit matrix held one row per byte, row 0 in the low byte, so bit c of row r becomes bit r of row c
+static inline uint64_t transpose_8x8(uint64_t x)
+{
+  uint64_t t;
+
+  // Swap 1x1 blocks within 2x2 blocks, then 2x2 blocks within 4x4 blocks, then 4x4 blocks
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+
+  return x;
+}
+
+JOYBUS_RAM_FUNC
+void joybus_bitslice_transpose(const uint8_t *const bytes[], uint8_t ports, uint8_t len, uint8_t *words)
+{
+  for (uint8_t i = 0; i < len; i++) {
+    // One row per port
+    uint64_t x = 0;
+    for (uint8_t p = 0; p < ports; p++)
+      x |= (uint64_t)bytes[p][i] << (p * 8);
+
+    // Row c now holds bit c of every port, the MSB goes out first
+    x = transpose_8x8(x);
+    for (uint8_t bit = 0; bit < 8; bit++)
+      words[i * 8 + bit] = x >> ((7 - bit) * 8);
+  }
+}
+
+JOYBUS_RAM_FUNC
+void joybus_bitslice_untranspose(const uint8_t *words, uint8_t ports, uint8_t len, uint8_t *const bytes[])
+{
+  for (uint8_t i = 0; i < len; i++) {
+    // One row per bit position, the first word is the MSB
+    uint64_t x = 0;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      x |= (uint64_t)words[i * 8 + bit] << ((7 - bit) * 8);
+
+    // Row p now holds port p's bits
+    x = transpose_8x8(x);
+    for (uint8_t p = 0; p < ports; p++)
+      bytes[p][i] = x >> (p * 8);
+  }
+}
+
+JOYBUS_RAM_FUNC
+uint8_t joybus_bitslice_decode(const uint8_t *samples, uint16_t num_samples, uint8_t *reply, uint8_t len)
+{
+  uint16_t k = 0;
+  for (uint8_t i = 0; i < len; i++) {
+    uint8_t value = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      // Wait for the line to be released, then for the falling edge that starts the bit
+      while (k < num_samples && !SAMPLE(samples, k))
+        k++;
+      while (k < num_samples && SAMPLE(samples, k))
+        k++;
+
+      // Read the line near the middle of the bit, low for a zero and high for a one. The edge was up to a sample
+      // before k, so stop a sample short of the middle
+      k += JOYBUS_BITSLICE_OVERSAMPLE / 2 - 1;
+      if (k >= num_samples)
+        return i;
+
+      value = value << 1 | SAMPLE(samples, k);
+    }
+
+    reply[i] = value;
+  }
+
+  return len;
+}
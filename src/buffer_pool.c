@@ -0,0 +1,90 @@
+#include <joybus/attributes.h>
+#include <joybus/buffer_pool.h>
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/errors.h>
+
+#if JOYBUS_USE_BUFFER_POOL
+
+int joybus_buffer_pool_init(struct joybus_buffer_pool *pool, struct joybus_buffers *buffers, uint8_t count)
+{
+  if (count == 0 || count > JOYBUS_BUFFER_POOL_MAX)
+    return -JOYBUS_ERR_INVALID;
+
+  pool->buffers   = buffers;
+  pool->count     = count;
+  pool->free_mask = count == 32 ? UINT32_MAX : (1u << count) - 1;
+
+  return 0;
+}
+
+uint8_t joybus_buffer_pool_available(const struct joybus_buffer_pool *pool)
+{
+  return __builtin_popcount(pool->free_mask);
+}
+
+int joybus_attach_buffer_pool(struct joybus *bus, struct joybus_buffer_pool *pool)
+{
+  bus->pool           = pool;
+  bus->target_buffers = NULL;
+  bus->command_buffer = NULL;
+
+  for (int i = 0; i < JOYBUS_COMMAND_SLOTS; i++) {
+    bus->slots[i].buffers = NULL;
+    bus->slots[i].state   = JOYBUS_COMMAND_SLOT_FREE;
+  }
+
+  return 0;
+}
+
+JOYBUS_RAM_FUNC
+struct joybus_buffers *joybus_buffer_pool_take(struct joybus_buffer_pool *pool)
+{
+  if (!pool || !pool->free_mask)
+    return NULL;
+
+  // Take the lowest free buffer
+  uint32_t index = __builtin_ctz(pool->free_mask);
+  pool->free_mask &= pool->free_mask - 1;
+
+  return &pool->buffers[index];
+}
+
+JOYBUS_RAM_FUNC
+void joybus_buffer_pool_give(struct joybus_buffer_pool *pool, struct joybus_buffers *buffers)
+{
+  pool->free_mask |= 1u << (buffers - pool->buffers);
+}
+
+int joybus_buffers_acquire(struct joybus *bus)
+{
+  if (bus->target_buffers)
+    return 0;
+
+  // Completions may return buffers from interrupt context
+  uint32_t state      = joybus_clock_lock(bus->clock);
+  bus->target_buffers = joybus_buffer_pool_take(bus->pool);
+  joybus_clock_unlock(bus->clock, state);
+
+  if (!bus->target_buffers)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  bus->command_buffer = bus->target_buffers->command;
+
+  return 0;
+}
+
+void joybus_buffers_release(struct joybus *bus)
+{
+  if (!bus->target_buffers)
+    return;
+
+  uint32_t state = joybus_clock_lock(bus->clock);
+  joybus_buffer_pool_give(bus->pool, bus->target_buffers);
+  joybus_clock_unlock(bus->clock, state);
+
+  bus->target_buffers = NULL;
+  bus->command_buffer = NULL;
+}
+
+#endif
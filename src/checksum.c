@@ -1,9 +1,9 @@
 #include <joybus/checksum.h>
 
-uint8_t joybus_data_checksum_update(uint8_t crc, uint8_t byte)
-{
-  // Full lookup table for CRC-8, polynomial 0x85
-  static const uint8_t DATA_CS_LUT[] = {
+// Lookup tables for CRC-8, polynomial 0x85. Table k folds in a byte followed by k more, the first is the usual
+// byte-at-a-time table.
+static const uint8_t DATA_CS_LUT[4][256] = {
+  {
     0x00, 0x85, 0x8F, 0x0A, 0x9B, 0x1E, 0x14, 0x91, 0xB3, 0x36, 0x3C, 0xB9, 0x28, 0xAD, 0xA7, 0x22, 0xE3, 0x66, 0x6C,
     0xE9, 0x78, 0xFD, 0xF7, 0x72, 0x50, 0xD5, 0xDF, 0x5A, 0xCB, 0x4E, 0x44, 0xC1, 0x43, 0xC6, 0xCC, 0x49, 0xD8, 0x5D,
     0x57, 0xD2, 0xF0, 0x75, 0x7F, 0xFA, 0x6B, 0xEE, 0xE4, 0x61, 0xA0, 0x25, 0x2F, 0xAA, 0x3B, 0xBE, 0xB4, 0x31, 0x13,
@@ -18,9 +18,60 @@ uint8_t joybus_data_checksum_update(uint8_t crc, uint8_t byte)
     0x69, 0x63, 0xE6, 0x77, 0xF2, 0xF8, 0x7D, 0x5F, 0xDA, 0xD0, 0x55, 0xC4, 0x41, 0x4B, 0xCE, 0x4C, 0xC9, 0xC3, 0x46,
     0xD7, 0x52, 0x58, 0xDD, 0xFF, 0x7A, 0x70, 0xF5, 0x64, 0xE1, 0xEB, 0x6E, 0xAF, 0x2A, 0x20, 0xA5, 0x34, 0xB1, 0xBB,
     0x3E, 0x1C, 0x99, 0x93, 0x16, 0x87, 0x02, 0x08, 0x8D,
-  };
+  },
+  {
+    0x00, 0x97, 0xAB, 0x3C, 0xD3, 0x44, 0x78, 0xEF, 0x23, 0xB4, 0x88, 0x1F, 0xF0, 0x67, 0x5B, 0xCC, 0x46, 0xD1, 0xED,
+    0x7A, 0x95, 0x02, 0x3E, 0xA9, 0x65, 0xF2, 0xCE, 0x59, 0xB6, 0x21, 0x1D, 0x8A, 0x8C, 0x1B, 0x27, 0xB0, 0x5F, 0xC8,
+    0xF4, 0x63, 0xAF, 0x38, 0x04, 0x93, 0x7C, 0xEB, 0xD7, 0x40, 0xCA, 0x5D, 0x61, 0xF6, 0x19, 0x8E, 0xB2, 0x25, 0xE9,
+    0x7E, 0x42, 0xD5, 0x3A, 0xAD, 0x91, 0x06, 0x9D, 0x0A, 0x36, 0xA1, 0x4E, 0xD9, 0xE5, 0x72, 0xBE, 0x29, 0x15, 0x82,
+    0x6D, 0xFA, 0xC6, 0x51, 0xDB, 0x4C, 0x70, 0xE7, 0x08, 0x9F, 0xA3, 0x34, 0xF8, 0x6F, 0x53, 0xC4, 0x2B, 0xBC, 0x80,
+    0x17, 0x11, 0x86, 0xBA, 0x2D, 0xC2, 0x55, 0x69, 0xFE, 0x32, 0xA5, 0x99, 0x0E, 0xE1, 0x76, 0x4A, 0xDD, 0x57, 0xC0,
+    0xFC, 0x6B, 0x84, 0x13, 0x2F, 0xB8, 0x74, 0xE3, 0xDF, 0x48, 0xA7, 0x30, 0x0C, 0x9B, 0xBF, 0x28, 0x14, 0x83, 0x6C,
+    0xFB, 0xC7, 0x50, 0x9C, 0x0B, 0x37, 0xA0, 0x4F, 0xD8, 0xE4, 0x73, 0xF9, 0x6E, 0x52, 0xC5, 0x2A, 0xBD, 0x81, 0x16,
+    0xDA, 0x4D, 0x71, 0xE6, 0x09, 0x9E, 0xA2, 0x35, 0x33, 0xA4, 0x98, 0x0F, 0xE0, 0x77, 0x4B, 0xDC, 0x10, 0x87, 0xBB,
+    0x2C, 0xC3, 0x54, 0x68, 0xFF, 0x75, 0xE2, 0xDE, 0x49, 0xA6, 0x31, 0x0D, 0x9A, 0x56, 0xC1, 0xFD, 0x6A, 0x85, 0x12,
+    0x2E, 0xB9, 0x22, 0xB5, 0x89, 0x1E, 0xF1, 0x66, 0x5A, 0xCD, 0x01, 0x96, 0xAA, 0x3D, 0xD2, 0x45, 0x79, 0xEE, 0x64,
+    0xF3, 0xCF, 0x58, 0xB7, 0x20, 0x1C, 0x8B, 0x47, 0xD0, 0xEC, 0x7B, 0x94, 0x03, 0x3F, 0xA8, 0xAE, 0x39, 0x05, 0x92,
+    0x7D, 0xEA, 0xD6, 0x41, 0x8D, 0x1A, 0x26, 0xB1, 0x5E, 0xC9, 0xF5, 0x62, 0xE8, 0x7F, 0x43, 0xD4, 0x3B, 0xAC, 0x90,
+    0x07, 0xCB, 0x5C, 0x60, 0xF7, 0x18, 0x8F, 0xB3, 0x24,
+  },
+  {
+    0x00, 0xFB, 0x73, 0x88, 0xE6, 0x1D, 0x95, 0x6E, 0x49, 0xB2, 0x3A, 0xC1, 0xAF, 0x54, 0xDC, 0x27, 0x92, 0x69, 0xE1,
+    0x1A, 0x74, 0x8F, 0x07, 0xFC, 0xDB, 0x20, 0xA8, 0x53, 0x3D, 0xC6, 0x4E, 0xB5, 0xA1, 0x5A, 0xD2, 0x29, 0x47, 0xBC,
+    0x34, 0xCF, 0xE8, 0x13, 0x9B, 0x60, 0x0E, 0xF5, 0x7D, 0x86, 0x33, 0xC8, 0x40, 0xBB, 0xD5, 0x2E, 0xA6, 0x5D, 0x7A,
+    0x81, 0x09, 0xF2, 0x9C, 0x67, 0xEF, 0x14, 0xC7, 0x3C, 0xB4, 0x4F, 0x21, 0xDA, 0x52, 0xA9, 0x8E, 0x75, 0xFD, 0x06,
+    0x68, 0x93, 0x1B, 0xE0, 0x55, 0xAE, 0x26, 0xDD, 0xB3, 0x48, 0xC0, 0x3B, 0x1C, 0xE7, 0x6F, 0x94, 0xFA, 0x01, 0x89,
+    0x72, 0x66, 0x9D, 0x15, 0xEE, 0x80, 0x7B, 0xF3, 0x08, 0x2F, 0xD4, 0x5C, 0xA7, 0xC9, 0x32, 0xBA, 0x41, 0xF4, 0x0F,
+    0x87, 0x7C, 0x12, 0xE9, 0x61, 0x9A, 0xBD, 0x46, 0xCE, 0x35, 0x5B, 0xA0, 0x28, 0xD3, 0x0B, 0xF0, 0x78, 0x83, 0xED,
+    0x16, 0x9E, 0x65, 0x42, 0xB9, 0x31, 0xCA, 0xA4, 0x5F, 0xD7, 0x2C, 0x99, 0x62, 0xEA, 0x11, 0x7F, 0x84, 0x0C, 0xF7,
+    0xD0, 0x2B, 0xA3, 0x58, 0x36, 0xCD, 0x45, 0xBE, 0xAA, 0x51, 0xD9, 0x22, 0x4C, 0xB7, 0x3F, 0xC4, 0xE3, 0x18, 0x90,
+    0x6B, 0x05, 0xFE, 0x76, 0x8D, 0x38, 0xC3, 0x4B, 0xB0, 0xDE, 0x25, 0xAD, 0x56, 0x71, 0x8A, 0x02, 0xF9, 0x97, 0x6C,
+    0xE4, 0x1F, 0xCC, 0x37, 0xBF, 0x44, 0x2A, 0xD1, 0x59, 0xA2, 0x85, 0x7E, 0xF6, 0x0D, 0x63, 0x98, 0x10, 0xEB, 0x5E,
+    0xA5, 0x2D, 0xD6, 0xB8, 0x43, 0xCB, 0x30, 0x17, 0xEC, 0x64, 0x9F, 0xF1, 0x0A, 0x82, 0x79, 0x6D, 0x96, 0x1E, 0xE5,
+    0x8B, 0x70, 0xF8, 0x03, 0x24, 0xDF, 0x57, 0xAC, 0xC2, 0x39, 0xB1, 0x4A, 0xFF, 0x04, 0x8C, 0x77, 0x19, 0xE2, 0x6A,
+    0x91, 0xB6, 0x4D, 0xC5, 0x3E, 0x50, 0xAB, 0x23, 0xD8,
+  },
+  {
+    0x00, 0x16, 0x2C, 0x3A, 0x58, 0x4E, 0x74, 0x62, 0xB0, 0xA6, 0x9C, 0x8A, 0xE8, 0xFE, 0xC4, 0xD2, 0xE5, 0xF3, 0xC9,
+    0xDF, 0xBD, 0xAB, 0x91, 0x87, 0x55, 0x43, 0x79, 0x6F, 0x0D, 0x1B, 0x21, 0x37, 0x4F, 0x59, 0x63, 0x75, 0x17, 0x01,
+    0x3B, 0x2D, 0xFF, 0xE9, 0xD3, 0xC5, 0xA7, 0xB1, 0x8B, 0x9D, 0xAA, 0xBC, 0x86, 0x90, 0xF2, 0xE4, 0xDE, 0xC8, 0x1A,
+    0x0C, 0x36, 0x20, 0x42, 0x54, 0x6E, 0x78, 0x9E, 0x88, 0xB2, 0xA4, 0xC6, 0xD0, 0xEA, 0xFC, 0x2E, 0x38, 0x02, 0x14,
+    0x76, 0x60, 0x5A, 0x4C, 0x7B, 0x6D, 0x57, 0x41, 0x23, 0x35, 0x0F, 0x19, 0xCB, 0xDD, 0xE7, 0xF1, 0x93, 0x85, 0xBF,
+    0xA9, 0xD1, 0xC7, 0xFD, 0xEB, 0x89, 0x9F, 0xA5, 0xB3, 0x61, 0x77, 0x4D, 0x5B, 0x39, 0x2F, 0x15, 0x03, 0x34, 0x22,
+    0x18, 0x0E, 0x6C, 0x7A, 0x40, 0x56, 0x84, 0x92, 0xA8, 0xBE, 0xDC, 0xCA, 0xF0, 0xE6, 0xB9, 0xAF, 0x95, 0x83, 0xE1,
+    0xF7, 0xCD, 0xDB, 0x09, 0x1F, 0x25, 0x33, 0x51, 0x47, 0x7D, 0x6B, 0x5C, 0x4A, 0x70, 0x66, 0x04, 0x12, 0x28, 0x3E,
+    0xEC, 0xFA, 0xC0, 0xD6, 0xB4, 0xA2, 0x98, 0x8E, 0xF6, 0xE0, 0xDA, 0xCC, 0xAE, 0xB8, 0x82, 0x94, 0x46, 0x50, 0x6A,
+    0x7C, 0x1E, 0x08, 0x32, 0x24, 0x13, 0x05, 0x3F, 0x29, 0x4B, 0x5D, 0x67, 0x71, 0xA3, 0xB5, 0x8F, 0x99, 0xFB, 0xED,
+    0xD7, 0xC1, 0x27, 0x31, 0x0B, 0x1D, 0x7F, 0x69, 0x53, 0x45, 0x97, 0x81, 0xBB, 0xAD, 0xCF, 0xD9, 0xE3, 0xF5, 0xC2,
+    0xD4, 0xEE, 0xF8, 0x9A, 0x8C, 0xB6, 0xA0, 0x72, 0x64, 0x5E, 0x48, 0x2A, 0x3C, 0x06, 0x10, 0x68, 0x7E, 0x44, 0x52,
+    0x30, 0x26, 0x1C, 0x0A, 0xD8, 0xCE, 0xF4, 0xE2, 0x80, 0x96, 0xAC, 0xBA, 0x8D, 0x9B, 0xA1, 0xB7, 0xD5, 0xC3, 0xF9,
+    0xEF, 0x3D, 0x2B, 0x11, 0x07, 0x65, 0x73, 0x49, 0x5F,
+  },
+};
 
-  return DATA_CS_LUT[crc ^ byte];
+uint8_t joybus_data_checksum_update(uint8_t crc, uint8_t byte)
+{
+  return DATA_CS_LUT[0][crc ^ byte];
 }
 
 uint8_t joybus_data_checksum(const uint8_t *data, size_t size)
@@ -28,6 +79,12 @@ uint8_t joybus_data_checksum(const uint8_t *data, size_t size)
   uint8_t val        = 0;
   const uint8_t *end = data + size;
 
+  // Four bytes at a time, the CRC is linear so the lookups for each byte don't depend on each other
+  while (end - data >= 4) {
+    val = DATA_CS_LUT[3][val ^ data[0]] ^ DATA_CS_LUT[2][data[1]] ^ DATA_CS_LUT[1][data[2]] ^ DATA_CS_LUT[0][data[3]];
+    data += 4;
+  }
+
   while (data < end) {
     val = joybus_data_checksum_update(val, *data);
     data++;
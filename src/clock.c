@@ -0,0 +1,97 @@
+#include <joybus/attributes.h>
+#include <joybus/clock.h>
+
+// Remove an alarm from the queue, the caller holds the lock
+static void unlink_alarm(struct joybus_clock *clock, struct joybus_alarm *alarm)
+{
+  for (struct joybus_alarm **link = &clock->alarms; *link; link = &(*link)->next) {
+    if (*link == alarm) {
+      *link = alarm->next;
+      break;
+    }
+  }
+
+  alarm->next    = NULL;
+  alarm->pending = false;
+}
+
+void joybus_alarm_init(struct joybus_alarm *alarm, joybus_alarm_cb callback, void *user_data)
+{
+  alarm->callback  = callback;
+  alarm->user_data = user_data;
+  alarm->at_us     = 0;
+  alarm->pending   = false;
+  alarm->next      = NULL;
+}
+
+JOYBUS_RAM_FUNC
+void joybus_alarm_schedule(struct joybus_clock *clock, struct joybus_alarm *alarm, uint64_t at_us)
+{
+  uint32_t state = joybus_clock_lock(clock);
+
+  if (alarm->pending)
+    unlink_alarm(clock, alarm);
+
+  // Insert in time order, after any alarms due at the same time
+  struct joybus_alarm **link = &clock->alarms;
+  while (*link && (*link)->at_us <= at_us)
+    link = &(*link)->next;
+
+  alarm->at_us   = at_us;
+  alarm->pending = true;
+  alarm->next    = *link;
+  *link          = alarm;
+
+  // A new earliest alarm needs the hardware alarm moving forward
+  bool due = clock->alarms == alarm && clock->api->set_alarm(clock, at_us) != 0;
+
+  joybus_clock_unlock(clock, state);
+
+  // Already due, fire it now
+  if (due)
+    joybus_clock_run_alarms(clock);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_alarm_cancel(struct joybus_clock *clock, struct joybus_alarm *alarm)
+{
+  uint32_t state = joybus_clock_lock(clock);
+
+  // The hardware alarm is left alone, firing with nothing due is harmless
+  if (alarm->pending)
+    unlink_alarm(clock, alarm);
+
+  joybus_clock_unlock(clock, state);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_clock_run_alarms(struct joybus_clock *clock)
+{
+  for (;;) {
+    uint32_t state             = joybus_clock_lock(clock);
+    struct joybus_alarm *alarm = clock->alarms;
+
+    if (!alarm) {
+      joybus_clock_unlock(clock, state);
+      return;
+    }
+
+    // Not due yet, wait for the hardware alarm unless the time passed while arming it
+    if (alarm->at_us > joybus_clock_now_us(clock)) {
+      bool due = clock->api->set_alarm(clock, alarm->at_us) != 0;
+      joybus_clock_unlock(clock, state);
+      if (!due)
+        return;
+
+      continue;
+    }
+
+    // Dequeue before calling back, so the callback can reschedule the alarm
+    clock->alarms  = alarm->next;
+    alarm->next    = NULL;
+    alarm->pending = false;
+    joybus_clock_unlock(clock, state);
+
+    alarm->callback(alarm, alarm->user_data);
+  }
+}
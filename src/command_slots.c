@@ -0,0 +1,274 @@
+#include <joybus/attributes.h>
+#include <joybus/buffer_pool.h>
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/errors.h>
+
+// Find a slot in the given state, the caller holds the lock
+static struct joybus_command_slot *find_slot(struct joybus *bus, uint8_t state)
+{
+  for (int i = 0; i < JOYBUS_COMMAND_SLOTS; i++) {
+    if (bus->slots[i].state == state)
+      return &bus->slots[i];
+  }
+
+  return NULL;
+}
+
+// Find the slot that was queued first, the caller holds the lock
+static struct joybus_command_slot *oldest_queued(struct joybus *bus)
+{
+  struct joybus_command_slot *oldest = NULL;
+  for (int i = 0; i < JOYBUS_COMMAND_SLOTS; i++) {
+    struct joybus_command_slot *slot = &bus->slots[i];
+    if (slot->state == JOYBUS_COMMAND_SLOT_QUEUED && (!oldest || (int8_t)(slot->seq - oldest->seq) < 0))
+      oldest = slot;
+  }
+
+  return oldest;
+}
+
+// Whether a transfer is on the wire or finishing, the caller holds the lock
+static bool transfer_in_progress(struct joybus *bus)
+{
+  return find_slot(bus, JOYBUS_COMMAND_SLOT_ACTIVE) || find_slot(bus, JOYBUS_COMMAND_SLOT_COMPLETING);
+}
+
+#if JOYBUS_USE_BUFFER_POOL
+// Lease a slot's buffers from the pool, the caller holds the lock
+static bool slot_lease(struct joybus *bus, struct joybus_command_slot *slot)
+{
+  slot->buffers = joybus_buffer_pool_take(bus->pool);
+  return slot->buffers != NULL;
+}
+
+// Return a slot's buffers to the pool, the caller holds the lock
+static void slot_free(struct joybus *bus, struct joybus_command_slot *slot)
+{
+  if (slot->buffers)
+    joybus_buffer_pool_give(bus->pool, slot->buffers);
+
+  slot->buffers = NULL;
+  slot->state   = JOYBUS_COMMAND_SLOT_FREE;
+}
+#else
+static bool slot_lease(struct joybus *bus, struct joybus_command_slot *slot)
+{
+  slot->buffers = &bus->buffers[slot - bus->slots];
+  return true;
+}
+
+static void slot_free(struct joybus *bus, struct joybus_command_slot *slot)
+{
+  slot->state = JOYBUS_COMMAND_SLOT_FREE;
+}
+#endif
+
+int joybus_command_slot_acquire(struct joybus *bus, struct joybus_command_slot **slot)
+{
+  uint32_t state = joybus_clock_lock(bus->clock);
+
+  // A host function called from a completion callback reuses the completed slot, keeping its state and buffers
+  struct joybus_command_slot *found = find_slot(bus, JOYBUS_COMMAND_SLOT_COMPLETING);
+
+  // A host function built on top of another one shares its slot
+  if (!found)
+    found = find_slot(bus, JOYBUS_COMMAND_SLOT_PREPARING);
+
+  if (!found) {
+    found = find_slot(bus, JOYBUS_COMMAND_SLOT_FREE);
+    if (!found) {
+      joybus_clock_unlock(bus->clock, state);
+      return -JOYBUS_ERR_BUSY;
+    }
+
+    if (!slot_lease(bus, found)) {
+      joybus_clock_unlock(bus->clock, state);
+      return -JOYBUS_ERR_NO_SPACE;
+    }
+  }
+
+  found->state = JOYBUS_COMMAND_SLOT_PREPARING;
+  joybus_clock_unlock(bus->clock, state);
+
+  *slot = found;
+  return 0;
+}
+
+// Run a slot's callback, then free it unless the callback queued another command in it
+JOYBUS_RAM_FUNC
+static void complete_slot(struct joybus *bus, struct joybus_command_slot *slot, int status)
+{
+  slot->state = JOYBUS_COMMAND_SLOT_COMPLETING;
+
+  if (slot->callback)
+    slot->callback(bus, status, slot->user_data);
+
+  uint32_t state = joybus_clock_lock(bus->clock);
+  if (slot->state == JOYBUS_COMMAND_SLOT_COMPLETING)
+    slot_free(bus, slot);
+  joybus_clock_unlock(bus->clock, state);
+}
+
+static void slot_transfer_done(struct joybus *bus, int status, void *user_data);
+
+// Extra gap before the given resend after a timeout, doubling with each one
+static uint16_t backoff_us(const struct joybus_retry_policy *policy, uint8_t retries)
+{
+  uint32_t max_us     = policy->max_backoff_us ? policy->max_backoff_us : UINT16_MAX;
+  uint32_t backoff_us = policy->backoff_us;
+  for (uint8_t i = 1; i < retries && backoff_us < max_us; i++)
+    backoff_us *= 2;
+
+  return backoff_us < max_us ? backoff_us : max_us;
+}
+
+// Send a slot's command again, with an extra gap on top of the bus profile's
+JOYBUS_RAM_FUNC
+static int resend(struct joybus *bus, struct joybus_command_slot *slot, uint16_t extra_gap_us)
+{
+  struct joybus_timing timing = bus->timing;
+  timing.min_gap_us = extra_gap_us > UINT16_MAX - timing.min_gap_us ? UINT16_MAX : timing.min_gap_us + extra_gap_us;
+
+  return joybus_transfer_timed(bus, &timing, slot->buffers->command, slot->write_len, slot->read_buf, slot->read_len,
+                               slot_transfer_done, slot);
+}
+
+// Count host functions that timed out in a row, opening the circuit breaker at the threshold
+JOYBUS_RAM_FUNC
+static void breaker_update(struct joybus *bus, int status)
+{
+  if (status >= 0) {
+    bus->breaker_failures = 0;
+  } else if (status == -JOYBUS_ERR_TIMEOUT && bus->breaker_failures < UINT8_MAX) {
+    if (++bus->breaker_failures == bus->retry.breaker_threshold)
+      bus->breaker_retry_us = joybus_clock_now_us(bus->clock) + bus->retry.breaker_cooldown_us;
+  }
+}
+
+// Whether the open circuit breaker turns a command away, the caller holds the lock
+static bool breaker_rejects(struct joybus *bus, struct joybus_command_slot *slot)
+{
+  if (!joybus_breaker_open(bus))
+    return false;
+
+  uint64_t now_us = joybus_clock_now_us(bus->clock);
+  if (now_us < bus->breaker_retry_us)
+    return true;
+
+  // Let this one through to look for a device, without retries, and turn others away until the next look
+  bus->breaker_retry_us  = now_us + bus->retry.breaker_cooldown_us;
+  slot->timeout_retries  = UINT8_MAX;
+  slot->checksum_retries = UINT8_MAX;
+
+  return false;
+}
+
+// Start queued commands in order, until one starts or none are left
+JOYBUS_RAM_FUNC
+static void start_queued(struct joybus *bus)
+{
+  for (;;) {
+    uint32_t state                   = joybus_clock_lock(bus->clock);
+    struct joybus_command_slot *slot = transfer_in_progress(bus) ? NULL : oldest_queued(bus);
+    if (slot)
+      slot->state = JOYBUS_COMMAND_SLOT_ACTIVE;
+    joybus_clock_unlock(bus->clock, state);
+
+    if (!slot)
+      return;
+
+    // The backend holds the transfer until the inter-transfer delay has passed
+    int rc = joybus_transfer(bus, slot->buffers->command, slot->write_len, slot->read_buf, slot->read_len,
+                             slot_transfer_done, slot);
+    if (rc >= 0)
+      return;
+
+    // The host function already returned, so report the failure through its callback
+    complete_slot(bus, slot, rc);
+  }
+}
+
+JOYBUS_RAM_FUNC
+static void slot_transfer_done(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_command_slot *slot = user_data;
+
+  // Resend a command that timed out, backing off a little more each time
+  if (status == -JOYBUS_ERR_TIMEOUT && slot->timeout_retries < bus->retry.timeout_retries) {
+    slot->timeout_retries++;
+    status = resend(bus, slot, backoff_us(&bus->retry, slot->timeout_retries));
+    if (status >= 0)
+      return;
+  }
+
+  breaker_update(bus, status);
+
+  complete_slot(bus, slot, status);
+  start_queued(bus);
+}
+
+JOYBUS_RAM_FUNC
+bool joybus_command_slot_retry(struct joybus *bus, struct joybus_command_slot *slot, int status)
+{
+  if (status != -JOYBUS_ERR_CHECKSUM || slot->checksum_retries >= bus->retry.checksum_retries)
+    return false;
+
+  // Put the slot back on the wire, so complete_slot() keeps it
+  slot->checksum_retries++;
+  slot->state = JOYBUS_COMMAND_SLOT_ACTIVE;
+  if (resend(bus, slot, 0) >= 0)
+    return true;
+
+  slot->state = JOYBUS_COMMAND_SLOT_COMPLETING;
+  return false;
+}
+
+int joybus_command_slot_submit(struct joybus *bus, struct joybus_command_slot *slot, uint8_t write_len,
+                               uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  slot->write_len        = write_len;
+  slot->read_buf         = read_buf;
+  slot->read_len         = read_len;
+  slot->callback         = callback;
+  slot->user_data        = user_data;
+  slot->timeout_retries  = 0;
+  slot->checksum_retries = 0;
+
+  // Fail straight away on a port the circuit breaker treats as empty
+  uint32_t state = joybus_clock_lock(bus->clock);
+  if (breaker_rejects(bus, slot)) {
+    slot_free(bus, slot);
+    joybus_clock_unlock(bus->clock, state);
+    return -JOYBUS_ERR_NO_DEVICE;
+  }
+
+  // Queue behind the transfer in flight, it starts the next one when it completes
+  bool queue  = transfer_in_progress(bus) || oldest_queued(bus);
+  slot->seq   = bus->slot_seq++;
+  slot->state = queue ? JOYBUS_COMMAND_SLOT_QUEUED : JOYBUS_COMMAND_SLOT_ACTIVE;
+  joybus_clock_unlock(bus->clock, state);
+
+  if (queue)
+    return 0;
+
+  int rc = joybus_transfer(bus, slot->buffers->command, write_len, read_buf, read_len, slot_transfer_done, slot);
+  if (rc < 0) {
+    state = joybus_clock_lock(bus->clock);
+    slot_free(bus, slot);
+    joybus_clock_unlock(bus->clock, state);
+  }
+
+  return rc;
+}
+
+void joybus_command_slots_reset(struct joybus *bus)
+{
+  uint32_t state = joybus_clock_lock(bus->clock);
+  for (int i = 0; i < JOYBUS_COMMAND_SLOTS; i++) {
+    if (bus->slots[i].state != JOYBUS_COMMAND_SLOT_FREE)
+      slot_free(bus, &bus->slots[i]);
+  }
+  bus->breaker_failures = 0;
+  joybus_clock_unlock(bus->clock, state);
+}
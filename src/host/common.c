@@ -10,10 +10,16 @@ int joybus_identify(struct joybus *bus, struct joybus_id *response)
 int joybus_identify_async(struct joybus *bus, struct joybus_id *response, joybus_transfer_cb callback,
                           void *user_data)
 {
-  bus->command_buffer[0] = JOYBUS_CMD_IDENTIFY;
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
 
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_IDENTIFY_TX, (uint8_t *)response, JOYBUS_CMD_IDENTIFY_RX,
-                         callback, user_data);
+  slot->buffers->command[0] = JOYBUS_CMD_IDENTIFY;
+
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_IDENTIFY_TX, (uint8_t *)response, JOYBUS_CMD_IDENTIFY_RX,
+                                    callback, user_data);
 }
 
 int joybus_reset(struct joybus *bus, struct joybus_id *response)
@@ -24,8 +30,30 @@ int joybus_reset(struct joybus *bus, struct joybus_id *response)
 
 int joybus_reset_async(struct joybus *bus, struct joybus_id *response, joybus_transfer_cb callback, void *user_data)
 {
-  bus->command_buffer[0] = JOYBUS_CMD_RESET;
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
+  slot->buffers->command[0] = JOYBUS_CMD_RESET;
+
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_RESET_TX, (uint8_t *)response, JOYBUS_CMD_RESET_RX, callback,
+                                    user_data);
+}
+
+void joybus_build_button_lut(uint16_t lut[2][256], const uint16_t button_map[16])
+{
+  // Each output is the union of the masks of the set input bits
+  for (int value = 0; value < 256; value++) {
+    uint16_t low = 0, high = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      uint16_t set = -((value >> bit) & 1);
+      low  |= set & button_map[bit];
+      high |= set & button_map[bit + 8];
+    }
 
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_RESET_TX, (uint8_t *)response, JOYBUS_CMD_RESET_RX,
-                         callback, user_data);
+    lut[0][value] = low;
+    lut[1][value] = high;
+  }
 }
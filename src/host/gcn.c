@@ -60,14 +60,16 @@ static int unpack_input_state(struct joybus_gcn_controller_state *dest, const ui
 
 static void gcn_read_cb(struct joybus *bus, int status, void *user_data)
 {
+  struct joybus_command_slot *slot = user_data;
+
   // Unpack the response
   if (status >= 0)
-    unpack_input_state((struct joybus_gcn_controller_state *)bus->host_op.response, bus->response_buffer,
-                       bus->host_op.arg);
+    unpack_input_state((struct joybus_gcn_controller_state *)slot->op.response, slot->buffers->response,
+                       slot->op.arg);
 
   // Fire the user callback if one is set
-  if (bus->host_op.callback)
-    bus->host_op.callback(bus, status, bus->host_op.user_data);
+  if (slot->op.callback)
+    slot->op.callback(bus, status, slot->op.user_data);
 }
 
 int joybus_gcn_read(struct joybus *bus, enum joybus_gcn_analog_mode analog_mode,
@@ -81,20 +83,75 @@ int joybus_gcn_read_async(struct joybus *bus, enum joybus_gcn_analog_mode analog
                           enum joybus_gcn_motor_state motor_state, struct joybus_gcn_controller_state *response,
                           joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
+  // Build the command
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_READ;
+  slot->buffers->command[1] = analog_mode;
+  slot->buffers->command[2] = motor_state;
+
+  // Set up the host operation
+  slot->op.callback  = callback;
+  slot->op.user_data = user_data;
+  slot->op.response  = (uint8_t *)response;
+  slot->op.arg       = analog_mode;
+
+  // Transfer the command
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_READ_TX, slot->buffers->response,
+                                    JOYBUS_CMD_GCN_READ_RX, gcn_read_cb, slot);
+}
+
+static void gcn_read_sample_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_command_slot *slot = user_data;
+  struct joybus_gcn_sample *sample = (struct joybus_gcn_sample *)slot->op.response;
+
+  // Unpack the response and record when it was read
+  if (status >= 0)
+    unpack_input_state(&sample->state, slot->buffers->response, slot->op.arg);
+  sample->timestamps = *joybus_last_timestamps(bus);
+
+  // Fire the user callback if one is set
+  if (slot->op.callback)
+    slot->op.callback(bus, status, slot->op.user_data);
+}
+
+int joybus_gcn_read_sample(struct joybus *bus, enum joybus_gcn_analog_mode analog_mode,
+                           enum joybus_gcn_motor_state motor_state, struct joybus_gcn_sample *sample)
+{
+  struct joybus_sync_ctx ctx = {0};
+  return joybus_sync(joybus_gcn_read_sample_async(bus, analog_mode, motor_state, sample, joybus_sync_cb, &ctx),
+                     &ctx);
+}
+
+int joybus_gcn_read_sample_async(struct joybus *bus, enum joybus_gcn_analog_mode analog_mode,
+                                 enum joybus_gcn_motor_state motor_state, struct joybus_gcn_sample *sample,
+                                 joybus_transfer_cb callback, void *user_data)
+{
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_READ;
-  bus->command_buffer[1] = analog_mode;
-  bus->command_buffer[2] = motor_state;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_READ;
+  slot->buffers->command[1] = analog_mode;
+  slot->buffers->command[2] = motor_state;
 
   // Set up the host operation
-  bus->host_op.callback  = callback;
-  bus->host_op.user_data = user_data;
-  bus->host_op.response  = (uint8_t *)response;
-  bus->host_op.arg       = analog_mode;
+  slot->op.callback  = callback;
+  slot->op.user_data = user_data;
+  slot->op.response  = (uint8_t *)sample;
+  slot->op.arg       = analog_mode;
 
   // Transfer the command
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_READ_TX, bus->response_buffer, JOYBUS_CMD_GCN_READ_RX,
-                         gcn_read_cb, NULL);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_READ_TX, slot->buffers->response,
+                                    JOYBUS_CMD_GCN_READ_RX, gcn_read_sample_cb, slot);
 }
 
 int joybus_gcn_read_origin(struct joybus *bus, struct joybus_gcn_controller_state *response)
@@ -106,12 +163,18 @@ int joybus_gcn_read_origin(struct joybus *bus, struct joybus_gcn_controller_stat
 int joybus_gcn_read_origin_async(struct joybus *bus, struct joybus_gcn_controller_state *response,
                                  joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_READ_ORIGIN;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_READ_ORIGIN;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_READ_ORIGIN_TX, (uint8_t *)response,
-                         JOYBUS_CMD_GCN_READ_ORIGIN_RX, callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_READ_ORIGIN_TX, (uint8_t *)response,
+                                    JOYBUS_CMD_GCN_READ_ORIGIN_RX, callback, user_data);
 }
 
 int joybus_gcn_calibrate(struct joybus *bus, struct joybus_gcn_controller_state *response)
@@ -123,14 +186,20 @@ int joybus_gcn_calibrate(struct joybus *bus, struct joybus_gcn_controller_state
 int joybus_gcn_calibrate_async(struct joybus *bus, struct joybus_gcn_controller_state *response,
                                joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_CALIBRATE;
-  bus->command_buffer[1] = 0;
-  bus->command_buffer[2] = 0;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_CALIBRATE;
+  slot->buffers->command[1] = 0;
+  slot->buffers->command[2] = 0;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_CALIBRATE_TX, (uint8_t *)response,
-                         JOYBUS_CMD_GCN_CALIBRATE_RX, callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_CALIBRATE_TX, (uint8_t *)response,
+                                    JOYBUS_CMD_GCN_CALIBRATE_RX, callback, user_data);
 }
 
 int joybus_gcn_read_long(struct joybus *bus, enum joybus_gcn_motor_state motor_state,
@@ -144,14 +213,20 @@ int joybus_gcn_read_long_async(struct joybus *bus, enum joybus_gcn_motor_state m
                                struct joybus_gcn_controller_state *response, joybus_transfer_cb callback,
                                void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_READ_LONG;
-  bus->command_buffer[1] = 0; // Analog mode ignored for full precision reads
-  bus->command_buffer[2] = motor_state;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_READ_LONG;
+  slot->buffers->command[1] = 0; // Analog mode ignored for full precision reads
+  slot->buffers->command[2] = motor_state;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_READ_LONG_TX, (uint8_t *)response,
-                         JOYBUS_CMD_GCN_READ_LONG_RX, callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_READ_LONG_TX, (uint8_t *)response,
+                                    JOYBUS_CMD_GCN_READ_LONG_RX, callback, user_data);
 }
 
 int joybus_gcn_probe_device(struct joybus *bus, uint8_t response[JOYBUS_CMD_GCN_PROBE_DEVICE_RX])
@@ -163,15 +238,21 @@ int joybus_gcn_probe_device(struct joybus *bus, uint8_t response[JOYBUS_CMD_GCN_
 int joybus_gcn_probe_device_async(struct joybus *bus, uint8_t response[JOYBUS_CMD_GCN_PROBE_DEVICE_RX],
                                   joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
   // TODO: Mirror the behavior of real systems for the args
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_PROBE_DEVICE;
-  bus->command_buffer[1] = 0;
-  bus->command_buffer[2] = 0;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_PROBE_DEVICE;
+  slot->buffers->command[1] = 0;
+  slot->buffers->command[2] = 0;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_PROBE_DEVICE_TX, response,
-                         JOYBUS_CMD_GCN_PROBE_DEVICE_RX, callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_PROBE_DEVICE_TX, response, JOYBUS_CMD_GCN_PROBE_DEVICE_RX,
+                                    callback, user_data);
 }
 
 int joybus_gcn_fix_device(struct joybus *bus, uint16_t wireless_id, struct joybus_id *response)
@@ -183,12 +264,18 @@ int joybus_gcn_fix_device(struct joybus *bus, uint16_t wireless_id, struct joybu
 int joybus_gcn_fix_device_async(struct joybus *bus, uint16_t wireless_id, struct joybus_id *response,
                                 joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_GCN_FIX_DEVICE;
-  bus->command_buffer[1] = ((wireless_id >> 2) & 0xC0) | 0x10;
-  bus->command_buffer[2] = wireless_id & 0xFF;
+  slot->buffers->command[0] = JOYBUS_CMD_GCN_FIX_DEVICE;
+  slot->buffers->command[1] = ((wireless_id >> 2) & 0xC0) | 0x10;
+  slot->buffers->command[2] = wireless_id & 0xFF;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_GCN_FIX_DEVICE_TX, (uint8_t *)response,
-                         JOYBUS_CMD_GCN_FIX_DEVICE_RX, callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_GCN_FIX_DEVICE_TX, (uint8_t *)response,
+                                    JOYBUS_CMD_GCN_FIX_DEVICE_RX, callback, user_data);
 }
@@ -0,0 +1,187 @@
+#include <string.h>
+
+#include <joybus/errors.h>
+#include <joybus/identify.h>
+#include <joybus/host/common.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/gcn_adapter.h>
+
+enum {
+  PORT_STATE_IDENTIFY,
+  PORT_STATE_READ_ORIGIN,
+  PORT_STATE_READ,
+};
+
+// Length of each port's section of the input report
+#define PORT_REPORT_LEN 9
+
+static void identify_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_gcn_adapter_port *port = user_data;
+  port->busy                           = false;
+
+  // Stay in identify mode on any Joybus error
+  if (status < 0)
+    return;
+
+  // Only standard GameCube controllers are supported
+  uint16_t type = port->id.type;
+  if (!(type & JOYBUS_TYPE_GCN_DEVICE) || !(type & JOYBUS_TYPE_GCN_STANDARD))
+    return;
+
+  // Wait until a wireless receiver has paired with a controller
+  if ((type & JOYBUS_TYPE_GCN_WIRELESS) && !(type & JOYBUS_TYPE_GCN_WIRELESS_RECEIVED))
+    return;
+
+  port->state = PORT_STATE_READ_ORIGIN;
+}
+
+static void read_origin_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_gcn_adapter_port *port = user_data;
+  port->busy                           = false;
+
+  // Start reading input once the origin is known, otherwise start over
+  port->state = status < 0 ? PORT_STATE_IDENTIFY : PORT_STATE_READ;
+}
+
+static void read_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_gcn_adapter_port *port = user_data;
+  port->busy                           = false;
+
+  // Return to identify mode on any error
+  if (status < 0) {
+    port->state = PORT_STATE_IDENTIFY;
+    return;
+  }
+
+#if JOYBUS_USE_MAILBOXES
+  // Hand the completed read to the input report
+  joybus_mailbox_put(&port->input_mailbox, &port->input);
+#endif
+
+  // Fetch the origin again if the controller has a new one
+  if (port->input.buttons & JOYBUS_GCN_NEED_ORIGIN)
+    port->state = PORT_STATE_READ_ORIGIN;
+}
+
+// Start the next operation on a port
+static void poll_port(struct joybus_gcn_adapter_port *port)
+{
+  // Skip unpopulated ports, and ports still waiting on the previous operation
+  if (!port->bus || port->busy)
+    return;
+
+  int rc;
+  port->busy = true;
+  switch (port->state) {
+    default:
+      rc = joybus_identify_async(port->bus, &port->id, identify_cb, port);
+      break;
+    case PORT_STATE_READ_ORIGIN:
+      rc = joybus_gcn_read_origin_async(port->bus, &port->origin, read_origin_cb, port);
+      break;
+    case PORT_STATE_READ:
+      rc = joybus_gcn_read_async(port->bus, JOYBUS_GCN_ANALOG_MODE_3, port->motor_state, &port->input, read_cb, port);
+      break;
+  }
+
+  // The callback won't fire if the transfer didn't start
+  if (rc < 0)
+    port->busy = false;
+}
+
+void joybus_gcn_adapter_init(struct joybus_gcn_adapter *adapter, struct joybus *buses[JOYBUS_GCN_ADAPTER_PORTS])
+{
+  // Start from a clean state
+  memset(adapter, 0, sizeof(*adapter));
+
+  // Assume rumble power is available, as on adapters with a boost converter
+  adapter->powered = true;
+
+  for (int i = 0; i < JOYBUS_GCN_ADAPTER_PORTS; i++) {
+    struct joybus_gcn_adapter_port *port = &adapter->ports[i];
+    port->bus                            = buses[i];
+
+#if JOYBUS_USE_MAILBOXES
+    joybus_mailbox_init(&port->input_mailbox, port->input_slots, sizeof(port->input_slots[0]));
+#endif
+  }
+}
+
+void joybus_gcn_adapter_poll(struct joybus_gcn_adapter *adapter)
+{
+  for (int i = 0; i < JOYBUS_GCN_ADAPTER_PORTS; i++)
+    poll_port(&adapter->ports[i]);
+}
+
+bool joybus_gcn_adapter_connected(struct joybus_gcn_adapter *adapter, uint8_t port)
+{
+  return adapter->ports[port].state == PORT_STATE_READ;
+}
+
+uint8_t joybus_gcn_adapter_build_report(struct joybus_gcn_adapter *adapter,
+                                        uint8_t report[JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN])
+{
+  uint8_t power = adapter->powered ? JOYBUS_GCN_ADAPTER_STATUS_POWERED : 0;
+
+  report[0] = JOYBUS_GCN_ADAPTER_REPORT_INPUT;
+  for (int i = 0; i < JOYBUS_GCN_ADAPTER_PORTS; i++) {
+    struct joybus_gcn_adapter_port *port = &adapter->ports[i];
+    uint8_t *dest                        = &report[1 + i * PORT_REPORT_LEN];
+
+    // Empty ports only report the power status
+    if (port->state != PORT_STATE_READ) {
+      memset(dest, 0, PORT_REPORT_LEN);
+      dest[0] = power;
+      continue;
+    }
+
+    // Port status
+    bool wireless = port->id.type & JOYBUS_TYPE_GCN_WIRELESS;
+    dest[0]       = power | (wireless ? JOYBUS_GCN_ADAPTER_STATUS_WIRELESS : JOYBUS_GCN_ADAPTER_STATUS_WIRED);
+
+    // First byte: A, B, X, Y in the low nibble, d-pad left, right, down, up in the high nibble
+    // Second byte: start, Z, R, L
+#if JOYBUS_USE_MAILBOXES
+    joybus_mailbox_get(&port->input_mailbox, &port->report_input);
+    const struct joybus_gcn_controller_state *input = &port->report_input;
+#else
+    const struct joybus_gcn_controller_state *input = &port->input;
+#endif
+
+    uint8_t lo = input->buttons & 0xFF;
+    uint8_t hi = input->buttons >> 8;
+    dest[1]    = (lo & 0x0F) | (hi & 0x0F) << 4;
+    dest[2]    = (lo >> 4 & 0x01) | (hi >> 3 & 0x0E);
+
+    // Analog axes are in the same order as the input state
+    memcpy(&dest[3], &input->stick_x, 6);
+  }
+
+  return JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN;
+}
+
+int joybus_gcn_adapter_handle_output_report(struct joybus_gcn_adapter *adapter, const uint8_t *report, uint16_t len)
+{
+  if (len < 1)
+    return -JOYBUS_ERR_NOT_SUPPORTED;
+
+  switch (report[0]) {
+    case JOYBUS_GCN_ADAPTER_REPORT_RUMBLE:
+      if (len < JOYBUS_GCN_ADAPTER_RUMBLE_REPORT_LEN)
+        return -JOYBUS_ERR_NOT_SUPPORTED;
+
+      // One byte per port, folded into the next read on that port
+      for (int i = 0; i < JOYBUS_GCN_ADAPTER_PORTS; i++)
+        adapter->ports[i].motor_state = report[1 + i] ? JOYBUS_GCN_MOTOR_RUMBLE : JOYBUS_GCN_MOTOR_STOP;
+      return 0;
+
+    case JOYBUS_GCN_ADAPTER_REPORT_INIT:
+      // Sent once by the host to start input reports, which we always send
+      return 0;
+  }
+
+  return -JOYBUS_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,117 @@
+#include <joybus/host/common.h>
+#include <joybus/host/gcn_pipeline.h>
+
+static inline int32_t max_i32(int32_t a, int32_t b)
+{
+  return a > b ? a : b;
+}
+
+static inline int32_t min_i32(int32_t a, int32_t b)
+{
+  return a < b ? a : b;
+}
+
+// Fixed-point (16.16) gain that maps the span between the deadzone and the range onto full scale
+static inline int32_t axis_gain(struct joybus_gcn_pipeline_axis_config config, int32_t full_scale)
+{
+  int32_t span = max_i32(config.range - config.deadzone, 1);
+  return (full_scale << 16) / span;
+}
+
+// Build the table for a centered axis (main stick or C-stick)
+static void build_centered_lut(uint8_t lut[256], uint8_t origin, struct joybus_gcn_pipeline_axis_config config)
+{
+  int32_t gain = axis_gain(config, 127);
+
+  for (int32_t value = 0; value < 256; value++) {
+    // Distance from the origin, with the deadzone removed
+    int32_t delta     = value - origin;
+    int32_t magnitude = max_i32((delta < 0 ? -delta : delta) - config.deadzone, 0);
+
+    // Scale to full deflection and restore the direction
+    int32_t scaled = min_i32((magnitude * gain + 0x8000) >> 16, 127);
+    lut[value]     = 0x80 + (delta < 0 ? -scaled : scaled);
+  }
+}
+
+// Build the table for a one-sided axis (analog triggers)
+static void build_trigger_lut(uint8_t lut[256], uint8_t origin, struct joybus_gcn_pipeline_axis_config config)
+{
+  int32_t gain = axis_gain(config, 255);
+
+  for (int32_t value = 0; value < 256; value++) {
+    // Travel past the origin, with the deadzone removed
+    int32_t magnitude = max_i32(value - origin - config.deadzone, 0);
+
+    // Scale to full travel
+    lut[value] = min_i32((magnitude * gain + 0x8000) >> 16, 255);
+  }
+}
+
+// Rebuild all axis tables of a port from its stored origin
+static void build_port_luts(struct joybus_gcn_pipeline *pipeline, uint8_t port)
+{
+  const struct joybus_gcn_pipeline_config *config = &pipeline->config;
+
+  for (int axis = JOYBUS_GCN_AXIS_STICK_X; axis <= JOYBUS_GCN_AXIS_STICK_Y; axis++)
+    build_centered_lut(pipeline->axis_lut[axis][port], pipeline->origin[axis][port], config->stick);
+
+  for (int axis = JOYBUS_GCN_AXIS_SUBSTICK_X; axis <= JOYBUS_GCN_AXIS_SUBSTICK_Y; axis++)
+    build_centered_lut(pipeline->axis_lut[axis][port], pipeline->origin[axis][port], config->substick);
+
+  for (int axis = JOYBUS_GCN_AXIS_TRIGGER_LEFT; axis <= JOYBUS_GCN_AXIS_TRIGGER_RIGHT; axis++)
+    build_trigger_lut(pipeline->axis_lut[axis][port], pipeline->origin[axis][port], config->trigger);
+}
+
+void joybus_gcn_pipeline_init(struct joybus_gcn_pipeline *pipeline, struct joybus_gcn_pipeline_config config)
+{
+  pipeline->config = config;
+
+  // Build the button tables
+  joybus_build_button_lut(pipeline->button_lut, config.button_map);
+
+  // Start every port from a centered origin
+  for (uint8_t port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++) {
+    for (int axis = 0; axis < JOYBUS_GCN_AXIS_COUNT; axis++)
+      pipeline->origin[axis][port] = axis < JOYBUS_GCN_AXIS_TRIGGER_LEFT ? 0x80 : 0x00;
+
+    build_port_luts(pipeline, port);
+  }
+}
+
+bool joybus_gcn_pipeline_set_origin(struct joybus_gcn_pipeline *pipeline, uint8_t port,
+                                    const struct joybus_gcn_controller_state *origin)
+{
+  // Axis values start at byte offset 2 of the input state
+  const uint8_t *axes = (const uint8_t *)origin + 2;
+
+  // Only rebuild the tables if the origin actually changed
+  bool changed = false;
+  for (int axis = 0; axis < JOYBUS_GCN_AXIS_COUNT; axis++) {
+    if (pipeline->origin[axis][port] != axes[axis]) {
+      pipeline->origin[axis][port] = axes[axis];
+      changed                      = true;
+    }
+  }
+
+  if (changed)
+    build_port_luts(pipeline, port);
+
+  return changed;
+}
+
+void joybus_gcn_pipeline_process(const struct joybus_gcn_pipeline *pipeline, const struct joybus_gcn_input_soa *in,
+                                 struct joybus_gcn_input_soa *out)
+{
+  // Remap buttons, one lookup per button byte
+  for (int port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++) {
+    uint16_t buttons   = in->buttons[port];
+    out->buttons[port] = pipeline->button_lut[0][buttons & 0xFF] | pipeline->button_lut[1][buttons >> 8];
+  }
+
+  // Origin correction, deadzone and scaling are all folded into the axis tables
+  for (int axis = 0; axis < JOYBUS_GCN_AXIS_COUNT; axis++) {
+    for (int port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++)
+      out->axes[axis][port] = pipeline->axis_lut[axis][port][in->axes[axis][port]];
+  }
+}
@@ -7,6 +7,7 @@
 #include <joybus/bus.h>
 #include <joybus/checksum.h>
 #include <joybus/commands.h>
+#include <joybus/errors.h>
 #include <joybus/common/n64_controller.h>
 #include <joybus/host/n64.h>
 
@@ -19,12 +20,74 @@ int joybus_n64_read(struct joybus *bus, struct joybus_n64_controller_state *resp
 int joybus_n64_read_async(struct joybus *bus, struct joybus_n64_controller_state *response, joybus_transfer_cb callback,
                           void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Build the command
-  bus->command_buffer[0] = JOYBUS_CMD_N64_READ;
+  slot->buffers->command[0] = JOYBUS_CMD_N64_READ;
 
   // Transfer the command and read the response directly into the response buffer
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_N64_READ_TX, (uint8_t *)response, JOYBUS_CMD_N64_READ_RX,
-                         callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_N64_READ_TX, (uint8_t *)response, JOYBUS_CMD_N64_READ_RX,
+                                    callback, user_data);
+}
+
+static void n64_read_sample_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_command_slot *slot = user_data;
+  struct joybus_n64_sample *sample = (struct joybus_n64_sample *)slot->op.response;
+
+  // The state was read in place, record when
+  sample->timestamps = *joybus_last_timestamps(bus);
+
+  // Fire the user callback if one is set
+  if (slot->op.callback)
+    slot->op.callback(bus, status, slot->op.user_data);
+}
+
+int joybus_n64_read_sample(struct joybus *bus, struct joybus_n64_sample *sample)
+{
+  struct joybus_sync_ctx ctx = {0};
+  return joybus_sync(joybus_n64_read_sample_async(bus, sample, joybus_sync_cb, &ctx), &ctx);
+}
+
+int joybus_n64_read_sample_async(struct joybus *bus, struct joybus_n64_sample *sample, joybus_transfer_cb callback,
+                                 void *user_data)
+{
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
+  // Build the command
+  slot->buffers->command[0] = JOYBUS_CMD_N64_READ;
+
+  // Set up the host operation
+  slot->op.callback  = callback;
+  slot->op.user_data = user_data;
+  slot->op.response  = (uint8_t *)sample;
+
+  // Transfer the command and read the response directly into the sample
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_N64_READ_TX, (uint8_t *)&sample->state,
+                                    JOYBUS_CMD_N64_READ_RX, n64_read_sample_cb, slot);
+}
+
+static void n64_pak_write_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_command_slot *slot = user_data;
+
+  // Check the pak's CRC of the written data, and resend the write if the retry policy allows
+  if (status >= 0 && slot->op.response[0] != slot->op.arg)
+    status = -JOYBUS_ERR_CHECKSUM;
+  if (joybus_command_slot_retry(bus, slot, status))
+    return;
+
+  // Fire the user callback if one is set
+  if (slot->op.callback)
+    slot->op.callback(bus, status, slot->op.user_data);
 }
 
 int joybus_n64_pak_write(struct joybus *bus, uint16_t addr, const void *data,
@@ -38,20 +101,52 @@ int joybus_n64_pak_write_async(struct joybus *bus, uint16_t addr, const uint8_t
                                uint8_t response[JOYBUS_CMD_N64_PAK_WRITE_RX], joybus_transfer_cb callback,
                                void *user_data)
 {
+  // The command doesn't fit a shrunk command buffer
+  if (JOYBUS_COMMAND_BUFFER_SIZE < JOYBUS_CMD_N64_PAK_WRITE_TX)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Generate address with checksum
   uint16_t with_checksum = (addr & 0xFFE0) | joybus_address_checksum(addr >> 5);
 
   // Build command
-  bus->command_buffer[0] = JOYBUS_CMD_N64_PAK_WRITE;
-  bus->command_buffer[1] = (uint8_t)(with_checksum >> 8);
-  bus->command_buffer[2] = (uint8_t)(with_checksum & 0xFF);
+  slot->buffers->command[0] = JOYBUS_CMD_N64_PAK_WRITE;
+  slot->buffers->command[1] = (uint8_t)(with_checksum >> 8);
+  slot->buffers->command[2] = (uint8_t)(with_checksum & 0xFF);
 
   // Copy data to be written
-  memcpy(&bus->command_buffer[3], data, 32);
+  memcpy(&slot->buffers->command[3], data, 32);
+
+  // Set up the host operation, working out the expected CRC while the previous command may still be on the wire
+  slot->op.callback  = callback;
+  slot->op.user_data = user_data;
+  slot->op.response  = response;
+  slot->op.arg       = joybus_data_checksum(data, JOYBUS_PAK_BLOCK_SIZE);
 
   // Send command
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_N64_PAK_WRITE_TX, response, JOYBUS_CMD_N64_PAK_WRITE_RX,
-                         callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_N64_PAK_WRITE_TX, response, JOYBUS_CMD_N64_PAK_WRITE_RX,
+                                    n64_pak_write_cb, slot);
+}
+
+static void n64_pak_read_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_command_slot *slot = user_data;
+
+  // Check the data against the CRC that follows it, and resend the read if the retry policy allows
+  if (status >= 0 && joybus_data_checksum(slot->op.response, JOYBUS_PAK_BLOCK_SIZE) !=
+                       slot->op.response[JOYBUS_PAK_BLOCK_SIZE])
+    status = -JOYBUS_ERR_CHECKSUM;
+  if (joybus_command_slot_retry(bus, slot, status))
+    return;
+
+  // Fire the user callback if one is set
+  if (slot->op.callback)
+    slot->op.callback(bus, status, slot->op.user_data);
 }
 
 int joybus_n64_pak_read(struct joybus *bus, uint16_t addr, uint8_t response[JOYBUS_CMD_N64_PAK_READ_RX])
@@ -63,15 +158,26 @@ int joybus_n64_pak_read(struct joybus *bus, uint16_t addr, uint8_t response[JOYB
 int joybus_n64_pak_read_async(struct joybus *bus, uint16_t addr, uint8_t response[JOYBUS_CMD_N64_PAK_READ_RX],
                               joybus_transfer_cb callback, void *user_data)
 {
+  // Claim a command slot, the previous command may still be on the wire
+  struct joybus_command_slot *slot;
+  int rc = joybus_command_slot_acquire(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Generate address with checksum
   uint16_t with_checksum = (addr & 0xFFE0) | joybus_address_checksum(addr >> 5);
 
   // Build command
-  bus->command_buffer[0] = JOYBUS_CMD_N64_PAK_READ;
-  bus->command_buffer[1] = (uint8_t)(with_checksum >> 8);
-  bus->command_buffer[2] = (uint8_t)(with_checksum & 0xFF);
+  slot->buffers->command[0] = JOYBUS_CMD_N64_PAK_READ;
+  slot->buffers->command[1] = (uint8_t)(with_checksum >> 8);
+  slot->buffers->command[2] = (uint8_t)(with_checksum & 0xFF);
+
+  // Set up the host operation
+  slot->op.callback  = callback;
+  slot->op.user_data = user_data;
+  slot->op.response  = response;
 
   // Send command
-  return joybus_transfer(bus, bus->command_buffer, JOYBUS_CMD_N64_PAK_READ_TX, response, JOYBUS_CMD_N64_PAK_READ_RX,
-                         callback, user_data);
+  return joybus_command_slot_submit(bus, slot, JOYBUS_CMD_N64_PAK_READ_TX, response, JOYBUS_CMD_N64_PAK_READ_RX,
+                                    n64_pak_read_cb, slot);
 }
@@ -1,10 +1,11 @@
 #include <string.h>
 
 #include <joybus/bus.h>
-#include <joybus/checksum.h>
+#include <joybus/commands.h>
 #include <joybus/errors.h>
 #include <joybus/host/n64.h>
 #include <joybus/host/n64_rumble_pak.h>
+#include <joybus/host/sequence.h>
 
 // Probe address and values
 #define RUMBLE_PAK_PROBE_ADDR     0x8000
@@ -17,123 +18,96 @@
 #define RUMBLE_PAK_MOTOR_ON       0x01
 #define RUMBLE_PAK_MOTOR_OFF      0x00
 
-// Probe steps
-enum {
-  PROBE_WROTE_ANTI_SIGNATURE,
-  PROBE_READ_ANTI_SIGNATURE,
-  PROBE_WROTE_SIGNATURE,
-  PROBE_READ_SIGNATURE,
-};
+// Write a uniform block to the probe register
+static int probe_write(struct joybus *bus, struct joybus_sequence *seq, uint8_t value)
+{
+  struct joybus_n64_rumble_pak_probe *probe = seq->context;
 
-static void probe_cb(struct joybus *bus, int status, void *user_data);
+  uint8_t block[JOYBUS_PAK_BLOCK_SIZE];
+  memset(block, value, sizeof(block));
 
-// Fire the saved user callback with a status
-static void probe_finish(struct joybus *bus, int status)
-{
-  if (bus->host_op.callback)
-    bus->host_op.callback(bus, status, bus->host_op.user_data);
+  return joybus_n64_pak_write_async(bus, RUMBLE_PAK_PROBE_ADDR, block, probe->block, joybus_sequence_cb, seq);
 }
 
-// Write a uniform block to the probe register and continue the chain
-static int probe_write(struct joybus *bus, uint8_t value)
+// Read the probe register back
+static int probe_read(struct joybus *bus, struct joybus_sequence *seq)
 {
-  uint8_t block[JOYBUS_PAK_BLOCK_SIZE];
-  memset(block, value, sizeof(block));
+  struct joybus_n64_rumble_pak_probe *probe = seq->context;
 
-  return joybus_n64_pak_write_async(bus, RUMBLE_PAK_PROBE_ADDR, block, bus->response_buffer, probe_cb, NULL);
+  return joybus_n64_pak_read_async(bus, RUMBLE_PAK_PROBE_ADDR, probe->block, joybus_sequence_cb, seq);
+}
+
+static int write_anti_signature(struct joybus *bus, struct joybus_sequence *seq)
+{
+  return probe_write(bus, seq, RUMBLE_PAK_ANTI_SIGNATURE);
 }
 
-// Read the probe register back and continue the chain
-static int probe_read(struct joybus *bus)
+static int write_signature(struct joybus *bus, struct joybus_sequence *seq)
 {
-  return joybus_n64_pak_read_async(bus, RUMBLE_PAK_PROBE_ADDR, bus->response_buffer, probe_cb, NULL);
+  struct joybus_n64_rumble_pak_probe *probe = seq->context;
+
+  // A controller pak reads the non-signature back, a rumble pak does not
+  if (probe->block[RUMBLE_PAK_PROBE_BYTE] == RUMBLE_PAK_ANTI_SIGNATURE)
+    return -JOYBUS_ERR_NO_DEVICE;
+
+  return probe_write(bus, seq, RUMBLE_PAK_SIGNATURE);
 }
 
-// Advance the probe one step each time a transfer completes
-static void probe_cb(struct joybus *bus, int status, void *user_data)
+static int check_signature(struct joybus *bus, struct joybus_sequence *seq)
 {
-  // Bail out of the chain on any transfer error
-  if (status < 0) {
-    probe_finish(bus, status);
-    return;
-  }
-
-  switch (bus->host_op.arg) {
-    case PROBE_WROTE_ANTI_SIGNATURE:
-      // Non-signature written, read it back
-      bus->host_op.arg = PROBE_READ_ANTI_SIGNATURE;
-      status           = probe_read(bus);
-      break;
-
-    case PROBE_READ_ANTI_SIGNATURE:
-      // A controller pak reads the non-signature back, a rumble pak does not
-      if (bus->response_buffer[RUMBLE_PAK_PROBE_BYTE] == RUMBLE_PAK_ANTI_SIGNATURE) {
-        probe_finish(bus, -JOYBUS_ERR_NO_DEVICE);
-        return;
-      }
-      bus->host_op.arg = PROBE_WROTE_SIGNATURE;
-      status           = probe_write(bus, RUMBLE_PAK_SIGNATURE);
-      break;
-
-    case PROBE_WROTE_SIGNATURE:
-      // Signature written, read it back
-      bus->host_op.arg = PROBE_READ_SIGNATURE;
-      status           = probe_read(bus);
-      break;
-
-    case PROBE_READ_SIGNATURE:
-      // A rumble pak reads the signature back once enabled
-      if (bus->response_buffer[RUMBLE_PAK_PROBE_BYTE] != RUMBLE_PAK_SIGNATURE)
-        status = -JOYBUS_ERR_NO_DEVICE;
-
-      probe_finish(bus, status >= 0 ? 0 : status);
-      return;
-  }
-
-  // A transfer that failed to start ends the chain
-  if (status < 0)
-    probe_finish(bus, status);
+  struct joybus_n64_rumble_pak_probe *probe = seq->context;
+
+  // A rumble pak reads the signature back once enabled
+  return probe->block[RUMBLE_PAK_PROBE_BYTE] == RUMBLE_PAK_SIGNATURE ? JOYBUS_SEQUENCE_DONE : -JOYBUS_ERR_NO_DEVICE;
 }
 
-static void motor_write_cb(struct joybus *bus, int status, void *user_data)
+// Write and read back the non-signature, then the signature
+static const joybus_sequence_step probe_steps[] = {
+  write_anti_signature, probe_read, write_signature, probe_read, check_signature, NULL,
+};
+
+// Claim a command slot for a chain of pak reads and writes, which need the full command and response buffers
+static int claim_slot(struct joybus *bus, struct joybus_command_slot **slot)
 {
-  // Check for CRC errors
-  if (status >= 0 && bus->host_op.arg != bus->response_buffer[0])
-    status = -JOYBUS_ERR_CHECKSUM;
+  if (JOYBUS_COMMAND_BUFFER_SIZE < JOYBUS_CMD_N64_PAK_WRITE_TX || JOYBUS_RESPONSE_BUFFER_SIZE < JOYBUS_CMD_N64_PAK_READ_RX)
+    return -JOYBUS_ERR_NO_SPACE;
 
-  // Fire the user callback
-  if (bus->host_op.callback)
-    bus->host_op.callback(bus, status, bus->host_op.user_data);
+  // The pak functions build their commands in the slot claimed here
+  int rc = joybus_command_slot_acquire(bus, slot);
+  if (rc < 0)
+    return rc;
+
+  // Pak responses land in the slot's response buffer
+  (*slot)->op.response = (*slot)->buffers->response;
+
+  return 0;
 }
 
 static int motor_write(struct joybus *bus, uint8_t value, joybus_transfer_cb callback, void *user_data) {
+  struct joybus_command_slot *slot;
+  int rc = claim_slot(bus, &slot);
+  if (rc < 0)
+    return rc;
+
   // Fill a block with bytes
   uint8_t block[JOYBUS_PAK_BLOCK_SIZE];
   memset(block, value, sizeof(block));
 
-  // Save the callback, user data, and expected checksum for later
-  bus->host_op.callback  = callback;
-  bus->host_op.user_data = user_data;
-  bus->host_op.arg       = joybus_data_checksum(block, sizeof(block));
-
-  return joybus_n64_pak_write_async(bus, RUMBLE_PAK_MOTOR_ADDR, block, bus->response_buffer, motor_write_cb, NULL);
+  // The pak write checks the CRC and retries, the response lands in the slot's buffer
+  return joybus_n64_pak_write_async(bus, RUMBLE_PAK_MOTOR_ADDR, block, slot->op.response, callback, user_data);
 }
 
 int joybus_n64_rumble_pak_init(struct joybus *bus)
 {
+  struct joybus_n64_rumble_pak_probe probe;
   struct joybus_sync_ctx ctx = {0};
-  return joybus_sync(joybus_n64_rumble_pak_init_async(bus, joybus_sync_cb, &ctx), &ctx);
+  return joybus_sync(joybus_n64_rumble_pak_init_async(bus, &probe, joybus_sync_cb, &ctx), &ctx);
 }
 
-int joybus_n64_rumble_pak_init_async(struct joybus *bus, joybus_transfer_cb callback, void *user_data)
+int joybus_n64_rumble_pak_init_async(struct joybus *bus, struct joybus_n64_rumble_pak_probe *probe,
+                                     joybus_transfer_cb callback, void *user_data)
 {
-  // Save the user callback for the end of the probe chain
-  bus->host_op.callback  = callback;
-  bus->host_op.user_data = user_data;
-
-  // Save the initial probe state and start the chain
-  bus->host_op.arg       = PROBE_WROTE_ANTI_SIGNATURE;
-  return probe_write(bus, RUMBLE_PAK_ANTI_SIGNATURE);
+  return joybus_sequence_start(bus, &probe->seq, probe_steps, probe, callback, user_data);
 }
 
 int joybus_n64_rumble_pak_start(struct joybus *bus)
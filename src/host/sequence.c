@@ -0,0 +1,46 @@
+#include <joybus/attributes.h>
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/host/sequence.h>
+
+// Run the next step, 0 once it started a transfer
+JOYBUS_RAM_FUNC
+static int run_step(struct joybus *bus, struct joybus_sequence *seq)
+{
+  joybus_sequence_step step = seq->steps[seq->next];
+  if (!step)
+    return JOYBUS_SEQUENCE_DONE;
+
+  seq->next++;
+  return step(bus, seq);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_sequence_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_sequence *seq = user_data;
+
+  // A failed transfer ends the sequence, otherwise carry on
+  if (status >= 0) {
+    status = run_step(bus, seq);
+    if (status == 0)
+      return;
+  }
+
+  if (seq->callback)
+    seq->callback(bus, status == JOYBUS_SEQUENCE_DONE ? 0 : status, seq->user_data);
+}
+
+int joybus_sequence_start(struct joybus *bus, struct joybus_sequence *seq, const joybus_sequence_step *steps,
+                          void *context, joybus_transfer_cb callback, void *user_data)
+{
+  seq->context   = context;
+  seq->steps     = steps;
+  seq->next      = 0;
+  seq->callback  = callback;
+  seq->user_data = user_data;
+
+  // The callback can't run before this returns, so the first step has to put something on the wire
+  int rc = run_step(bus, seq);
+  return rc == JOYBUS_SEQUENCE_DONE ? -JOYBUS_ERR_INVALID : rc;
+}
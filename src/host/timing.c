@@ -0,0 +1,112 @@
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/host/timing.h>
+
+static void calibrate_cb(struct joybus *bus, int status, void *user_data);
+
+// Send the command with the given gap before it
+static int send(struct joybus_gap_calibration *cal, uint16_t gap_us)
+{
+  cal->timing.min_gap_us = gap_us;
+  return joybus_transfer_timed(cal->bus, &cal->timing, cal->command, cal->write_len, cal->response, cal->read_len,
+                               calibrate_cb, cal);
+}
+
+// Report the result, the bus is idle by now
+static void finish(struct joybus_gap_calibration *cal, int status)
+{
+  if (status >= 0)
+    cal->min_gap_us = cal->hi_us;
+
+  if (cal->callback)
+    cal->callback(cal->bus, status, cal->user_data);
+}
+
+// Try the gap halfway between the shortest that might work and the shortest known to work
+static void next_candidate(struct joybus_gap_calibration *cal)
+{
+  if (cal->lo_us >= cal->hi_us) {
+    finish(cal, 0);
+    return;
+  }
+
+  // Lead in with a gap known to work, so a command missed by the last candidate can't affect this one
+  cal->trial = 0;
+  int rc     = send(cal, cal->hi_us);
+  if (rc < 0)
+    finish(cal, rc);
+}
+
+static void calibrate_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_gap_calibration *cal = user_data;
+  uint16_t gap_us                    = cal->lo_us + (cal->hi_us - cal->lo_us) / 2;
+
+  if (status < 0 && cal->trial == 0) {
+    // The lead-in failed, the device doesn't reply reliably even at a gap that should work
+    finish(cal, status);
+    return;
+  }
+
+  if (status < 0) {
+    // Missed a command, the gap is too short
+    cal->lo_us = gap_us + 1;
+    next_candidate(cal);
+    return;
+  }
+
+  if (cal->trial == JOYBUS_CALIBRATE_TRIALS) {
+    // Every trial passed, the gap works
+    cal->hi_us = gap_us;
+    next_candidate(cal);
+    return;
+  }
+
+  if (cal->lo_us >= cal->hi_us) {
+    // The bus profile has no gap to shrink
+    finish(cal, 0);
+    return;
+  }
+
+  cal->trial++;
+  int rc = send(cal, gap_us);
+  if (rc < 0)
+    finish(cal, rc);
+}
+
+int joybus_calibrate_gap(struct joybus *bus, const uint8_t *command, uint8_t write_len, uint8_t read_len,
+                         uint16_t *min_gap_us)
+{
+  struct joybus_gap_calibration cal;
+  struct joybus_sync_ctx ctx = {0};
+
+  int rc = joybus_calibrate_gap_async(bus, &cal, command, write_len, read_len, joybus_sync_cb, &ctx);
+  rc     = joybus_sync(rc, &ctx);
+  if (rc >= 0)
+    *min_gap_us = cal.min_gap_us;
+
+  return rc;
+}
+
+int joybus_calibrate_gap_async(struct joybus *bus, struct joybus_gap_calibration *cal, const uint8_t *command,
+                               uint8_t write_len, uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  if (write_len == 0)
+    return -JOYBUS_ERR_INVALID;
+  if (read_len > JOYBUS_BLOCK_SIZE)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  cal->bus       = bus;
+  cal->command   = command;
+  cal->write_len = write_len;
+  cal->read_len  = read_len;
+  cal->timing    = *joybus_get_timing(bus);
+  cal->lo_us     = 0;
+  cal->hi_us     = cal->timing.min_gap_us;
+  cal->trial     = 0;
+  cal->callback  = callback;
+  cal->user_data = user_data;
+
+  // Start with the lead-in to the first candidate
+  return send(cal, cal->hi_us);
+}
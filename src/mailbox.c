@@ -0,0 +1,47 @@
+#include <string.h>
+
+#include <joybus/attributes.h>
+#include <joybus/mailbox.h>
+
+// Flag set in the middle index when it holds a value the consumer hasn't taken
+#define MAILBOX_FRESH 0x80
+
+void joybus_mailbox_init(struct joybus_mailbox *mailbox, void *slots, uint8_t size)
+{
+  mailbox->slots = slots;
+  mailbox->size  = size;
+  mailbox->front = 0;
+  mailbox->back  = 2;
+  atomic_init(&mailbox->middle, 1);
+}
+
+JOYBUS_RAM_FUNC
+void joybus_mailbox_put(struct joybus_mailbox *mailbox, const void *value)
+{
+  memcpy(&mailbox->slots[mailbox->back * mailbox->size], value, mailbox->size);
+
+  // Release the value along with the slot, and take back whichever slot was in the middle
+  uint8_t previous = atomic_exchange_explicit(&mailbox->middle, mailbox->back | MAILBOX_FRESH, memory_order_acq_rel);
+  mailbox->back    = previous & ~MAILBOX_FRESH;
+}
+
+JOYBUS_RAM_FUNC
+bool joybus_mailbox_get(struct joybus_mailbox *mailbox, void *value)
+{
+  // Nothing new, keep the front slot
+  if (!(atomic_load_explicit(&mailbox->middle, memory_order_relaxed) & MAILBOX_FRESH))
+    return false;
+
+  // Acquire the latest value, and hand the old front slot back to the producer
+  uint8_t previous = atomic_exchange_explicit(&mailbox->middle, mailbox->front, memory_order_acq_rel);
+  mailbox->front   = previous & ~MAILBOX_FRESH;
+
+  memcpy(value, &mailbox->slots[mailbox->front * mailbox->size], mailbox->size);
+  return true;
+}
+
+JOYBUS_RAM_FUNC
+bool joybus_mailbox_pending(struct joybus_mailbox *mailbox)
+{
+  return atomic_load_explicit(&mailbox->middle, memory_order_relaxed) & MAILBOX_FRESH;
+}
@@ -0,0 +1,313 @@
+#include <string.h>
+
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/host/common.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/target/bridge.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+// Console polls further than this fraction of the period from the prediction are outliers
+#define PERIOD_TOLERANCE_DIV 4
+
+// Consecutive outliers before the period estimate is dropped, eg. after the game changes its polling rate
+#define MAX_OUTLIERS         4
+
+// Largest stick displacement from center on either controller
+#define MAX_RANGE            127
+
+// Nominal duration of an upstream read at 4us per bit, including both stop bits and the target's reply delay
+#define GCN_READ_US          ((JOYBUS_CMD_GCN_READ_TX + JOYBUS_CMD_GCN_READ_RX) * 32 + 8 + 4)
+#define N64_READ_US          ((JOYBUS_CMD_N64_READ_TX + JOYBUS_CMD_N64_READ_RX) * 32 + 8 + 4)
+
+static inline int32_t clamp_i32(int32_t value, int32_t min, int32_t max)
+{
+  return value < min ? min : value > max ? max : value;
+}
+
+// Scale a signed value by num/den, rounding to nearest
+static inline int32_t scale(int32_t value, int32_t num, int32_t den)
+{
+  int32_t product = value * num;
+  return (product + (product < 0 ? -den : den) / 2) / den;
+}
+
+// Read command of the controller the console sees
+static inline uint8_t console_read_command(const struct joybus_target_bridge *bridge)
+{
+  return bridge->config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN ? JOYBUS_CMD_GCN_READ : JOYBUS_CMD_N64_READ;
+}
+
+// Work out when the next upstream read should start
+static void schedule_read(struct joybus_target_bridge *bridge)
+{
+  // Rescheduled once the read in flight completes
+  if (bridge->read_busy)
+    return;
+
+  // Not locked onto the console yet, read once after every console poll
+  if (!bridge->period_us) {
+    bridge->next_read_us = bridge->polled ? bridge->last_poll_us : UINT64_MAX;
+    return;
+  }
+
+  // Aim to finish halfway into the freshness window before the next poll
+  int64_t lead      = bridge->read_us + bridge->config.max_age_us / 2;
+  int64_t next_read = bridge->last_poll_us + bridge->period_us - lead;
+
+  // One read per console cycle
+  while (next_read <= (int64_t)bridge->read_start_us)
+    next_read += bridge->period_us;
+
+  bridge->next_read_us = next_read < 0 ? 0 : next_read;
+}
+
+// Update the polling period estimate from a console poll
+static void track_console_poll(struct joybus_target_bridge *bridge, uint64_t now)
+{
+  // Age of the data the console is about to be served
+  if (bridge->data_us) {
+    bridge->last_age_us = now - bridge->data_us;
+    if (bridge->last_age_us > bridge->config.max_age_us)
+      bridge->stale_polls++;
+  }
+
+  uint32_t interval = now - bridge->last_poll_us;
+  bool first        = bridge->polls++ == 0;
+
+  bridge->last_poll_us = now;
+  bridge->polled       = true;
+
+  if (!bridge->period_us) {
+    // Take the first interval as the initial estimate
+    if (!first)
+      bridge->period_us = interval;
+  } else if (interval > bridge->period_us - bridge->period_us / PERIOD_TOLERANCE_DIV &&
+             interval < bridge->period_us + bridge->period_us / PERIOD_TOLERANCE_DIV) {
+    // Poll where expected, smooth out jitter
+    bridge->period_us += ((int32_t)interval - (int32_t)bridge->period_us) / 8;
+    bridge->outliers   = 0;
+  } else if (++bridge->outliers >= MAX_OUTLIERS) {
+    // Polling rate changed, start over from this interval
+    bridge->period_us = interval;
+    bridge->outliers  = 0;
+  }
+
+  schedule_read(bridge);
+}
+
+// Translate an N64 controller state into the GameCube controller target's input
+static void translate_n64_to_gcn(struct joybus_target_bridge *bridge)
+{
+  struct joybus_target_gcn_controller *controller = JOYBUS_TARGET_GCN_CONTROLLER(bridge->target);
+  const struct joybus_n64_controller_state *src   = &bridge->upstream.n64;
+  struct joybus_gcn_controller_state *dest        = &controller->input;
+
+  // Remap buttons, keeping the origin flags owned by the target
+  uint16_t buttons = bridge->button_lut[0][src->buttons & 0xFF] | bridge->button_lut[1][src->buttons >> 8];
+  dest->buttons    = (dest->buttons & ~JOYBUS_GCN_BUTTON_MASK) | buttons;
+
+  // Main stick
+  dest->stick_x = bridge->axis_lut[(uint8_t)src->stick_x];
+  dest->stick_y = bridge->axis_lut[(uint8_t)src->stick_y];
+
+  // C buttons push the C-stick to full deflection
+  uint8_t range    = bridge->config.gcn_range;
+  dest->substick_x = 0x80 + (src->buttons & JOYBUS_N64_BUTTON_C_RIGHT ? range : 0) -
+                     (src->buttons & JOYBUS_N64_BUTTON_C_LEFT ? range : 0);
+  dest->substick_y = 0x80 + (src->buttons & JOYBUS_N64_BUTTON_C_UP ? range : 0) -
+                     (src->buttons & JOYBUS_N64_BUTTON_C_DOWN ? range : 0);
+
+  // Digital shoulder buttons fully press the analog triggers
+  dest->trigger_left  = buttons & JOYBUS_GCN_BUTTON_L ? 0xFF : 0x00;
+  dest->trigger_right = buttons & JOYBUS_GCN_BUTTON_R ? 0xFF : 0x00;
+
+  joybus_target_gcn_controller_input_valid(controller, true);
+}
+
+// Translate a GameCube controller state into the N64 controller target's input
+static void translate_gcn_to_n64(struct joybus_target_bridge *bridge)
+{
+  struct joybus_target_n64_controller *controller = JOYBUS_TARGET_N64_CONTROLLER(bridge->target);
+  const struct joybus_gcn_controller_state *src   = &bridge->upstream.gcn;
+  struct joybus_n64_controller_state *dest        = &controller->input;
+
+  // Remap buttons
+  uint16_t buttons = bridge->button_lut[0][src->buttons & 0xFF] | bridge->button_lut[1][src->buttons >> 8];
+
+  // C-stick past the threshold presses the C buttons
+  int threshold = bridge->config.substick_threshold;
+  int dx        = src->substick_x - 0x80;
+  int dy        = src->substick_y - 0x80;
+  if (dx > threshold)
+    buttons |= JOYBUS_N64_BUTTON_C_RIGHT;
+  if (dx < -threshold)
+    buttons |= JOYBUS_N64_BUTTON_C_LEFT;
+  if (dy > threshold)
+    buttons |= JOYBUS_N64_BUTTON_C_UP;
+  if (dy < -threshold)
+    buttons |= JOYBUS_N64_BUTTON_C_DOWN;
+
+  dest->buttons = buttons;
+
+  // Main stick
+  dest->stick_x = (int8_t)bridge->axis_lut[src->stick_x];
+  dest->stick_y = (int8_t)bridge->axis_lut[src->stick_y];
+}
+
+// Serve neutral input while the controller can't be read
+static void clear_input(struct joybus_target_bridge *bridge)
+{
+  if (bridge->config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+    joybus_target_gcn_controller_input_valid(JOYBUS_TARGET_GCN_CONTROLLER(bridge->target), false);
+  } else {
+    memset(&JOYBUS_TARGET_N64_CONTROLLER(bridge->target)->input, 0, sizeof(struct joybus_n64_controller_state));
+  }
+}
+
+static void read_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_target_bridge *bridge = user_data;
+  uint64_t now                        = joybus_clock_now_us(bus->clock);
+
+  if (status < 0) {
+    clear_input(bridge);
+  } else {
+    // Track the read duration, including any wait for the bus
+    uint32_t duration = now - bridge->read_start_us;
+    bridge->read_us  += ((int32_t)duration - (int32_t)bridge->read_us) / 4;
+    bridge->data_us   = now;
+
+    if (bridge->config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+      translate_n64_to_gcn(bridge);
+    } else {
+      translate_gcn_to_n64(bridge);
+    }
+  }
+
+  bridge->read_busy = false;
+  schedule_read(bridge);
+}
+
+JOYBUS_RAM_FUNC
+static int bridge_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
+                                joybus_target_response_cb send_response, void *user_data)
+{
+  struct joybus_target_bridge *bridge = JOYBUS_TARGET_BRIDGE(target);
+
+  // Timestamp console reads as soon as the command byte arrives
+  if (bytes_read == 1 && command[0] == console_read_command(bridge))
+    track_console_poll(bridge, joybus_clock_now_us(bridge->host_bus->clock));
+
+  // Let the controller target answer
+  return joybus_target_byte_received(bridge->target, command, bytes_read, send_response, user_data);
+}
+
+static const struct joybus_target_api bridge_api = {
+  .byte_received = bridge_byte_received,
+};
+
+struct joybus_target_bridge_config joybus_target_bridge_config_default(enum joybus_target_bridge_mode mode)
+{
+  struct joybus_target_bridge_config config = {
+    .mode               = mode,
+    .max_age_us         = 500,
+    .n64_range          = 80,
+    .gcn_range          = 100,
+    .substick_threshold = 48,
+  };
+
+  if (mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+    // Indexed by N64 button bit, C buttons are handled as the C-stick
+    static const uint16_t n64_to_gcn[16] = {
+      JOYBUS_GCN_BUTTON_RIGHT, JOYBUS_GCN_BUTTON_LEFT, JOYBUS_GCN_BUTTON_DOWN, JOYBUS_GCN_BUTTON_UP,
+      JOYBUS_GCN_BUTTON_START, JOYBUS_GCN_BUTTON_Z,    JOYBUS_GCN_BUTTON_B,    JOYBUS_GCN_BUTTON_A,
+      0,                       0,                      0,                      0,
+      JOYBUS_GCN_BUTTON_R,     JOYBUS_GCN_BUTTON_L,    0,                      0,
+    };
+    memcpy(config.button_map, n64_to_gcn, sizeof(config.button_map));
+  } else {
+    // Indexed by GameCube button bit, X and Y stand in for C-down and C-left
+    static const uint16_t gcn_to_n64[16] = {
+      JOYBUS_N64_BUTTON_A,    JOYBUS_N64_BUTTON_B,     JOYBUS_N64_BUTTON_C_DOWN, JOYBUS_N64_BUTTON_C_LEFT,
+      JOYBUS_N64_BUTTON_START, 0,                      0,                        0,
+      JOYBUS_N64_BUTTON_LEFT, JOYBUS_N64_BUTTON_RIGHT, JOYBUS_N64_BUTTON_DOWN,   JOYBUS_N64_BUTTON_UP,
+      JOYBUS_N64_BUTTON_Z,    JOYBUS_N64_BUTTON_R,     JOYBUS_N64_BUTTON_L,      0,
+    };
+    memcpy(config.button_map, gcn_to_n64, sizeof(config.button_map));
+  }
+
+  return config;
+}
+
+int joybus_target_bridge_init(struct joybus_target_bridge *bridge, struct joybus *host_bus,
+                              struct joybus_target *target, struct joybus_target_bridge_config config)
+{
+  // The ranges divide each other in the stick table, and the GameCube range also offsets the C-stick
+  if (config.n64_range == 0 || config.n64_range > MAX_RANGE || config.gcn_range == 0 || config.gcn_range > MAX_RANGE)
+    return -JOYBUS_ERR_INVALID;
+
+  // Start from a clean state
+  memset(bridge, 0, sizeof(*bridge));
+
+  // Set the target callbacks
+  bridge->base.api = &bridge_api;
+  bridge->host_bus = host_bus;
+  bridge->target   = target;
+  bridge->config   = config;
+
+  // Build the button tables
+  joybus_build_button_lut(bridge->button_lut, config.button_map);
+
+  // Build the stick table
+  for (int value = 0; value < 256; value++) {
+    if (config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+      // Signed N64 position to a GameCube position centered at 0x80
+      int32_t delta           = scale((int8_t)value, config.gcn_range, config.n64_range);
+      bridge->axis_lut[value] = 0x80 + clamp_i32(delta, -127, 127);
+    } else {
+      // GameCube position centered at 0x80 to a signed N64 position
+      int32_t delta           = scale(value - 0x80, config.n64_range, config.gcn_range);
+      bridge->axis_lut[value] = (uint8_t)clamp_i32(delta, INT8_MIN, INT8_MAX);
+    }
+  }
+
+  // Start with the nominal read duration, and read the controller straight away
+  bridge->read_us = config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN ? N64_READ_US : GCN_READ_US;
+  bridge->polled  = true;
+
+  return 0;
+}
+
+void joybus_target_bridge_poll(struct joybus_target_bridge *bridge)
+{
+  if (bridge->read_busy)
+    return;
+
+  uint64_t now = joybus_clock_now_us(bridge->host_bus->clock);
+  if (now < bridge->next_read_us)
+    return;
+
+  // Read the controller into the upstream buffer
+  bridge->read_busy     = true;
+  bridge->read_start_us = now;
+  bridge->next_read_us  = UINT64_MAX;
+  bridge->polled        = false;
+  bridge->reads++;
+
+  int rc;
+  if (bridge->config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+    rc = joybus_n64_read_async(bridge->host_bus, &bridge->upstream.n64, read_cb, bridge);
+  } else {
+    rc = joybus_gcn_read_async(bridge->host_bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP,
+                               &bridge->upstream.gcn, read_cb, bridge);
+  }
+
+  // The callback won't fire if the transfer didn't start, try again at the next poll
+  if (rc < 0) {
+    bridge->read_busy    = false;
+    bridge->next_read_us = now;
+  }
+}
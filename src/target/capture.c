@@ -0,0 +1,220 @@
+#include <string.h>
+
+#include <joybus/errors.h>
+#include <joybus/target/capture.h>
+
+static const uint8_t capture_magic[4] = {'J', 'B', 'C', 'P'};
+
+// ---------------------------------------------------------------------------
+// Recorder
+// ---------------------------------------------------------------------------
+
+// Append the command in progress to the capture
+static void write_record(struct joybus_target_recorder *recorder)
+{
+  size_t needed = JOYBUS_CAPTURE_RECORD_LEN + recorder->command_len + recorder->response_len;
+  if (recorder->len + needed > recorder->size) {
+    recorder->dropped++;
+    return;
+  }
+
+  uint32_t delta = recorder->command_us - recorder->last_us;
+  uint8_t *dest  = &recorder->buf[recorder->len];
+  dest[0]        = delta;
+  dest[1]        = delta >> 8;
+  dest[2]        = delta >> 16;
+  dest[3]        = delta >> 24;
+  dest[4]        = recorder->command_len;
+  dest[5]        = recorder->response_len;
+  memcpy(&dest[JOYBUS_CAPTURE_RECORD_LEN], recorder->command, recorder->command_len);
+  memcpy(&dest[JOYBUS_CAPTURE_RECORD_LEN + recorder->command_len], recorder->response, recorder->response_len);
+
+  recorder->len    += needed;
+  recorder->last_us = recorder->command_us;
+  recorder->records++;
+}
+
+// Record the target's response on its way to the backend
+static void record_response(const uint8_t *response, uint8_t len, void *user_data)
+{
+  struct joybus_target_recorder *recorder = user_data;
+
+  memcpy(recorder->response, response, len);
+  recorder->response_len = len;
+
+  recorder->send_response(response, len, recorder->response_user_data);
+}
+
+JOYBUS_RAM_FUNC
+static int recorder_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
+                                  joybus_target_response_cb send_response, void *user_data)
+{
+  struct joybus_target_recorder *recorder = JOYBUS_TARGET_RECORDER(target);
+
+  // Start of a new command, the previous one is complete
+  if (bytes_read == 1) {
+    if (recorder->pending)
+      write_record(recorder);
+
+    recorder->command_us         = joybus_clock_now_us(recorder->bus->clock);
+    recorder->command_len        = 0;
+    recorder->response_len       = 0;
+    recorder->send_response      = send_response;
+    recorder->response_user_data = user_data;
+    recorder->pending            = true;
+  }
+
+  // Copy everything since the last call, a bulk payload arrives in one go
+  memcpy(&recorder->command[recorder->command_len], &command[recorder->command_len],
+         bytes_read - recorder->command_len);
+  recorder->command_len = bytes_read;
+
+  // Let the recorded target answer
+  return joybus_target_byte_received(recorder->target, command, bytes_read, record_response, recorder);
+}
+
+static const struct joybus_target_api recorder_api = {
+  .byte_received = recorder_byte_received,
+};
+
+int joybus_target_recorder_init(struct joybus_target_recorder *recorder, struct joybus *bus,
+                                struct joybus_target *target, uint8_t *buf, size_t size)
+{
+  // Start from a clean state
+  memset(recorder, 0, sizeof(*recorder));
+  recorder->base.api = &recorder_api;
+  recorder->bus      = bus;
+  recorder->target   = target;
+  recorder->buf      = buf;
+  recorder->size     = size;
+
+  if (size < JOYBUS_CAPTURE_HEADER_LEN)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  // Write the header
+  memset(buf, 0, JOYBUS_CAPTURE_HEADER_LEN);
+  memcpy(buf, capture_magic, sizeof(capture_magic));
+  buf[4]             = JOYBUS_CAPTURE_VERSION;
+  recorder->len      = JOYBUS_CAPTURE_HEADER_LEN;
+  recorder->start_us = joybus_clock_now_us(bus->clock);
+  recorder->last_us  = recorder->start_us;
+
+  return 0;
+}
+
+size_t joybus_target_recorder_finish(struct joybus_target_recorder *recorder)
+{
+  if (recorder->pending) {
+    write_record(recorder);
+    recorder->pending = false;
+  }
+
+  return recorder->len;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+int joybus_capture_reader_init(struct joybus_capture_reader *reader, const uint8_t *buf, size_t len)
+{
+  reader->buf     = buf;
+  reader->len     = len;
+  reader->pos     = JOYBUS_CAPTURE_HEADER_LEN;
+  reader->time_us = 0;
+
+  if (len < JOYBUS_CAPTURE_HEADER_LEN || memcmp(buf, capture_magic, sizeof(capture_magic)) != 0 ||
+      buf[4] != JOYBUS_CAPTURE_VERSION)
+    return -JOYBUS_ERR_INVALID;
+
+  return 0;
+}
+
+int joybus_capture_reader_next(struct joybus_capture_reader *reader, struct joybus_capture_record *record)
+{
+  if (reader->pos == reader->len)
+    return 0;
+
+  // The record header and its payload must both be there
+  const uint8_t *src = &reader->buf[reader->pos];
+  size_t remaining   = reader->len - reader->pos;
+  if (remaining < JOYBUS_CAPTURE_RECORD_LEN)
+    return -JOYBUS_ERR_INVALID;
+
+  uint8_t command_len  = src[4];
+  uint8_t response_len = src[5];
+  size_t record_len    = JOYBUS_CAPTURE_RECORD_LEN + command_len + response_len;
+  if (command_len == 0 || command_len > JOYBUS_BLOCK_SIZE || response_len > JOYBUS_BLOCK_SIZE ||
+      remaining < record_len)
+    return -JOYBUS_ERR_INVALID;
+
+  reader->time_us += src[0] | src[1] << 8 | src[2] << 16 | (uint32_t)src[3] << 24;
+  reader->pos     += record_len;
+
+  record->time_us      = reader->time_us;
+  record->command      = &src[JOYBUS_CAPTURE_RECORD_LEN];
+  record->command_len  = command_len;
+  record->response     = &src[JOYBUS_CAPTURE_RECORD_LEN + command_len];
+  record->response_len = response_len;
+
+  return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+static void replay_response(const uint8_t *response, uint8_t len, void *user_data)
+{
+  struct joybus_capture_result *result = user_data;
+
+  memcpy(result->response, response, len);
+  result->response_len = len;
+}
+
+int joybus_capture_replay(const uint8_t *buf, size_t len, struct joybus_target *target,
+                          const struct joybus_capture_replay_config *config)
+{
+  struct joybus_capture_reader reader;
+  int rc = joybus_capture_reader_init(&reader, buf, len);
+  if (rc < 0)
+    return rc;
+
+  int mismatches = 0;
+
+  struct joybus_capture_result result;
+  while ((rc = joybus_capture_reader_next(&reader, &result.record)) > 0) {
+    const struct joybus_capture_record *record = &result.record;
+
+    if (config->wait_until_us)
+      config->wait_until_us(record->time_us, config->user_data);
+
+    result.response_len = 0;
+    result.handler_ns   = 0;
+
+    // Deliver the command a byte at a time, as a backend would
+    uint8_t command[JOYBUS_BLOCK_SIZE];
+    for (uint8_t i = 1; i <= record->command_len; i++) {
+      command[i - 1] = record->command[i - 1];
+
+      uint64_t start = config->now_ns ? config->now_ns() : 0;
+      int remaining  = joybus_target_byte_received(target, command, i, replay_response, &result);
+      if (config->now_ns)
+        result.handler_ns += config->now_ns() - start;
+
+      // Target rejected the command, or wanted fewer bytes than were recorded
+      if (remaining <= 0)
+        break;
+    }
+
+    result.match = result.response_len == record->response_len &&
+                   memcmp(result.response, record->response, record->response_len) == 0;
+    if (!result.match)
+      mismatches++;
+
+    if (config->on_result)
+      config->on_result(&result, config->user_data);
+  }
+
+  return rc < 0 ? rc : mismatches;
+}
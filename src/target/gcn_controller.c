@@ -5,6 +5,7 @@
 #include <joybus/identify.h>
 #include <joybus/target/gcn_controller.h>
 
+#if JOYBUS_USE_GCN_ANALOG_MODES
 /*
  * Pack a "full" input state into a "short" 8-byte input state, depending on the
  * analog mode. See enum joybus_gcn_analog_mode for more details.
@@ -51,6 +52,7 @@ static inline uint8_t *pack_input_state(uint8_t *dest, const struct joybus_gcn_c
 
   return dest;
 }
+#endif
 
 // Set or clear the "need origin" flag in the input state and device ID
 static inline void set_need_origin(struct joybus_target_gcn_controller *controller, bool need_origin)
@@ -72,6 +74,53 @@ static inline void set_need_origin(struct joybus_target_gcn_controller *controll
   }
 }
 
+// Update the analog values of the origin, and flag it if they changed
+static inline void update_origin(struct joybus_target_gcn_controller *controller,
+                                 const struct joybus_gcn_controller_state *new_origin)
+{
+  // Check if the analog values in the new origin differ from the current origin
+  if (memcmp(&controller->origin.stick_x, &new_origin->stick_x, 6) != 0) {
+    // Update the origin state
+    memcpy(&controller->origin.stick_x, &new_origin->stick_x, 6);
+
+    // Tell the host that new origin data is available
+    set_need_origin(controller, true);
+  }
+
+  // Set the "has wireless origin" flag in the device ID
+  if (joybus_target_gcn_controller_is_wireless(controller))
+    joybus_id_set_type_flags(&controller->id, JOYBUS_TYPE_GCN_WIRELESS_ORIGIN);
+}
+
+// Report a new motor state to the callback, and to the motor mailbox
+static inline void motor_state_changed(struct joybus_target_gcn_controller *controller, uint8_t motor_state)
+{
+  if (controller->on_motor_state_change)
+    controller->on_motor_state_change(controller, motor_state);
+
+#if JOYBUS_USE_MAILBOXES
+  joybus_mailbox_put(&controller->motor_mailbox, &motor_state);
+#endif
+}
+
+#if JOYBUS_USE_MAILBOXES
+// Pick up the input state and origin last published from another core
+static inline void take_published_state(struct joybus_target_gcn_controller *controller)
+{
+  struct joybus_gcn_controller_state state;
+
+  if (joybus_mailbox_get(&controller->origin_mailbox, &state))
+    update_origin(controller, &state);
+
+  if (joybus_mailbox_get(&controller->input_mailbox, &state)) {
+    // Keep the origin flags, which are owned by the controller
+    state.buttons = (state.buttons & JOYBUS_GCN_BUTTON_MASK) | (controller->input.buttons & ~JOYBUS_GCN_BUTTON_MASK);
+    controller->input       = state;
+    controller->input_valid = true;
+  }
+}
+#endif
+
 /**
  * Handle "reset" commands.
  *
@@ -90,8 +139,7 @@ static inline int handle_reset(struct joybus_target_gcn_controller *controller,
     controller->on_reset(controller);
 
   // Stop the rumble motor
-  if (controller->on_motor_state_change)
-    controller->on_motor_state_change(controller, JOYBUS_GCN_MOTOR_STOP);
+  motor_state_changed(controller, JOYBUS_GCN_MOTOR_STOP);
 
   return 0;
 }
@@ -130,12 +178,16 @@ static inline int handle_read(struct joybus_target_gcn_controller *controller, c
     // Respond with the appropriate input state
     // Most games use analog mode 3, which is just the first 8 bytes of the full input state
     // Otherwise, pack the input state based on the analog mode
+#if JOYBUS_USE_GCN_ANALOG_MODES
     enum joybus_gcn_analog_mode analog_mode = command[1];
     if (analog_mode == JOYBUS_GCN_ANALOG_MODE_3) {
       send_response((uint8_t *)input, JOYBUS_CMD_GCN_READ_RX, user_data);
     } else {
       send_response(pack_input_state(controller->packed_input, input, analog_mode), JOYBUS_CMD_GCN_READ_RX, user_data);
     }
+#else
+    send_response((uint8_t *)input, JOYBUS_CMD_GCN_READ_RX, user_data);
+#endif
   } else if (bytes_read == JOYBUS_CMD_GCN_READ_TX) {
     // Save origin flags and state
     enum joybus_gcn_analog_mode analog_mode = command[1];
@@ -153,9 +205,9 @@ static inline int handle_read(struct joybus_target_gcn_controller *controller, c
                                    JOYBUS_STATUS_GCN_MOTOR_STATE_MASK | JOYBUS_STATUS_GCN_ANALOG_MODE_MASK);
       joybus_id_set_status_flags(&controller->id, motor_state << JOYBUS_STATUS_GCN_MOTOR_STATE_SHIFT | analog_mode);
 
-      // If motor state has changed, call the motor state change callback
-      if (last_motor_state != motor_state && controller->on_motor_state_change)
-        controller->on_motor_state_change(controller, motor_state);
+      // If motor state has changed, report it
+      if (last_motor_state != motor_state)
+        motor_state_changed(controller, motor_state);
     }
   }
 
@@ -204,6 +256,7 @@ static inline int handle_calibrate(struct joybus_target_gcn_controller *controll
   return JOYBUS_CMD_GCN_CALIBRATE_TX - bytes_read;
 }
 
+#if JOYBUS_USE_GCN_READ_LONG
 /**
  * Handle "long read" commands, to fetch the current input state with full precision.
  *
@@ -241,15 +294,17 @@ static inline int handle_read_long(struct joybus_target_gcn_controller *controll
                                    JOYBUS_STATUS_GCN_MOTOR_STATE_MASK | JOYBUS_STATUS_GCN_ANALOG_MODE_MASK);
       joybus_id_set_status_flags(&controller->id, motor_state << JOYBUS_STATUS_GCN_MOTOR_STATE_SHIFT | analog_mode);
 
-      // If motor state has changed, call the motor state change callback
-      if (last_motor_state != motor_state && controller->on_motor_state_change)
-        controller->on_motor_state_change(controller, motor_state);
+      // If motor state has changed, report it
+      if (last_motor_state != motor_state)
+        motor_state_changed(controller, motor_state);
     }
   }
 
   return JOYBUS_CMD_GCN_READ_LONG_TX - bytes_read;
 }
+#endif
 
+#if JOYBUS_USE_GCN_WAVEBIRD
 /**
  * Handle "probe device" commands.
  *
@@ -308,12 +363,20 @@ static inline int handle_fix_device(struct joybus_target_gcn_controller *control
 
   return JOYBUS_CMD_GCN_FIX_DEVICE_TX - bytes_read;
 }
+#endif
 
 JOYBUS_RAM_FUNC
 static int gcn_controller_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
                                         joybus_target_response_cb send_response, void *user_data)
 {
   struct joybus_target_gcn_controller *controller = JOYBUS_TARGET_GCN_CONTROLLER(target);
+
+#if JOYBUS_USE_MAILBOXES
+  // Pick up published state before handling a new command
+  if (bytes_read == 1)
+    take_published_state(controller);
+#endif
+
   switch (command[0]) {
     case JOYBUS_CMD_RESET:
       return handle_reset(controller, command, bytes_read, send_response, user_data);
@@ -325,12 +388,16 @@ static int gcn_controller_byte_received(struct joybus_target *target, const uint
       return handle_read_origin(controller, command, bytes_read, send_response, user_data);
     case JOYBUS_CMD_GCN_CALIBRATE:
       return handle_calibrate(controller, command, bytes_read, send_response, user_data);
+#if JOYBUS_USE_GCN_READ_LONG
     case JOYBUS_CMD_GCN_READ_LONG:
       return handle_read_long(controller, command, bytes_read, send_response, user_data);
+#endif
+#if JOYBUS_USE_GCN_WAVEBIRD
     case JOYBUS_CMD_GCN_PROBE_DEVICE:
       return handle_probe_device(controller, command, bytes_read, send_response, user_data);
     case JOYBUS_CMD_GCN_FIX_DEVICE:
       return handle_fix_device(controller, command, bytes_read, send_response, user_data);
+#endif
   }
 
   return -JOYBUS_ERR_NOT_SUPPORTED;
@@ -363,6 +430,12 @@ void joybus_target_gcn_controller_init_with_type(struct joybus_target_gcn_contro
 
   // Mark the input as valid initially
   controller->input_valid = true;
+
+#if JOYBUS_USE_MAILBOXES
+  joybus_mailbox_init(&controller->input_mailbox, controller->input_slots, sizeof(controller->input_slots[0]));
+  joybus_mailbox_init(&controller->origin_mailbox, controller->origin_slots, sizeof(controller->origin_slots[0]));
+  joybus_mailbox_init(&controller->motor_mailbox, controller->motor_slots, sizeof(controller->motor_slots[0]));
+#endif
 }
 
 void joybus_target_gcn_controller_set_reset_cb(struct joybus_target_gcn_controller *controller,
@@ -377,6 +450,7 @@ void joybus_target_gcn_controller_set_motor_cb(struct joybus_target_gcn_controll
   controller->on_motor_state_change = callback;
 }
 
+#if JOYBUS_USE_GCN_WAVEBIRD
 void joybus_target_gcn_controller_set_wireless_id(struct joybus_target_gcn_controller *controller, uint16_t wireless_id)
 {
   if (joybus_target_gcn_controller_wireless_id_fixed(controller))
@@ -388,20 +462,24 @@ void joybus_target_gcn_controller_set_wireless_id(struct joybus_target_gcn_contr
   // Update other controller ID flags
   joybus_id_set_type_flags(&controller->id, JOYBUS_TYPE_GCN_STANDARD | JOYBUS_TYPE_GCN_WIRELESS_RECEIVED);
 }
+#endif
 
 void joybus_target_gcn_controller_set_origin(struct joybus_target_gcn_controller *controller,
                                              struct joybus_gcn_controller_state *new_origin)
 {
-  // Check if the analog values in the new origin differ from the current origin
-  if (memcmp(&controller->origin.stick_x, &new_origin->stick_x, 6) != 0) {
-    // Update the origin state
-    memcpy(&controller->origin.stick_x, &new_origin->stick_x, 6);
+  update_origin(controller, new_origin);
+}
 
-    // Tell the host that new origin data is available
-    set_need_origin(controller, true);
-  }
+#if JOYBUS_USE_MAILBOXES
+void joybus_target_gcn_controller_publish_input(struct joybus_target_gcn_controller *controller,
+                                                const struct joybus_gcn_controller_state *input)
+{
+  joybus_mailbox_put(&controller->input_mailbox, input);
+}
 
-  // Set the "has wireless origin" flag in the device ID
-  if (joybus_target_gcn_controller_is_wireless(controller))
-    joybus_id_set_type_flags(&controller->id, JOYBUS_TYPE_GCN_WIRELESS_ORIGIN);
+void joybus_target_gcn_controller_publish_origin(struct joybus_target_gcn_controller *controller,
+                                                 const struct joybus_gcn_controller_state *origin)
+{
+  joybus_mailbox_put(&controller->origin_mailbox, origin);
 }
+#endif
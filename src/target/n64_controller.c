@@ -14,7 +14,11 @@
 // An pak is "ready" when it is present and pak changed flag has been cleared
 static inline bool pak_ready(struct joybus_target_n64_controller *controller)
 {
+#if JOYBUS_USE_N64_PAKS
   return controller->pak && !joybus_id_n64_pak_changed(&controller->id);
+#else
+  return false;
+#endif
 }
 
 // Sample the current input as the origin
@@ -148,6 +152,7 @@ static int handle_pak_read(struct joybus_target_n64_controller *controller, cons
   }
 
   // Prepare and send the response
+#if JOYBUS_USE_N64_PAKS
   if (pak_ready(controller) && checksum_valid) {
     // Ask the pak to fill the response buffer
     uint16_t block_addr               = addr & 0xFFE0;
@@ -159,14 +164,16 @@ static int handle_pak_read(struct joybus_target_n64_controller *controller, cons
 
     // Send the response
     send_response(controller->response, JOYBUS_CMD_N64_PAK_READ_RX, user_data);
-  } else {
-    // Prepare a zero response with the "no pak" CRC
-    memset(controller->response, 0, JOYBUS_CMD_N64_PAK_READ_RX);
-    controller->response[JOYBUS_PAK_BLOCK_SIZE] = 0xFF;
-
-    // Send the response
-    send_response(controller->response, JOYBUS_CMD_N64_PAK_READ_RX, user_data);
+    return 0;
   }
+#endif
+
+  // Prepare a zero response with the "no pak" CRC
+  memset(controller->response, 0, JOYBUS_CMD_N64_PAK_READ_RX);
+  controller->response[JOYBUS_PAK_BLOCK_SIZE] = 0xFF;
+
+  // Send the response
+  send_response(controller->response, JOYBUS_CMD_N64_PAK_READ_RX, user_data);
 
   return 0;
 }
@@ -181,7 +188,11 @@ static int handle_pak_read(struct joybus_target_n64_controller *controller, cons
 static int handle_pak_write(struct joybus_target_n64_controller *controller, const uint8_t *command, uint8_t bytes_read,
                             joybus_target_response_cb send_response, void *user_data)
 {
-  // First 3 bytes are command and address
+  // Wait for the command and address
+  if (bytes_read < 3)
+    return JOYBUS_CMD_N64_PAK_WRITE_TX - bytes_read;
+
+  // Check the address once it's in, then take the payload in one go
   if (bytes_read == 3) {
     // Extract the address from the command
     uint16_t addr = ((uint16_t)command[1] << 8) | command[2];
@@ -193,38 +204,47 @@ static int handle_pak_write(struct joybus_target_n64_controller *controller, con
       joybus_id_set_status_flags(&controller->id, JOYBUS_STATUS_N64_ADDR_CHECKSUM_ERROR);
     }
 
-    // Reset the running CRC for the payload bytes
-    controller->crc = 0;
+    controller->crc     = 0;
+    controller->crc_len = 0;
+  }
 
-    return JOYBUS_CMD_N64_PAK_WRITE_TX - bytes_read;
+  // Fold in the payload bytes that arrived since the last call. Backends without bulk reception deliver them one at a
+  // time, which keeps the CRC off the response critical path, a bulk receive hands over the whole block at once
+  uint8_t payload_len = bytes_read - 3;
+  if (controller->crc_len == 0 && payload_len == JOYBUS_PAK_BLOCK_SIZE) {
+    controller->crc = joybus_data_checksum(&command[3], JOYBUS_PAK_BLOCK_SIZE);
+  } else {
+    for (uint8_t i = controller->crc_len; i < payload_len; i++)
+      controller->crc = joybus_data_checksum_update(controller->crc, command[3 + i]);
   }
+  controller->crc_len = payload_len;
 
-  // Subsequent bytes are payload, accumulate the checksum
-  controller->crc = joybus_data_checksum_update(controller->crc, command[bytes_read - 1]);
+  if (bytes_read < JOYBUS_CMD_N64_PAK_WRITE_TX)
+    return JOYBUS_TARGET_BULK(JOYBUS_CMD_N64_PAK_WRITE_TX - bytes_read);
 
-  // Full payload received, respond with the CRC
-  if (bytes_read == JOYBUS_CMD_N64_PAK_WRITE_TX) {
-    bool checksum_valid = (controller->id.status & JOYBUS_STATUS_N64_ADDR_CHECKSUM_ERROR) == 0;
-    bool ready          = pak_ready(controller) && checksum_valid;
+  // Full payload received, respond with its CRC
+  bool checksum_valid = (controller->id.status & JOYBUS_STATUS_N64_ADDR_CHECKSUM_ERROR) == 0;
+  bool ready          = pak_ready(controller) && checksum_valid;
 
-    // Mark the CRC as "no pak" if we're not ready to commit the write
-    if (!ready) {
-      controller->crc ^= 0xFF;
-    }
+  // Mark the CRC as "no pak" if we're not ready to commit the write
+  if (!ready) {
+    controller->crc ^= 0xFF;
+  }
 
-    // Send the CRC response first to keep the storage write off the response critical path
-    send_response(&controller->crc, JOYBUS_CMD_N64_PAK_WRITE_RX, user_data);
+  // Send the CRC response first to keep the storage write off the response critical path
+  send_response(&controller->crc, JOYBUS_CMD_N64_PAK_WRITE_RX, user_data);
 
-    // Hand the payload to the pak after the host has its response
-    if (ready) {
-      uint16_t addr                     = ((uint16_t)command[1] << 8) | command[2];
-      uint16_t block_addr               = addr & 0xFFE0;
-      struct joybus_target_n64_pak *acc = controller->pak;
-      acc->api->write_block(acc, block_addr, &command[3]);
-    }
+#if JOYBUS_USE_N64_PAKS
+  // Hand the payload to the pak after the host has its response
+  if (ready) {
+    uint16_t addr                     = ((uint16_t)command[1] << 8) | command[2];
+    uint16_t block_addr               = addr & 0xFFE0;
+    struct joybus_target_n64_pak *acc = controller->pak;
+    acc->api->write_block(acc, block_addr, &command[3]);
   }
+#endif
 
-  return JOYBUS_CMD_N64_PAK_WRITE_TX - bytes_read;
+  return 0;
 }
 
 JOYBUS_RAM_FUNC
@@ -232,6 +252,13 @@ static int n64_controller_byte_received(struct joybus_target *target, const uint
                                         joybus_target_response_cb send_response, void *user_data)
 {
   struct joybus_target_n64_controller *controller = JOYBUS_TARGET_N64_CONTROLLER(target);
+
+#if JOYBUS_USE_MAILBOXES
+  // Pick up the input state last published from another core before handling a new command
+  if (bytes_read == 1)
+    joybus_mailbox_get(&controller->input_mailbox, &controller->input);
+#endif
+
   switch (command[0]) {
     case JOYBUS_CMD_RESET:
       return handle_reset(controller, command, bytes_read, send_response, user_data);
@@ -264,6 +291,10 @@ void joybus_target_n64_controller_init(struct joybus_target_n64_controller *cont
   // Initialize the controller ID
   joybus_id_set_type_flags(&controller->id, JOYBUS_DEVICE_N64_CONTROLLER);
   joybus_id_set_status_flags(&controller->id, JOYBUS_STATUS_N64_PAK_PULLED);
+
+#if JOYBUS_USE_MAILBOXES
+  joybus_mailbox_init(&controller->input_mailbox, controller->input_slots, sizeof(controller->input_slots[0]));
+#endif
 }
 
 void joybus_target_n64_controller_set_reset_cb(struct joybus_target_n64_controller *controller,
@@ -272,6 +303,7 @@ void joybus_target_n64_controller_set_reset_cb(struct joybus_target_n64_controll
   controller->on_reset = callback;
 }
 
+#if JOYBUS_USE_N64_PAKS
 void joybus_target_n64_controller_attach_pak(struct joybus_target_n64_controller *controller,
                                              struct joybus_target_n64_pak *pak)
 {
@@ -295,8 +327,17 @@ void joybus_target_n64_controller_detach_pak(struct joybus_target_n64_controller
   joybus_id_clear_status_flags(&controller->id, JOYBUS_STATUS_N64_PAK_PRESENT);
   joybus_id_set_status_flags(&controller->id, JOYBUS_STATUS_N64_PAK_PULLED);
 }
+#endif
 
 void joybus_target_n64_controller_calibrate(struct joybus_target_n64_controller *controller)
 {
   n64_controller_recalibrate(controller);
 }
+
+#if JOYBUS_USE_MAILBOXES
+void joybus_target_n64_controller_publish_input(struct joybus_target_n64_controller *controller,
+                                                const struct joybus_n64_controller_state *input)
+{
+  joybus_mailbox_put(&controller->input_mailbox, input);
+}
+#endif
@@ -0,0 +1,290 @@
+#include <string.h>
+
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/common/gcn_controller.h>
+#include <joybus/common/n64_controller.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/playback.h>
+
+#define RING_MASK (JOYBUS_TARGET_PLAYBACK_RING_LEN - 1)
+
+_Static_assert((JOYBUS_TARGET_PLAYBACK_RING_LEN & RING_MASK) == 0, "ring length must be a power of two");
+_Static_assert(JOYBUS_TARGET_PLAYBACK_RING_LEN <= 128, "ring counters are 8 bits");
+
+static const uint8_t stream_magic[4] = {'J', 'B', 'P', 'S'};
+
+static inline uint8_t frame_len(enum joybus_playback_device device)
+{
+  return device == JOYBUS_PLAYBACK_GCN ? sizeof(struct joybus_gcn_controller_state)
+                                       : sizeof(struct joybus_n64_controller_state);
+}
+
+// Size of the changed byte mask in a delta record
+static inline int mask_len(uint8_t frame_len)
+{
+  return (frame_len + 7) / 8;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+static int put_byte(struct joybus_playback_encoder *encoder, uint8_t byte)
+{
+  if (encoder->len >= encoder->size)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  encoder->buf[encoder->len++] = byte;
+  return 0;
+}
+
+// Write out any pending run of repeated frames
+static int flush_run(struct joybus_playback_encoder *encoder)
+{
+  if (encoder->run == 0)
+    return 0;
+
+  int rc = put_byte(encoder, encoder->run - 1);
+  if (rc == 0)
+    encoder->run = 0;
+
+  return rc;
+}
+
+int joybus_playback_encoder_init(struct joybus_playback_encoder *encoder, enum joybus_playback_device device,
+                                 uint8_t *buf, size_t size)
+{
+  memset(encoder, 0, sizeof(*encoder));
+  encoder->buf       = buf;
+  encoder->size      = size;
+  encoder->frame_len = frame_len(device);
+
+  if (size < JOYBUS_PLAYBACK_HEADER_LEN)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  // Write the header
+  memset(buf, 0, JOYBUS_PLAYBACK_HEADER_LEN);
+  memcpy(buf, stream_magic, sizeof(stream_magic));
+  buf[4]       = JOYBUS_PLAYBACK_VERSION;
+  buf[5]       = device;
+  encoder->len = JOYBUS_PLAYBACK_HEADER_LEN;
+
+  return 0;
+}
+
+int joybus_playback_encoder_add(struct joybus_playback_encoder *encoder, const void *frame)
+{
+  const uint8_t *bytes = frame;
+
+  // Work out which bytes changed
+  uint16_t mask = 0;
+  for (int i = 0; i < encoder->frame_len; i++) {
+    if (bytes[i] != encoder->prev[i])
+      mask |= 1 << i;
+  }
+
+  // Same as the previous frame, extend the run
+  if (mask == 0) {
+    if (encoder->run == JOYBUS_PLAYBACK_RUN_MAX) {
+      int rc = flush_run(encoder);
+      if (rc < 0)
+        return rc;
+    }
+
+    encoder->run++;
+    return 0;
+  }
+
+  // Write the changed bytes, the whole record must fit
+  size_t needed = (encoder->run ? 1 : 0) + 1 + mask_len(encoder->frame_len) + __builtin_popcount(mask);
+  if (encoder->len + needed > encoder->size)
+    return -JOYBUS_ERR_NO_SPACE;
+
+  flush_run(encoder);
+  put_byte(encoder, JOYBUS_PLAYBACK_TAG_DELTA);
+  for (int i = 0; i < mask_len(encoder->frame_len); i++)
+    put_byte(encoder, mask >> (8 * i));
+  for (int i = 0; i < encoder->frame_len; i++) {
+    if (mask & (1 << i))
+      put_byte(encoder, bytes[i]);
+  }
+
+  memcpy(encoder->prev, bytes, encoder->frame_len);
+
+  return 0;
+}
+
+int joybus_playback_encoder_finish(struct joybus_playback_encoder *encoder)
+{
+  int rc = flush_run(encoder);
+  if (rc < 0)
+    return rc;
+
+  rc = put_byte(encoder, JOYBUS_PLAYBACK_TAG_END);
+  if (rc < 0)
+    return rc;
+
+  return encoder->len;
+}
+
+// ---------------------------------------------------------------------------
+// Decoder
+// ---------------------------------------------------------------------------
+
+// Decode the next frame into the previous frame buffer
+static bool decode_frame(struct joybus_target_playback *playback)
+{
+  if (playback->run) {
+    playback->run--;
+    return true;
+  }
+
+  if (playback->decoded)
+    return false;
+
+  const uint8_t *stream = playback->stream;
+  size_t len            = playback->stream_len;
+  size_t pos            = playback->pos;
+
+  uint8_t tag = pos < len ? stream[pos++] : JOYBUS_PLAYBACK_TAG_END;
+  if (tag < JOYBUS_PLAYBACK_TAG_DELTA) {
+    // Run of repeated frames, this is the first of them
+    playback->run = tag;
+  } else if (tag == JOYBUS_PLAYBACK_TAG_DELTA && pos + mask_len(playback->frame_len) <= len) {
+    // Changed frame
+    uint16_t mask = 0;
+    for (int i = 0; i < mask_len(playback->frame_len); i++)
+      mask |= stream[pos++] << (8 * i);
+
+    for (int i = 0; i < playback->frame_len; i++) {
+      if (!(mask & (1 << i)))
+        continue;
+
+      if (pos >= len) {
+        playback->corrupt = true;
+        break;
+      }
+
+      playback->prev[i] = stream[pos++];
+    }
+  } else {
+    // End of stream, anything else is malformed
+    playback->corrupt = tag != JOYBUS_PLAYBACK_TAG_END;
+  }
+
+  playback->pos = pos;
+
+  if (tag == JOYBUS_PLAYBACK_TAG_END || playback->corrupt) {
+    playback->decoded = true;
+    return false;
+  }
+
+  return true;
+}
+
+int joybus_target_playback_fill(struct joybus_target_playback *playback)
+{
+  int decoded = 0;
+
+  while ((uint8_t)(playback->head - playback->tail) < JOYBUS_TARGET_PLAYBACK_RING_LEN && decode_frame(playback)) {
+    memcpy(playback->ring[playback->head & RING_MASK], playback->prev, playback->frame_len);
+
+    // Publish the frame only once it has been written
+    __atomic_signal_fence(__ATOMIC_RELEASE);
+    playback->head++;
+    decoded++;
+  }
+
+  return decoded;
+}
+
+// ---------------------------------------------------------------------------
+// Target
+// ---------------------------------------------------------------------------
+
+// Replace the controller's input with a frame
+static void apply_frame(struct joybus_target_playback *playback, const uint8_t *frame)
+{
+  if (playback->device == JOYBUS_PLAYBACK_GCN) {
+    struct joybus_target_gcn_controller *controller = JOYBUS_TARGET_GCN_CONTROLLER(playback->target);
+    struct joybus_gcn_controller_state state;
+    memcpy(&state, frame, sizeof(state));
+
+    // Keep the origin flags owned by the target
+    uint16_t flags    = controller->input.buttons & ~JOYBUS_GCN_BUTTON_MASK;
+    state.buttons     = flags | (state.buttons & JOYBUS_GCN_BUTTON_MASK);
+    controller->input = state;
+  } else {
+    memcpy(&JOYBUS_TARGET_N64_CONTROLLER(playback->target)->input, frame, sizeof(struct joybus_n64_controller_state));
+  }
+}
+
+// Whether a command reads the controller's input
+static inline bool is_input_read(struct joybus_target_playback *playback, uint8_t command)
+{
+  if (playback->device == JOYBUS_PLAYBACK_GCN)
+    return command == JOYBUS_CMD_GCN_READ || command == JOYBUS_CMD_GCN_READ_LONG;
+
+  return command == JOYBUS_CMD_N64_READ;
+}
+
+JOYBUS_RAM_FUNC
+static int playback_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
+                                  joybus_target_response_cb send_response, void *user_data)
+{
+  struct joybus_target_playback *playback = JOYBUS_TARGET_PLAYBACK(target);
+
+  // Advance to the next frame as soon as a read starts
+  if (bytes_read == 1 && is_input_read(playback, command[0])) {
+    uint8_t tail = playback->tail;
+    if (tail != playback->head) {
+      __atomic_signal_fence(__ATOMIC_ACQUIRE);
+      apply_frame(playback, playback->ring[tail & RING_MASK]);
+      playback->tail = tail + 1;
+      playback->frames++;
+    } else if (!playback->decoded) {
+      // Decoder fell behind, the previous frame is served again
+      playback->underruns++;
+    }
+  }
+
+  // Let the controller target answer
+  return joybus_target_byte_received(playback->target, command, bytes_read, send_response, user_data);
+}
+
+static const struct joybus_target_api playback_api = {
+  .byte_received = playback_byte_received,
+};
+
+int joybus_target_playback_init(struct joybus_target_playback *playback, struct joybus_target *target,
+                                const uint8_t *stream, size_t len)
+{
+  // Start from a clean state
+  memset(playback, 0, sizeof(*playback));
+  playback->base.api   = &playback_api;
+  playback->target     = target;
+  playback->stream     = stream;
+  playback->stream_len = len;
+  playback->pos        = JOYBUS_PLAYBACK_HEADER_LEN;
+
+  // Check the header
+  if (len < JOYBUS_PLAYBACK_HEADER_LEN || memcmp(stream, stream_magic, sizeof(stream_magic)) != 0 ||
+      stream[4] != JOYBUS_PLAYBACK_VERSION || stream[5] > JOYBUS_PLAYBACK_GCN) {
+    playback->decoded = true;
+    playback->corrupt = true;
+    return -JOYBUS_ERR_INVALID;
+  }
+
+  playback->device    = stream[5];
+  playback->frame_len = frame_len(playback->device);
+
+  // The controller has input to serve from the first read
+  if (playback->device == JOYBUS_PLAYBACK_GCN)
+    joybus_target_gcn_controller_input_valid(JOYBUS_TARGET_GCN_CONTROLLER(target), true);
+
+  joybus_target_playback_fill(playback);
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/target/relay.h>
+
+// Default longest acceptable turnaround, about two byte times at the controller's rate plus some slack
+#define DEFAULT_REPLY_DEADLINE_US 100
+
+// Command and response lengths of a known command
+struct command_info {
+  uint8_t command;
+  uint8_t tx_len;
+  uint8_t rx_len;
+};
+
+#define COMMAND_INFO(name) {JOYBUS_CMD_##name, JOYBUS_CMD_##name##_TX, JOYBUS_CMD_##name##_RX}
+
+static const struct command_info commands[] = {
+  COMMAND_INFO(RESET),
+  COMMAND_INFO(IDENTIFY),
+  COMMAND_INFO(N64_READ),
+  COMMAND_INFO(N64_PAK_READ),
+  COMMAND_INFO(N64_PAK_WRITE),
+  COMMAND_INFO(N64_EEPROM_READ),
+  COMMAND_INFO(N64_EEPROM_WRITE),
+  COMMAND_INFO(N64_RTC_INFO),
+  COMMAND_INFO(N64_RTC_READ),
+  COMMAND_INFO(N64_RTC_WRITE),
+  COMMAND_INFO(N64_KEYBOARD_READ),
+  COMMAND_INFO(GBA_READ),
+  COMMAND_INFO(GBA_WRITE),
+  COMMAND_INFO(PIXELFX_GAMEID),
+  COMMAND_INFO(GCN_READ),
+  COMMAND_INFO(GCN_READ_ORIGIN),
+  COMMAND_INFO(GCN_CALIBRATE),
+  COMMAND_INFO(GCN_READ_LONG),
+  COMMAND_INFO(GCN_PROBE_DEVICE),
+  COMMAND_INFO(GCN_FIX_DEVICE),
+  COMMAND_INFO(GCN_KEYBOARD_READ),
+};
+
+static const struct command_info *find_command(uint8_t command)
+{
+  for (unsigned i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    if (commands[i].command == command)
+      return &commands[i];
+  }
+
+  return NULL;
+}
+
+// Whether downstream command byte k would be sent before it arrives, when forwarding after j bytes.
+//
+// Downstream byte k starts k host byte times after console byte j-1 arrived, while console byte k arrives k-j+1
+// console byte times after it. A bit time is kept to spare.
+static bool byte_late(unsigned k, unsigned j, uint64_t console_byte_ns, uint64_t host_byte_ns)
+{
+  return (k + 1 - j) * console_byte_ns + console_byte_ns / 8 > k * host_byte_ns;
+}
+
+// Work out how many command bytes must arrive before a command of each length can be forwarded
+static void build_forward_table(struct joybus_target_relay *relay)
+{
+  uint64_t console_byte_ns = 8000000000ULL / relay->config.console_freq;
+  uint64_t host_byte_ns    = 8000000000ULL / relay->host_bus->freq;
+
+  for (unsigned len = 1; len <= JOYBUS_BLOCK_SIZE; len++) {
+    // Lateness is linear in k, so checking the first and last bytes still to arrive covers them all
+    unsigned j = 1;
+    while (j < len && (byte_late(j, j, console_byte_ns, host_byte_ns) ||
+                       byte_late(len - 1, j, console_byte_ns, host_byte_ns)))
+      j++;
+
+    relay->forward_at[len] = j;
+  }
+}
+
+// Rewrite response bytes up to, but not including, the given index
+static void rewrite_until(struct joybus_target_relay *relay, uint8_t end)
+{
+  for (; relay->rewritten < end; relay->rewritten++) {
+    uint8_t idx = relay->rewritten;
+    relay->reply[idx] =
+      relay->config.rewrite ? relay->config.rewrite(relay->command, relay->response, idx, relay->config.user_data)
+                            : relay->response[idx];
+  }
+}
+
+// Handle a response byte arriving from the controller
+static void relay_rx_byte(struct joybus *bus, uint8_t idx, void *user_data)
+{
+  struct joybus_target_relay *relay = user_data;
+  relay->received                   = idx + 1;
+
+  // Rewrite every byte whose lookahead has arrived, and the rest once the response is complete
+  uint8_t lag = relay->config.reply_lag;
+  if (relay->received == relay->rx_len) {
+    rewrite_until(relay, relay->rx_len);
+  } else if (relay->received >= lag) {
+    rewrite_until(relay, relay->received - lag + 1);
+  }
+
+  if (relay->replying || relay->rewritten == 0)
+    return;
+
+  // Start the reply, later bytes are filled in as they arrive
+  uint32_t turnaround       = joybus_clock_now_us(relay->console_bus->clock) - relay->command_end_us;
+  relay->replying           = true;
+  relay->last_turnaround_us = turnaround;
+  if (turnaround > relay->max_turnaround_us)
+    relay->max_turnaround_us = turnaround;
+  if (turnaround > relay->config.reply_deadline_us)
+    relay->late_replies++;
+
+  relay->send_response(relay->reply, relay->rx_len, relay->response_user_data);
+}
+
+// Handle the end of a downstream transfer, the console bus gives up on a reply that won't come by itself
+static void relay_transfer_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_target_relay *relay = user_data;
+
+  if (status == 0) {
+    relay->relayed++;
+  } else {
+    relay->dropped++;
+  }
+}
+
+static int relay_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t bytes_read,
+                               joybus_target_response_cb send_response, void *user_data)
+{
+  struct joybus_target_relay *relay = JOYBUS_TARGET_RELAY(target);
+
+  // Start of a new command, look up its lengths
+  if (bytes_read == 1) {
+    const struct command_info *info = find_command(command[0]);
+    if (!info)
+      return -JOYBUS_ERR_NOT_SUPPORTED;
+
+    relay->command            = command;
+    relay->tx_len             = info->tx_len;
+    relay->rx_len             = info->rx_len;
+    relay->send_response      = send_response;
+    relay->response_user_data = user_data;
+    relay->received           = 0;
+    relay->rewritten          = 0;
+    relay->replying           = false;
+  }
+
+  // Forward the command, while the rest of it is still arriving if the host bus reads each byte as it sends it
+  if (bytes_read == relay->forward_at[relay->tx_len]) {
+    int rc = joybus_transfer(relay->host_bus, command, relay->tx_len, relay->response, relay->rx_len, relay_transfer_cb,
+                             relay);
+    if (rc < 0) {
+      relay->dropped++;
+      return rc;
+    }
+  }
+
+  if (bytes_read < relay->tx_len)
+    return relay->tx_len - bytes_read;
+
+  // The reply is sent once the controller starts answering
+  relay->command_end_us = joybus_clock_now_us(relay->console_bus->clock);
+
+  return 0;
+}
+
+static const struct joybus_target_api relay_api = {
+  .byte_received = relay_byte_received,
+};
+
+struct joybus_target_relay_config joybus_target_relay_config_default(void)
+{
+  return (struct joybus_target_relay_config){
+    .console_freq      = JOYBUS_FREQ_GCN_CONSOLE,
+    .reply_lag         = 1,
+    .reply_deadline_us = DEFAULT_REPLY_DEADLINE_US,
+  };
+}
+
+int joybus_target_relay_init(struct joybus_target_relay *relay, struct joybus *console_bus, struct joybus *host_bus,
+                             struct joybus_target_relay_config config)
+{
+  // A backend that buffers the command ahead of the wire would send bytes that haven't arrived yet
+  if (!host_bus->streams_write_buf)
+    return -JOYBUS_ERR_NOT_SUPPORTED;
+
+  memset(relay, 0, sizeof(*relay));
+  relay->base.api    = &relay_api;
+  relay->console_bus = console_bus;
+  relay->host_bus    = host_bus;
+  relay->config      = config;
+
+  // A byte must arrive before it can be relayed
+  if (relay->config.reply_lag == 0)
+    relay->config.reply_lag = 1;
+
+  build_forward_table(relay);
+
+  // Wait for the deferred reply as long as the console does
+  struct joybus_timing timing = *joybus_get_timing(console_bus);
+  timing.reply_timeout_us     = relay->config.reply_deadline_us < UINT16_MAX ? relay->config.reply_deadline_us
+                                                                            : UINT16_MAX;
+  joybus_set_timing(console_bus, &timing);
+
+  joybus_set_rx_byte_cb(host_bus, relay_rx_byte, relay);
+  joybus_attach_target(console_bus, JOYBUS_TARGET(relay));
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <string.h>
+
+#include <joybus/virtual_clock.h>
+
+static uint64_t virtual_clock_now_us(struct joybus_clock *clock)
+{
+  return JOYBUS_VIRTUAL_CLOCK(clock)->now_ns / 1000;
+}
+
+static uint32_t virtual_clock_cycles(struct joybus_clock *clock)
+{
+  struct joybus_virtual_clock *virtual_clock = JOYBUS_VIRTUAL_CLOCK(clock);
+  return virtual_clock->now_ns * virtual_clock->cpu_mhz / 1000;
+}
+
+static int virtual_clock_set_alarm(struct joybus_clock *clock, uint64_t at_us)
+{
+  // Nothing to arm, joybus_virtual_clock_advance_to() checks the queue
+  return at_us <= virtual_clock_now_us(clock);
+}
+
+static const struct joybus_clock_api virtual_clock_api = {
+  .now_us    = virtual_clock_now_us,
+  .cycles    = virtual_clock_cycles,
+  .set_alarm = virtual_clock_set_alarm,
+};
+
+void joybus_virtual_clock_init(struct joybus_virtual_clock *clock, uint32_t cpu_mhz)
+{
+  // Start from a clean state
+  memset(clock, 0, sizeof(*clock));
+  clock->base.api = &virtual_clock_api;
+  clock->cpu_mhz  = cpu_mhz;
+}
+
+bool joybus_virtual_clock_next_alarm(const struct joybus_virtual_clock *clock, uint64_t *at_ns)
+{
+  if (!clock->base.alarms)
+    return false;
+
+  *at_ns = clock->base.alarms->at_us * 1000;
+  return true;
+}
+
+void joybus_virtual_clock_advance_to(struct joybus_virtual_clock *clock, uint64_t time_ns)
+{
+  // Step from alarm to alarm, so each one sees its own expiry time
+  uint64_t at_ns;
+  while (joybus_virtual_clock_next_alarm(clock, &at_ns) && at_ns <= time_ns) {
+    if (at_ns > clock->now_ns)
+      clock->now_ns = at_ns;
+
+    joybus_clock_run_alarms(&clock->base);
+  }
+
+  if (time_ns > clock->now_ns)
+    clock->now_ns = time_ns;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <joybus/bus.h>
+#include <joybus/target.h>
+#include <joybus/backend/loopback.h>
+
+// Wire a host bus to a target bus over loopback, both with the default config, and enable the host. If a target is
+// given it's plugged in, attached to the target bus and enabled in target mode, otherwise the port is left empty
+static inline void loopback_pair_setup(struct joybus_loopback *host_bus, struct joybus_loopback *target_bus,
+                                       struct joybus_target *target)
+{
+  joybus_loopback_init(host_bus, joybus_loopback_config_default());
+  joybus_loopback_init(target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(host_bus, target_bus);
+  joybus_enable(JOYBUS(host_bus), JOYBUS_MODE_HOST);
+
+  if (target) {
+    joybus_attach_target(JOYBUS(target_bus), target);
+    joybus_enable(JOYBUS(target_bus), JOYBUS_MODE_TARGET);
+  }
+}
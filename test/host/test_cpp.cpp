@@ -0,0 +1,253 @@
+#include <joybus/joybus.hpp>
+
+extern "C" {
+#include <joybus/backend/loopback.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+#include "unity.h"
+
+#include "harness.h"
+}
+
+// Commands are built at compile time, with their lengths in their types
+static_assert(libjoybus::commands::identify().bytes[0] == JOYBUS_CMD_IDENTIFY);
+static_assert(libjoybus::commands::identify().read_len == JOYBUS_CMD_IDENTIFY_RX);
+static_assert(libjoybus::commands::gcn_read(JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_RUMBLE).bytes ==
+              std::array<std::uint8_t, 3>{JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_RUMBLE});
+static_assert(decltype(libjoybus::commands::gcn_read_origin())::read_len == JOYBUS_CMD_GCN_READ_ORIGIN_RX);
+static_assert(decltype(libjoybus::commands::n64_read())::write_len == JOYBUS_CMD_N64_READ_TX);
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+static libjoybus::frame<512> frame;
+
+// Task completions
+static int done_status;
+static int done_count;
+
+static void done_cb(int status, void *user_data)
+{
+  done_status = status;
+  done_count++;
+}
+
+static void attach(struct joybus_target *target)
+{
+  joybus_attach_target(JOYBUS(&target_bus), target);
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+}
+
+void setUp(void)
+{
+  loopback_pair_setup(&host_bus, &target_bus, NULL);
+
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  joybus_target_n64_controller_init(&n64_controller);
+
+  done_status = 1;
+  done_count  = 0;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+// The usual GameCube controller start-up: identify, read the origin, then read the input
+static libjoybus::task gcn_poll(libjoybus::frame_base &, struct joybus *bus, struct joybus_id &id,
+                                struct joybus_gcn_controller_state &origin, struct joybus_gcn_controller_state &state)
+{
+  if (int rc = co_await libjoybus::identify(bus, id); rc < 0)
+    co_return rc;
+
+  if (int rc = co_await libjoybus::gcn_read_origin(bus, origin); rc < 0)
+    co_return rc;
+
+  co_return co_await libjoybus::gcn_read(bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, state);
+}
+
+// Read an N64 controller with raw transfers of built commands
+static libjoybus::task n64_poll(libjoybus::frame_base &, struct joybus *bus,
+                                struct joybus_n64_controller_state &state)
+{
+  struct joybus_id id;
+  if (int rc = co_await libjoybus::transfer(bus, libjoybus::commands::identify(), libjoybus::reply_buffer(id)); rc < 0)
+    co_return rc;
+
+  if (id.type != n64_controller.id.type)
+    co_return -JOYBUS_ERR_NO_DEVICE;
+
+  co_return co_await libjoybus::transfer(bus, libjoybus::commands::n64_read(), libjoybus::reply_buffer(state));
+}
+
+// Test the views pick the buttons and axes out of the C states
+static void test_views(void)
+{
+  struct joybus_gcn_controller_state gcn_state = {};
+  gcn_state.buttons      = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_L | JOYBUS_GCN_NEED_ORIGIN;
+  gcn_state.stick_x      = 0x12;
+  gcn_state.trigger_left = 0xC0;
+
+  libjoybus::gcn_controller_view gcn(gcn_state);
+  TEST_ASSERT_TRUE(gcn.pressed(libjoybus::gcn_button::a));
+  TEST_ASSERT_TRUE(gcn.pressed(libjoybus::gcn_button::l));
+  TEST_ASSERT_TRUE(gcn.pressed(libjoybus::gcn_button::need_origin));
+  TEST_ASSERT_FALSE(gcn.pressed(libjoybus::gcn_button::b));
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_L, gcn.buttons());
+  TEST_ASSERT_EQUAL_HEX8(0x12, gcn.stick_x());
+  TEST_ASSERT_EQUAL_HEX8(0xC0, gcn.trigger_left());
+
+  struct joybus_n64_controller_state n64_state = {};
+  n64_state.buttons = JOYBUS_N64_BUTTON_C_UP | JOYBUS_N64_RST;
+  n64_state.stick_y = -80;
+
+  libjoybus::n64_controller_view n64(n64_state);
+  TEST_ASSERT_TRUE(n64.pressed(libjoybus::n64_button::c_up));
+  TEST_ASSERT_TRUE(n64.pressed(libjoybus::n64_button::reset));
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_N64_BUTTON_C_UP, n64.buttons());
+  TEST_ASSERT_EQUAL(-80, n64.stick_y());
+}
+
+// Test a coroutine identifies a GameCube controller, reads its origin and then its input
+static void test_gcn_poll(void)
+{
+  attach(JOYBUS_TARGET(&gcn_controller));
+  gcn_controller.input.buttons = JOYBUS_GCN_BUTTON_B;
+  gcn_controller.input.stick_x = 0x90;
+
+  struct joybus_id id;
+  struct joybus_gcn_controller_state origin, state;
+  libjoybus::task task = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_TRUE(frame.busy());
+
+  // Lazy, so nothing happens until it's started
+  TEST_ASSERT_EQUAL(0, joybus_loopback_run());
+  TEST_ASSERT_EQUAL(0, task.start(done_cb, nullptr));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, task.start(done_cb, nullptr));
+  TEST_ASSERT_FALSE(task.done());
+
+  TEST_ASSERT_EQUAL(3, joybus_loopback_run());
+  TEST_ASSERT_TRUE(task.done());
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(0, task.status());
+
+  TEST_ASSERT_EQUAL_HEX16(gcn_controller.id.type, id.type);
+  libjoybus::gcn_controller_view view(state);
+  TEST_ASSERT_TRUE(view.pressed(libjoybus::gcn_button::b));
+  TEST_ASSERT_FALSE(view.pressed(libjoybus::gcn_button::need_origin));
+  TEST_ASSERT_EQUAL_HEX8(0x90, view.stick_x());
+
+  // Destroying the task frees the frame
+  task = libjoybus::task();
+  TEST_ASSERT_FALSE(frame.busy());
+}
+
+// Test a started task can't be started again after it's moved
+static void test_moved_task_stays_started(void)
+{
+  attach(JOYBUS_TARGET(&gcn_controller));
+
+  struct joybus_id id;
+  struct joybus_gcn_controller_state origin, state;
+  libjoybus::task task = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_EQUAL(0, task.start(done_cb, nullptr));
+
+  libjoybus::task moved(std::move(task));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, moved.start(done_cb, nullptr));
+
+  libjoybus::task assigned;
+  assigned = std::move(moved);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, assigned.start(done_cb, nullptr));
+
+  TEST_ASSERT_EQUAL(3, joybus_loopback_run());
+  TEST_ASSERT_TRUE(assigned.done());
+  TEST_ASSERT_EQUAL(1, done_count);
+}
+
+// Test raw transfers of built commands into fixed-size replies
+static void test_raw_transfer(void)
+{
+  attach(JOYBUS_TARGET(&n64_controller));
+  n64_controller.input.buttons = JOYBUS_N64_BUTTON_A | JOYBUS_N64_BUTTON_Z;
+  n64_controller.input.stick_x = 42;
+
+  struct joybus_n64_controller_state state;
+  libjoybus::task task = n64_poll(frame, JOYBUS(&host_bus), state);
+  TEST_ASSERT_EQUAL(0, task.start(done_cb, nullptr));
+  TEST_ASSERT_EQUAL(2, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  libjoybus::n64_controller_view view(state);
+  TEST_ASSERT_TRUE(view.pressed(libjoybus::n64_button::a));
+  TEST_ASSERT_TRUE(view.pressed(libjoybus::n64_button::z));
+  TEST_ASSERT_EQUAL(42, view.stick_x());
+}
+
+// Test a failed transfer comes back from co_await, and the coroutine can give up with it
+static void test_transfer_error(void)
+{
+  struct joybus_id id;
+  struct joybus_gcn_controller_state origin, state;
+  libjoybus::task task = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_EQUAL(0, task.start(done_cb, nullptr));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+}
+
+// Test a transfer that can't start finishes the coroutine before start() returns
+static void test_start_error(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+
+  struct joybus_id id;
+  struct joybus_gcn_controller_state origin, state;
+  libjoybus::task task = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_EQUAL(0, task.start(done_cb, nullptr));
+
+  TEST_ASSERT_TRUE(task.done());
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_LESS_THAN(0, done_status);
+}
+
+// Test a coroutine whose frame doesn't fit never runs
+static void test_frame_too_small(void)
+{
+  static libjoybus::frame<8> small;
+
+  struct joybus_id id;
+  struct joybus_gcn_controller_state origin, state;
+  libjoybus::task task = gcn_poll(small, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_FALSE(small.busy());
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE, task.start(done_cb, nullptr));
+  TEST_ASSERT_EQUAL(0, done_count);
+
+  // A frame holds one coroutine at a time
+  libjoybus::task first  = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  libjoybus::task second = gcn_poll(frame, JOYBUS(&host_bus), id, origin, state);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE, second.start(done_cb, nullptr));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_views);
+  RUN_TEST(test_gcn_poll);
+  RUN_TEST(test_moved_task_stays_started);
+  RUN_TEST(test_raw_transfer);
+  RUN_TEST(test_transfer_error);
+  RUN_TEST(test_start_error);
+  RUN_TEST(test_frame_too_small);
+
+  return UNITY_END();
+}
@@ -0,0 +1,292 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/identify.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn_adapter.h>
+#include <joybus/target/gcn_controller.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Polling interval of the official adapter
+#define POLL_INTERVAL_NS 1000000
+
+// The adapter under test
+static struct joybus_gcn_adapter adapter;
+
+// Host-side buses, one per adapter port
+static struct joybus_loopback host_buses[JOYBUS_GCN_ADAPTER_PORTS];
+
+// Controller-side buses and controllers, port 3 is left empty
+static struct joybus_loopback target_buses[JOYBUS_GCN_ADAPTER_PORTS];
+static struct joybus_target_gcn_controller controllers[JOYBUS_GCN_ADAPTER_PORTS];
+
+// Report buffer, standing in for the USB endpoint buffer
+static uint8_t report[JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN];
+
+// Spy for the controllers' motor state change callbacks
+static uint8_t motor_state[JOYBUS_GCN_ADAPTER_PORTS];
+static void on_motor(struct joybus_target_gcn_controller *controller, uint8_t state)
+{
+  motor_state[controller - controllers] = state;
+}
+
+// Run one USB polling interval
+static void poll_interval(void)
+{
+  uint64_t start = joybus_loopback_now_ns();
+  joybus_gcn_adapter_poll(&adapter);
+  joybus_loopback_run_until(start + POLL_INTERVAL_NS);
+}
+
+// Poll until every populated port is connected
+static void connect_all(void)
+{
+  for (int i = 0; i < 4; i++)
+    poll_interval();
+
+  for (int i = 0; i < 3; i++)
+    TEST_ASSERT_TRUE(joybus_gcn_adapter_connected(&adapter, i));
+}
+
+void setUp(void)
+{
+  struct joybus *buses[JOYBUS_GCN_ADAPTER_PORTS];
+
+  for (int i = 0; i < JOYBUS_GCN_ADAPTER_PORTS; i++) {
+    joybus_target_gcn_controller_init(&controllers[i]);
+    joybus_target_gcn_controller_set_motor_cb(&controllers[i], on_motor);
+
+    // Wire each adapter port to a controller port, with a controller plugged into the first three
+    loopback_pair_setup(&host_buses[i], &target_buses[i], i < 3 ? JOYBUS_TARGET(&controllers[i]) : NULL);
+    buses[i] = JOYBUS(&host_buses[i]);
+
+    motor_state[i] = JOYBUS_GCN_MOTOR_STOP;
+  }
+
+  joybus_gcn_adapter_init(&adapter, buses);
+  memset(report, 0xAA, sizeof(report));
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Input report
+// ---------------------------------------------------------------------------
+
+// Test the report before any controller has been detected
+static void test_report_empty(void)
+{
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_ADAPTER_INPUT_REPORT_LEN, joybus_gcn_adapter_build_report(&adapter, report));
+  TEST_ASSERT_EQUAL_HEX8(0x21, report[0]);
+
+  for (int port = 0; port < JOYBUS_GCN_ADAPTER_PORTS; port++) {
+    uint8_t expected[9] = {JOYBUS_GCN_ADAPTER_STATUS_POWERED};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &report[1 + port * 9], 9);
+  }
+}
+
+// Test that populated ports connect and the empty port stays empty
+static void test_ports_connect(void)
+{
+  connect_all();
+  TEST_ASSERT_FALSE(joybus_gcn_adapter_connected(&adapter, 3));
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  TEST_ASSERT_EQUAL_HEX8(0x14, report[1 + 0 * 9]);
+  TEST_ASSERT_EQUAL_HEX8(0x14, report[1 + 2 * 9]);
+  TEST_ASSERT_EQUAL_HEX8(0x04, report[1 + 3 * 9]);
+}
+
+// Test the button and axis layout of a port in the report
+static void test_report_layout(void)
+{
+  connect_all();
+
+  controllers[1].input.buttons = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_Y | JOYBUS_GCN_BUTTON_UP |
+                                 JOYBUS_GCN_BUTTON_LEFT | JOYBUS_GCN_BUTTON_START | JOYBUS_GCN_BUTTON_L;
+
+  controllers[1].input.stick_x       = 0x11;
+  controllers[1].input.stick_y       = 0x22;
+  controllers[1].input.substick_x    = 0x33;
+  controllers[1].input.substick_y    = 0x44;
+  controllers[1].input.trigger_left  = 0x55;
+  controllers[1].input.trigger_right = 0x66;
+  poll_interval();
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  uint8_t expected[9] = {0x14, 0x09 | 0x10 | 0x80, 0x01 | 0x08, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &report[1 + 1 * 9], 9);
+}
+
+// Test that the remaining buttons land in the second button byte, and status flags are dropped
+static void test_report_second_button_byte(void)
+{
+  connect_all();
+
+  controllers[0].input.buttons = JOYBUS_GCN_BUTTON_Z | JOYBUS_GCN_BUTTON_R | JOYBUS_GCN_BUTTON_DOWN |
+                                 JOYBUS_GCN_BUTTON_RIGHT | JOYBUS_GCN_ERROR_LATCH;
+  poll_interval();
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  TEST_ASSERT_EQUAL_HEX8(0x20 | 0x40, report[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x02 | 0x04, report[3]);
+}
+
+// Test that the power flag follows the adapter's power state
+static void test_report_unpowered(void)
+{
+  connect_all();
+  joybus_gcn_adapter_set_powered(&adapter, false);
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  TEST_ASSERT_EQUAL_HEX8(0x10, report[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, report[1 + 3 * 9]);
+}
+
+// ---------------------------------------------------------------------------
+// Rumble
+// ---------------------------------------------------------------------------
+
+// Test that a rumble report reaches each controller with the next read
+static void test_rumble_folded_into_read(void)
+{
+  connect_all();
+
+  const uint8_t rumble[] = {0x11, 0x01, 0x00, 0x01, 0x01};
+  TEST_ASSERT_EQUAL(0, joybus_gcn_adapter_handle_output_report(&adapter, rumble, sizeof(rumble)));
+
+  // Nothing is sent until the next poll
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_STOP, motor_state[0]);
+
+  poll_interval();
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_RUMBLE, motor_state[0]);
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_STOP, motor_state[1]);
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_RUMBLE, motor_state[2]);
+
+  // And stopped again
+  const uint8_t stop[] = {0x11, 0x00, 0x00, 0x00, 0x00};
+  joybus_gcn_adapter_handle_output_report(&adapter, stop, sizeof(stop));
+  poll_interval();
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_STOP, motor_state[0]);
+}
+
+// Test that unknown and truncated output reports are rejected
+static void test_output_report_validation(void)
+{
+  const uint8_t init[]      = {0x13};
+  const uint8_t truncated[] = {0x11, 0x01};
+  const uint8_t unknown[]   = {0x42, 0x00};
+
+  TEST_ASSERT_EQUAL(0, joybus_gcn_adapter_handle_output_report(&adapter, init, sizeof(init)));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, joybus_gcn_adapter_handle_output_report(&adapter, truncated, 2));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, joybus_gcn_adapter_handle_output_report(&adapter, unknown, 2));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, joybus_gcn_adapter_handle_output_report(&adapter, init, 0));
+}
+
+// ---------------------------------------------------------------------------
+// Connection handling
+// ---------------------------------------------------------------------------
+
+// Test that the origin is re-read when the controller flags a new one
+static void test_origin_refresh(void)
+{
+  connect_all();
+
+  struct joybus_gcn_controller_state new_origin = controllers[2].origin;
+  new_origin.stick_x                            = 0x7A;
+  joybus_target_gcn_controller_set_origin(&controllers[2], &new_origin);
+
+  // One read sees the flag, the next poll fetches the origin
+  poll_interval();
+  poll_interval();
+  TEST_ASSERT_EQUAL_HEX8(0x7A, adapter.ports[2].origin.stick_x);
+  TEST_ASSERT_TRUE(joybus_gcn_adapter_connected(&adapter, 2));
+}
+
+// Test that unplugging a controller empties its port
+static void test_unplug(void)
+{
+  connect_all();
+
+  joybus_disable(JOYBUS(&target_buses[1]));
+  poll_interval();
+  TEST_ASSERT_FALSE(joybus_gcn_adapter_connected(&adapter, 1));
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  TEST_ASSERT_EQUAL_HEX8(0x04, report[1 + 1 * 9]);
+}
+
+// Test that an unpaired WaveBird receiver is not reported as connected
+static void test_wavebird_waits_for_pairing(void)
+{
+  joybus_target_gcn_controller_init_wavebird(&controllers[0]);
+  for (int i = 0; i < 4; i++)
+    poll_interval();
+  TEST_ASSERT_FALSE(joybus_gcn_adapter_connected(&adapter, 0));
+
+  // Pairing a controller makes it show up as wireless
+  joybus_target_gcn_controller_set_wireless_id(&controllers[0], 0x123);
+  for (int i = 0; i < 4; i++)
+    poll_interval();
+  TEST_ASSERT_TRUE(joybus_gcn_adapter_connected(&adapter, 0));
+
+  joybus_gcn_adapter_build_report(&adapter, report);
+  TEST_ASSERT_EQUAL_HEX8(0x24, report[1]);
+}
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+// Test that a full four-port poll finishes well inside a 1 ms USB interval
+static void test_poll_fits_1khz(void)
+{
+  // Populate the fourth port too
+  joybus_attach_target(JOYBUS(&target_buses[3]), JOYBUS_TARGET(&controllers[3]));
+  joybus_enable(JOYBUS(&target_buses[3]), JOYBUS_MODE_TARGET);
+  connect_all();
+  TEST_ASSERT_TRUE(joybus_gcn_adapter_connected(&adapter, 3));
+
+  for (int i = 0; i < 100; i++) {
+    uint64_t start = joybus_loopback_now_ns();
+    joybus_gcn_adapter_poll(&adapter);
+    TEST_ASSERT_EQUAL(JOYBUS_GCN_ADAPTER_PORTS, joybus_loopback_run());
+
+    // Leave room for the inter-transfer delay before the next interval
+    uint64_t elapsed = joybus_loopback_now_ns() - start;
+    TEST_ASSERT_LESS_THAN(POLL_INTERVAL_NS - JOYBUS_INTER_TRANSFER_DELAY_US * 1000, elapsed);
+    joybus_loopback_run_until(start + POLL_INTERVAL_NS);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  // Input report
+  RUN_TEST(test_report_empty);
+  RUN_TEST(test_ports_connect);
+  RUN_TEST(test_report_layout);
+  RUN_TEST(test_report_second_button_byte);
+  RUN_TEST(test_report_unpowered);
+
+  // Rumble
+  RUN_TEST(test_rumble_folded_into_read);
+  RUN_TEST(test_output_report_validation);
+
+  // Connection handling
+  RUN_TEST(test_origin_refresh);
+  RUN_TEST(test_unplug);
+  RUN_TEST(test_wavebird_waits_for_pairing);
+
+  // Timing
+  RUN_TEST(test_poll_fits_1khz);
+
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+#include <string.h>
+
+#include <joybus/common/gcn_controller.h>
+#include <joybus/host/gcn_pipeline.h>
+
+#include "unity.h"
+
+// The pipeline under test
+static struct joybus_gcn_pipeline pipeline;
+
+// Raw and processed input batches
+static struct joybus_gcn_input_soa in, out;
+
+// A config with round numbers so expected values are easy to derive
+static struct joybus_gcn_pipeline_config test_config(void)
+{
+  struct joybus_gcn_pipeline_config config = joybus_gcn_pipeline_config_default();
+
+  config.stick    = (struct joybus_gcn_pipeline_axis_config){.deadzone = 10, .range = 110};
+  config.substick = (struct joybus_gcn_pipeline_axis_config){.deadzone = 0, .range = 127};
+  config.trigger  = (struct joybus_gcn_pipeline_axis_config){.deadzone = 0, .range = 255};
+  return config;
+}
+
+// Build a controller state with the given stick and trigger positions
+static struct joybus_gcn_controller_state make_state(uint16_t buttons, uint8_t stick_x, uint8_t trigger_left)
+{
+  struct joybus_gcn_controller_state state = {
+    .buttons      = buttons,
+    .stick_x      = stick_x,
+    .stick_y      = 0x80,
+    .substick_x   = 0x80,
+    .substick_y   = 0x80,
+    .trigger_left = trigger_left,
+  };
+  return state;
+}
+
+void setUp(void)
+{
+  joybus_gcn_pipeline_init(&pipeline, test_config());
+  memset(&in, 0, sizeof(in));
+  memset(&out, 0, sizeof(out));
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Axes
+// ---------------------------------------------------------------------------
+
+// Test that a centered stick reads as centered and stays centered inside the deadzone
+static void test_stick_deadzone(void)
+{
+  for (int offset = -10; offset <= 10; offset++) {
+    in.axes[JOYBUS_GCN_AXIS_STICK_X][0] = 0x80 + offset;
+    joybus_gcn_pipeline_process(&pipeline, &in, &out);
+    TEST_ASSERT_EQUAL_HEX8(0x80, out.axes[JOYBUS_GCN_AXIS_STICK_X][0]);
+  }
+}
+
+// Test that the configured range maps to full deflection and beyond clamps
+static void test_stick_scaling(void)
+{
+  // Range edge in both directions
+  in.axes[JOYBUS_GCN_AXIS_STICK_X][0] = 0x80 + 110;
+  in.axes[JOYBUS_GCN_AXIS_STICK_Y][0] = 0x80 - 110;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, out.axes[JOYBUS_GCN_AXIS_STICK_X][0]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, out.axes[JOYBUS_GCN_AXIS_STICK_Y][0]);
+
+  // Halfway between the deadzone and the range edge
+  in.axes[JOYBUS_GCN_AXIS_STICK_X][0] = 0x80 + 10 + 50;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_UINT8_WITHIN(1, 0x80 + 64, out.axes[JOYBUS_GCN_AXIS_STICK_X][0]);
+
+  // Raw extremes clamp rather than wrap
+  in.axes[JOYBUS_GCN_AXIS_STICK_X][0] = 0x00;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0x01, out.axes[JOYBUS_GCN_AXIS_STICK_X][0]);
+}
+
+// Test that an identity-configured axis passes values through unchanged
+static void test_substick_identity(void)
+{
+  for (int value = 1; value < 256; value++) {
+    in.axes[JOYBUS_GCN_AXIS_SUBSTICK_X][0] = value;
+    joybus_gcn_pipeline_process(&pipeline, &in, &out);
+    TEST_ASSERT_EQUAL_HEX8(value, out.axes[JOYBUS_GCN_AXIS_SUBSTICK_X][0]);
+  }
+}
+
+// Test that origin correction shifts the rest position of sticks and triggers
+static void test_origin_correction(void)
+{
+  struct joybus_gcn_controller_state origin = make_state(0, 0x90, 0x20);
+  joybus_gcn_pipeline_set_origin(&pipeline, 0, &origin);
+
+  // Resting at the new origin reads as rest
+  in.axes[JOYBUS_GCN_AXIS_STICK_X][0]      = 0x90;
+  in.axes[JOYBUS_GCN_AXIS_TRIGGER_LEFT][0] = 0x20;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0x80, out.axes[JOYBUS_GCN_AXIS_STICK_X][0]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, out.axes[JOYBUS_GCN_AXIS_TRIGGER_LEFT][0]);
+
+  // Values below the trigger origin also read as rest
+  in.axes[JOYBUS_GCN_AXIS_TRIGGER_LEFT][0] = 0x10;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0x00, out.axes[JOYBUS_GCN_AXIS_TRIGGER_LEFT][0]);
+}
+
+// Test that the default trigger config applies a deadzone and reaches full scale at its range
+static void test_trigger_default_config(void)
+{
+  joybus_gcn_pipeline_init(&pipeline, joybus_gcn_pipeline_config_default());
+
+  in.axes[JOYBUS_GCN_AXIS_TRIGGER_RIGHT][0] = 16;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0x00, out.axes[JOYBUS_GCN_AXIS_TRIGGER_RIGHT][0]);
+
+  in.axes[JOYBUS_GCN_AXIS_TRIGGER_RIGHT][0] = 200;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, out.axes[JOYBUS_GCN_AXIS_TRIGGER_RIGHT][0]);
+}
+
+// ---------------------------------------------------------------------------
+// Origin changes
+// ---------------------------------------------------------------------------
+
+// Test that tables are only rebuilt when the origin actually changes
+static void test_set_origin_rebuilds_on_change_only(void)
+{
+  struct joybus_gcn_controller_state origin = make_state(0, 0x80, 0x00);
+  TEST_ASSERT_FALSE(joybus_gcn_pipeline_set_origin(&pipeline, 0, &origin));
+
+  origin.stick_x = 0x84;
+  TEST_ASSERT_TRUE(joybus_gcn_pipeline_set_origin(&pipeline, 0, &origin));
+  TEST_ASSERT_FALSE(joybus_gcn_pipeline_set_origin(&pipeline, 0, &origin));
+
+  // Buttons are not part of the origin
+  origin.buttons = JOYBUS_GCN_BUTTON_A;
+  TEST_ASSERT_FALSE(joybus_gcn_pipeline_set_origin(&pipeline, 0, &origin));
+}
+
+// Test that an origin change on one port leaves the other ports untouched
+static void test_set_origin_is_per_port(void)
+{
+  struct joybus_gcn_controller_state origin = make_state(0, 0xB0, 0x00);
+  joybus_gcn_pipeline_set_origin(&pipeline, 1, &origin);
+
+  for (int port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++)
+    in.axes[JOYBUS_GCN_AXIS_STICK_X][port] = 0xB0;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+
+  for (int port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++) {
+    if (port == 1) {
+      TEST_ASSERT_EQUAL_HEX8(0x80, out.axes[JOYBUS_GCN_AXIS_STICK_X][port]);
+    } else {
+      TEST_ASSERT_GREATER_THAN(0x80, out.axes[JOYBUS_GCN_AXIS_STICK_X][port]);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Buttons
+// ---------------------------------------------------------------------------
+
+// Test that the default mapping passes every button bit through
+static void test_buttons_identity(void)
+{
+  in.buttons[0] = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_START | JOYBUS_GCN_BUTTON_Z | JOYBUS_GCN_USE_ORIGIN;
+  in.buttons[3] = 0xFFFF;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX16(in.buttons[0], out.buttons[0]);
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, out.buttons[3]);
+}
+
+// Test remapping buttons across bytes, swapping, and dropping
+static void test_buttons_remap(void)
+{
+  struct joybus_gcn_pipeline_config config = test_config();
+
+  // Swap A and B, move Z to X, and drop use-origin
+  config.button_map[0]  = JOYBUS_GCN_BUTTON_B;
+  config.button_map[1]  = JOYBUS_GCN_BUTTON_A;
+  config.button_map[12] = JOYBUS_GCN_BUTTON_X;
+  config.button_map[15] = 0;
+  joybus_gcn_pipeline_init(&pipeline, config);
+
+  in.buttons[0] = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_Z | JOYBUS_GCN_USE_ORIGIN;
+  in.buttons[1] = JOYBUS_GCN_BUTTON_B | JOYBUS_GCN_BUTTON_UP;
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_GCN_BUTTON_B | JOYBUS_GCN_BUTTON_X, out.buttons[0]);
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_UP, out.buttons[1]);
+}
+
+// ---------------------------------------------------------------------------
+// Batches
+// ---------------------------------------------------------------------------
+
+// Test that storing states and processing in place matches processing into a separate batch
+static void test_store_and_process_in_place(void)
+{
+  for (int port = 0; port < JOYBUS_GCN_PIPELINE_PORTS; port++) {
+    struct joybus_gcn_controller_state state = make_state(1 << port, 0x40 + port * 0x20, 0x10 * port);
+    joybus_gcn_input_soa_store(&in, port, &state);
+  }
+
+  joybus_gcn_pipeline_process(&pipeline, &in, &out);
+  joybus_gcn_pipeline_process(&pipeline, &in, &in);
+  TEST_ASSERT_EQUAL_MEMORY(&out, &in, sizeof(in));
+
+  // Spot check a stored field
+  TEST_ASSERT_EQUAL_HEX16(1 << 2, out.buttons[2]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  // Axes
+  RUN_TEST(test_stick_deadzone);
+  RUN_TEST(test_stick_scaling);
+  RUN_TEST(test_substick_identity);
+  RUN_TEST(test_origin_correction);
+  RUN_TEST(test_trigger_default_config);
+
+  // Origin changes
+  RUN_TEST(test_set_origin_rebuilds_on_change_only);
+  RUN_TEST(test_set_origin_is_per_port);
+
+  // Buttons
+  RUN_TEST(test_buttons_identity);
+  RUN_TEST(test_buttons_remap);
+
+  // Batches
+  RUN_TEST(test_store_and_process_in_place);
+
+  return UNITY_END();
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Wire time of a byte and a stop bit at the nominal frequency, in microseconds
+#define BYTE_US          32
+#define STOP_BIT_US      4
+
+// Delay between the host stop bit and the first reply bit on the loopback backend
+#define REPLY_DELAY_US   2
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+// Completions, and the last status
+static int done_count;
+static int done_status;
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_count++;
+  done_status = status;
+}
+
+void setUp(void)
+{
+  loopback_pair_setup(&host_bus, &target_bus, NULL);
+
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_n64_controller_init(&n64_controller);
+
+  // Start each test on a whole millisecond, well clear of the last transfer
+  uint64_t now_ns = joybus_loopback_now_ns();
+  joybus_loopback_run_until((now_ns / 1000000 + 1) * 1000000);
+
+  done_count  = 0;
+  done_status = 1;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+static void attach(struct joybus_target *target)
+{
+  joybus_attach_target(JOYBUS(&target_bus), target);
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+}
+
+// Test a GameCube read returns the input state with when it was on the wire
+static void test_gcn_read_sample(void)
+{
+  gcn_controller.input.buttons = JOYBUS_GCN_BUTTON_A;
+  gcn_controller.input.stick_x = 0x12;
+  gcn_controller.input.stick_y = 0x34;
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  attach(JOYBUS_TARGET(&gcn_controller));
+
+  uint64_t start_us = joybus_loopback_now_ns() / 1000;
+  struct joybus_gcn_sample sample;
+  TEST_ASSERT_EQUAL(0, joybus_gcn_read_sample_async(JOYBUS(&host_bus), JOYBUS_GCN_ANALOG_MODE_3,
+                                                    JOYBUS_GCN_MOTOR_STOP, &sample, done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_GCN_BUTTON_A, sample.state.buttons & JOYBUS_GCN_BUTTON_A);
+  TEST_ASSERT_EQUAL_HEX8(0x12, sample.state.stick_x);
+  TEST_ASSERT_EQUAL_HEX8(0x34, sample.state.stick_y);
+
+  // Three command bytes and a stop bit, the reply delay, then the first of eight reply bytes and a stop bit
+  uint64_t command_us = JOYBUS_CMD_GCN_READ_TX * BYTE_US + STOP_BIT_US;
+  TEST_ASSERT_EQUAL_UINT64(start_us, sample.timestamps.start_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + command_us + REPLY_DELAY_US + BYTE_US, sample.timestamps.first_byte_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + command_us + REPLY_DELAY_US + JOYBUS_CMD_GCN_READ_RX * BYTE_US + STOP_BIT_US,
+                           sample.timestamps.complete_us);
+
+  // The same timestamps are left on the bus
+  TEST_ASSERT_EQUAL_MEMORY(&sample.timestamps, joybus_last_timestamps(JOYBUS(&host_bus)), sizeof(sample.timestamps));
+}
+
+// Test an N64 read returns the input state with when it was on the wire
+static void test_n64_read_sample(void)
+{
+  n64_controller.input.buttons = 0x8000;
+  n64_controller.input.stick_x = 40;
+  attach(JOYBUS_TARGET(&n64_controller));
+
+  uint64_t start_us = joybus_loopback_now_ns() / 1000;
+  struct joybus_n64_sample sample;
+  TEST_ASSERT_EQUAL(0, joybus_n64_read_sample_async(JOYBUS(&host_bus), &sample, done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(40, sample.state.stick_x);
+
+  uint64_t command_us = JOYBUS_CMD_N64_READ_TX * BYTE_US + STOP_BIT_US;
+  TEST_ASSERT_EQUAL_UINT64(start_us, sample.timestamps.start_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + command_us + REPLY_DELAY_US + BYTE_US, sample.timestamps.first_byte_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + command_us + REPLY_DELAY_US + JOYBUS_CMD_N64_READ_RX * BYTE_US + STOP_BIT_US,
+                           sample.timestamps.complete_us);
+}
+
+// Test a read nobody answers still records when the command went out, without a first byte
+static void test_timeout_has_no_first_byte(void)
+{
+  uint64_t start_us = joybus_loopback_now_ns() / 1000;
+  struct joybus_gcn_sample sample;
+  memset(&sample, 0xAA, sizeof(sample));
+  TEST_ASSERT_EQUAL(0, joybus_gcn_read_sample_async(JOYBUS(&host_bus), JOYBUS_GCN_ANALOG_MODE_3,
+                                                    JOYBUS_GCN_MOTOR_STOP, &sample, done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+  TEST_ASSERT_EQUAL_UINT64(start_us, sample.timestamps.start_us);
+  TEST_ASSERT_EQUAL_UINT64(0, sample.timestamps.first_byte_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + JOYBUS_CMD_GCN_READ_TX * BYTE_US + STOP_BIT_US + JOYBUS_REPLY_TIMEOUT_US,
+                           sample.timestamps.complete_us);
+}
+
+static struct joybus_gcn_sample chained[2];
+
+static void chain_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_cb(bus, status, user_data);
+  if (done_count == 1)
+    joybus_gcn_read_sample_async(bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &chained[1], chain_cb, NULL);
+}
+
+// Test back-to-back reads each get their own timestamps, with the inter-transfer delay between them
+static void test_chained_reads(void)
+{
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  attach(JOYBUS_TARGET(&gcn_controller));
+
+  TEST_ASSERT_EQUAL(0, joybus_gcn_read_sample_async(JOYBUS(&host_bus), JOYBUS_GCN_ANALOG_MODE_3,
+                                                    JOYBUS_GCN_MOTOR_STOP, &chained[0], chain_cb, NULL));
+  TEST_ASSERT_EQUAL(2, joybus_loopback_run());
+  TEST_ASSERT_EQUAL(0, done_status);
+
+  uint64_t duration_us = chained[0].timestamps.complete_us - chained[0].timestamps.start_us;
+  TEST_ASSERT_EQUAL_UINT64(chained[0].timestamps.complete_us + JOYBUS_INTER_TRANSFER_DELAY_US,
+                           chained[1].timestamps.start_us);
+  TEST_ASSERT_EQUAL_UINT64(duration_us, chained[1].timestamps.complete_us - chained[1].timestamps.start_us);
+}
+
+// Test a transfer scheduled on the bus clock goes out exactly then
+static void test_transfer_at(void)
+{
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  attach(JOYBUS_TARGET(&gcn_controller));
+
+  static const uint8_t command[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+  uint8_t response[JOYBUS_CMD_GCN_READ_RX];
+  uint64_t at_us = joybus_clock_now_us(joybus_loopback_clock()) + 1234;
+  TEST_ASSERT_EQUAL(0, joybus_transfer_at(JOYBUS(&host_bus), at_us, command, sizeof(command), response,
+                                          sizeof(response), done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL_UINT64(at_us, joybus_last_timestamps(JOYBUS(&host_bus))->start_us);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_gcn_read_sample);
+  RUN_TEST(test_n64_read_sample);
+  RUN_TEST(test_timeout_has_no_first_byte);
+  RUN_TEST(test_chained_reads);
+  RUN_TEST(test_transfer_at);
+
+  return UNITY_END();
+}
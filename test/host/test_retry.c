@@ -0,0 +1,331 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/host/n64_rumble_pak.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Wire time of a byte and a stop bit at the nominal frequency, in microseconds
+#define BYTE_US     32
+#define STOP_BIT_US 4
+
+// Maximum number of completions recorded by a test
+#define MAX_DONE 4
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+static struct joybus_target_n64_rumble_pak rumble;
+
+static struct joybus_gcn_controller_state states[MAX_DONE];
+
+// Completion statuses, in the order they happened
+static int done_statuses[MAX_DONE];
+static int done_count;
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  TEST_ASSERT_LESS_THAN(MAX_DONE, done_count);
+  done_statuses[done_count++] = status;
+}
+
+// A target that garbles the CRC of the next few pak replies of the controller it wraps
+static struct {
+  struct joybus_target base;
+  struct joybus_target *inner;
+  int corrupt;
+  joybus_target_response_cb send_response;
+  void *user_data;
+} flaky;
+
+static void flaky_send_response(const uint8_t *response, uint8_t len, void *user_data)
+{
+  static uint8_t garbled[JOYBUS_CMD_N64_PAK_READ_RX];
+  if ((len == JOYBUS_CMD_N64_PAK_WRITE_RX || len == JOYBUS_CMD_N64_PAK_READ_RX) && flaky.corrupt > 0) {
+    flaky.corrupt--;
+    memcpy(garbled, response, len);
+    garbled[len - 1] ^= 0xFF;
+    response = garbled;
+  }
+
+  flaky.send_response(response, len, flaky.user_data);
+}
+
+static int flaky_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
+                               joybus_target_response_cb send_response, void *user_data)
+{
+  flaky.send_response = send_response;
+  flaky.user_data     = user_data;
+
+  return joybus_target_byte_received(flaky.inner, command, byte_idx, flaky_send_response, NULL);
+}
+
+static const struct joybus_target_api flaky_api = {
+  .byte_received = flaky_byte_received,
+};
+
+// Plug a target into the port
+static void attach(struct joybus_target *target, uint32_t recovery_us)
+{
+  struct joybus_loopback_config config = joybus_loopback_config_default();
+  config.recovery_us                   = recovery_us;
+  joybus_loopback_init(&target_bus, config);
+  joybus_loopback_connect(&host_bus, &target_bus);
+
+  joybus_attach_target(JOYBUS(&target_bus), target);
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+}
+
+void setUp(void)
+{
+  loopback_pair_setup(&host_bus, &target_bus, NULL);
+
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+
+  joybus_target_n64_rumble_pak_init(&rumble);
+  joybus_target_n64_controller_init(&n64_controller);
+  joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble));
+  flaky.base.api = &flaky_api;
+  flaky.inner    = JOYBUS_TARGET(&n64_controller);
+  flaky.corrupt  = 0;
+
+  done_count = 0;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+static int start_read(int i)
+{
+  return joybus_gcn_read_async(JOYBUS(&host_bus), JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &states[i],
+                               done_cb, NULL);
+}
+
+static void set_policy(uint8_t timeout_retries, uint16_t backoff_us, uint16_t max_backoff_us)
+{
+  struct joybus_retry_policy policy = joybus_retry_policy_default();
+  policy.timeout_retries            = timeout_retries;
+  policy.backoff_us                 = backoff_us;
+  policy.max_backoff_us             = max_backoff_us;
+  joybus_set_retry_policy(JOYBUS(&host_bus), &policy);
+}
+
+// Test a controller that needs longer than the gap between reads misses the second without a retry policy
+static void test_no_retries_by_default(void)
+{
+  attach(JOYBUS_TARGET(&gcn_controller), 150);
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_statuses[1]);
+}
+
+// Test a timed-out read is resent after the backoff, and only its final result is reported
+static void test_timeout_retry(void)
+{
+  attach(JOYBUS_TARGET(&gcn_controller), 150);
+  set_policy(1, 100, 0);
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+}
+
+// Test the backoff doubles with each resend, until the controller has had long enough
+static void test_timeout_backoff_doubles(void)
+{
+  // Resends go out 180, 280 and 480us after the last timeout
+  attach(JOYBUS_TARGET(&gcn_controller), 400);
+  set_policy(3, 100, 0);
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+}
+
+// Test the backoff stops growing at its bound, and the last timeout is reported once retries are used up
+static void test_timeout_backoff_bounded(void)
+{
+  attach(JOYBUS_TARGET(&gcn_controller), 400);
+  set_policy(3, 100, 200);
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_statuses[1]);
+}
+
+// Test a rumble pak write with a garbled CRC is resent straight away
+static void test_checksum_retry(void)
+{
+  struct joybus_n64_rumble_pak_probe probe;
+  attach(&flaky.base, 0);
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_init_async(JOYBUS(&host_bus), &probe, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+
+  // Without retries the error is reported
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_start_async(JOYBUS(&host_bus), done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_CHECKSUM, done_statuses[1]);
+
+  // With a retry the write goes through
+  struct joybus_retry_policy policy = joybus_retry_policy_default();
+  policy.checksum_retries           = 1;
+  joybus_set_retry_policy(JOYBUS(&host_bus), &policy);
+
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_start_async(JOYBUS(&host_bus), done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[2]);
+  TEST_ASSERT_TRUE(rumble.active);
+}
+
+static void set_checksum_retries(uint8_t checksum_retries)
+{
+  struct joybus_retry_policy policy = joybus_retry_policy_default();
+  policy.checksum_retries           = checksum_retries;
+  joybus_set_retry_policy(JOYBUS(&host_bus), &policy);
+}
+
+// Test a pak read whose data doesn't match its CRC is reported, or resent if the policy allows
+static void test_pak_read_checksum(void)
+{
+  uint8_t response[JOYBUS_CMD_N64_PAK_READ_RX];
+  attach(&flaky.base, 0);
+
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_pak_read_async(JOYBUS(&host_bus), 0x8000, response, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_CHECKSUM, done_statuses[0]);
+
+  set_checksum_retries(1);
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_pak_read_async(JOYBUS(&host_bus), 0x8000, response, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+  TEST_ASSERT_EQUAL_HEX8(joybus_data_checksum(response, JOYBUS_PAK_BLOCK_SIZE), response[JOYBUS_PAK_BLOCK_SIZE]);
+}
+
+// Test a pak write whose CRC doesn't match the data is reported, or resent if the policy allows
+static void test_pak_write_checksum(void)
+{
+  uint8_t block[JOYBUS_PAK_BLOCK_SIZE];
+  uint8_t response[JOYBUS_CMD_N64_PAK_WRITE_RX];
+  memset(block, 0x55, sizeof(block));
+  attach(&flaky.base, 0);
+
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_pak_write_async(JOYBUS(&host_bus), 0x8000, block, response, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_CHECKSUM, done_statuses[0]);
+
+  set_checksum_retries(1);
+  flaky.corrupt = 1;
+  TEST_ASSERT_EQUAL(0, joybus_n64_pak_write_async(JOYBUS(&host_bus), 0x8000, block, response, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+}
+
+// Test a pak write to a controller with no pak inserted fails its checksum
+static void test_pak_write_no_pak(void)
+{
+  uint8_t block[JOYBUS_PAK_BLOCK_SIZE] = {0};
+  uint8_t response[JOYBUS_CMD_N64_PAK_WRITE_RX];
+  joybus_target_n64_controller_init(&n64_controller);
+  attach(JOYBUS_TARGET(&n64_controller), 0);
+
+  TEST_ASSERT_EQUAL(0, joybus_n64_pak_write_async(JOYBUS(&host_bus), 0x8000, block, response, done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_CHECKSUM, done_statuses[0]);
+}
+
+// Test the circuit breaker turns host functions away on an empty port, looking for a device once per cooldown
+static void test_circuit_breaker(void)
+{
+  struct joybus_retry_policy policy = joybus_retry_policy_default();
+  policy.timeout_retries            = 2;
+  policy.breaker_threshold          = 2;
+  policy.breaker_cooldown_us        = 1000;
+  joybus_set_retry_policy(JOYBUS(&host_bus), &policy);
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_statuses[1]);
+  TEST_ASSERT_TRUE(joybus_breaker_open(JOYBUS(&host_bus)));
+
+  // Open, so reads fail without touching the bus
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_DEVICE, start_read(2));
+
+  // Once the cooldown has passed, one read looks for a device, without retries
+  joybus_loopback_run_until(joybus_loopback_now_ns() + 1000 * 1000);
+  uint64_t probe_us = joybus_loopback_now_ns() / 1000;
+  TEST_ASSERT_EQUAL(0, start_read(2));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_DEVICE, start_read(3));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_statuses[2]);
+  TEST_ASSERT_EQUAL_UINT64(probe_us + JOYBUS_CMD_GCN_READ_TX * BYTE_US + STOP_BIT_US + JOYBUS_REPLY_TIMEOUT_US,
+                           joybus_last_timestamps(JOYBUS(&host_bus))->complete_us);
+
+  // Plug a controller in, the next look finds it and closes the breaker
+  attach(JOYBUS_TARGET(&gcn_controller), 0);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_DEVICE, start_read(3));
+  joybus_loopback_run_until(joybus_loopback_now_ns() + 1000 * 1000);
+  TEST_ASSERT_EQUAL(0, start_read(3));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, done_statuses[3]);
+  TEST_ASSERT_FALSE(joybus_breaker_open(JOYBUS(&host_bus)));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_no_retries_by_default);
+  RUN_TEST(test_timeout_retry);
+  RUN_TEST(test_timeout_backoff_doubles);
+  RUN_TEST(test_timeout_backoff_bounded);
+  RUN_TEST(test_checksum_retry);
+  RUN_TEST(test_pak_read_checksum);
+  RUN_TEST(test_pak_write_checksum);
+  RUN_TEST(test_pak_write_no_pak);
+  RUN_TEST(test_circuit_breaker);
+
+  return UNITY_END();
+}
@@ -0,0 +1,193 @@
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/common.h>
+#include <joybus/host/n64.h>
+#include <joybus/host/n64_rumble_pak.h>
+#include <joybus/host/sequence.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Maximum number of completions recorded by a test
+#define MAX_DONE 4
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_n64_controller controller;
+static struct joybus_target_n64_rumble_pak rumble;
+
+// Completions, in the order they happened
+static int done_ids[MAX_DONE];
+static int done_statuses[MAX_DONE];
+static int done_count;
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  TEST_ASSERT_LESS_THAN(MAX_DONE, done_count);
+  done_ids[done_count]      = (int)(intptr_t)user_data;
+  done_statuses[done_count] = status;
+  done_count++;
+}
+
+void setUp(void)
+{
+  joybus_target_n64_rumble_pak_init(&rumble);
+  joybus_target_n64_controller_init(&controller);
+  loopback_pair_setup(&host_bus, &target_bus, JOYBUS_TARGET(&controller));
+
+  done_count = 0;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+// A sequence that identifies the controller a number of times, counting the steps it ran
+struct identify_loop {
+  struct joybus_id id;
+  int remaining;
+  int steps;
+};
+
+static int identify(struct joybus *bus, struct joybus_sequence *seq)
+{
+  struct identify_loop *loop = seq->context;
+
+  loop->steps++;
+  return joybus_identify_async(bus, &loop->id, joybus_sequence_cb, seq);
+}
+
+static int identify_again(struct joybus *bus, struct joybus_sequence *seq)
+{
+  struct identify_loop *loop = seq->context;
+
+  loop->steps++;
+  if (--loop->remaining == 0)
+    return JOYBUS_SEQUENCE_DONE;
+
+  joybus_sequence_goto(seq, 1);
+  return joybus_identify_async(bus, &loop->id, joybus_sequence_cb, seq);
+}
+
+static const joybus_sequence_step identify_loop_steps[] = {identify, identify_again, NULL};
+
+// Test the rumble pak probe finds a rumble pak, and turns the motor on afterwards
+static void test_rumble_pak_probe(void)
+{
+  // Plug the pak in, and let the host see the change
+  joybus_target_n64_controller_attach_pak(&controller, JOYBUS_TARGET_N64_PAK(&rumble));
+  struct joybus_id id;
+  TEST_ASSERT_EQUAL(0, joybus_identify_async(JOYBUS(&host_bus), &id, NULL, NULL));
+  joybus_loopback_run();
+
+  struct joybus_n64_rumble_pak_probe probe;
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_init_async(JOYBUS(&host_bus), &probe, done_cb, NULL));
+  TEST_ASSERT_EQUAL(4, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_start_async(JOYBUS(&host_bus), done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+  TEST_ASSERT_TRUE(rumble.active);
+}
+
+// Test the rumble pak probe fails on a controller without a pak, with the error of the step that gave up
+static void test_rumble_pak_probe_no_pak(void)
+{
+  struct joybus_n64_rumble_pak_probe probe;
+  TEST_ASSERT_EQUAL(0, joybus_n64_rumble_pak_init_async(JOYBUS(&host_bus), &probe, done_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_LESS_THAN(0, done_statuses[0]);
+}
+
+// Test a step can loop back, and the sequence completes once a step says it's done
+static void test_goto_loops(void)
+{
+  struct identify_loop loop = {.remaining = 3};
+  struct joybus_sequence seq;
+  TEST_ASSERT_EQUAL(0, joybus_sequence_start(JOYBUS(&host_bus), &seq, identify_loop_steps, &loop, done_cb, NULL));
+  TEST_ASSERT_EQUAL(3, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+  TEST_ASSERT_EQUAL(4, loop.steps);
+  TEST_ASSERT_EQUAL_HEX16(controller.id.type, loop.id.type);
+}
+
+// Test two sequences on the same bus interleave their transfers, each with its own state
+static void test_concurrent_sequences(void)
+{
+  struct identify_loop loops[2] = {{.remaining = 2}, {.remaining = 3}};
+  struct joybus_sequence seqs[2];
+  TEST_ASSERT_EQUAL(0, joybus_sequence_start(JOYBUS(&host_bus), &seqs[0], identify_loop_steps, &loops[0], done_cb,
+                                             (void *)(intptr_t)0));
+  TEST_ASSERT_EQUAL(0, joybus_sequence_start(JOYBUS(&host_bus), &seqs[1], identify_loop_steps, &loops[1], done_cb,
+                                             (void *)(intptr_t)1));
+  TEST_ASSERT_EQUAL(5, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_ids[0]);
+  TEST_ASSERT_EQUAL(1, done_ids[1]);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+  TEST_ASSERT_EQUAL(3, loops[0].steps);
+  TEST_ASSERT_EQUAL(4, loops[1].steps);
+}
+
+// Test a failed transfer ends the sequence without running the later steps
+static void test_transfer_error_ends_sequence(void)
+{
+  joybus_disable(JOYBUS(&target_bus));
+
+  struct identify_loop loop = {.remaining = 3};
+  struct joybus_sequence seq;
+  TEST_ASSERT_EQUAL(0, joybus_sequence_start(JOYBUS(&host_bus), &seq, identify_loop_steps, &loop, done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_statuses[0]);
+  TEST_ASSERT_EQUAL(1, loop.steps);
+}
+
+static int nothing_to_do(struct joybus *bus, struct joybus_sequence *seq)
+{
+  return JOYBUS_SEQUENCE_DONE;
+}
+
+static const joybus_sequence_step empty_steps[] = {nothing_to_do, NULL};
+
+// Test a sequence has to start with a transfer, so the callback never runs before the start returns
+static void test_first_step_must_transfer(void)
+{
+  struct joybus_sequence seq;
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_INVALID,
+                    joybus_sequence_start(JOYBUS(&host_bus), &seq, empty_steps, NULL, done_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(0, done_count);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_rumble_pak_probe);
+  RUN_TEST(test_rumble_pak_probe_no_pak);
+  RUN_TEST(test_goto_loops);
+  RUN_TEST(test_concurrent_sequences);
+  RUN_TEST(test_transfer_error_ends_sequence);
+  RUN_TEST(test_first_step_must_transfer);
+
+  return UNITY_END();
+}
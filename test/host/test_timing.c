@@ -0,0 +1,221 @@
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/timing.h>
+#include <joybus/target/gcn_controller.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Wire time of a byte and a stop bit at the nominal frequency, in microseconds
+#define BYTE_US     32
+#define STOP_BIT_US 4
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller controller;
+
+static const uint8_t identify[] = {JOYBUS_CMD_IDENTIFY};
+static uint8_t response[JOYBUS_CMD_IDENTIFY_RX];
+
+// Completions, and the last status
+static int done_count;
+static int done_status;
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_count++;
+  done_status = status;
+}
+
+// Wire both buses, with a controller that needs the given time after each transfer, and for each handler call
+static void connect(uint32_t recovery_us, uint32_t handler_ns)
+{
+  struct joybus_loopback_config target_config = joybus_loopback_config_default();
+  target_config.recovery_us                   = recovery_us;
+  target_config.handler_ns                    = handler_ns;
+  joybus_loopback_init(&target_bus, target_config);
+  joybus_loopback_connect(&host_bus, &target_bus);
+
+  joybus_attach_target(JOYBUS(&target_bus), JOYBUS_TARGET(&controller));
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+}
+
+void setUp(void)
+{
+  loopback_pair_setup(&host_bus, &target_bus, NULL);
+  joybus_target_gcn_controller_init(&controller);
+
+  done_count  = 0;
+  done_status = 1;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+static void chain_cb(struct joybus *bus, int status, void *user_data)
+{
+  struct joybus_timestamps *first = user_data;
+
+  done_cb(bus, status, NULL);
+  if (done_count == 1) {
+    *first = *joybus_last_timestamps(bus);
+    joybus_transfer(bus, identify, sizeof(identify), response, sizeof(response), chain_cb, NULL);
+  }
+}
+
+// Test the bus profile's minimum gap applies between transfers
+static void test_bus_min_gap(void)
+{
+  connect(0, 0);
+
+  struct joybus_timing timing = joybus_timing_default();
+  timing.min_gap_us           = 10;
+  joybus_set_timing(JOYBUS(&host_bus), &timing);
+  TEST_ASSERT_EQUAL(10, joybus_get_timing(JOYBUS(&host_bus))->min_gap_us);
+
+  struct joybus_timestamps first;
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), identify, sizeof(identify), response, sizeof(response),
+                                       chain_cb, &first));
+  TEST_ASSERT_EQUAL(2, joybus_loopback_run());
+
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL_UINT64(first.complete_us + 10, joybus_last_timestamps(JOYBUS(&host_bus))->start_us);
+}
+
+// Test a transfer with its own profile gives up on an empty port early
+static void test_transfer_timed_reply_timeout(void)
+{
+  struct joybus_timing timing = joybus_timing_default();
+  timing.reply_timeout_us     = 20;
+
+  TEST_ASSERT_EQUAL(0, joybus_transfer_timed(JOYBUS(&host_bus), &timing, identify, sizeof(identify), response,
+                                             sizeof(response), done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+
+  const struct joybus_timestamps *ts = joybus_last_timestamps(JOYBUS(&host_bus));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+  TEST_ASSERT_EQUAL_UINT64(ts->start_us + BYTE_US + STOP_BIT_US + 20, ts->complete_us);
+
+  // The next transfer is back on the bus profile
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), identify, sizeof(identify), response, sizeof(response),
+                                       done_cb, NULL));
+  TEST_ASSERT_EQUAL(1, joybus_loopback_run());
+  TEST_ASSERT_EQUAL_UINT64(ts->start_us + BYTE_US + STOP_BIT_US + JOYBUS_REPLY_TIMEOUT_US, ts->complete_us);
+}
+
+// Time from the start of an identify transfer to its first reply byte, against a controller with the given handler cost
+static uint64_t first_byte_delay_us(uint32_t handler_ns)
+{
+  connect(0, handler_ns);
+
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), identify, sizeof(identify), response, sizeof(response),
+                                       done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, done_status);
+
+  const struct joybus_timestamps *ts = joybus_last_timestamps(JOYBUS(&host_bus));
+  return ts->first_byte_us - ts->start_us;
+}
+
+// Test a slow target handler delays the reply once it outlasts the stop bit
+static void test_handler_cost_delays_reply(void)
+{
+  uint64_t fast_us = first_byte_delay_us(0);
+
+  // Shorter than the stop bit, the response is ready when the command ends
+  TEST_ASSERT_EQUAL_UINT64(fast_us, first_byte_delay_us(STOP_BIT_US * 1000));
+
+  // The controller answers identify from its first byte, the reply waits for the handler to return
+  TEST_ASSERT_EQUAL_UINT64(fast_us + 6, first_byte_delay_us((STOP_BIT_US + 6) * 1000));
+}
+
+// Test a target handler slower than the reply timeout is never heard
+static void test_handler_cost_past_timeout(void)
+{
+  connect(0, (JOYBUS_REPLY_TIMEOUT_US + STOP_BIT_US) * 1000);
+
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), identify, sizeof(identify), response, sizeof(response),
+                                       done_cb, NULL));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+}
+
+// Test calibration finds the gap the device needs, and leaves the bus profile alone
+static void test_calibrate_gap(void)
+{
+  connect(30, 0);
+
+  struct joybus_gap_calibration cal;
+  TEST_ASSERT_EQUAL(0, joybus_calibrate_gap_async(JOYBUS(&host_bus), &cal, identify, sizeof(identify),
+                                                  JOYBUS_CMD_IDENTIFY_RX, done_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(30, cal.min_gap_us);
+  TEST_ASSERT_EQUAL(JOYBUS_INTER_TRANSFER_DELAY_US, joybus_get_timing(JOYBUS(&host_bus))->min_gap_us);
+
+  // The device keeps up at the calibrated gap
+  struct joybus_timing timing = joybus_timing_default();
+  timing.min_gap_us           = cal.min_gap_us;
+  joybus_set_timing(JOYBUS(&host_bus), &timing);
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), identify, sizeof(identify), response, sizeof(response),
+                                         done_cb, NULL));
+    joybus_loopback_run();
+    TEST_ASSERT_EQUAL(0, done_status);
+  }
+}
+
+// Test a device that needs no gap at all calibrates to zero
+static void test_calibrate_gap_none_needed(void)
+{
+  connect(0, 0);
+
+  struct joybus_gap_calibration cal;
+  TEST_ASSERT_EQUAL(0, joybus_calibrate_gap_async(JOYBUS(&host_bus), &cal, identify, sizeof(identify),
+                                                  JOYBUS_CMD_IDENTIFY_RX, done_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(0, cal.min_gap_us);
+}
+
+// Test calibration fails without a device, and rejects bad arguments up front
+static void test_calibrate_gap_errors(void)
+{
+  struct joybus_gap_calibration cal;
+  TEST_ASSERT_EQUAL(0, joybus_calibrate_gap_async(JOYBUS(&host_bus), &cal, identify, sizeof(identify),
+                                                  JOYBUS_CMD_IDENTIFY_RX, done_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_INVALID,
+                    joybus_calibrate_gap_async(JOYBUS(&host_bus), &cal, identify, 0, 3, done_cb, NULL));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE, joybus_calibrate_gap_async(JOYBUS(&host_bus), &cal, identify, 1,
+                                                                     JOYBUS_BLOCK_SIZE + 1, done_cb, NULL));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_bus_min_gap);
+  RUN_TEST(test_transfer_timed_reply_timeout);
+  RUN_TEST(test_handler_cost_delays_reply);
+  RUN_TEST(test_handler_cost_past_timeout);
+  RUN_TEST(test_calibrate_gap);
+  RUN_TEST(test_calibrate_gap_none_needed);
+  RUN_TEST(test_calibrate_gap_errors);
+
+  return UNITY_END();
+}
@@ -1,15 +1,66 @@
 #pragma once
 
+#include <stdbool.h>
 #include <string.h>
+#include <time.h>
 
 #include <joybus/bus.h>
+#include <joybus/commands.h>
 #include <joybus/target.h>
 
 #include "unity.h"
 
+// Reply deadline model
+//
+// Commands are clocked in one bit at a time, so the backend hands each byte to the target as soon as its last bit is
+// in, and the reply has to start on the wire shortly after the command's stop bit. send_command() places each
+// byte_received call on a virtual timeline starting at the first bit of the command, and checks that a response sent
+// during the command is committed early enough for the backend to start the reply in time. A handler can only start
+// once its byte is in and the previous call has returned, so slow handlers push back the following bytes.
+//
+// The backend needs several microseconds to stage a reply, so only a response committed before the last command byte
+// can start within a bit time of the stop bit. The harness checks each command's response against the byte it's
+// expected at, from harness_default_reply_points unless a suite overrides it with harness_set_reply_points(). A
+// command that needs its last byte is held to the console's reply timeout instead, and any other late response fails.
+static struct {
+  uint32_t freq;          ///< Bus frequency in Hz
+  uint32_t turnaround_ns; ///< Time allowed from the end of the stop bit to the start of the reply
+  uint32_t lead_ns;       ///< Time the backend needs from the response being committed to the reply starting
+  uint32_t handler_ns;    ///< Modelled cost of each byte_received call, or 0 to time the calls on the host
+  uint32_t host_scale;    ///< How many times slower the target is than the host, when timing on the host
+} timing;
+
+// The command byte a suite expects a command's response at, 1-based
+struct harness_reply_point {
+  uint8_t command;
+  uint8_t at_byte;
+};
+
+// The command byte the library's targets respond to each command at. Single-byte commands, and commands whose
+// response depends on their whole payload, can only respond after the last byte
+static const struct harness_reply_point harness_default_reply_points[] = {
+  {JOYBUS_CMD_RESET, 1},
+  {JOYBUS_CMD_IDENTIFY, 1},
+  {JOYBUS_CMD_N64_READ, 1},
+  {JOYBUS_CMD_N64_PAK_READ, 3},
+  {JOYBUS_CMD_N64_PAK_WRITE, 35},
+  {JOYBUS_CMD_GCN_READ, 2},
+  {JOYBUS_CMD_GCN_READ_ORIGIN, 1},
+  {JOYBUS_CMD_GCN_CALIBRATE, 1},
+  {JOYBUS_CMD_GCN_READ_LONG, 2},
+  {JOYBUS_CMD_GCN_PROBE_DEVICE, 1},
+  {JOYBUS_CMD_GCN_FIX_DEVICE, 3},
+};
+
 // The target under test, set by harness_reset()
 static struct joybus_target *target_under_test;
 
+// Expected response points, the defaults installed by harness_reset() and a suite's overrides
+static const struct harness_reply_point *reply_points;
+static size_t reply_point_count;
+static const struct harness_reply_point *reply_point_overrides;
+static size_t reply_point_override_count;
+
 // Monotonic event counter for asserting relative ordering.
 static int event_seq;
 
@@ -20,46 +71,165 @@ static struct {
   int count;                       ///< Responses sent since harness_reset()
   uint8_t at_byte;                 ///< 1-based command byte that triggered the response
   int seq;                         ///< event_seq stamp taken when the response was sent
+  uint32_t commit_ns;              ///< Time the response was sent, from the start of the command
+  int32_t slack_ns;                ///< Time to spare before the reply deadline, negative if it was missed
 } response;
 
 // Command byte currently being delivered, 1-based
 static uint8_t current_byte;
 
+// Set while send_command() is delivering a command
+static bool in_command;
+
+// byte_received calls made by the last send_command()
+static int byte_calls;
+
+// Set to deliver every byte of a bulk payload, like capture replay or a wrapping target that calls through per byte
+static bool deliver_bulk_bytewise;
+
+// Start of the current byte_received call on the virtual timeline, and on the host clock
+static uint32_t call_start_ns;
+static struct timespec call_start_host;
+
+// Nanoseconds per bit at the modelled bus frequency
+static inline uint32_t harness_bit_ns(void)
+{
+  return 1000000000u / timing.freq;
+}
+
+// Time at which command byte n (1-based) has been clocked in, from the start of the command
+static inline uint32_t harness_byte_end_ns(uint8_t n)
+{
+  return n * 8 * harness_bit_ns();
+}
+
+// Time at which the stop bit of a command of len bytes has been clocked in, from the start of the command
+static inline uint32_t harness_stop_end_ns(uint8_t len)
+{
+  return (len * 8 + 1) * harness_bit_ns();
+}
+
+// Time spent in the current byte_received call so far
+static uint32_t call_elapsed_ns(void)
+{
+  if (timing.handler_ns)
+    return timing.handler_ns;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t elapsed = (int64_t)(now.tv_sec - call_start_host.tv_sec) * 1000000000 +
+                    (now.tv_nsec - call_start_host.tv_nsec);
+  return elapsed * timing.host_scale;
+}
+
 // joybus_target_response_cb that records the target's response
 static void record_response(const uint8_t *data, uint8_t len, void *user_data)
 {
   TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(sizeof(response.data), len, "response larger than JOYBUS_BLOCK_SIZE");
   memcpy(response.data, data, len);
-  response.len     = len;
-  response.at_byte = current_byte;
-  response.seq     = ++event_seq;
+  response.len       = len;
+  response.at_byte   = current_byte;
+  response.seq       = ++event_seq;
+  response.commit_ns = in_command ? call_start_ns + call_elapsed_ns() : 0;
   response.count++;
 }
 
-// Deliver a complete command to the target byte-by-byte
+// Find the expected response point of a command, or NULL if it isn't listed
+static inline const struct harness_reply_point *harness_find_reply_point(uint8_t command)
+{
+  for (size_t i = 0; i < reply_point_override_count; i++) {
+    if (reply_point_overrides[i].command == command)
+      return &reply_point_overrides[i];
+  }
+
+  for (size_t i = 0; i < reply_point_count; i++) {
+    if (reply_points[i].command == command)
+      return &reply_points[i];
+  }
+
+  return NULL;
+}
+
+// Deliver a complete command to the target byte-by-byte, checking the reply deadline if the target responds
 static inline int send_command(const uint8_t *command, uint8_t len)
 {
+  int responses    = response.count;
+  uint32_t busy_ns = 0;
+  in_command       = true;
+  byte_calls       = 0;
+
   for (uint8_t i = 1; i <= len; i++) {
     // Keep track of the current byte index for error reporting
-    current_byte  = i;
+    current_byte = i;
+
+    // The call starts once the byte is in and the previous call has returned
+    call_start_ns = harness_byte_end_ns(i) > busy_ns ? harness_byte_end_ns(i) : busy_ns;
+    clock_gettime(CLOCK_MONOTONIC, &call_start_host);
 
     // Call the target's byte-received handler and check the result
     int remaining = joybus_target_byte_received(target_under_test, command, i, record_response, NULL);
-    if (remaining < 0)
+    byte_calls++;
+    busy_ns       = call_start_ns + call_elapsed_ns();
+    if (remaining < 0) {
+      in_command = false;
       return remaining;
+    }
 
     // Check that the handler reports the correct number of bytes remaining
-    TEST_ASSERT_EQUAL_MESSAGE(len - i, remaining, "bytes-remaining contract violated");
+    TEST_ASSERT_EQUAL_MESSAGE(len - i, joybus_target_bytes_expected(remaining), "bytes-remaining contract violated");
+
+    // Like a backend with bulk reception, skip straight to the last byte of a bulk payload
+    if (joybus_target_bulk(remaining) && !deliver_bulk_bytewise)
+      i = len - 1;
+  }
+
+  in_command = false;
+
+  // Check that the backend could start the reply within the turnaround after the stop bit
+  if (response.count != responses) {
+    const struct harness_reply_point *point = harness_find_reply_point(command[0]);
+    if (point) {
+      TEST_ASSERT_EQUAL_MESSAGE(point->at_byte, response.at_byte,
+                                "response committed at a different byte than expected");
+    }
+
+    // A response that needs the last byte can't be staged within a bit time, the console has to wait for it
+    uint32_t turnaround_ns = point && point->at_byte == len ? JOYBUS_REPLY_TIMEOUT_US * 1000 : timing.turnaround_ns;
+
+    int64_t deadline  = (int64_t)harness_stop_end_ns(len) + turnaround_ns - timing.lead_ns;
+    response.slack_ns = deadline - response.commit_ns;
+    TEST_ASSERT_TRUE_MESSAGE(response.slack_ns >= 0, "response committed too late for the reply turnaround");
   }
 
   return 0;
 }
 
+// Override the byte some commands' responses are expected at, until the next harness_reset()
+static inline void harness_set_reply_points(const struct harness_reply_point *points, size_t count)
+{
+  reply_point_overrides      = points;
+  reply_point_override_count = count;
+}
+
 // Point the harness at a target and clear all recorded state; call from setUp()
 static inline void harness_reset(struct joybus_target *target)
 {
   target_under_test = target;
+  harness_set_reply_points(NULL, 0);
+  reply_points      = harness_default_reply_points;
+  reply_point_count = sizeof(harness_default_reply_points) / sizeof(harness_default_reply_points[0]);
   memset(&response, 0, sizeof(response));
-  current_byte = 0;
-  event_seq    = 0;
+  current_byte          = 0;
+  in_command            = false;
+  deliver_bulk_bytewise = false;
+  event_seq             = 0;
+
+  // A target at the nominal bus frequency, replying within a bit time like an OEM controller, with a backend that
+  // takes 10 us to start a committed reply, like the rp2xxx and esp32 interrupt and DMA or RMT set-up, and handlers
+  // that take 1 us per byte
+  timing.freq          = JOYBUS_FREQ_NOMINAL;
+  timing.turnaround_ns = 4000;
+  timing.lead_ns       = 10000;
+  timing.handler_ns    = 1000;
+  timing.host_scale    = 1;
 }
@@ -0,0 +1,338 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/target/bridge.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+#include "unity.h"
+
+// How often the simulated main loop calls joybus_target_bridge_poll()
+#define MAIN_LOOP_US 5
+
+// Console polling period
+#define PERIOD_US    1000
+
+// The bridge under test
+static struct joybus_target_bridge bridge;
+
+// Console to bridge wire
+static struct joybus_loopback console_bus;
+static struct joybus_loopback bridge_target_bus;
+
+// Bridge to controller wire
+static struct joybus_loopback bridge_host_bus;
+static struct joybus_loopback controller_bus;
+
+// The real controller, and the controller the console sees
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+// Latest states read by the console
+static struct joybus_gcn_controller_state console_gcn;
+static struct joybus_n64_controller_state console_n64;
+
+static uint64_t now_us(void)
+{
+  return joybus_loopback_now_ns() / 1000;
+}
+
+// Wire up the console, the bridge and a controller for the given direction
+static void start_bridge(enum joybus_target_bridge_mode mode, bool plugged)
+{
+  // The console clocks out commands at its own rate
+  struct joybus_loopback_config console_config = joybus_loopback_config_default();
+
+  console_config.freq = mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN ? JOYBUS_FREQ_GCN_CONSOLE : JOYBUS_FREQ_N64_CONSOLE;
+
+  joybus_loopback_init(&console_bus, console_config);
+  joybus_loopback_init(&bridge_target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&console_bus, &bridge_target_bus);
+
+  joybus_loopback_init(&bridge_host_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&controller_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&bridge_host_bus, &controller_bus);
+
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_n64_controller_init(&n64_controller);
+
+  // The real controller is the other kind to the one the console sees
+  struct joybus_target_bridge_config config = joybus_target_bridge_config_default(mode);
+  if (mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+    joybus_attach_target(JOYBUS(&controller_bus), JOYBUS_TARGET(&n64_controller));
+    TEST_ASSERT_EQUAL_INT(
+      0, joybus_target_bridge_init(&bridge, JOYBUS(&bridge_host_bus), JOYBUS_TARGET(&gcn_controller), config));
+  } else {
+    joybus_attach_target(JOYBUS(&controller_bus), JOYBUS_TARGET(&gcn_controller));
+    TEST_ASSERT_EQUAL_INT(
+      0, joybus_target_bridge_init(&bridge, JOYBUS(&bridge_host_bus), JOYBUS_TARGET(&n64_controller), config));
+  }
+  joybus_attach_target(JOYBUS(&bridge_target_bus), JOYBUS_TARGET(&bridge));
+
+  joybus_enable(JOYBUS(&console_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&bridge_target_bus), JOYBUS_MODE_TARGET);
+  joybus_enable(JOYBUS(&bridge_host_bus), JOYBUS_MODE_HOST);
+  if (plugged)
+    joybus_enable(JOYBUS(&controller_bus), JOYBUS_MODE_TARGET);
+}
+
+// Run the main loop for a while
+static void run_for(uint32_t duration_us)
+{
+  uint64_t end = now_us() + duration_us;
+  while (now_us() < end) {
+    joybus_target_bridge_poll(&bridge);
+    joybus_loopback_run_until((now_us() + MAIN_LOOP_US) * 1000);
+  }
+}
+
+// Start a console read
+static void console_read(void)
+{
+  if (bridge.config.mode == JOYBUS_TARGET_BRIDGE_N64_TO_GCN) {
+    joybus_gcn_read_async(JOYBUS(&console_bus), JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &console_gcn, NULL,
+                          NULL);
+  } else {
+    joybus_n64_read_async(JOYBUS(&console_bus), &console_n64, NULL, NULL);
+  }
+}
+
+// Poll from the console a number of times, with an optional repeating jitter pattern
+static void console_polls(int count, uint32_t period_us, const int *jitter_us, int jitter_len)
+{
+  for (int i = 0; i < count; i++) {
+    run_for(period_us + (jitter_len ? jitter_us[i % jitter_len] : 0));
+    console_read();
+  }
+
+  // Let the last read complete
+  run_for(period_us);
+}
+
+void setUp(void)
+{
+  memset(&console_gcn, 0, sizeof(console_gcn));
+  memset(&console_n64, 0, sizeof(console_n64));
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&console_bus));
+  joybus_disable(JOYBUS(&bridge_target_bus));
+  joybus_disable(JOYBUS(&bridge_host_bus));
+  joybus_disable(JOYBUS(&controller_bus));
+}
+
+// ---------------------------------------------------------------------------
+// Translation
+// ---------------------------------------------------------------------------
+
+// Test that N64 buttons and stick positions reach a GameCube console
+static void test_n64_to_gcn_translation(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+
+  n64_controller.input.buttons = JOYBUS_N64_BUTTON_A | JOYBUS_N64_BUTTON_START | JOYBUS_N64_BUTTON_Z |
+                                 JOYBUS_N64_BUTTON_R | JOYBUS_N64_BUTTON_UP;
+  n64_controller.input.stick_x = 80;
+  n64_controller.input.stick_y = -40;
+  console_polls(3, PERIOD_US, NULL, 0);
+
+  uint16_t expected = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_START | JOYBUS_GCN_BUTTON_Z | JOYBUS_GCN_BUTTON_R |
+                      JOYBUS_GCN_BUTTON_UP;
+  TEST_ASSERT_EQUAL_HEX16(expected, console_gcn.buttons & JOYBUS_GCN_BUTTON_MASK);
+  TEST_ASSERT_EQUAL_HEX8(0x80 + 100, console_gcn.stick_x);
+  TEST_ASSERT_EQUAL_HEX8(0x80 - 50, console_gcn.stick_y);
+  TEST_ASSERT_EQUAL_HEX8(0x00, console_gcn.trigger_left);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, console_gcn.trigger_right);
+}
+
+// Test that N64 C buttons push the GameCube C-stick
+static void test_n64_c_buttons_drive_substick(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+
+  n64_controller.input.buttons = JOYBUS_N64_BUTTON_C_RIGHT | JOYBUS_N64_BUTTON_C_DOWN;
+  console_polls(3, PERIOD_US, NULL, 0);
+
+  TEST_ASSERT_EQUAL_HEX16(0, console_gcn.buttons & JOYBUS_GCN_BUTTON_MASK);
+  TEST_ASSERT_EQUAL_HEX8(0x80 + 100, console_gcn.substick_x);
+  TEST_ASSERT_EQUAL_HEX8(0x80 - 100, console_gcn.substick_y);
+}
+
+// Test that GameCube buttons, stick and C-stick reach an N64 console
+static void test_gcn_to_n64_translation(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_GCN_TO_N64, true);
+
+  gcn_controller.input.buttons    = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_X | JOYBUS_GCN_BUTTON_L |
+                                    JOYBUS_GCN_BUTTON_Z | JOYBUS_GCN_BUTTON_LEFT;
+  gcn_controller.input.stick_x    = 0x80 + 100;
+  gcn_controller.input.stick_y    = 0x80 - 50;
+  gcn_controller.input.substick_x = 0x80 - 60;
+  gcn_controller.input.substick_y = 0x80 + 10;
+  console_polls(3, PERIOD_US, NULL, 0);
+
+  uint16_t expected = JOYBUS_N64_BUTTON_A | JOYBUS_N64_BUTTON_C_DOWN | JOYBUS_N64_BUTTON_L | JOYBUS_N64_BUTTON_Z |
+                      JOYBUS_N64_BUTTON_LEFT | JOYBUS_N64_BUTTON_C_LEFT;
+  TEST_ASSERT_EQUAL_HEX16(expected, console_n64.buttons);
+  TEST_ASSERT_EQUAL_INT8(80, console_n64.stick_x);
+  TEST_ASSERT_EQUAL_INT8(-40, console_n64.stick_y);
+}
+
+// Test that the stick tables clamp at the ends of the range
+static void test_stick_table_clamps(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  TEST_ASSERT_EQUAL_HEX8(0x80, bridge.axis_lut[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, bridge.axis_lut[127]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, bridge.axis_lut[(uint8_t)-128]);
+
+  start_bridge(JOYBUS_TARGET_BRIDGE_GCN_TO_N64, true);
+  TEST_ASSERT_EQUAL_INT8(0, (int8_t)bridge.axis_lut[0x80]);
+  TEST_ASSERT_EQUAL_INT8(102, (int8_t)bridge.axis_lut[0xFF]);
+  TEST_ASSERT_EQUAL_INT8(-102, (int8_t)bridge.axis_lut[0x00]);
+}
+
+// Test that stick ranges the tables can't be built from are rejected
+static void test_invalid_ranges(void)
+{
+  static const uint8_t bad_ranges[]         = {0, 128, 255};
+  struct joybus_target_bridge_config config = joybus_target_bridge_config_default(JOYBUS_TARGET_BRIDGE_N64_TO_GCN);
+
+  for (size_t i = 0; i < sizeof(bad_ranges); i++) {
+    struct joybus_target_bridge_config bad = config;
+    bad.n64_range                          = bad_ranges[i];
+    TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID, joybus_target_bridge_init(&bridge, JOYBUS(&bridge_host_bus),
+                                                                         JOYBUS_TARGET(&gcn_controller), bad));
+
+    bad           = config;
+    bad.gcn_range = bad_ranges[i];
+    TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID, joybus_target_bridge_init(&bridge, JOYBUS(&bridge_host_bus),
+                                                                         JOYBUS_TARGET(&gcn_controller), bad));
+  }
+
+  // Full deflection on both sides is fine
+  config.n64_range = 127;
+  config.gcn_range = 127;
+  TEST_ASSERT_EQUAL_INT(
+    0, joybus_target_bridge_init(&bridge, JOYBUS(&bridge_host_bus), JOYBUS_TARGET(&gcn_controller), config));
+}
+
+// Test that the console sees a neutral controller while nothing is plugged in
+static void test_unplugged_controller(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, false);
+  gcn_controller.input.stick_x = 0x20;
+  console_polls(3, PERIOD_US, NULL, 0);
+
+  TEST_ASSERT_EQUAL_HEX8(0x80, console_gcn.stick_x);
+  TEST_ASSERT_EQUAL(0, bridge.data_us);
+}
+
+// ---------------------------------------------------------------------------
+// Read-ahead
+// ---------------------------------------------------------------------------
+
+// Test that the controller is read straight away, then once per console poll until locked
+static void test_reads_before_lock(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  TEST_ASSERT_EQUAL_UINT64(0, joybus_target_bridge_next_read_us(&bridge));
+
+  run_for(PERIOD_US);
+  TEST_ASSERT_EQUAL(1, bridge.reads);
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, joybus_target_bridge_next_read_us(&bridge));
+
+  console_polls(1, PERIOD_US, NULL, 0);
+  TEST_ASSERT_EQUAL(2, bridge.reads);
+  TEST_ASSERT_EQUAL(0, bridge.period_us);
+}
+
+// Test that the bridge locks onto the console period and reads once per poll
+static void test_locks_onto_console_period(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  console_polls(50, PERIOD_US, NULL, 0);
+
+  TEST_ASSERT_UINT32_WITHIN(MAIN_LOOP_US, PERIOD_US, bridge.period_us);
+  TEST_ASSERT_UINT32_WITHIN(2, bridge.polls, bridge.reads);
+}
+
+// Test that every console poll is served data within the maximum age once locked
+static void test_served_data_is_fresh(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_GCN_TO_N64, true);
+  console_polls(10, PERIOD_US, NULL, 0);
+
+  bridge.stale_polls = 0;
+  console_polls(200, PERIOD_US, NULL, 0);
+  TEST_ASSERT_EQUAL(0, bridge.stale_polls);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(bridge.config.max_age_us, bridge.last_age_us);
+}
+
+// Test that data stays fresh with a jittery console
+static void test_fresh_with_jitter(void)
+{
+  static const int jitter[] = {0, 40, -30, 10, -50, 20};
+
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  console_polls(10, PERIOD_US, jitter, 6);
+
+  bridge.stale_polls = 0;
+  console_polls(200, PERIOD_US, jitter, 6);
+  TEST_ASSERT_EQUAL(0, bridge.stale_polls);
+}
+
+// Test that a new console polling rate is picked up
+static void test_polling_rate_change(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  console_polls(20, PERIOD_US, NULL, 0);
+
+  console_polls(10, PERIOD_US * 4, NULL, 0);
+  TEST_ASSERT_UINT32_WITHIN(MAIN_LOOP_US * 4, PERIOD_US * 4, bridge.period_us);
+
+  bridge.stale_polls = 0;
+  console_polls(50, PERIOD_US * 4, NULL, 0);
+  TEST_ASSERT_EQUAL(0, bridge.stale_polls);
+}
+
+// Test that read-ahead serves fresher data than reading right after each poll
+static void test_fresher_than_naive(void)
+{
+  start_bridge(JOYBUS_TARGET_BRIDGE_N64_TO_GCN, true);
+  console_polls(1, PERIOD_US, NULL, 0);
+  TEST_ASSERT_GREATER_THAN_UINT32(bridge.config.max_age_us, bridge.last_age_us);
+
+  console_polls(20, PERIOD_US, NULL, 0);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(bridge.config.max_age_us, bridge.last_age_us);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  // Translation
+  RUN_TEST(test_n64_to_gcn_translation);
+  RUN_TEST(test_n64_c_buttons_drive_substick);
+  RUN_TEST(test_gcn_to_n64_translation);
+  RUN_TEST(test_stick_table_clamps);
+  RUN_TEST(test_invalid_ranges);
+  RUN_TEST(test_unplugged_controller);
+
+  // Read-ahead
+  RUN_TEST(test_reads_before_lock);
+  RUN_TEST(test_locks_onto_console_period);
+  RUN_TEST(test_served_data_is_fresh);
+  RUN_TEST(test_fresh_with_jitter);
+  RUN_TEST(test_polling_rate_change);
+  RUN_TEST(test_fresher_than_naive);
+
+  return UNITY_END();
+}
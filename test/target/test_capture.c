@@ -0,0 +1,312 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/target/capture.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+#include "unity.h"
+
+// Gap between console commands
+#define COMMAND_INTERVAL_US 500
+
+// The recorder under test
+static struct joybus_target_recorder recorder;
+static uint8_t capture[4096];
+static size_t capture_len;
+
+// Console to recorder wire
+static struct joybus_loopback console_bus;
+static struct joybus_loopback target_bus;
+
+// Recorded controllers, and fresh ones to replay against
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+static struct joybus_target_n64_rumble_pak rumble;
+static struct joybus_target_gcn_controller gcn_replay;
+static struct joybus_target_n64_controller n64_replay;
+static struct joybus_target_n64_rumble_pak rumble_replay;
+
+// Replay spies
+static int result_count;
+static int mismatch_count;
+static uint64_t total_handler_ns;
+static uint64_t wait_times[64];
+static int wait_count;
+
+// Fake nanosecond clock, ticking once per call
+static uint64_t fake_ns;
+static uint64_t tick_ns(void)
+{
+  return fake_ns += 100;
+}
+
+static void on_result(const struct joybus_capture_result *result, void *user_data)
+{
+  result_count++;
+  if (!result->match)
+    mismatch_count++;
+  total_handler_ns += result->handler_ns;
+}
+
+static void wait_until_us(uint64_t time_us, void *user_data)
+{
+  if (wait_count < 64)
+    wait_times[wait_count++] = time_us;
+}
+
+// Record a target on the far end of a loopback wire
+static void start_recording(struct joybus_target *target, size_t size)
+{
+  joybus_loopback_init(&console_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&console_bus, &target_bus);
+
+  TEST_ASSERT_EQUAL_INT(0, joybus_target_recorder_init(&recorder, JOYBUS(&target_bus), target, capture, size));
+  joybus_attach_target(JOYBUS(&target_bus), JOYBUS_TARGET(&recorder));
+
+  joybus_enable(JOYBUS(&console_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&target_bus), JOYBUS_MODE_TARGET);
+}
+
+static void stop_recording(void)
+{
+  joybus_disable(JOYBUS(&console_bus));
+  joybus_disable(JOYBUS(&target_bus));
+  capture_len = joybus_target_recorder_finish(&recorder);
+}
+
+// Send a command from the console, starting on the next command interval
+static void console_send(const uint8_t *command, uint8_t len, uint8_t response_len)
+{
+  static uint8_t response[JOYBUS_BLOCK_SIZE];
+
+  uint64_t next = (joybus_loopback_now_ns() / 1000 / COMMAND_INTERVAL_US + 1) * COMMAND_INTERVAL_US;
+  joybus_loopback_run_until(next * 1000);
+  joybus_transfer(JOYBUS(&console_bus), command, len, response, response_len, NULL, NULL);
+  joybus_loopback_run();
+}
+
+// A short GameCube session: identify, origin, and reads with changing input
+static void record_gcn_session(void)
+{
+  static const uint8_t identify[] = {JOYBUS_CMD_IDENTIFY};
+  static const uint8_t origin[]   = {JOYBUS_CMD_GCN_READ_ORIGIN};
+  static const uint8_t read[]     = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+
+  start_recording(JOYBUS_TARGET(&gcn_controller), sizeof(capture));
+  console_send(identify, sizeof(identify), JOYBUS_CMD_IDENTIFY_RX);
+  console_send(origin, sizeof(origin), JOYBUS_CMD_GCN_READ_ORIGIN_RX);
+  for (int i = 0; i < 8; i++) {
+    gcn_controller.input.stick_x = 0x80 + i * 4;
+    console_send(read, sizeof(read), JOYBUS_CMD_GCN_READ_RX);
+  }
+  stop_recording();
+}
+
+void setUp(void)
+{
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  joybus_target_gcn_controller_init(&gcn_replay);
+  joybus_target_gcn_controller_input_valid(&gcn_replay, true);
+  joybus_target_n64_controller_init(&n64_controller);
+  joybus_target_n64_controller_init(&n64_replay);
+
+  result_count     = 0;
+  mismatch_count   = 0;
+  total_handler_ns = 0;
+  wait_count       = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+// ---------------------------------------------------------------------------
+
+// Test that every command is recorded with its response and start time
+static void test_record_gcn_session(void)
+{
+  record_gcn_session();
+  TEST_ASSERT_EQUAL_UINT32(10, recorder.records);
+  TEST_ASSERT_EQUAL_UINT32(0, recorder.dropped);
+
+  struct joybus_capture_reader reader;
+  struct joybus_capture_record record;
+  TEST_ASSERT_EQUAL_INT(0, joybus_capture_reader_init(&reader, capture, capture_len));
+
+  // Identify
+  TEST_ASSERT_EQUAL_INT(1, joybus_capture_reader_next(&reader, &record));
+  TEST_ASSERT_EQUAL_HEX8(JOYBUS_CMD_IDENTIFY, record.command[0]);
+  TEST_ASSERT_EQUAL_UINT8(JOYBUS_CMD_IDENTIFY_RX, record.response_len);
+  uint64_t first_us = record.time_us;
+
+  // Origin, one interval later
+  TEST_ASSERT_EQUAL_INT(1, joybus_capture_reader_next(&reader, &record));
+  TEST_ASSERT_EQUAL_HEX8(JOYBUS_CMD_GCN_READ_ORIGIN, record.command[0]);
+  TEST_ASSERT_UINT64_WITHIN(1, COMMAND_INTERVAL_US, record.time_us - first_us);
+
+  // Reads carry the changing stick position
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_INT(1, joybus_capture_reader_next(&reader, &record));
+    TEST_ASSERT_EQUAL_UINT8(JOYBUS_CMD_GCN_READ_TX, record.command_len);
+    TEST_ASSERT_EQUAL_UINT8(JOYBUS_CMD_GCN_READ_RX, record.response_len);
+    TEST_ASSERT_EQUAL_HEX8(0x80 + i * 4, record.response[2]);
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, joybus_capture_reader_next(&reader, &record));
+}
+
+// Test that commands the target rejects are recorded without a response
+static void test_record_unsupported_command(void)
+{
+  static const uint8_t bogus[] = {0x99};
+
+  start_recording(JOYBUS_TARGET(&gcn_controller), sizeof(capture));
+  console_send(bogus, sizeof(bogus), 4);
+  stop_recording();
+
+  struct joybus_capture_reader reader;
+  struct joybus_capture_record record;
+  joybus_capture_reader_init(&reader, capture, capture_len);
+  TEST_ASSERT_EQUAL_INT(1, joybus_capture_reader_next(&reader, &record));
+  TEST_ASSERT_EQUAL_HEX8(0x99, record.command[0]);
+  TEST_ASSERT_EQUAL_UINT8(0, record.response_len);
+}
+
+// Test that commands that don't fit are dropped and counted
+static void test_record_buffer_full(void)
+{
+  static const uint8_t read[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+  size_t record_len           = JOYBUS_CAPTURE_RECORD_LEN + JOYBUS_CMD_GCN_READ_TX + JOYBUS_CMD_GCN_READ_RX;
+
+  start_recording(JOYBUS_TARGET(&gcn_controller), JOYBUS_CAPTURE_HEADER_LEN + 2 * record_len);
+  for (int i = 0; i < 4; i++)
+    console_send(read, sizeof(read), JOYBUS_CMD_GCN_READ_RX);
+  stop_recording();
+
+  TEST_ASSERT_EQUAL_UINT32(2, recorder.records);
+  TEST_ASSERT_EQUAL_UINT32(2, recorder.dropped);
+  TEST_ASSERT_EQUAL_UINT32(JOYBUS_CAPTURE_HEADER_LEN + 2 * record_len, capture_len);
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+// Test that replay reports the responses that differ from the capture, and times the handler
+static void test_replay_detects_changes(void)
+{
+  record_gcn_session();
+
+  struct joybus_capture_replay_config config = {
+    .now_ns    = tick_ns,
+    .on_result = on_result,
+  };
+
+  gcn_replay.input.stick_x = 0x80;
+  int mismatches           = joybus_capture_replay(capture, capture_len, JOYBUS_TARGET(&gcn_replay), &config);
+
+  // Only the first read matches, the stick never moves during replay
+  TEST_ASSERT_EQUAL_INT(7, mismatches);
+  TEST_ASSERT_EQUAL_INT(10, result_count);
+
+  // Handler time is measured for every byte delivered
+  TEST_ASSERT_GREATER_THAN_UINT64(0, total_handler_ns);
+}
+
+// Test that replaying against an identical controller matches, at the recorded times
+static void test_replay_gcn_timing(void)
+{
+  static const uint8_t read[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+
+  start_recording(JOYBUS_TARGET(&gcn_controller), sizeof(capture));
+  for (int i = 0; i < 5; i++)
+    console_send(read, sizeof(read), JOYBUS_CMD_GCN_READ_RX);
+  stop_recording();
+
+  struct joybus_capture_replay_config config = {
+    .wait_until_us = wait_until_us,
+    .on_result     = on_result,
+  };
+  TEST_ASSERT_EQUAL_INT(0, joybus_capture_replay(capture, capture_len, JOYBUS_TARGET(&gcn_replay), &config));
+
+  // Commands are replayed at their recorded offsets
+  TEST_ASSERT_EQUAL_INT(5, wait_count);
+  for (int i = 1; i < 5; i++)
+    TEST_ASSERT_UINT64_WITHIN(1, COMMAND_INTERVAL_US, wait_times[i] - wait_times[i - 1]);
+}
+
+// Test that an N64 session with pak traffic replays against a fresh controller and pak
+static void test_replay_n64_pak_session(void)
+{
+  static const uint8_t read[] = {JOYBUS_CMD_N64_READ};
+  uint8_t write[JOYBUS_CMD_N64_PAK_WRITE_TX];
+  uint16_t addr = 0x8000 | joybus_address_checksum(0x8000 >> 5);
+
+  write[0] = JOYBUS_CMD_N64_PAK_WRITE;
+  write[1] = addr >> 8;
+  write[2] = addr & 0xFF;
+  memset(&write[3], 0x80, JOYBUS_PAK_BLOCK_SIZE);
+
+  joybus_target_n64_rumble_pak_init(&rumble);
+  joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble));
+  joybus_target_n64_rumble_pak_init(&rumble_replay);
+  joybus_target_n64_controller_attach_pak(&n64_replay, JOYBUS_TARGET_N64_PAK(&rumble_replay));
+
+  start_recording(JOYBUS_TARGET(&n64_controller), sizeof(capture));
+  console_send(read, sizeof(read), JOYBUS_CMD_N64_READ_RX);
+  console_send(write, sizeof(write), JOYBUS_CMD_N64_PAK_WRITE_RX);
+  console_send(read, sizeof(read), JOYBUS_CMD_N64_READ_RX);
+  stop_recording();
+
+  struct joybus_capture_replay_config config = {
+    .on_result = on_result,
+  };
+  TEST_ASSERT_EQUAL_INT(0, joybus_capture_replay(capture, capture_len, JOYBUS_TARGET(&n64_replay), &config));
+  TEST_ASSERT_EQUAL_INT(3, result_count);
+  TEST_ASSERT_TRUE(rumble_replay.enabled);
+}
+
+// Test that malformed captures are rejected
+static void test_replay_malformed(void)
+{
+  struct joybus_capture_replay_config config = {0};
+
+  record_gcn_session();
+
+  // Truncated mid-record
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID,
+                        joybus_capture_replay(capture, capture_len - 1, JOYBUS_TARGET(&gcn_replay), &config));
+
+  // Bad magic
+  capture[0] = 'X';
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID,
+                        joybus_capture_replay(capture, capture_len, JOYBUS_TARGET(&gcn_replay), &config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // Recording
+  RUN_TEST(test_record_gcn_session);
+  RUN_TEST(test_record_unsupported_command);
+  RUN_TEST(test_record_buffer_full);
+
+  // Replay
+  RUN_TEST(test_replay_detects_changes);
+  RUN_TEST(test_replay_gcn_timing);
+  RUN_TEST(test_replay_n64_pak_session);
+  RUN_TEST(test_replay_malformed);
+
+  return UNITY_END();
+}
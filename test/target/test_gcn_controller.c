@@ -206,6 +206,21 @@ static void test_read_responds_at_second_byte(void)
   TEST_ASSERT_EQUAL(JOYBUS_CMD_GCN_READ_RX, response.len);
 }
 
+// Test that read commits its response early enough for a backend that needs 20 us to stage a reply, which it couldn't
+// do waiting for the motor byte
+static void test_read_meets_deadline_with_slow_backend(void)
+{
+  timing.lead_ns = 20000;
+
+  // Every mode responds at the second byte, packed modes included
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_0, JOYBUS_GCN_MOTOR_STOP};
+  TEST_ASSERT_EQUAL_INT(0, send_command(command, sizeof(command)));
+
+  // Committed 1 us into the second byte's handler, 19 us before the reply has to be staged
+  TEST_ASSERT_EQUAL(2 * 8 * 4000 + 1000, response.commit_ns);
+  TEST_ASSERT_EQUAL(19000, response.slack_ns);
+}
+
 // Test the 8-byte input packing for every analog mode
 static void test_read_pack_matrix(void)
 {
@@ -389,6 +404,16 @@ static void test_read_long_returns_full_state(void)
   TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response.data, sizeof(expected));
 }
 
+// Test that read long commits its response early enough for a backend that needs 20 us to stage a reply
+static void test_read_long_meets_deadline_with_slow_backend(void)
+{
+  timing.lead_ns = 20000;
+
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ_LONG, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+  TEST_ASSERT_EQUAL_INT(0, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL(2, response.at_byte);
+}
+
 // Test that "read long" masks the analog mode and motor state before latching them
 static void test_read_long_masks_mode_and_motor(void)
 {
@@ -691,6 +716,7 @@ int main(void)
 
   // Read
   RUN_TEST(test_read_responds_at_second_byte);
+  RUN_TEST(test_read_meets_deadline_with_slow_backend);
   RUN_TEST(test_read_pack_matrix);
   RUN_TEST(test_read_uses_origin_when_input_invalid);
   RUN_TEST(test_read_latches_flags);
@@ -705,6 +731,7 @@ int main(void)
 
   // Read long
   RUN_TEST(test_read_long_returns_full_state);
+  RUN_TEST(test_read_long_meets_deadline_with_slow_backend);
   RUN_TEST(test_read_long_masks_mode_and_motor);
 
   // Probe device
@@ -0,0 +1,175 @@
+/*
+ * Self-tests for the target test harness.
+ *
+ * The target suites rely on send_command() failing when a response is
+ * committed too late for the backend to start the reply, so these tests drive
+ * it with a fake target that answers a three-byte command at a chosen byte.
+ * A deadline miss aborts the test that hit it, so the late cases run
+ * send_command() in a forked child and check that it failed there.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Command handled by the fake target, not one of the harness defaults, and its lengths
+#define FAKE_CMD    0x7E
+#define FAKE_CMD_TX 3
+#define FAKE_CMD_RX 3
+
+// Fake target that answers any three-byte command once reply_at bytes are in
+static uint8_t reply_at;
+
+static int fake_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
+                              joybus_target_response_cb send_response, void *user_data)
+{
+  if (byte_idx == reply_at) {
+    static const uint8_t reply[FAKE_CMD_RX] = {0x01, 0x02, 0x03};
+    send_response(reply, sizeof(reply), user_data);
+  }
+
+  return FAKE_CMD_TX - byte_idx;
+}
+
+static const struct joybus_target_api fake_api = {
+  .byte_received = fake_byte_received,
+};
+
+static struct joybus_target fake_target = {.api = &fake_api};
+
+// The command sent to the fake target
+static uint8_t command[FAKE_CMD_TX];
+
+void setUp(void)
+{
+  harness_reset(&fake_target);
+  memset(command, 0, sizeof(command));
+  command[0] = FAKE_CMD;
+}
+
+void tearDown(void)
+{
+}
+
+// Run send_command() in a child process, returning whether it passed
+static bool send_command_passes(void)
+{
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Keep the child's failure report out of the test output
+    if (!freopen("/dev/null", "w", stdout))
+      _exit(2);
+
+    if (TEST_PROTECT()) {
+      send_command(command, sizeof(command));
+      _exit(0);
+    }
+    _exit(1);
+  }
+
+  int wstatus;
+  TEST_ASSERT_TRUE(pid > 0 && waitpid(pid, &wstatus, 0) == pid);
+  TEST_ASSERT_TRUE(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) != 2);
+
+  return WEXITSTATUS(wstatus) == 0;
+}
+
+// Test that a response committed before the last byte meets the default deadline
+static void test_early_response_passes(void)
+{
+  reply_at = 2;
+  TEST_ASSERT_EQUAL_INT(0, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL(2, response.at_byte);
+  TEST_ASSERT_TRUE(response.slack_ns >= 0);
+}
+
+// Test that a response waiting for the last byte fails the deadline with the default backend lead
+static void test_late_response_fails(void)
+{
+  reply_at = 3;
+  TEST_ASSERT_FALSE(send_command_passes());
+}
+
+// Test that a response at a different byte than the suite listed fails
+static void test_unexpected_reply_point_fails(void)
+{
+  static const struct harness_reply_point points[] = {{FAKE_CMD, 2}};
+  harness_set_reply_points(points, 1);
+
+  reply_at = 1;
+  TEST_ASSERT_FALSE(send_command_passes());
+}
+
+// Test that the standard commands are checked against the default response points
+static void test_default_reply_point_fails(void)
+{
+  // GameCube reads respond at the second byte
+  command[0] = JOYBUS_CMD_GCN_READ;
+  reply_at   = 1;
+  TEST_ASSERT_FALSE(send_command_passes());
+
+  reply_at = 2;
+  TEST_ASSERT_TRUE(send_command_passes());
+}
+
+// Test that a suite's override replaces the default response point
+static void test_override_replaces_default(void)
+{
+  static const struct harness_reply_point points[] = {{JOYBUS_CMD_GCN_READ, 1}};
+  harness_set_reply_points(points, 1);
+
+  command[0] = JOYBUS_CMD_GCN_READ;
+  reply_at   = 1;
+  TEST_ASSERT_TRUE(send_command_passes());
+
+  // Until the next reset
+  harness_reset(&fake_target);
+  TEST_ASSERT_FALSE(send_command_passes());
+}
+
+// Test that a command listed as needing its last byte is held to the console's reply timeout instead
+static void test_last_byte_reply_point_passes(void)
+{
+  static const struct harness_reply_point points[] = {{FAKE_CMD, FAKE_CMD_TX}};
+  harness_set_reply_points(points, 1);
+
+  reply_at = 3;
+  TEST_ASSERT_TRUE(send_command_passes());
+}
+
+// Test that a response listed at the last byte still fails if the target is slower than the console's reply timeout
+static void test_last_byte_reply_point_fails_when_slow(void)
+{
+  static const struct harness_reply_point points[] = {{FAKE_CMD, FAKE_CMD_TX}};
+  harness_set_reply_points(points, 1);
+
+  reply_at          = 3;
+  timing.handler_ns = JOYBUS_REPLY_TIMEOUT_US * 1000;
+  TEST_ASSERT_FALSE(send_command_passes());
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_early_response_passes);
+  RUN_TEST(test_late_response_fails);
+  RUN_TEST(test_unexpected_reply_point_fails);
+  RUN_TEST(test_default_reply_point_fails);
+  RUN_TEST(test_override_replaces_default);
+  RUN_TEST(test_last_byte_reply_point_passes);
+  RUN_TEST(test_last_byte_reply_point_fails_when_slow);
+
+  return UNITY_END();
+}
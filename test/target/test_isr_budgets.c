@@ -0,0 +1,347 @@
+/*
+ * Instruction-count budgets for the target command handlers.
+ *
+ * Target handlers run in interrupt context, on the reply critical path, so a
+ * change that makes a handler slower eats directly into the time the backend
+ * has to start the reply. Each test delivers a complete command to a fresh
+ * target through joybus_target_byte_received(), counts the instructions
+ * retired while doing so, and fails if the count exceeds the checked-in
+ * budget for that command. Commands delivered a byte at a time also have the
+ * last byte counted on its own, as that is what delays the reply.
+ *
+ * Instructions are counted by single-stepping a forked child with ptrace, so
+ * the counts are exact and repeatable without valgrind or access to the
+ * performance counters. The budgets were measured on x86_64 at -O2 and have
+ * about 25% headroom for compiler differences, they aren't enforced on other
+ * architectures, where the tests only report the counts. If a change adds
+ * work to a handler on purpose, raise the budget in the table below along
+ * with it.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/target.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+
+#include "unity.h"
+
+// Budgets are only meaningful for the architecture they were measured on
+#if defined(__x86_64__)
+#define BUDGETS_ENFORCED 1
+#else
+#define BUDGETS_ENFORCED 0
+#endif
+
+// Instructions retired delivering each command, including the target's dispatch
+#define BUDGET_GCN_RESET          75
+#define BUDGET_GCN_IDENTIFY       70
+#define BUDGET_GCN_READ           210
+#define BUDGET_GCN_READ_ORIGIN    80
+#define BUDGET_GCN_CALIBRATE      190
+#define BUDGET_GCN_READ_LONG      210
+#define BUDGET_GCN_PROBE_DEVICE   180
+#define BUDGET_GCN_FIX_DEVICE     190
+#define BUDGET_N64_RESET          90
+#define BUDGET_N64_IDENTIFY       90
+#define BUDGET_N64_READ           120
+#define BUDGET_N64_PAK_READ       580
+#define BUDGET_N64_PAK_WRITE      580
+#define BUDGET_N64_PAK_WRITE_BYTE 3600
+#define BUDGET_N64_PAK_WRITE_LAST 140
+
+// The targets under test
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+static struct joybus_target_n64_rumble_pak rumble_pak;
+
+// Length of the last response, reported back to the parent as the child's exit status
+static uint8_t response_len;
+
+// Set to call the target for every byte of a bulk payload, as capture replay and backends without bulk reception do
+static bool bulk_bytewise;
+
+// Set to only count the last byte of a command, the part of a bytewise delivery on the reply critical path
+static bool last_byte_only;
+
+// joybus_target_response_cb that only records the response length, to keep its cost out of the counts
+static void record_response(const uint8_t *data, uint8_t len, void *user_data)
+{
+  response_len = len;
+}
+
+// Deliver bytes first to last of a command byte-by-byte, as a backend's receive interrupt would
+__attribute__((noinline)) static void deliver(struct joybus_target *target, const uint8_t *command, uint8_t first,
+                                              uint8_t len)
+{
+  for (uint8_t i = first; i <= len; i++) {
+    int rc = joybus_target_byte_received(target, command, i, record_response, NULL);
+    if (rc < 0)
+      return;
+
+    // A bulk payload arrives in one go
+    if (joybus_target_bulk(rc) && !bulk_bytewise)
+      i = len - 1;
+  }
+}
+
+// Count the instructions retired delivering a command in a traced child
+// Returns the count, or -1 if the child can't be traced
+static long trace_deliver(struct joybus_target *target, const uint8_t *command, uint8_t len, int *status)
+{
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Stop until the parent starts stepping, then mark the end of the region with SIGUSR2
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
+      _exit(255);
+
+    // Everything before the counted region goes in first
+    uint8_t first = 1;
+    if (last_byte_only) {
+      deliver(target, command, 1, len - 1);
+      first = len;
+    }
+
+    raise(SIGSTOP);
+    deliver(target, command, first, len);
+    raise(SIGUSR2);
+    _exit(response_len);
+  }
+
+  int wstatus;
+  if (pid < 0 || waitpid(pid, &wstatus, 0) < 0 || !WIFSTOPPED(wstatus))
+    return -1;
+
+  // Step until the end marker
+  long count = 0;
+  for (;;) {
+    if (ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL) < 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, &wstatus, 0);
+      return -1;
+    }
+
+    waitpid(pid, &wstatus, 0);
+    if (!WIFSTOPPED(wstatus) || WSTOPSIG(wstatus) != SIGTRAP)
+      break;
+
+    count++;
+  }
+
+  // Let the child run to completion, suppressing the marker signal
+  if (WIFSTOPPED(wstatus)) {
+    ptrace(PTRACE_CONT, pid, NULL, NULL);
+    waitpid(pid, &wstatus, 0);
+  }
+
+  *status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1;
+  return count;
+}
+
+// Instructions counted for an empty region, subtracted from each measurement
+static long overhead;
+
+// Measure a command and check it against its budget
+static void check_budget(const char *name, struct joybus_target *target, const uint8_t *command, uint8_t len,
+                         uint8_t expected_len, long budget)
+{
+  int status = -1;
+  long count = trace_deliver(target, command, len, &status);
+  if (count < 0 || overhead < 0)
+    TEST_IGNORE_MESSAGE("ptrace unavailable, can't count instructions");
+
+  // The command must have taken the path it's budgeted for
+  TEST_ASSERT_EQUAL_MESSAGE(expected_len, status, "unexpected response length");
+
+  count -= overhead;
+  printf("%-24s %6ld / %6ld instructions\n", name, count, budget);
+
+  if (BUDGETS_ENFORCED && count > budget) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s took %ld instructions, over its budget of %ld", name, count, budget);
+    TEST_FAIL_MESSAGE(message);
+  }
+}
+
+void setUp(void)
+{
+  bulk_bytewise  = false;
+  last_byte_only = false;
+  joybus_target_gcn_controller_init(&gcn_controller);
+
+  // An N64 controller with a rumble pak, as the pak commands are the most expensive
+  joybus_target_n64_controller_init(&n64_controller);
+  joybus_target_n64_rumble_pak_init(&rumble_pak);
+  joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble_pak));
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// GameCube controller
+// ---------------------------------------------------------------------------
+
+static void test_gcn_reset(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_RESET};
+  check_budget("gcn reset", JOYBUS_TARGET(&gcn_controller), command, sizeof(command), JOYBUS_CMD_RESET_RX,
+               BUDGET_GCN_RESET);
+}
+
+static void test_gcn_identify(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_IDENTIFY};
+  check_budget("gcn identify", JOYBUS_TARGET(&gcn_controller), command, sizeof(command), JOYBUS_CMD_IDENTIFY_RX,
+               BUDGET_GCN_IDENTIFY);
+}
+
+static void test_gcn_read(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, 0x00};
+  check_budget("gcn read", JOYBUS_TARGET(&gcn_controller), command, sizeof(command), JOYBUS_CMD_GCN_READ_RX,
+               BUDGET_GCN_READ);
+}
+
+static void test_gcn_read_origin(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ_ORIGIN};
+  check_budget("gcn read origin", JOYBUS_TARGET(&gcn_controller), command, sizeof(command),
+               JOYBUS_CMD_GCN_READ_ORIGIN_RX, BUDGET_GCN_READ_ORIGIN);
+}
+
+static void test_gcn_calibrate(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_CALIBRATE, 0x00, 0x00};
+  check_budget("gcn calibrate", JOYBUS_TARGET(&gcn_controller), command, sizeof(command), JOYBUS_CMD_GCN_CALIBRATE_RX,
+               BUDGET_GCN_CALIBRATE);
+}
+
+static void test_gcn_read_long(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ_LONG, 0x00, 0x00};
+  check_budget("gcn read long", JOYBUS_TARGET(&gcn_controller), command, sizeof(command), JOYBUS_CMD_GCN_READ_LONG_RX,
+               BUDGET_GCN_READ_LONG);
+}
+
+static void test_gcn_probe_device(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_PROBE_DEVICE, 0x00, 0x00};
+  check_budget("gcn probe device", JOYBUS_TARGET(&gcn_controller), command, sizeof(command),
+               JOYBUS_CMD_GCN_PROBE_DEVICE_RX, BUDGET_GCN_PROBE_DEVICE);
+}
+
+static void test_gcn_fix_device(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_GCN_FIX_DEVICE, 0x12, 0x34};
+  check_budget("gcn fix device", JOYBUS_TARGET(&gcn_controller), command, sizeof(command),
+               JOYBUS_CMD_GCN_FIX_DEVICE_RX, BUDGET_GCN_FIX_DEVICE);
+}
+
+// ---------------------------------------------------------------------------
+// N64 controller
+// ---------------------------------------------------------------------------
+
+static void test_n64_reset(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_RESET};
+  check_budget("n64 reset", JOYBUS_TARGET(&n64_controller), command, sizeof(command), JOYBUS_CMD_RESET_RX,
+               BUDGET_N64_RESET);
+}
+
+static void test_n64_identify(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_IDENTIFY};
+  check_budget("n64 identify", JOYBUS_TARGET(&n64_controller), command, sizeof(command), JOYBUS_CMD_IDENTIFY_RX,
+               BUDGET_N64_IDENTIFY);
+}
+
+static void test_n64_read(void)
+{
+  uint8_t command[] = {JOYBUS_CMD_N64_READ};
+  check_budget("n64 read", JOYBUS_TARGET(&n64_controller), command, sizeof(command), JOYBUS_CMD_N64_READ_RX,
+               BUDGET_N64_READ);
+}
+
+static void test_n64_pak_read(void)
+{
+  // Read the rumble pak's probe block at 0x8000
+  uint16_t addr     = 0x8000 | joybus_address_checksum(0x8000 >> 5);
+  uint8_t command[] = {JOYBUS_CMD_N64_PAK_READ, addr >> 8, addr & 0xFF};
+  check_budget("n64 pak read", JOYBUS_TARGET(&n64_controller), command, sizeof(command), JOYBUS_CMD_N64_PAK_READ_RX,
+               BUDGET_N64_PAK_READ);
+}
+
+static void test_n64_pak_write(void)
+{
+  // Start the rumble motor
+  uint16_t addr                                = 0xC000 | joybus_address_checksum(0xC000 >> 5);
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX] = {JOYBUS_CMD_N64_PAK_WRITE, addr >> 8, addr & 0xFF};
+  memset(&command[3], 0x01, JOYBUS_PAK_BLOCK_SIZE);
+  check_budget("n64 pak write", JOYBUS_TARGET(&n64_controller), command, sizeof(command), JOYBUS_CMD_N64_PAK_WRITE_RX,
+               BUDGET_N64_PAK_WRITE);
+}
+
+static void test_n64_pak_write_byte_at_a_time(void)
+{
+  // The same write with the target called for every payload byte
+  uint16_t addr                                = 0xC000 | joybus_address_checksum(0xC000 >> 5);
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX] = {JOYBUS_CMD_N64_PAK_WRITE, addr >> 8, addr & 0xFF};
+  memset(&command[3], 0x01, JOYBUS_PAK_BLOCK_SIZE);
+  bulk_bytewise = true;
+  check_budget("n64 pak write bytewise", JOYBUS_TARGET(&n64_controller), command, sizeof(command),
+               JOYBUS_CMD_N64_PAK_WRITE_RX, BUDGET_N64_PAK_WRITE_BYTE);
+}
+
+static void test_n64_pak_write_last_byte(void)
+{
+  // The same bytewise write, counting only the call for the last byte, which has to produce the CRC
+  uint16_t addr                                = 0xC000 | joybus_address_checksum(0xC000 >> 5);
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX] = {JOYBUS_CMD_N64_PAK_WRITE, addr >> 8, addr & 0xFF};
+  memset(&command[3], 0x01, JOYBUS_PAK_BLOCK_SIZE);
+  bulk_bytewise  = true;
+  last_byte_only = true;
+  check_budget("n64 pak write last byte", JOYBUS_TARGET(&n64_controller), command, sizeof(command),
+               JOYBUS_CMD_N64_PAK_WRITE_RX, BUDGET_N64_PAK_WRITE_LAST);
+}
+
+int main(void)
+{
+  // Calibrate out the cost of the markers around the region
+  int status;
+  overhead = trace_deliver(JOYBUS_TARGET(&gcn_controller), NULL, 0, &status);
+
+  UNITY_BEGIN();
+
+  // GameCube controller
+  RUN_TEST(test_gcn_reset);
+  RUN_TEST(test_gcn_identify);
+  RUN_TEST(test_gcn_read);
+  RUN_TEST(test_gcn_read_origin);
+  RUN_TEST(test_gcn_calibrate);
+  RUN_TEST(test_gcn_read_long);
+  RUN_TEST(test_gcn_probe_device);
+  RUN_TEST(test_gcn_fix_device);
+
+  // N64 controller
+  RUN_TEST(test_n64_reset);
+  RUN_TEST(test_n64_identify);
+  RUN_TEST(test_n64_read);
+  RUN_TEST(test_n64_pak_read);
+  RUN_TEST(test_n64_pak_write);
+  RUN_TEST(test_n64_pak_write_byte_at_a_time);
+  RUN_TEST(test_n64_pak_write_last_byte);
+
+  return UNITY_END();
+}
@@ -461,6 +461,7 @@ static void test_pak_write_commits_to_pak(void)
   uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX];
   build_pak_write(command, valid_pak_addr(0x8000), payload);
   send_command(command, sizeof(command));
+  TEST_ASSERT_EQUAL(4, byte_calls);
 
   TEST_ASSERT_EQUAL(1, response.count);
   TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_WRITE_TX, response.at_byte);
@@ -474,6 +475,48 @@ static void test_pak_write_commits_to_pak(void)
   TEST_ASSERT_TRUE(response.seq < write_block_seq);
 }
 
+// Test that a pak write delivered a byte at a time, as capture replay and backends without bulk reception do, responds
+// only once the payload is in and commits the same block
+static void test_pak_write_byte_at_a_time(void)
+{
+  joybus_target_n64_controller_attach_pak(&controller, &pak);
+
+  uint8_t payload[JOYBUS_PAK_BLOCK_SIZE];
+  fill_payload(payload);
+
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX];
+  build_pak_write(command, valid_pak_addr(0x8000), payload);
+  deliver_bulk_bytewise = true;
+  TEST_ASSERT_EQUAL_INT(0, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_WRITE_TX, byte_calls);
+
+  TEST_ASSERT_EQUAL(1, response.count);
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_WRITE_TX, response.at_byte);
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_WRITE_RX, response.len);
+  TEST_ASSERT_EQUAL_HEX8(joybus_data_checksum(payload, sizeof(payload)), response.data[0]);
+
+  TEST_ASSERT_EQUAL(1, write_block_count);
+  TEST_ASSERT_EQUAL_HEX16(0x8000, write_block_addr);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, write_block_data, sizeof(payload));
+}
+
+// Test that the CRC folded a byte at a time starts afresh for each write
+static void test_pak_write_byte_at_a_time_repeated(void)
+{
+  joybus_target_n64_controller_attach_pak(&controller, &pak);
+
+  uint8_t payload[JOYBUS_PAK_BLOCK_SIZE];
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX];
+  deliver_bulk_bytewise = true;
+  for (int i = 0; i < 2; i++) {
+    fill_payload(payload);
+    payload[0] ^= i;
+    build_pak_write(command, valid_pak_addr(0x8000), payload);
+    TEST_ASSERT_EQUAL_INT(0, send_command(command, sizeof(command)));
+    TEST_ASSERT_EQUAL_HEX8(joybus_data_checksum(payload, sizeof(payload)), response.data[0]);
+  }
+}
+
 // Test that a pak write with no pak attached responds with the inverted "no pak" CRC and never reaches a pak
 static void test_pak_write_no_pak(void)
 {
@@ -626,6 +669,8 @@ int main(void)
 
   // Pak write
   RUN_TEST(test_pak_write_commits_to_pak);
+  RUN_TEST(test_pak_write_byte_at_a_time);
+  RUN_TEST(test_pak_write_byte_at_a_time_repeated);
   RUN_TEST(test_pak_write_no_pak);
   RUN_TEST(test_pak_write_refused_while_pak_changed);
   RUN_TEST(test_pak_write_bad_checksum);
@@ -0,0 +1,313 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+#include <joybus/common/gcn_controller.h>
+#include <joybus/common/n64_controller.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/playback.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// The playback target under test, and the controllers it drives
+static struct joybus_target_playback playback;
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+// Stream buffer and encoder
+static uint8_t stream[4096];
+static struct joybus_playback_encoder encoder;
+
+static const uint8_t gcn_read[]     = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+static const uint8_t n64_read[]     = {JOYBUS_CMD_N64_READ};
+static const uint8_t identify_cmd[] = {JOYBUS_CMD_IDENTIFY};
+
+// GameCube frame with a recognizable pattern for frame n
+static struct joybus_gcn_controller_state gcn_frame(int n)
+{
+  return (struct joybus_gcn_controller_state){
+    .buttons       = (n & 1 ? JOYBUS_GCN_BUTTON_A : 0) | (n & 2 ? JOYBUS_GCN_BUTTON_Z : 0),
+    .stick_x       = 0x80 + n / 4,
+    .stick_y       = 0x80,
+    .substick_x    = 0x80,
+    .substick_y    = 0x80 - n / 8,
+    .trigger_left  = 0,
+    .trigger_right = n % 3 ? 0x20 : 0,
+  };
+}
+
+// N64 frame with a recognizable pattern for frame n
+static struct joybus_n64_controller_state n64_frame(int n)
+{
+  return (struct joybus_n64_controller_state){
+    .buttons = n & 1 ? JOYBUS_N64_BUTTON_A : 0,
+    .stick_x = (int8_t)(n / 3 - 40),
+    .stick_y = 0,
+  };
+}
+
+// Encode frames 0..count-1 of the GameCube pattern, each repeated `repeat` times
+static int encode_gcn(int count, int repeat)
+{
+  joybus_playback_encoder_init(&encoder, JOYBUS_PLAYBACK_GCN, stream, sizeof(stream));
+  for (int n = 0; n < count; n++) {
+    struct joybus_gcn_controller_state frame = gcn_frame(n);
+    for (int r = 0; r < repeat; r++)
+      TEST_ASSERT_EQUAL_INT(0, joybus_playback_encoder_add(&encoder, &frame));
+  }
+
+  return joybus_playback_encoder_finish(&encoder);
+}
+
+static int encode_n64(int count)
+{
+  joybus_playback_encoder_init(&encoder, JOYBUS_PLAYBACK_N64, stream, sizeof(stream));
+  for (int n = 0; n < count; n++) {
+    struct joybus_n64_controller_state frame = n64_frame(n);
+    TEST_ASSERT_EQUAL_INT(0, joybus_playback_encoder_add(&encoder, &frame));
+  }
+
+  return joybus_playback_encoder_finish(&encoder);
+}
+
+// Check the GameCube controller is serving frame n
+static void assert_gcn_frame(int n)
+{
+  struct joybus_gcn_controller_state expected = gcn_frame(n);
+  TEST_ASSERT_EQUAL_HEX16(expected.buttons, gcn_controller.input.buttons & JOYBUS_GCN_BUTTON_MASK);
+  TEST_ASSERT_EQUAL_HEX8(expected.stick_x, gcn_controller.input.stick_x);
+  TEST_ASSERT_EQUAL_HEX8(expected.substick_y, gcn_controller.input.substick_y);
+  TEST_ASSERT_EQUAL_HEX8(expected.trigger_right, gcn_controller.input.trigger_right);
+}
+
+void setUp(void)
+{
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_n64_controller_init(&n64_controller);
+  memset(stream, 0, sizeof(stream));
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+// Test that repeated frames are run-length encoded
+static void test_encoder_runs(void)
+{
+  int len = encode_gcn(1, 1000);
+
+  // Header, one delta record with the 4 non-zero bytes, 999 repeats in 8 run records, end
+  TEST_ASSERT_EQUAL_INT(JOYBUS_PLAYBACK_HEADER_LEN + 7 + 8 + 1, len);
+  TEST_ASSERT_EQUAL_HEX8('J', stream[0]);
+  TEST_ASSERT_EQUAL_HEX8(JOYBUS_PLAYBACK_GCN, stream[5]);
+}
+
+// Test that only the changed bytes of a frame are encoded
+static void test_encoder_deltas(void)
+{
+  struct joybus_gcn_controller_state frame = gcn_frame(0);
+
+  joybus_playback_encoder_init(&encoder, JOYBUS_PLAYBACK_GCN, stream, sizeof(stream));
+  joybus_playback_encoder_add(&encoder, &frame);
+  size_t before = encoder.len;
+
+  frame.stick_x++;
+  joybus_playback_encoder_add(&encoder, &frame);
+
+  // Tag, two mask bytes and one changed byte
+  TEST_ASSERT_EQUAL_UINT32(4, encoder.len - before);
+  TEST_ASSERT_EQUAL_HEX8(JOYBUS_PLAYBACK_TAG_DELTA, stream[before]);
+  TEST_ASSERT_EQUAL_HEX8(1 << 2, stream[before + 1]);
+  TEST_ASSERT_EQUAL_HEX8(0, stream[before + 2]);
+}
+
+// Test that the encoder reports running out of space without writing a partial record
+static void test_encoder_no_space(void)
+{
+  struct joybus_gcn_controller_state frame = gcn_frame(0);
+
+  joybus_playback_encoder_init(&encoder, JOYBUS_PLAYBACK_GCN, stream, JOYBUS_PLAYBACK_HEADER_LEN + 4);
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_NO_SPACE, joybus_playback_encoder_add(&encoder, &frame));
+  TEST_ASSERT_EQUAL_UINT32(JOYBUS_PLAYBACK_HEADER_LEN, encoder.len);
+}
+
+// ---------------------------------------------------------------------------
+// Playback
+// ---------------------------------------------------------------------------
+
+// Test that init rejects streams with a bad header
+static void test_init_rejects_bad_header(void)
+{
+  int len = encode_gcn(4, 1);
+
+  stream[0] = 'X';
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID,
+                        joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len));
+  TEST_ASSERT_TRUE(joybus_target_playback_finished(&playback));
+
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_INVALID,
+                        joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, 4));
+}
+
+// Test that each GameCube read is answered with the next frame of the stream
+static void test_gcn_playback(void)
+{
+  int len = encode_gcn(40, 3);
+  TEST_ASSERT_EQUAL_INT(0, joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len));
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  for (int i = 0; i < 40 * 3; i++) {
+    joybus_target_playback_fill(&playback);
+    TEST_ASSERT_EQUAL_INT(0, send_command(gcn_read, sizeof(gcn_read)));
+    assert_gcn_frame(i / 3);
+
+    // The response carries the frame's stick position
+    TEST_ASSERT_EQUAL_HEX8(gcn_frame(i / 3).stick_x, response.data[2]);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(40 * 3, playback.frames);
+  TEST_ASSERT_EQUAL_UINT32(0, playback.underruns);
+  TEST_ASSERT_TRUE(joybus_target_playback_finished(&playback));
+}
+
+// Test that each N64 read is answered with the next frame of the stream
+static void test_n64_playback(void)
+{
+  int len = encode_n64(100);
+  TEST_ASSERT_EQUAL_INT(0, joybus_target_playback_init(&playback, JOYBUS_TARGET(&n64_controller), stream, len));
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  for (int i = 0; i < 100; i++) {
+    joybus_target_playback_fill(&playback);
+    TEST_ASSERT_EQUAL_INT(0, send_command(n64_read, sizeof(n64_read)));
+
+    struct joybus_n64_controller_state expected = n64_frame(i);
+    TEST_ASSERT_EQUAL_HEX16(expected.buttons, n64_controller.input.buttons);
+    TEST_ASSERT_EQUAL_INT8(expected.stick_x, n64_controller.input.stick_x);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, playback.underruns);
+}
+
+// Test that commands other than reads are answered by the controller without consuming frames
+static void test_other_commands_keep_frame(void)
+{
+  int len = encode_gcn(4, 1);
+  joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len);
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  TEST_ASSERT_EQUAL_INT(0, send_command(identify_cmd, sizeof(identify_cmd)));
+  TEST_ASSERT_EQUAL_INT(1, response.count);
+  TEST_ASSERT_EQUAL_UINT32(0, playback.frames);
+
+  TEST_ASSERT_EQUAL_INT(0, send_command(gcn_read, sizeof(gcn_read)));
+  assert_gcn_frame(0);
+}
+
+// Test that the previous frame is repeated when the decoder falls behind, and playback catches up after
+static void test_underrun_repeats_frame(void)
+{
+  int len = encode_gcn(20, 1);
+  joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len);
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  // Only the frames decoded at init are available
+  for (int i = 0; i < JOYBUS_TARGET_PLAYBACK_RING_LEN + 2; i++)
+    send_command(gcn_read, sizeof(gcn_read));
+
+  TEST_ASSERT_EQUAL_UINT32(JOYBUS_TARGET_PLAYBACK_RING_LEN, playback.frames);
+  TEST_ASSERT_EQUAL_UINT32(2, playback.underruns);
+  assert_gcn_frame(JOYBUS_TARGET_PLAYBACK_RING_LEN - 1);
+
+  // No frames were skipped
+  joybus_target_playback_fill(&playback);
+  send_command(gcn_read, sizeof(gcn_read));
+  assert_gcn_frame(JOYBUS_TARGET_PLAYBACK_RING_LEN);
+}
+
+// Test that the last frame is held once the stream ends
+static void test_end_holds_last_frame(void)
+{
+  int len = encode_gcn(3, 1);
+  joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len);
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  for (int i = 0; i < 10; i++) {
+    joybus_target_playback_fill(&playback);
+    send_command(gcn_read, sizeof(gcn_read));
+  }
+
+  assert_gcn_frame(2);
+  TEST_ASSERT_EQUAL_UINT32(3, playback.frames);
+  TEST_ASSERT_EQUAL_UINT32(0, playback.underruns);
+  TEST_ASSERT_FALSE(playback.corrupt);
+}
+
+// Test that a long run plays back from a tiny stream with a fixed-size decoder
+static void test_long_run(void)
+{
+  int len = encode_gcn(2, 50000);
+  TEST_ASSERT_LESS_THAN(1024, len);
+
+  joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len);
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  for (int i = 0; i < 100000; i++) {
+    joybus_target_playback_fill(&playback);
+    send_command(gcn_read, sizeof(gcn_read));
+  }
+
+  assert_gcn_frame(1);
+  TEST_ASSERT_EQUAL_UINT32(100000, playback.frames);
+  TEST_ASSERT_TRUE(joybus_target_playback_finished(&playback));
+}
+
+// Test that a truncated stream stops playback at the last complete frame
+static void test_truncated_stream(void)
+{
+  int len = encode_gcn(5, 1);
+
+  // Cut the last record short, dropping the end marker and one changed byte
+  joybus_target_playback_init(&playback, JOYBUS_TARGET(&gcn_controller), stream, len - 2);
+  harness_reset(JOYBUS_TARGET(&playback));
+
+  for (int i = 0; i < 8; i++) {
+    joybus_target_playback_fill(&playback);
+    send_command(gcn_read, sizeof(gcn_read));
+  }
+
+  TEST_ASSERT_TRUE(playback.corrupt);
+  TEST_ASSERT_EQUAL_UINT32(4, playback.frames);
+  assert_gcn_frame(3);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // Encoder
+  RUN_TEST(test_encoder_runs);
+  RUN_TEST(test_encoder_deltas);
+  RUN_TEST(test_encoder_no_space);
+
+  // Playback
+  RUN_TEST(test_init_rejects_bad_header);
+  RUN_TEST(test_gcn_playback);
+  RUN_TEST(test_n64_playback);
+  RUN_TEST(test_other_commands_keep_frame);
+  RUN_TEST(test_underrun_repeats_frame);
+  RUN_TEST(test_end_holds_last_frame);
+  RUN_TEST(test_long_run);
+  RUN_TEST(test_truncated_stream);
+
+  return UNITY_END();
+}
@@ -0,0 +1,369 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+#include <joybus/target/n64_rumble_pak.h>
+#include <joybus/target/relay.h>
+
+#include "unity.h"
+
+// Gap between console polls
+#define POLL_INTERVAL_US 1000
+
+// The relay under test
+static struct joybus_target_relay relay;
+
+// Console to relay wire
+static struct joybus_loopback console_bus;
+static struct joybus_loopback relay_target_bus;
+
+// Relay to controller wire
+static struct joybus_loopback relay_host_bus;
+static struct joybus_loopback controller_bus;
+
+// The real controllers
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+static struct joybus_target_n64_rumble_pak rumble;
+
+// Latest states read by the console, and the status of the last console transfer
+static struct joybus_gcn_controller_state console_gcn;
+static struct joybus_n64_controller_state console_n64;
+static int console_status;
+
+static void console_cb(struct joybus *bus, int status, void *user_data)
+{
+  console_status = status;
+}
+
+// Wire up the console, the relay and a controller, the console waits for a reply as long as the relay's deadline
+static void start_relay(uint32_t console_freq, struct joybus_target *controller,
+                        struct joybus_target_relay_config config)
+{
+  struct joybus_loopback_config console_config = joybus_loopback_config_default();
+
+  console_config.freq             = console_freq;
+  console_config.reply_timeout_us = config.reply_deadline_us;
+
+  joybus_loopback_init(&console_bus, console_config);
+  joybus_loopback_init(&relay_target_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&console_bus, &relay_target_bus);
+
+  joybus_loopback_init(&relay_host_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&controller_bus, joybus_loopback_config_default());
+  joybus_loopback_connect(&relay_host_bus, &controller_bus);
+
+  config.console_freq = console_freq;
+  TEST_ASSERT_EQUAL_INT(0,
+                        joybus_target_relay_init(&relay, JOYBUS(&relay_target_bus), JOYBUS(&relay_host_bus), config));
+  joybus_attach_target(JOYBUS(&controller_bus), controller);
+
+  joybus_enable(JOYBUS(&console_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&relay_target_bus), JOYBUS_MODE_TARGET);
+  joybus_enable(JOYBUS(&relay_host_bus), JOYBUS_MODE_HOST);
+  joybus_enable(JOYBUS(&controller_bus), JOYBUS_MODE_TARGET);
+}
+
+static void start_gcn_relay(struct joybus_target_relay_config config)
+{
+  start_relay(JOYBUS_FREQ_GCN_CONSOLE, JOYBUS_TARGET(&gcn_controller), config);
+}
+
+static void start_n64_relay(struct joybus_target_relay_config config)
+{
+  start_relay(JOYBUS_FREQ_N64_CONSOLE, JOYBUS_TARGET(&n64_controller), config);
+}
+
+// Let the buses settle, then poll the controller from the console
+static int console_gcn_read(void)
+{
+  joybus_loopback_run_until(joybus_loopback_now_ns() + POLL_INTERVAL_US * 1000ULL);
+  console_status = 1;
+  joybus_gcn_read_async(JOYBUS(&console_bus), JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &console_gcn,
+                        console_cb, NULL);
+  joybus_loopback_run();
+  return console_status;
+}
+
+static int console_n64_read(void)
+{
+  joybus_loopback_run_until(joybus_loopback_now_ns() + POLL_INTERVAL_US * 1000ULL);
+  console_status = 1;
+  joybus_n64_read_async(JOYBUS(&console_bus), &console_n64, console_cb, NULL);
+  joybus_loopback_run();
+  return console_status;
+}
+
+// Swap A and B in GameCube read responses
+static uint8_t swap_ab(const uint8_t *command, const uint8_t *response, uint8_t idx, void *user_data)
+{
+  uint8_t byte = response[idx];
+  if (command[0] != JOYBUS_CMD_GCN_READ || idx != 0)
+    return byte;
+
+  uint8_t a = byte & JOYBUS_GCN_BUTTON_A, b = byte & JOYBUS_GCN_BUTTON_B;
+  return (byte & ~(JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_B)) | (a ? JOYBUS_GCN_BUTTON_B : 0) |
+         (b ? JOYBUS_GCN_BUTTON_A : 0);
+}
+
+// Make Z also press A in GameCube read responses, which needs the second byte to rewrite the first
+static uint8_t z_presses_a(const uint8_t *command, const uint8_t *response, uint8_t idx, void *user_data)
+{
+  uint8_t byte = response[idx];
+  if (command[0] == JOYBUS_CMD_GCN_READ && idx == 0 && response[1] & (JOYBUS_GCN_BUTTON_Z >> 8))
+    byte |= JOYBUS_GCN_BUTTON_A;
+
+  return byte;
+}
+
+void setUp(void)
+{
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_gcn_controller_input_valid(&gcn_controller, true);
+  joybus_target_n64_controller_init(&n64_controller);
+
+  memset(&console_gcn, 0, sizeof(console_gcn));
+  memset(&console_n64, 0, sizeof(console_n64));
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&console_bus));
+  joybus_disable(JOYBUS(&relay_target_bus));
+  joybus_disable(JOYBUS(&relay_host_bus));
+  joybus_disable(JOYBUS(&controller_bus));
+}
+
+// ---------------------------------------------------------------------------
+// Forwarding
+// ---------------------------------------------------------------------------
+
+// Test that commands are forwarded as early as the bit rates allow
+static void test_forward_table(void)
+{
+  start_gcn_relay(joybus_target_relay_config_default());
+
+  // Single byte commands can only go once complete
+  TEST_ASSERT_EQUAL_UINT8(1, relay.forward_at[JOYBUS_CMD_N64_READ_TX]);
+
+  // A slower console leaves a byte in hand, but never more than a whole command
+  TEST_ASSERT_EQUAL_UINT8(2, relay.forward_at[JOYBUS_CMD_GCN_READ_TX]);
+  for (int len = 1; len <= JOYBUS_BLOCK_SIZE; len++)
+    TEST_ASSERT_LESS_OR_EQUAL_UINT8(len, relay.forward_at[len]);
+}
+
+// Test that a host bus that buffers commands ahead of the wire is refused
+static void test_non_streaming_host_bus(void)
+{
+  joybus_loopback_init(&console_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&relay_target_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&relay_host_bus, joybus_loopback_config_default());
+  joybus_loopback_init(&controller_bus, joybus_loopback_config_default());
+  JOYBUS(&relay_host_bus)->streams_write_buf = false;
+
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_NOT_SUPPORTED,
+                        joybus_target_relay_init(&relay, JOYBUS(&relay_target_bus), JOYBUS(&relay_host_bus),
+                                                 joybus_target_relay_config_default()));
+
+  // Nothing is attached or hooked
+  TEST_ASSERT_NULL(JOYBUS(&relay_target_bus)->target);
+  TEST_ASSERT_NULL(JOYBUS(&relay_host_bus)->rx_byte_callback);
+}
+
+// Test that a GameCube read is relayed unchanged
+static void test_gcn_read_relayed(void)
+{
+  start_gcn_relay(joybus_target_relay_config_default());
+  gcn_controller.input.buttons |= JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_BUTTON_Z;
+  gcn_controller.input.stick_x  = 0x12;
+  gcn_controller.input.stick_y  = 0xEF;
+
+  TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+  TEST_ASSERT_EQUAL_HEX16(gcn_controller.input.buttons, console_gcn.buttons);
+  TEST_ASSERT_EQUAL_HEX8(0x12, console_gcn.stick_x);
+  TEST_ASSERT_EQUAL_HEX8(0xEF, console_gcn.stick_y);
+  TEST_ASSERT_EQUAL_UINT32(1, relay.relayed);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.dropped);
+}
+
+// Test that an N64 read is relayed unchanged
+static void test_n64_read_relayed(void)
+{
+  start_n64_relay(joybus_target_relay_config_default());
+  n64_controller.input.buttons = JOYBUS_N64_BUTTON_START;
+  n64_controller.input.stick_x = -40;
+
+  TEST_ASSERT_EQUAL_INT(0, console_n64_read());
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_N64_BUTTON_START, console_n64.buttons);
+  TEST_ASSERT_EQUAL_INT8(-40, console_n64.stick_x);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.late_replies);
+}
+
+// Test that a long pak write reaches the pak intact and its checksum makes it back
+static void test_pak_write_relayed(void)
+{
+  joybus_target_n64_rumble_pak_init(&rumble);
+  joybus_target_n64_controller_attach_pak(&n64_controller, JOYBUS_TARGET_N64_PAK(&rumble));
+  start_n64_relay(joybus_target_relay_config_default());
+
+  uint8_t data[JOYBUS_PAK_BLOCK_SIZE];
+  uint8_t response[JOYBUS_CMD_N64_PAK_WRITE_RX];
+  memset(data, 0x80, sizeof(data));
+
+  joybus_loopback_run_until(joybus_loopback_now_ns() + POLL_INTERVAL_US * 1000ULL);
+  console_status = 1;
+  joybus_n64_pak_write_async(JOYBUS(&console_bus), 0x8000, data, response, console_cb, NULL);
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL_INT(0, console_status);
+  TEST_ASSERT_EQUAL_HEX8(joybus_data_checksum(data, sizeof(data)), response[0]);
+  TEST_ASSERT_TRUE(rumble.enabled);
+}
+
+// Test that commands the relay doesn't know are ignored, and never reach the controller
+static void test_unknown_command_ignored(void)
+{
+  start_gcn_relay(joybus_target_relay_config_default());
+
+  uint8_t command[] = {0x99};
+  uint8_t response[4];
+  console_status = 1;
+  joybus_transfer(JOYBUS(&console_bus), command, sizeof(command), response, sizeof(response), console_cb, NULL);
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_TIMEOUT, console_status);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.relayed);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.dropped);
+}
+
+// ---------------------------------------------------------------------------
+// Rewriting
+// ---------------------------------------------------------------------------
+
+// Test that the rewrite hook is applied to the response seen by the console
+static void test_rewrite_swaps_buttons(void)
+{
+  struct joybus_target_relay_config config = joybus_target_relay_config_default();
+  config.rewrite                           = swap_ab;
+  start_gcn_relay(config);
+
+  gcn_controller.input.buttons |= JOYBUS_GCN_BUTTON_A;
+  TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+  TEST_ASSERT_TRUE(console_gcn.buttons & JOYBUS_GCN_BUTTON_B);
+  TEST_ASSERT_FALSE(console_gcn.buttons & JOYBUS_GCN_BUTTON_A);
+
+  // The rest of the response is untouched
+  TEST_ASSERT_EQUAL_HEX8(gcn_controller.input.stick_x, console_gcn.stick_x);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.late_replies);
+}
+
+// Test that a longer reply lag lets the rewrite hook look ahead in the response, given a more patient console
+static void test_rewrite_with_lookahead(void)
+{
+  struct joybus_target_relay_config config = joybus_target_relay_config_default();
+  config.reply_lag                         = 2;
+  config.reply_deadline_us                 = 150;
+  config.rewrite                           = z_presses_a;
+  start_gcn_relay(config);
+
+  gcn_controller.input.buttons |= JOYBUS_GCN_BUTTON_Z;
+  TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+  TEST_ASSERT_TRUE(console_gcn.buttons & JOYBUS_GCN_BUTTON_A);
+  TEST_ASSERT_TRUE(console_gcn.buttons & JOYBUS_GCN_BUTTON_Z);
+
+  gcn_controller.input.buttons &= ~JOYBUS_GCN_BUTTON_Z;
+  TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+  TEST_ASSERT_FALSE(console_gcn.buttons & JOYBUS_GCN_BUTTON_A);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.late_replies);
+}
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+// Test that every reply starts within the deadline, for both consoles
+static void test_turnaround_within_deadline(void)
+{
+  start_gcn_relay(joybus_target_relay_config_default());
+  for (int i = 0; i < 50; i++)
+    TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+
+  TEST_ASSERT_EQUAL_UINT32(50, relay.relayed);
+  TEST_ASSERT_EQUAL_UINT32(0, relay.late_replies);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(relay.config.reply_deadline_us, relay.max_turnaround_us);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, relay.max_turnaround_us);
+
+  start_n64_relay(joybus_target_relay_config_default());
+  for (int i = 0; i < 50; i++)
+    TEST_ASSERT_EQUAL_INT(0, console_n64_read());
+
+  TEST_ASSERT_EQUAL_UINT32(0, relay.late_replies);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(relay.config.reply_deadline_us, relay.max_turnaround_us);
+}
+
+// Test that waiting for the whole response before replying, as store-and-forward would, misses the deadline
+static void test_store_and_forward_misses_deadline(void)
+{
+  struct joybus_target_relay_config config = joybus_target_relay_config_default();
+  config.reply_lag                         = JOYBUS_CMD_GCN_READ_RX;
+  start_gcn_relay(config);
+
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_TIMEOUT, console_gcn_read());
+  TEST_ASSERT_EQUAL_UINT32(1, relay.late_replies);
+  TEST_ASSERT_GREATER_THAN_UINT32(relay.config.reply_deadline_us, relay.last_turnaround_us);
+}
+
+// ---------------------------------------------------------------------------
+// Errors
+// ---------------------------------------------------------------------------
+
+// Test that the console times out with no controller, and the relay recovers once one is plugged in
+static void test_unplugged_controller(void)
+{
+  start_gcn_relay(joybus_target_relay_config_default());
+  joybus_disable(JOYBUS(&controller_bus));
+
+  TEST_ASSERT_EQUAL_INT(-JOYBUS_ERR_TIMEOUT, console_gcn_read());
+  TEST_ASSERT_EQUAL_UINT32(1, relay.dropped);
+
+  // The console bus waited for the reply as long as the console, then listened again by itself
+  const struct joybus_timing *timing = joybus_get_timing(JOYBUS(&relay_target_bus));
+  TEST_ASSERT_EQUAL_UINT16(relay.config.reply_deadline_us, timing->reply_timeout_us);
+
+  joybus_enable(JOYBUS(&controller_bus), JOYBUS_MODE_TARGET);
+  TEST_ASSERT_EQUAL_INT(0, console_gcn_read());
+  TEST_ASSERT_EQUAL_UINT32(1, relay.relayed);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // Forwarding
+  RUN_TEST(test_forward_table);
+  RUN_TEST(test_non_streaming_host_bus);
+  RUN_TEST(test_gcn_read_relayed);
+  RUN_TEST(test_n64_read_relayed);
+  RUN_TEST(test_pak_write_relayed);
+  RUN_TEST(test_unknown_command_ignored);
+
+  // Rewriting
+  RUN_TEST(test_rewrite_swaps_buttons);
+  RUN_TEST(test_rewrite_with_lookahead);
+
+  // Timing
+  RUN_TEST(test_turnaround_within_deadline);
+  RUN_TEST(test_store_and_forward_misses_deadline);
+
+  // Errors
+  RUN_TEST(test_unplugged_controller);
+
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <string.h>
+
+#include <joybus/checksum.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+#include <joybus/common/gcn_controller.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+#include "unity.h"
+
+#include "harness.h"
+
+// Built with every optional target feature compiled out
+#if JOYBUS_USE_GCN_WAVEBIRD || JOYBUS_USE_GCN_READ_LONG || JOYBUS_USE_GCN_ANALOG_MODES || JOYBUS_USE_N64_PAKS
+#error "test_trimmed_targets must be built with the optional target features disabled"
+#endif
+
+// The controller targets under test
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+void setUp(void)
+{
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_n64_controller_init(&n64_controller);
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// GameCube controller
+// ---------------------------------------------------------------------------
+
+// Test that the WaveBird receiver commands are not supported
+static void test_gcn_wavebird_commands_not_supported(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+
+  uint8_t probe[] = {JOYBUS_CMD_GCN_PROBE_DEVICE, 0x12, 0x34};
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, send_command(probe, sizeof(probe)));
+
+  uint8_t fix[] = {JOYBUS_CMD_GCN_FIX_DEVICE, 0x90, 0xB1};
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, send_command(fix, sizeof(fix)));
+
+  TEST_ASSERT_EQUAL(0, response.count);
+}
+
+// Test that read long is not supported
+static void test_gcn_read_long_not_supported(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ_LONG, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NOT_SUPPORTED, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL(0, response.count);
+}
+
+// Test that read responds with the analog mode 3 layout whatever mode is requested, and still latches the mode
+static void test_gcn_read_uses_mode_3_layout(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+  gcn_controller.input.substick_x    = 0x56;
+  gcn_controller.input.substick_y    = 0x78;
+  gcn_controller.input.trigger_left  = 0x9A;
+  gcn_controller.input.trigger_right = 0xBC;
+
+  // The completed read latches use-origin into the input, so compare against a copy
+  struct joybus_gcn_controller_state expected = gcn_controller.input;
+
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_0, JOYBUS_GCN_MOTOR_STOP};
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_GCN_READ_RX, response.len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(&expected, response.data, JOYBUS_CMD_GCN_READ_RX);
+  TEST_ASSERT_EQUAL_HEX8(JOYBUS_GCN_ANALOG_MODE_0, gcn_controller.id.status & JOYBUS_STATUS_GCN_ANALOG_MODE_MASK);
+}
+
+// Test that a WaveBird controller type is treated as wired
+static void test_gcn_wireless_type_ignored(void)
+{
+  joybus_target_gcn_controller_init_with_type(&gcn_controller, JOYBUS_DEVICE_GCN_WAVEBIRD);
+  TEST_ASSERT_FALSE(joybus_target_gcn_controller_is_wireless(&gcn_controller));
+}
+
+// ---------------------------------------------------------------------------
+// N64 controller
+// ---------------------------------------------------------------------------
+
+// Test that identify reports no pak
+static void test_n64_identify_reports_no_pak(void)
+{
+  harness_reset(JOYBUS_TARGET(&n64_controller));
+
+  uint8_t command[] = {JOYBUS_CMD_IDENTIFY};
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+
+  uint8_t expected[] = {0x05, 0x00, 0x02};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response.data, sizeof(expected));
+}
+
+// Test that pak read responds like an OEM controller with no pak, with zeroes and the "no pak" CRC
+static void test_n64_pak_read_without_pak(void)
+{
+  harness_reset(JOYBUS_TARGET(&n64_controller));
+
+  uint16_t addr     = 0x8000 | joybus_address_checksum(0x8000 >> 5);
+  uint8_t command[] = {JOYBUS_CMD_N64_PAK_READ, addr >> 8, addr & 0xFF};
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+
+  uint8_t expected[JOYBUS_CMD_N64_PAK_READ_RX] = {0};
+  expected[JOYBUS_PAK_BLOCK_SIZE]              = 0xFF;
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_READ_RX, response.len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response.data, sizeof(expected));
+}
+
+// Test that pak write responds with the inverted data CRC, like an OEM controller with no pak
+static void test_n64_pak_write_without_pak(void)
+{
+  harness_reset(JOYBUS_TARGET(&n64_controller));
+
+  uint16_t addr                                = 0xC000 | joybus_address_checksum(0xC000 >> 5);
+  uint8_t command[JOYBUS_CMD_N64_PAK_WRITE_TX] = {JOYBUS_CMD_N64_PAK_WRITE, addr >> 8, addr & 0xFF};
+  memset(&command[3], 0x01, JOYBUS_PAK_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+
+  TEST_ASSERT_EQUAL(JOYBUS_CMD_N64_PAK_WRITE_RX, response.len);
+  TEST_ASSERT_EQUAL_HEX8(joybus_data_checksum(&command[3], JOYBUS_PAK_BLOCK_SIZE) ^ 0xFF, response.data[0]);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // GameCube controller
+  RUN_TEST(test_gcn_wavebird_commands_not_supported);
+  RUN_TEST(test_gcn_read_long_not_supported);
+  RUN_TEST(test_gcn_read_uses_mode_3_layout);
+  RUN_TEST(test_gcn_wireless_type_ignored);
+
+  // N64 controller
+  RUN_TEST(test_n64_identify_reports_no_pak);
+  RUN_TEST(test_n64_pak_read_without_pak);
+  RUN_TEST(test_n64_pak_write_without_pak);
+
+  return UNITY_END();
+}
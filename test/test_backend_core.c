@@ -0,0 +1,739 @@
+#include <string.h>
+
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/errors.h>
+#include <joybus/target.h>
+#include <joybus/virtual_clock.h>
+#include <joybus/backend/core.h>
+
+#include "unity.h"
+
+// Test target commands
+#define CMD_REPLY   0x01 // One byte, three byte reply
+#define CMD_SILENT  0x02 // One byte, no reply
+#define CMD_LONG    0x03 // Three bytes, three byte reply
+#define CMD_ENDLESS 0x04 // Always expects another byte
+#define CMD_BULK    0x05 // One byte, then a bulk payload of four, three byte reply
+#define CMD_DEFER   0x06 // One byte, three byte reply sent later with respond_deferred()
+
+#define US(us) ((uint64_t)(us) * 1000)
+
+// A backend on a fake HAL, which records what the core asked of the peripheral
+struct fake_bus {
+  struct joybus base;
+  struct joybus_core core;
+
+  int host_idle_calls;
+  int host_start_calls;
+  uint64_t host_start_ns;
+  int listen_calls;
+  bool listen_await_idle;
+  int ignore_calls;
+  int prepare_reply_calls;
+  int send_reply_calls;
+  int receive_bulk_calls;
+  uint8_t receive_bulk_len;
+};
+
+static struct joybus_virtual_clock virtual_clock;
+static struct fake_bus fake;
+static struct joybus_target target;
+
+// Completions, and the last status and time
+static int done_count;
+static int done_status;
+static uint64_t done_ns;
+
+// Per-byte receive callbacks
+static int rx_byte_count;
+
+// Calls into the test target
+static int target_calls;
+
+// Response callback of the last deferred command
+static joybus_target_response_cb deferred_response;
+static void *deferred_user_data;
+
+static const uint8_t reply[3] = {0x09, 0x00, 0x03};
+
+static void hal_host_idle(struct joybus *bus)
+{
+  fake.host_idle_calls++;
+}
+
+static void hal_host_start(struct joybus *bus)
+{
+  fake.host_start_calls++;
+  fake.host_start_ns = joybus_virtual_clock_now_ns(&virtual_clock);
+}
+
+static void hal_target_listen(struct joybus *bus, bool await_idle)
+{
+  fake.listen_calls++;
+  fake.listen_await_idle = await_idle;
+}
+
+static void hal_target_ignore(struct joybus *bus)
+{
+  fake.ignore_calls++;
+}
+
+static void hal_target_prepare_reply(struct joybus *bus)
+{
+  fake.prepare_reply_calls++;
+}
+
+static void hal_target_send_reply(struct joybus *bus)
+{
+  fake.send_reply_calls++;
+}
+
+static void hal_target_receive_bulk(struct joybus *bus, uint8_t len)
+{
+  fake.receive_bulk_calls++;
+  fake.receive_bulk_len = len;
+}
+
+// A peripheral without idle detection, timeouts come from alarms
+static const struct joybus_core_hal alarm_hal = {
+  .host_idle            = hal_host_idle,
+  .host_start           = hal_host_start,
+  .target_listen        = hal_target_listen,
+  .target_prepare_reply = hal_target_prepare_reply,
+  .target_send_reply    = hal_target_send_reply,
+  .reply_timeout_us     = JOYBUS_REPLY_TIMEOUT_US,
+  .byte_timeout_us      = 60,
+};
+
+// A peripheral that reports the line going idle
+static const struct joybus_core_hal idle_hal = {
+  .host_idle         = hal_host_idle,
+  .host_start        = hal_host_start,
+  .target_listen     = hal_target_listen,
+  .target_ignore     = hal_target_ignore,
+  .target_send_reply = hal_target_send_reply,
+};
+
+// A peripheral that can receive a bulk payload without an interrupt per byte
+static const struct joybus_core_hal bulk_hal = {
+  .host_idle            = hal_host_idle,
+  .host_start           = hal_host_start,
+  .target_listen        = hal_target_listen,
+  .target_prepare_reply = hal_target_prepare_reply,
+  .target_send_reply    = hal_target_send_reply,
+  .target_receive_bulk  = hal_target_receive_bulk,
+  .reply_timeout_us     = JOYBUS_REPLY_TIMEOUT_US,
+  .byte_timeout_us      = 60,
+};
+
+// A peripheral whose alarms fire late, scheduled transfers wake up early and spin
+static const struct joybus_core_hal lead_hal = {
+  .host_idle         = hal_host_idle,
+  .host_start        = hal_host_start,
+  .target_listen     = hal_target_listen,
+  .target_send_reply = hal_target_send_reply,
+  .reply_timeout_us  = JOYBUS_REPLY_TIMEOUT_US,
+  .start_lead_us     = 10,
+};
+
+static int fake_enable(struct joybus *bus)
+{
+  joybus_core_enable(&fake.core);
+  return 0;
+}
+
+static int fake_disable(struct joybus *bus)
+{
+  joybus_core_disable(&fake.core);
+  return 0;
+}
+
+static int fake_transfer_at(struct joybus *bus, uint64_t at_us, const uint8_t *write_buf, uint8_t write_len,
+                            uint8_t *read_buf, uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  return joybus_core_transfer_at(&fake.core, at_us, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+static int fake_transfer(struct joybus *bus, const uint8_t *write_buf, uint8_t write_len, uint8_t *read_buf,
+                         uint8_t read_len, joybus_transfer_cb callback, void *user_data)
+{
+  return joybus_core_transfer(&fake.core, write_buf, write_len, read_buf, read_len, callback, user_data);
+}
+
+static const struct joybus_api fake_api = {
+  .enable      = fake_enable,
+  .disable     = fake_disable,
+  .transfer    = fake_transfer,
+  .transfer_at = fake_transfer_at,
+};
+
+static int test_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
+                              joybus_target_response_cb send_response, void *user_data)
+{
+  target_calls++;
+
+  switch (command[0]) {
+    case CMD_REPLY:
+      send_response(reply, sizeof(reply), user_data);
+      return 0;
+    case CMD_SILENT:
+      return 0;
+    case CMD_LONG:
+      if (byte_idx < 3)
+        return 3 - byte_idx;
+      send_response(reply, sizeof(reply), user_data);
+      return 0;
+    case CMD_ENDLESS:
+      return 1;
+    case CMD_BULK:
+      if (byte_idx < 5)
+        return JOYBUS_TARGET_BULK(5 - byte_idx);
+      send_response(reply, sizeof(reply), user_data);
+      return 0;
+    case CMD_DEFER:
+      deferred_response  = send_response;
+      deferred_user_data = user_data;
+      return 0;
+    default:
+      return -JOYBUS_ERR_NOT_SUPPORTED;
+  }
+}
+
+static const struct joybus_target_api test_target_api = {
+  .byte_received = test_byte_received,
+};
+
+// Send the reply to the last deferred command
+static void respond_deferred(void)
+{
+  deferred_response(reply, sizeof(reply), deferred_user_data);
+}
+
+static void init_fake(const struct joybus_core_hal *hal)
+{
+  memset(&fake, 0, sizeof(fake));
+  fake.base.api    = &fake_api;
+  fake.base.freq   = JOYBUS_FREQ_NOMINAL;
+  fake.base.clock  = &virtual_clock.base;
+  fake.base.timing = joybus_timing_default();
+  joybus_core_init(&fake.core, JOYBUS(&fake), hal);
+
+  target.api = &test_target_api;
+  joybus_attach_target(JOYBUS(&fake), &target);
+}
+
+void setUp(void)
+{
+  joybus_virtual_clock_init(&virtual_clock, 100);
+  init_fake(&alarm_hal);
+
+  done_count    = 0;
+  done_status   = 1;
+  rx_byte_count = 0;
+  target_calls  = 0;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&fake));
+}
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_count++;
+  done_status = status;
+  done_ns     = joybus_virtual_clock_now_ns(&virtual_clock);
+}
+
+static void rx_byte_cb(struct joybus *bus, uint8_t idx, void *user_data)
+{
+  TEST_ASSERT_EQUAL(rx_byte_count, idx);
+  rx_byte_count++;
+}
+
+static uint8_t command[3] = {CMD_REPLY};
+static uint8_t response[3];
+
+// Enable as a host and start a transfer, advancing until the command starts going out
+static void start_transfer(uint8_t read_len)
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, read_len, done_cb, NULL));
+  joybus_virtual_clock_advance_to(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US));
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_TX, fake.core.state);
+}
+
+// Test a transfer waits out the inter-transfer delay before the command goes out
+static void test_transfer_waits_inter_transfer_delay()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(1, fake.host_idle_calls);
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 3, done_cb, NULL));
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_WAIT, fake.core.state);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US) - 1);
+  TEST_ASSERT_EQUAL(0, fake.host_start_calls);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US));
+  TEST_ASSERT_EQUAL(1, fake.host_start_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_TX, fake.core.state);
+}
+
+// Test a scheduled transfer starts at its time, but never before the inter-transfer delay
+static void test_transfer_at()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(0, joybus_transfer_at(JOYBUS(&fake), 500, command, 1, response, 0, done_cb, NULL));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, joybus_transfer_at(JOYBUS(&fake), 500, command, 1, response, 0, done_cb, NULL));
+
+  joybus_virtual_clock_advance_to(&virtual_clock, US(500) - 1);
+  TEST_ASSERT_EQUAL(0, fake.host_start_calls);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, US(500));
+  TEST_ASSERT_EQUAL(1, fake.host_start_calls);
+  TEST_ASSERT_EQUAL_UINT64(US(500), fake.host_start_ns);
+
+  // Scheduled too soon after the last transfer, it waits out the delay
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, joybus_transfer_at(JOYBUS(&fake), 510, command, 1, response, 0, done_cb, NULL));
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+  TEST_ASSERT_EQUAL(2, fake.host_start_calls);
+  TEST_ASSERT_EQUAL_UINT64(US(500 + JOYBUS_INTER_TRANSFER_DELAY_US), fake.host_start_ns);
+}
+
+// Test a scheduled transfer wakes up early by the HAL's lead time, and a regular one doesn't
+static void test_transfer_at_wakes_early()
+{
+  init_fake(&lead_hal);
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+
+  TEST_ASSERT_EQUAL(0, joybus_transfer_at(JOYBUS(&fake), 500, command, 1, response, 0, done_cb, NULL));
+  TEST_ASSERT_TRUE(joybus_alarm_pending(&fake.core.transfer_start_alarm));
+  TEST_ASSERT_EQUAL_UINT64(490, fake.core.transfer_start_alarm.at_us);
+
+  joybus_disable(JOYBUS(&fake));
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 0, done_cb, NULL));
+  TEST_ASSERT_EQUAL_UINT64(JOYBUS_INTER_TRANSFER_DELAY_US, fake.core.transfer_start_alarm.at_us);
+}
+
+// Test a reply is stored byte by byte, and the transfer completes once
+static void test_host_transfer_completes_once()
+{
+  joybus_set_rx_byte_cb(JOYBUS(&fake), rx_byte_cb, NULL);
+  start_transfer(3);
+
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_RX, fake.core.state);
+
+  for (int i = 0; i < 3; i++)
+    joybus_core_rx_byte(&fake.core, reply[i]);
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(3, rx_byte_count);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(reply, response, 3);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_IDLE, fake.core.state);
+  TEST_ASSERT_EQUAL(2, fake.host_idle_calls);
+
+  // Late events from the peripheral don't complete it again
+  joybus_core_rx_idle(&fake.core);
+  joybus_core_rx_byte(&fake.core, 0xFF);
+  joybus_core_tx_done(&fake.core);
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+}
+
+// Test a transfer without a reply completes once the command has been sent
+static void test_host_no_reply_completes_on_tx_done()
+{
+  start_transfer(0);
+
+  joybus_core_tx_done(&fake.core);
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(0, done_status);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_IDLE, fake.core.state);
+}
+
+// Test a missing reply times out, and the next transfer waits out the delay from then
+static void test_host_reply_timeout()
+{
+  start_transfer(3);
+
+  joybus_core_tx_done(&fake.core);
+  uint64_t tx_done_ns = joybus_virtual_clock_now_ns(&virtual_clock);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, tx_done_ns + US(JOYBUS_REPLY_TIMEOUT_US) - 1);
+  TEST_ASSERT_EQUAL(0, done_count);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, tx_done_ns + US(JOYBUS_REPLY_TIMEOUT_US));
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 3, done_cb, NULL));
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+  TEST_ASSERT_EQUAL(2, fake.host_start_calls);
+  TEST_ASSERT_EQUAL_UINT64(done_ns + US(JOYBUS_INTER_TRANSFER_DELAY_US), fake.host_start_ns);
+}
+
+// Test the timing profile's timeouts override the peripheral's
+static void test_host_timing_profile()
+{
+  struct joybus_timing timing = joybus_timing_default();
+  timing.reply_timeout_us     = 20;
+  timing.byte_timeout_us      = 10;
+  joybus_set_timing(JOYBUS(&fake), &timing);
+  start_transfer(3);
+
+  joybus_core_tx_done(&fake.core);
+  uint64_t tx_done_ns = joybus_virtual_clock_now_ns(&virtual_clock);
+  joybus_virtual_clock_advance_to(&virtual_clock, tx_done_ns + US(19));
+  joybus_core_rx_byte(&fake.core, reply[0]);
+
+  joybus_virtual_clock_advance(&virtual_clock, US(10) - 1);
+  TEST_ASSERT_EQUAL(0, done_count);
+  joybus_virtual_clock_advance(&virtual_clock, 1);
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+}
+
+// Test each following reply byte gets its own timeout
+static void test_host_byte_timeout()
+{
+  start_transfer(3);
+
+  joybus_core_tx_done(&fake.core);
+  joybus_core_rx_byte(&fake.core, reply[0]);
+  uint64_t byte_ns = joybus_virtual_clock_now_ns(&virtual_clock);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, byte_ns + US(alarm_hal.byte_timeout_us) - 1);
+  TEST_ASSERT_EQUAL(0, done_count);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, byte_ns + US(alarm_hal.byte_timeout_us));
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+}
+
+// Test a peripheral that detects the line going idle ends a short reply, without alarms
+static void test_host_rx_idle_ends_reply()
+{
+  init_fake(&idle_hal);
+  start_transfer(3);
+
+  joybus_core_tx_done(&fake.core);
+  joybus_core_rx_byte(&fake.core, reply[0]);
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+  TEST_ASSERT_EQUAL(0, done_count);
+
+  joybus_core_rx_idle(&fake.core);
+  joybus_core_rx_idle(&fake.core);
+
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+}
+
+// Test the wire timestamps are published before the callback runs
+static void test_host_timestamps()
+{
+  start_transfer(3);
+  uint64_t start_us = joybus_clock_now_us(&virtual_clock.base);
+
+  joybus_virtual_clock_advance(&virtual_clock, US(40));
+  joybus_core_tx_done(&fake.core);
+  joybus_virtual_clock_advance(&virtual_clock, US(35));
+  joybus_core_rx_byte(&fake.core, reply[0]);
+  joybus_virtual_clock_advance(&virtual_clock, US(32));
+  joybus_core_rx_byte(&fake.core, reply[1]);
+  joybus_virtual_clock_advance(&virtual_clock, US(32));
+  joybus_core_rx_byte(&fake.core, reply[2]);
+
+  const struct joybus_timestamps *ts = joybus_last_timestamps(JOYBUS(&fake));
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL_UINT64(start_us, ts->start_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + 75, ts->first_byte_us);
+  TEST_ASSERT_EQUAL_UINT64(start_us + 139, ts->complete_us);
+  TEST_ASSERT_EQUAL_UINT64(done_ns / 1000, ts->complete_us);
+
+  // A transfer without a reply has no first byte
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 3, done_cb, NULL));
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US));
+  joybus_core_tx_done(&fake.core);
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_REPLY_TIMEOUT_US));
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, done_status);
+  TEST_ASSERT_EQUAL_UINT64(start_us + 139 + JOYBUS_INTER_TRANSFER_DELAY_US, ts->start_us);
+  TEST_ASSERT_EQUAL_UINT64(0, ts->first_byte_us);
+  TEST_ASSERT_EQUAL_UINT64(ts->start_us + JOYBUS_REPLY_TIMEOUT_US, ts->complete_us);
+}
+
+static void chain_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_cb(bus, status, user_data);
+
+  // The core is idle again by the time the callback runs
+  TEST_ASSERT_EQUAL(0, joybus_transfer(bus, command, 1, response, 0, done_cb, NULL));
+}
+
+// Test transfers fail while disabled or busy, and can be chained from a callback
+static void test_transfer_disabled_busy_and_chained()
+{
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_DISABLED, joybus_transfer(JOYBUS(&fake), command, 1, response, 3, done_cb, NULL));
+
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 0, chain_cb, NULL));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, joybus_transfer(JOYBUS(&fake), command, 1, response, 0, done_cb, NULL));
+
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US));
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_HOST_WAIT, fake.core.state);
+
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_INTER_TRANSFER_DELAY_US));
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(2, fake.host_start_calls);
+}
+
+// Test disabling drops a transfer waiting to start, without calling back
+static void test_disable_drops_transfer()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_HOST));
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&fake), command, 1, response, 3, done_cb, NULL));
+  joybus_disable(JOYBUS(&fake));
+
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+  joybus_core_tx_done(&fake.core);
+
+  TEST_ASSERT_EQUAL(0, fake.host_start_calls);
+  TEST_ASSERT_EQUAL(0, done_count);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_DISABLED, fake.core.state);
+}
+
+// Test a target waits for an idle line when enabled, replies, then listens again
+static void test_target_replies()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+  TEST_ASSERT_EQUAL(1, fake.listen_calls);
+  TEST_ASSERT_TRUE(fake.listen_await_idle);
+
+  joybus_core_rx_byte(&fake.core, CMD_REPLY);
+  TEST_ASSERT_EQUAL(1, fake.prepare_reply_calls);
+  TEST_ASSERT_EQUAL(1, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_TX, fake.core.state);
+  TEST_ASSERT_EQUAL_PTR(reply, fake.core.write_buf);
+  TEST_ASSERT_EQUAL(3, fake.core.write_len);
+
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+  TEST_ASSERT_FALSE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+  TEST_ASSERT_EQUAL(0, fake.core.read_count);
+}
+
+// Test a command without a reply goes back to listening once the host has given up on one
+static void test_target_silent_command()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_SILENT);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_DEFER, fake.core.state);
+  TEST_ASSERT_EQUAL(1, fake.listen_calls);
+
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_REPLY_TIMEOUT_US));
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+  TEST_ASSERT_FALSE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+}
+
+// Test a reply provided after the handler returns is sent as soon as it arrives
+static void test_target_deferred_reply()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_DEFER);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_DEFER, fake.core.state);
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_REPLY_TIMEOUT_US - 10));
+  respond_deferred();
+  TEST_ASSERT_EQUAL(1, fake.prepare_reply_calls);
+  TEST_ASSERT_EQUAL(1, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_TX, fake.core.state);
+  TEST_ASSERT_EQUAL_PTR(reply, fake.core.write_buf);
+
+  // The reply timeout was cancelled, the reply finishes normally
+  joybus_virtual_clock_advance(&virtual_clock, US(100));
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_TX, fake.core.state);
+  joybus_core_tx_done(&fake.core);
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+}
+
+// Test a deferred reply that comes too late is dropped, as is one interrupted by the line
+static void test_target_deferred_reply_late()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_DEFER);
+  joybus_virtual_clock_advance(&virtual_clock, US(JOYBUS_REPLY_TIMEOUT_US));
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+
+  respond_deferred();
+  TEST_ASSERT_EQUAL(0, fake.prepare_reply_calls);
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+  TEST_ASSERT_NULL(fake.core.write_buf);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+
+  // Activity on the line while waiting abandons the reply
+  joybus_core_rx_byte(&fake.core, CMD_DEFER);
+  joybus_core_rx_byte(&fake.core, 0x00);
+  TEST_ASSERT_EQUAL(3, fake.listen_calls);
+  TEST_ASSERT_TRUE(fake.listen_await_idle);
+
+  respond_deferred();
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+}
+
+// Test a multi-byte command is received in full, and an incomplete one times out
+static void test_target_multi_byte_command()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_LONG);
+  joybus_core_rx_byte(&fake.core, 0x12);
+  joybus_core_rx_byte(&fake.core, 0x34);
+  TEST_ASSERT_EQUAL(1, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL_HEX8(0x34, fake.base.command_buffer[2]);
+  joybus_core_tx_done(&fake.core);
+
+  // The byte timeout only runs once a command has started
+  joybus_virtual_clock_advance(&virtual_clock, US(1000));
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+
+  joybus_core_rx_byte(&fake.core, CMD_LONG);
+  joybus_virtual_clock_advance(&virtual_clock, US(alarm_hal.byte_timeout_us));
+  TEST_ASSERT_EQUAL(3, fake.listen_calls);
+  TEST_ASSERT_TRUE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(0, fake.core.read_count);
+}
+
+// Test an unsupported command makes a peripheral without idle detection wait for an idle line
+static void test_target_unsupported_command_awaits_idle()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, 0xEE);
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+  TEST_ASSERT_TRUE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+}
+
+// Test a command too long for the buffer is ignored until the line goes idle
+static void test_target_ignores_long_command()
+{
+  init_fake(&idle_hal);
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_ENDLESS);
+  for (int i = 1; i < JOYBUS_COMMAND_BUFFER_SIZE; i++)
+    joybus_core_rx_byte(&fake.core, 0x00);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+
+  joybus_core_rx_byte(&fake.core, 0x00);
+  TEST_ASSERT_EQUAL(1, fake.ignore_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_IGNORE, fake.core.state);
+
+  // The rest of the command is dropped
+  joybus_core_rx_byte(&fake.core, CMD_REPLY);
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+
+  joybus_core_rx_idle(&fake.core);
+  TEST_ASSERT_EQUAL(2, fake.listen_calls);
+  TEST_ASSERT_FALSE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_RX, fake.core.state);
+}
+
+// Test a peripheral without bulk reception passes the target each byte of the payload
+static void test_target_bulk_byte_by_byte()
+{
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_BULK);
+  for (int i = 0; i < 3; i++) {
+    joybus_virtual_clock_advance(&virtual_clock, US(alarm_hal.byte_timeout_us - 1));
+    joybus_core_rx_byte(&fake.core, 0x10 + i);
+  }
+  TEST_ASSERT_EQUAL(4, target_calls);
+  TEST_ASSERT_EQUAL(0, fake.send_reply_calls);
+
+  joybus_core_rx_byte(&fake.core, 0x13);
+  TEST_ASSERT_EQUAL(5, target_calls);
+  TEST_ASSERT_EQUAL(1, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL_HEX8(0x13, fake.base.command_buffer[4]);
+}
+
+// Test a peripheral with bulk reception is asked for the payload, and the target is called once it's in
+static void test_target_bulk_receive()
+{
+  init_fake(&bulk_hal);
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&fake), JOYBUS_MODE_TARGET));
+
+  joybus_core_rx_byte(&fake.core, CMD_BULK);
+  TEST_ASSERT_EQUAL(1, fake.receive_bulk_calls);
+  TEST_ASSERT_EQUAL(4, fake.receive_bulk_len);
+
+  // The payload lands in the command buffer, then the peripheral reports it
+  memcpy(&fake.base.command_buffer[1], "\x10\x11\x12\x13", 4);
+  joybus_virtual_clock_advance(&virtual_clock, US(alarm_hal.byte_timeout_us * 3));
+  joybus_core_rx_bulk(&fake.core);
+  TEST_ASSERT_EQUAL(2, target_calls);
+  TEST_ASSERT_EQUAL(1, fake.send_reply_calls);
+  TEST_ASSERT_EQUAL(JOYBUS_CORE_TARGET_TX, fake.core.state);
+
+  // A payload that never arrives times out like a byte
+  joybus_core_tx_done(&fake.core);
+  joybus_core_rx_byte(&fake.core, CMD_BULK);
+  joybus_virtual_clock_advance(&virtual_clock, US(alarm_hal.byte_timeout_us * 4));
+  TEST_ASSERT_TRUE(fake.listen_await_idle);
+  TEST_ASSERT_EQUAL(0, fake.core.read_count);
+
+  // A late report is dropped
+  joybus_core_rx_bulk(&fake.core);
+  TEST_ASSERT_EQUAL(3, target_calls);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_transfer_waits_inter_transfer_delay);
+  RUN_TEST(test_transfer_at);
+  RUN_TEST(test_transfer_at_wakes_early);
+  RUN_TEST(test_host_transfer_completes_once);
+  RUN_TEST(test_host_no_reply_completes_on_tx_done);
+  RUN_TEST(test_host_reply_timeout);
+  RUN_TEST(test_host_byte_timeout);
+  RUN_TEST(test_host_timing_profile);
+  RUN_TEST(test_host_rx_idle_ends_reply);
+  RUN_TEST(test_host_timestamps);
+  RUN_TEST(test_transfer_disabled_busy_and_chained);
+  RUN_TEST(test_disable_drops_transfer);
+  RUN_TEST(test_target_replies);
+  RUN_TEST(test_target_silent_command);
+  RUN_TEST(test_target_deferred_reply);
+  RUN_TEST(test_target_deferred_reply_late);
+  RUN_TEST(test_target_multi_byte_command);
+  RUN_TEST(test_target_unsupported_command_awaits_idle);
+  RUN_TEST(test_target_ignores_long_command);
+  RUN_TEST(test_target_bulk_byte_by_byte);
+  RUN_TEST(test_target_bulk_receive);
+
+  return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include <joybus/bitslice.h>
+
+#include "unity.h"
+
+// Line sample period, an eighth of a nominal 4 µs bit
+#define SAMPLE_NS       500
+
+// Longest turnaround covered by the sample window, in bit times
+#define TURNAROUND_BITS 8
+
+// Samples for a GameCube read reply, and the sample streams untransposed from them
+#define REPLY_LEN       8
+#define NUM_SAMPLES     JOYBUS_BITSLICE_SAMPLES(REPLY_LEN, TURNAROUND_BITS)
+
+static uint8_t pin_words[NUM_SAMPLES];
+static uint8_t streams[JOYBUS_BITSLICE_MAX_PORTS][NUM_SAMPLES / 8];
+static uint8_t *stream_ptrs[JOYBUS_BITSLICE_MAX_PORTS];
+
+static uint32_t rng_state;
+
+static uint8_t rng_next(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Reference transpose, one bit at a time
+static void transpose_reference(const uint8_t *const bytes[], uint8_t ports, uint8_t len, uint8_t *words)
+{
+  memset(words, 0, len * 8);
+  for (int i = 0; i < len * 8; i++) {
+    for (int p = 0; p < ports; p++)
+      words[i] |= ((bytes[p][i / 8] >> (7 - i % 8)) & 1) << p;
+  }
+}
+
+// Render a target's reply on a port's line into the pin words, starting after a turnaround and running off the
+// target's own bit period, followed by the target stop bit
+static void render_reply(uint8_t port, const uint8_t *reply, uint8_t len, uint32_t turnaround_ns, uint32_t bit_ns)
+{
+  for (int s = 0; s < NUM_SAMPLES; s++) {
+    uint32_t t    = s * SAMPLE_NS;
+    bool released = true;
+
+    if (t >= turnaround_ns) {
+      uint32_t bit   = (t - turnaround_ns) / bit_ns;
+      uint32_t phase = (t - turnaround_ns) % bit_ns;
+      if (bit < len * 8u) {
+        // Low for a quarter of the bit for a one, three quarters for a zero
+        bool one = (reply[bit / 8] >> (7 - bit % 8)) & 1;
+        released = phase >= (one ? bit_ns / 4 : bit_ns * 3 / 4);
+      } else if (bit == len * 8u) {
+        // Target stop bit, low for half a bit
+        released = phase >= bit_ns / 2;
+      }
+    }
+
+    if (released)
+      pin_words[s] |= 1 << port;
+    else
+      pin_words[s] &= ~(1 << port);
+  }
+}
+
+// Untranspose the pin words into sample streams, and decode a port's reply
+static uint8_t decode_port(uint8_t port, uint8_t ports, uint8_t *reply)
+{
+  joybus_bitslice_untranspose(pin_words, ports, NUM_SAMPLES / 8, stream_ptrs);
+  return joybus_bitslice_decode(streams[port], NUM_SAMPLES, reply, REPLY_LEN);
+}
+
+void setUp(void)
+{
+  rng_state = 0x12345678;
+  memset(pin_words, 0xFF, sizeof(pin_words));
+  for (int p = 0; p < JOYBUS_BITSLICE_MAX_PORTS; p++)
+    stream_ptrs[p] = streams[p];
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Transpose
+// ---------------------------------------------------------------------------
+
+// Test the bit order of the pin words
+static void test_transpose_bit_order(void)
+{
+  uint8_t port0[] = {0x80}, port1[] = {0x01};
+  const uint8_t *bytes[] = {port0, port1};
+
+  uint8_t words[8];
+  joybus_bitslice_transpose(bytes, 2, 1, words);
+
+  uint8_t expected[8] = {0x01, 0, 0, 0, 0, 0, 0, 0x02};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, words, 8);
+}
+
+// Test the transpose against the reference for every port count
+static void test_transpose_matches_reference(void)
+{
+  uint8_t data[JOYBUS_BITSLICE_MAX_PORTS][3];
+  const uint8_t *bytes[JOYBUS_BITSLICE_MAX_PORTS];
+  for (int p = 0; p < JOYBUS_BITSLICE_MAX_PORTS; p++) {
+    bytes[p] = data[p];
+    for (int i = 0; i < 3; i++)
+      data[p][i] = rng_next();
+  }
+
+  for (uint8_t ports = 1; ports <= JOYBUS_BITSLICE_MAX_PORTS; ports++) {
+    uint8_t words[24], expected[24];
+    joybus_bitslice_transpose(bytes, ports, 3, words);
+    transpose_reference(bytes, ports, 3, expected);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, words, sizeof(words));
+  }
+}
+
+// Test that untranspose undoes transpose, and drops pins above the port count
+static void test_untranspose_round_trip(void)
+{
+  uint8_t data[4][10], out[4][10];
+  const uint8_t *bytes[4];
+  uint8_t *out_ptrs[4];
+  for (int p = 0; p < 4; p++) {
+    bytes[p]    = data[p];
+    out_ptrs[p] = out[p];
+    for (int i = 0; i < 10; i++)
+      data[p][i] = rng_next();
+  }
+
+  uint8_t words[80];
+  joybus_bitslice_transpose(bytes, 4, 10, words);
+
+  // Garbage on the unused pins
+  for (int i = 0; i < 80; i++)
+    words[i] |= 0xF0;
+
+  joybus_bitslice_untranspose(words, 4, 10, out_ptrs);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(data, out, sizeof(data));
+}
+
+// ---------------------------------------------------------------------------
+// Decode
+// ---------------------------------------------------------------------------
+
+// Test decoding a reply sent in step with the sampling clock
+static void test_decode_nominal(void)
+{
+  uint8_t reply[REPLY_LEN] = {0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x1F, 0x1F};
+  render_reply(0, reply, REPLY_LEN, 2000, 4000);
+
+  uint8_t decoded[REPLY_LEN];
+  TEST_ASSERT_EQUAL(REPLY_LEN, decode_port(0, 1, decoded));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(reply, decoded, REPLY_LEN);
+}
+
+// Test that each port is decoded independently, whatever its turnaround, bit rate and sampling phase
+static void test_decode_ports_out_of_step(void)
+{
+  static const uint32_t turnaround_ns[] = {1500, 2300, 3100, 6750};
+  static const uint32_t bit_ns[]        = {4000, 3600, 4400, 3900};
+
+  uint8_t replies[4][REPLY_LEN];
+  for (int p = 0; p < 4; p++) {
+    for (int i = 0; i < REPLY_LEN; i++)
+      replies[p][i] = rng_next();
+    render_reply(p, replies[p], REPLY_LEN, turnaround_ns[p], bit_ns[p]);
+  }
+
+  for (int p = 0; p < 4; p++) {
+    uint8_t decoded[REPLY_LEN];
+    TEST_ASSERT_EQUAL(REPLY_LEN, decode_port(p, 4, decoded));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(replies[p], decoded, REPLY_LEN);
+  }
+}
+
+// Test that a port with nothing plugged in decodes nothing
+static void test_decode_no_reply(void)
+{
+  uint8_t decoded[REPLY_LEN];
+  TEST_ASSERT_EQUAL(0, decode_port(2, 4, decoded));
+}
+
+// Test that a reply running past the sample window decodes to the bytes that made it
+static void test_decode_truncated(void)
+{
+  uint8_t reply[REPLY_LEN] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0};
+
+  // Start the reply two and a half bytes before the end of the window
+  render_reply(0, reply, REPLY_LEN, NUM_SAMPLES * SAMPLE_NS - 20 * 4000, 4000);
+
+  uint8_t decoded[REPLY_LEN];
+  TEST_ASSERT_EQUAL(2, decode_port(0, 1, decoded));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(reply, decoded, 2);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // Transpose
+  RUN_TEST(test_transpose_bit_order);
+  RUN_TEST(test_transpose_matches_reference);
+  RUN_TEST(test_untranspose_round_trip);
+
+  // Decode
+  RUN_TEST(test_decode_nominal);
+  RUN_TEST(test_decode_ports_out_of_step);
+  RUN_TEST(test_decode_no_reply);
+  RUN_TEST(test_decode_truncated);
+
+  return UNITY_END();
+}
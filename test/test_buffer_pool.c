@@ -0,0 +1,247 @@
+// Built with JOYBUS_USE_BUFFER_POOL=1 and buffers sized for GameCube controllers, see CMakeLists.txt
+
+#include <joybus/buffer_pool.h>
+#include <joybus/bus.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/gcn.h>
+#include <joybus/host/n64.h>
+#include <joybus/host/n64_rumble_pak.h>
+#include <joybus/target/gcn_controller.h>
+
+#include "unity.h"
+
+#define NUM_PORTS 3
+
+// Host buses share two buffers, targets get one each
+static struct joybus_buffers host_buffers[2];
+static struct joybus_buffers target_buffers[NUM_PORTS];
+static struct joybus_buffer_pool host_pool;
+static struct joybus_buffer_pool target_pool;
+
+static struct joybus_loopback host_buses[NUM_PORTS];
+static struct joybus_loopback target_buses[NUM_PORTS];
+static struct joybus_target_gcn_controller controllers[NUM_PORTS];
+
+// Completion status for each port, and how many reads each port should chain
+static struct joybus_gcn_controller_state states[NUM_PORTS];
+static int statuses[NUM_PORTS];
+static int chained_reads[NUM_PORTS];
+
+void setUp(void)
+{
+  joybus_buffer_pool_init(&host_pool, host_buffers, 2);
+  joybus_buffer_pool_init(&target_pool, target_buffers, NUM_PORTS);
+
+  for (int i = 0; i < NUM_PORTS; i++) {
+    joybus_loopback_init(&host_buses[i], joybus_loopback_config_default());
+    joybus_loopback_init(&target_buses[i], joybus_loopback_config_default());
+    joybus_loopback_connect(&host_buses[i], &target_buses[i]);
+    joybus_attach_buffer_pool(JOYBUS(&host_buses[i]), &host_pool);
+    joybus_attach_buffer_pool(JOYBUS(&target_buses[i]), &target_pool);
+
+    joybus_target_gcn_controller_init(&controllers[i]);
+    controllers[i].input.stick_x = 0x10 + i;
+    joybus_target_gcn_controller_input_valid(&controllers[i], true);
+    joybus_attach_target(JOYBUS(&target_buses[i]), JOYBUS_TARGET(&controllers[i]));
+
+    TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&host_buses[i]), JOYBUS_MODE_HOST));
+    TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&target_buses[i]), JOYBUS_MODE_TARGET));
+
+    statuses[i]      = 1;
+    chained_reads[i] = 0;
+  }
+}
+
+void tearDown(void)
+{
+  for (int i = 0; i < NUM_PORTS; i++) {
+    joybus_disable(JOYBUS(&host_buses[i]));
+    joybus_disable(JOYBUS(&target_buses[i]));
+  }
+}
+
+static int port_of(struct joybus *bus)
+{
+  for (int i = 0; i < NUM_PORTS; i++) {
+    if (bus == JOYBUS(&host_buses[i]))
+      return i;
+  }
+
+  return -1;
+}
+
+static void read_cb(struct joybus *bus, int status, void *user_data)
+{
+  int port       = port_of(bus);
+  statuses[port] = status;
+
+  if (status == 0 && chained_reads[port] > 0) {
+    chained_reads[port]--;
+    statuses[port] = joybus_gcn_read_async(bus, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP, &states[port],
+                                           read_cb, NULL);
+  }
+}
+
+static int start_read(int port)
+{
+  return joybus_gcn_read_async(JOYBUS(&host_buses[port]), JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP,
+                               &states[port], read_cb, NULL);
+}
+
+// Test enabled targets hold their buffers, and return them when disabled
+static void test_targets_hold_buffers_while_enabled()
+{
+  TEST_ASSERT_EQUAL(0, joybus_buffer_pool_available(&target_pool));
+
+  joybus_disable(JOYBUS(&target_buses[0]));
+  TEST_ASSERT_EQUAL(1, joybus_buffer_pool_available(&target_pool));
+
+  TEST_ASSERT_EQUAL(0, joybus_enable(JOYBUS(&target_buses[0]), JOYBUS_MODE_TARGET));
+  TEST_ASSERT_EQUAL(0, joybus_buffer_pool_available(&target_pool));
+}
+
+// Test a target can't be enabled once the pool is exhausted
+static void test_target_enable_pool_exhausted()
+{
+  struct joybus_loopback extra;
+  joybus_loopback_init(&extra, joybus_loopback_config_default());
+  joybus_attach_buffer_pool(JOYBUS(&extra), &target_pool);
+
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE, joybus_enable(JOYBUS(&extra), JOYBUS_MODE_TARGET));
+}
+
+// Test host buses only hold buffers while a host function is in flight
+static void test_host_leases_per_transfer()
+{
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  TEST_ASSERT_EQUAL(0, joybus_buffer_pool_available(&host_pool));
+
+  // A third port has to wait for a buffer
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE, start_read(2));
+
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(0, statuses[0]);
+  TEST_ASSERT_EQUAL(0, statuses[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x10, states[0].stick_x);
+  TEST_ASSERT_EQUAL_HEX8(0x11, states[1].stick_x);
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+
+  TEST_ASSERT_EQUAL(0, start_read(2));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(0, statuses[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x12, states[2].stick_x);
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+}
+
+// Test a host function started from a completion callback keeps the buffers
+static void test_host_chained_reads_keep_buffers()
+{
+  chained_reads[0] = 3;
+
+  TEST_ASSERT_EQUAL(0, start_read(0));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  joybus_loopback_run_until(joybus_loopback_now_ns() + 500000);
+
+  // Port 1 finished, port 0 is still chaining
+  TEST_ASSERT_EQUAL(0, statuses[1]);
+  TEST_ASSERT_EQUAL(1, joybus_buffer_pool_available(&host_pool));
+
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(0, chained_reads[0]);
+  TEST_ASSERT_EQUAL(0, statuses[0]);
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+}
+
+// Test buffers are returned when a host function fails to start
+static void test_host_start_failure_returns_buffers()
+{
+  joybus_disable(JOYBUS(&host_buses[0]));
+
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_DISABLED, start_read(0));
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+
+  // A second host function queued behind the one in flight leases its own buffers
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  TEST_ASSERT_EQUAL(0, start_read(1));
+  TEST_ASSERT_EQUAL(0, joybus_buffer_pool_available(&host_pool));
+
+  // A third has no command slot left, and fails without returning the buffers
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, start_read(1));
+  TEST_ASSERT_EQUAL(0, joybus_buffer_pool_available(&host_pool));
+
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, statuses[1]);
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+}
+
+// Test host functions that need more than the configured buffers fail cleanly
+static void test_host_functions_too_large_for_buffers()
+{
+  uint8_t block[JOYBUS_PAK_BLOCK_SIZE] = {0};
+  uint8_t response[JOYBUS_CMD_N64_PAK_WRITE_RX];
+  struct joybus_n64_rumble_pak_probe probe;
+
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE,
+                    joybus_n64_pak_write_async(JOYBUS(&host_buses[0]), 0x8000, block, response, read_cb, NULL));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_NO_SPACE,
+                    joybus_n64_rumble_pak_init_async(JOYBUS(&host_buses[0]), &probe, read_cb, NULL));
+  TEST_ASSERT_EQUAL(2, joybus_buffer_pool_available(&host_pool));
+}
+
+// A target that expects longer commands than the buffer holds
+static int long_command_bytes;
+
+static int long_command_byte_received(struct joybus_target *target, const uint8_t *command, uint8_t byte_idx,
+                                      joybus_target_response_cb send_response, void *user_data)
+{
+  long_command_bytes = byte_idx;
+  return 5 - byte_idx;
+}
+
+static const struct joybus_target_api long_command_api = {
+  .byte_received = long_command_byte_received,
+};
+
+static void transfer_cb(struct joybus *bus, int status, void *user_data)
+{
+  statuses[0] = status;
+}
+
+// Test a target ignores commands longer than its command buffer
+static void test_target_ignores_long_commands()
+{
+  struct joybus_target long_command_target = {.api = &long_command_api};
+  joybus_attach_target(JOYBUS(&target_buses[0]), &long_command_target);
+  long_command_bytes = 0;
+
+  uint8_t command[5] = {0x55, 1, 2, 3, 4};
+  uint8_t response[1];
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_buses[0]), command, sizeof(command), response, sizeof(response),
+                                       transfer_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(JOYBUS_COMMAND_BUFFER_SIZE, long_command_bytes);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_TIMEOUT, statuses[0]);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_targets_hold_buffers_while_enabled);
+  RUN_TEST(test_target_enable_pool_exhausted);
+  RUN_TEST(test_host_leases_per_transfer);
+  RUN_TEST(test_host_chained_reads_keep_buffers);
+  RUN_TEST(test_host_start_failure_returns_buffers);
+  RUN_TEST(test_host_functions_too_large_for_buffers);
+  RUN_TEST(test_target_ignores_long_commands);
+
+  return UNITY_END();
+}
@@ -38,6 +38,22 @@ static void test_data_checksum_multi_byte()
   TEST_ASSERT_EQUAL_HEX8(0x36, joybus_data_checksum(buf, sizeof(buf)));
 }
 
+// Test joybus_data_checksum agrees with folding in a byte at a time, for every length up to a pak block and beyond
+static void test_data_checksum_matches_update()
+{
+  uint8_t buf[40];
+  for (size_t i = 0; i < sizeof(buf); i++)
+    buf[i] = (uint8_t)(i * 37 + 11);
+
+  for (size_t len = 0; len <= sizeof(buf); len++) {
+    uint8_t expected = 0;
+    for (size_t i = 0; i < len; i++)
+      expected = joybus_data_checksum_update(expected, buf[i]);
+
+    TEST_ASSERT_EQUAL_HEX8(expected, joybus_data_checksum(buf, len));
+  }
+}
+
 // Test address_checksum against various known values
 static void test_address_checksum_known()
 {
@@ -54,6 +70,7 @@ int main(int argc, char **argv)
   RUN_TEST(test_data_checksum_empty_buffer);
   RUN_TEST(test_data_checksum_single_byte);
   RUN_TEST(test_data_checksum_multi_byte);
+  RUN_TEST(test_data_checksum_matches_update);
 
   RUN_TEST(test_address_checksum_known);
 
@@ -0,0 +1,263 @@
+#include <joybus/bus.h>
+#include <joybus/clock.h>
+#include <joybus/commands.h>
+#include <joybus/virtual_clock.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/target/gcn_controller.h>
+
+#include "unity.h"
+
+#include "host/harness.h"
+
+// Maximum number of alarm firings recorded by a test
+#define MAX_FIRED 8
+
+// A test alarm that records when it fired
+struct test_alarm {
+  struct joybus_alarm alarm;
+  int id;
+};
+
+static struct joybus_virtual_clock virtual_clock;
+
+// Alarm ids and clock times, in the order they fired
+static int fired_ids[MAX_FIRED];
+static uint64_t fired_ns[MAX_FIRED];
+static int fired_count;
+
+void setUp(void)
+{
+  joybus_virtual_clock_init(&virtual_clock, 100);
+  fired_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void record_fired(int id, uint64_t now_ns)
+{
+  TEST_ASSERT_LESS_THAN(MAX_FIRED, fired_count);
+  fired_ids[fired_count] = id;
+  fired_ns[fired_count]  = now_ns;
+  fired_count++;
+}
+
+static void alarm_cb(struct joybus_alarm *alarm, void *user_data)
+{
+  struct test_alarm *test_alarm = (struct test_alarm *)alarm;
+  record_fired(test_alarm->id, joybus_virtual_clock_now_ns(user_data));
+}
+
+static void init_alarm(struct test_alarm *test_alarm, int id)
+{
+  joybus_alarm_init(&test_alarm->alarm, alarm_cb, &virtual_clock);
+  test_alarm->id = id;
+}
+
+// Test alarms fire in expiry order, each at its own time
+static void test_alarms_fire_in_order()
+{
+  struct test_alarm a, b, c;
+  init_alarm(&a, 1);
+  init_alarm(&b, 2);
+  init_alarm(&c, 3);
+
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 30);
+  joybus_alarm_schedule(&virtual_clock.base, &b.alarm, 10);
+  joybus_alarm_schedule(&virtual_clock.base, &c.alarm, 20);
+
+  joybus_virtual_clock_advance_to(&virtual_clock, 25000);
+
+  TEST_ASSERT_EQUAL(2, fired_count);
+  TEST_ASSERT_EQUAL(2, fired_ids[0]);
+  TEST_ASSERT_EQUAL_UINT64(10000, fired_ns[0]);
+  TEST_ASSERT_EQUAL(3, fired_ids[1]);
+  TEST_ASSERT_EQUAL_UINT64(20000, fired_ns[1]);
+  TEST_ASSERT_TRUE(joybus_alarm_pending(&a.alarm));
+  TEST_ASSERT_EQUAL_UINT64(25000, joybus_virtual_clock_now_ns(&virtual_clock));
+
+  joybus_virtual_clock_advance(&virtual_clock, 5000);
+
+  TEST_ASSERT_EQUAL(3, fired_count);
+  TEST_ASSERT_EQUAL(1, fired_ids[2]);
+  TEST_ASSERT_FALSE(joybus_alarm_pending(&a.alarm));
+}
+
+// Test alarms due at the same time fire in the order they were scheduled
+static void test_alarms_same_time_fire_in_schedule_order()
+{
+  struct test_alarm a, b;
+  init_alarm(&a, 1);
+  init_alarm(&b, 2);
+
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 10);
+  joybus_alarm_schedule(&virtual_clock.base, &b.alarm, 10);
+  joybus_virtual_clock_advance(&virtual_clock, 10000);
+
+  TEST_ASSERT_EQUAL(2, fired_count);
+  TEST_ASSERT_EQUAL(1, fired_ids[0]);
+  TEST_ASSERT_EQUAL(2, fired_ids[1]);
+}
+
+// Test a cancelled alarm never fires
+static void test_alarm_cancel()
+{
+  struct test_alarm a, b;
+  init_alarm(&a, 1);
+  init_alarm(&b, 2);
+
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 10);
+  joybus_alarm_schedule(&virtual_clock.base, &b.alarm, 20);
+  joybus_alarm_cancel(&virtual_clock.base, &a.alarm);
+
+  TEST_ASSERT_FALSE(joybus_alarm_pending(&a.alarm));
+
+  joybus_virtual_clock_advance(&virtual_clock, 100000);
+
+  TEST_ASSERT_EQUAL(1, fired_count);
+  TEST_ASSERT_EQUAL(2, fired_ids[0]);
+
+  // Cancelling an alarm that isn't pending does nothing
+  joybus_alarm_cancel(&virtual_clock.base, &a.alarm);
+}
+
+// Test rescheduling a pending alarm moves it rather than adding it twice
+static void test_alarm_reschedule()
+{
+  struct test_alarm a;
+  init_alarm(&a, 1);
+
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 10);
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 50);
+  joybus_virtual_clock_advance(&virtual_clock, 100000);
+
+  TEST_ASSERT_EQUAL(1, fired_count);
+  TEST_ASSERT_EQUAL_UINT64(50000, fired_ns[0]);
+}
+
+// Test an alarm scheduled in the past fires before joybus_alarm_schedule() returns
+static void test_alarm_past_fires_inline()
+{
+  struct test_alarm a, b;
+  init_alarm(&a, 1);
+  init_alarm(&b, 2);
+
+  joybus_virtual_clock_advance(&virtual_clock, 100000);
+
+  joybus_alarm_schedule(&virtual_clock.base, &a.alarm, 40);
+  TEST_ASSERT_EQUAL(1, fired_count);
+  TEST_ASSERT_FALSE(joybus_alarm_pending(&a.alarm));
+
+  joybus_alarm_schedule_in(&virtual_clock.base, &b.alarm, 0);
+  TEST_ASSERT_EQUAL(2, fired_count);
+  TEST_ASSERT_EQUAL_UINT64(100000, fired_ns[1]);
+}
+
+static struct joybus_alarm periodic_alarm;
+static int periodic_remaining;
+
+static void periodic_cb(struct joybus_alarm *alarm, void *user_data)
+{
+  record_fired(0, joybus_virtual_clock_now_ns(&virtual_clock));
+
+  if (--periodic_remaining > 0)
+    joybus_alarm_schedule(&virtual_clock.base, alarm, alarm->at_us + 10);
+}
+
+// Test an alarm can reschedule itself from its own callback
+static void test_alarm_reschedule_from_callback()
+{
+  joybus_alarm_init(&periodic_alarm, periodic_cb, NULL);
+  periodic_remaining = 3;
+
+  joybus_alarm_schedule(&virtual_clock.base, &periodic_alarm, 10);
+  joybus_virtual_clock_advance(&virtual_clock, 1000000);
+
+  TEST_ASSERT_EQUAL(3, fired_count);
+  TEST_ASSERT_EQUAL_UINT64(10000, fired_ns[0]);
+  TEST_ASSERT_EQUAL_UINT64(20000, fired_ns[1]);
+  TEST_ASSERT_EQUAL_UINT64(30000, fired_ns[2]);
+}
+
+// Test the virtual clock's time and cycle counter
+static void test_virtual_clock_time()
+{
+  uint64_t at_ns;
+  TEST_ASSERT_FALSE(joybus_virtual_clock_next_alarm(&virtual_clock, &at_ns));
+
+  joybus_virtual_clock_advance(&virtual_clock, 2500);
+
+  TEST_ASSERT_EQUAL_UINT64(2, joybus_clock_now_us(&virtual_clock.base));
+  TEST_ASSERT_EQUAL_UINT32(250, joybus_clock_cycles(&virtual_clock.base));
+
+  // Time never moves backwards
+  joybus_virtual_clock_advance_to(&virtual_clock, 1000);
+  TEST_ASSERT_EQUAL_UINT64(2500, joybus_virtual_clock_now_ns(&virtual_clock));
+}
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller controller;
+static uint64_t transfer_done_ns;
+
+static void loopback_alarm_cb(struct joybus_alarm *alarm, void *user_data)
+{
+  record_fired(0, joybus_loopback_now_ns());
+}
+
+static void transfer_cb(struct joybus *bus, int status, void *user_data)
+{
+  TEST_ASSERT_EQUAL(0, status);
+  transfer_done_ns = joybus_loopback_now_ns();
+}
+
+// Test loopback buses run on the loopback clock, and its alarms fire between bus events
+static void test_loopback_clock_alarms()
+{
+  joybus_target_gcn_controller_init(&controller);
+  loopback_pair_setup(&host_bus, &target_bus, JOYBUS_TARGET(&controller));
+
+  struct joybus_clock *loopback_clock = joybus_loopback_clock();
+  TEST_ASSERT_EQUAL_PTR(loopback_clock, JOYBUS(&host_bus)->clock);
+  TEST_ASSERT_EQUAL_PTR(loopback_clock, JOYBUS(&target_bus)->clock);
+
+  // Fire mid-transfer, and once after it completes
+  struct joybus_alarm mid, after;
+  joybus_alarm_init(&mid, loopback_alarm_cb, NULL);
+  joybus_alarm_init(&after, loopback_alarm_cb, NULL);
+
+  uint64_t start_us = joybus_clock_now_us(loopback_clock);
+  joybus_alarm_schedule(loopback_clock, &mid, start_us + 100);
+  joybus_alarm_schedule(loopback_clock, &after, start_us + 1000);
+
+  uint8_t command = JOYBUS_CMD_IDENTIFY;
+  uint8_t response[JOYBUS_CMD_IDENTIFY_RX];
+  TEST_ASSERT_EQUAL(0, joybus_transfer(JOYBUS(&host_bus), &command, 1, response, sizeof(response), transfer_cb, NULL));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, fired_count);
+  TEST_ASSERT_EQUAL_UINT64((start_us + 100) * 1000, fired_ns[0]);
+  TEST_ASSERT_EQUAL_UINT64((start_us + 1000) * 1000, fired_ns[1]);
+  TEST_ASSERT_TRUE(fired_ns[0] < transfer_done_ns);
+  TEST_ASSERT_TRUE(transfer_done_ns < fired_ns[1]);
+
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_alarms_fire_in_order);
+  RUN_TEST(test_alarms_same_time_fire_in_schedule_order);
+  RUN_TEST(test_alarm_cancel);
+  RUN_TEST(test_alarm_reschedule);
+  RUN_TEST(test_alarm_past_fires_inline);
+  RUN_TEST(test_alarm_reschedule_from_callback);
+  RUN_TEST(test_virtual_clock_time);
+  RUN_TEST(test_loopback_clock_alarms);
+
+  return UNITY_END();
+}
@@ -0,0 +1,203 @@
+#include <joybus/bus.h>
+#include <joybus/commands.h>
+#include <joybus/errors.h>
+#include <joybus/backend/loopback.h>
+#include <joybus/host/common.h>
+#include <joybus/host/gcn.h>
+#include <joybus/target/gcn_controller.h>
+
+#include "unity.h"
+
+#include "host/harness.h"
+
+// Maximum number of completions recorded by a test
+#define MAX_DONE 8
+
+static struct joybus_loopback host_bus;
+static struct joybus_loopback target_bus;
+static struct joybus_target_gcn_controller controller;
+
+// Completions, in the order they happened
+static int done_ids[MAX_DONE];
+static int done_statuses[MAX_DONE];
+static uint64_t done_ns[MAX_DONE];
+static int done_count;
+
+// Motor states seen by the controller, in order
+static uint8_t motor_states[MAX_DONE];
+static int motor_count;
+
+static struct joybus_gcn_controller_state states[MAX_DONE];
+
+void setUp(void)
+{
+  joybus_target_gcn_controller_init(&controller);
+  controller.input.stick_x = 0x42;
+  joybus_target_gcn_controller_input_valid(&controller, true);
+  loopback_pair_setup(&host_bus, &target_bus, JOYBUS_TARGET(&controller));
+
+  done_count  = 0;
+  motor_count = 0;
+}
+
+void tearDown(void)
+{
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_disable(JOYBUS(&target_bus));
+}
+
+static void done_cb(struct joybus *bus, int status, void *user_data)
+{
+  TEST_ASSERT_LESS_THAN(MAX_DONE, done_count);
+  done_ids[done_count]      = (int)(intptr_t)user_data;
+  done_statuses[done_count] = status;
+  done_ns[done_count]       = joybus_loopback_now_ns();
+  done_count++;
+}
+
+static void motor_cb(struct joybus_target_gcn_controller *controller, uint8_t state)
+{
+  TEST_ASSERT_LESS_THAN(MAX_DONE, motor_count);
+  motor_states[motor_count++] = state;
+}
+
+static int start_read(int id, enum joybus_gcn_motor_state motor_state, joybus_transfer_cb callback)
+{
+  return joybus_gcn_read_async(JOYBUS(&host_bus), JOYBUS_GCN_ANALOG_MODE_3, motor_state, &states[id], callback,
+                               (void *)(intptr_t)id);
+}
+
+// Test a command prepared while another is on the wire starts right after the inter-transfer delay
+static void test_queued_command_starts_after_delay()
+{
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(0, done_ids[0]);
+  TEST_ASSERT_EQUAL(1, done_ids[1]);
+  TEST_ASSERT_EQUAL(0, done_statuses[0]);
+  TEST_ASSERT_EQUAL(0, done_statuses[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x42, states[0].stick_x);
+  TEST_ASSERT_EQUAL_HEX8(0x42, states[1].stick_x);
+
+  // The second read takes as long as the first, and starts as soon as the bus is ready
+  uint64_t duration_ns = done_ns[0];
+  TEST_ASSERT_EQUAL_UINT64(done_ns[0] + JOYBUS_INTER_TRANSFER_DELAY_US * 1000 + duration_ns, done_ns[1]);
+}
+
+// Test each command slot keeps its own command while the other is on the wire
+static void test_slots_keep_their_commands()
+{
+  joybus_target_gcn_controller_set_motor_cb(&controller, motor_cb);
+
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_RUMBLE, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(2, motor_count);
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_RUMBLE, motor_states[0]);
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_STOP, motor_states[1]);
+}
+
+// Test a host function fails once both slots are taken, and the slots are free again afterwards
+static void test_slots_exhausted()
+{
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, start_read(2, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+
+  TEST_ASSERT_EQUAL(0, start_read(2, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(3, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(4, done_count);
+  TEST_ASSERT_EQUAL(3, done_ids[3]);
+}
+
+static void chain_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_cb(bus, status, user_data);
+
+  // Chain a read, which runs after the one already queued
+  TEST_ASSERT_EQUAL(0, start_read(2, JOYBUS_GCN_MOTOR_STOP, done_cb));
+}
+
+// Test commands run in the order they were submitted, including ones chained from a callback
+static void test_chained_command_runs_after_queued()
+{
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_STOP, chain_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(0, done_ids[0]);
+  TEST_ASSERT_EQUAL(1, done_ids[1]);
+  TEST_ASSERT_EQUAL(2, done_ids[2]);
+  TEST_ASSERT_EQUAL(0, done_statuses[2]);
+}
+
+static uint8_t raw_command = JOYBUS_CMD_IDENTIFY;
+static uint8_t raw_response[JOYBUS_CMD_IDENTIFY_RX];
+
+static void raw_transfer_cb(struct joybus *bus, int status, void *user_data)
+{
+  done_cb(bus, status, user_data);
+
+  // Take the bus before the queued command can start
+  TEST_ASSERT_EQUAL(0, joybus_transfer(bus, &raw_command, 1, raw_response, sizeof(raw_response), done_cb,
+                                       (void *)(intptr_t)9));
+}
+
+// Test a queued command that can't start reports the failure through its callback
+static void test_queued_start_failure()
+{
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_STOP, raw_transfer_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(1, done_ids[1]);
+  TEST_ASSERT_EQUAL(-JOYBUS_ERR_BUSY, done_statuses[1]);
+  TEST_ASSERT_EQUAL(9, done_ids[2]);
+  TEST_ASSERT_EQUAL(0, done_statuses[2]);
+}
+
+// Test disabling the bus drops queued commands, and the slots are usable once enabled again
+static void test_disable_drops_queued()
+{
+  TEST_ASSERT_EQUAL(0, start_read(0, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(1, JOYBUS_GCN_MOTOR_STOP, done_cb));
+
+  joybus_disable(JOYBUS(&host_bus));
+  joybus_loopback_run();
+  TEST_ASSERT_EQUAL(0, done_count);
+
+  joybus_enable(JOYBUS(&host_bus), JOYBUS_MODE_HOST);
+  TEST_ASSERT_EQUAL(0, start_read(2, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  TEST_ASSERT_EQUAL(0, start_read(3, JOYBUS_GCN_MOTOR_STOP, done_cb));
+  joybus_loopback_run();
+
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(2, done_ids[0]);
+  TEST_ASSERT_EQUAL(3, done_ids[1]);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_queued_command_starts_after_delay);
+  RUN_TEST(test_slots_keep_their_commands);
+  RUN_TEST(test_slots_exhausted);
+  RUN_TEST(test_chained_command_runs_after_queued);
+  RUN_TEST(test_queued_start_failure);
+  RUN_TEST(test_disable_drops_queued);
+
+  return UNITY_END();
+}
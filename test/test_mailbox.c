@@ -0,0 +1,252 @@
+// Built with JOYBUS_USE_MAILBOXES=1, see CMakeLists.txt
+
+#include <pthread.h>
+#include <string.h>
+
+#include <joybus/commands.h>
+#include <joybus/mailbox.h>
+#include <joybus/target/gcn_controller.h>
+#include <joybus/target/n64_controller.h>
+
+#include "unity.h"
+
+#include "target/harness.h"
+
+// Values published by the stress test, every byte of the payload is derived from the sequence number so a torn
+// read shows up as a mismatch
+struct stress_value {
+  uint32_t seq;
+  uint8_t payload[28];
+};
+
+#define STRESS_VALUES 200000
+
+static struct joybus_mailbox mailbox;
+static uint32_t slots[JOYBUS_MAILBOX_SLOTS];
+
+static struct joybus_mailbox stress_mailbox;
+static struct stress_value stress_slots[JOYBUS_MAILBOX_SLOTS];
+
+// The controller targets under test
+static struct joybus_target_gcn_controller gcn_controller;
+static struct joybus_target_n64_controller n64_controller;
+
+void setUp(void)
+{
+  joybus_mailbox_init(&mailbox, slots, sizeof(slots[0]));
+  joybus_target_gcn_controller_init(&gcn_controller);
+  joybus_target_n64_controller_init(&n64_controller);
+}
+
+void tearDown(void)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Mailbox
+// ---------------------------------------------------------------------------
+
+// Test that a new mailbox has nothing to take
+static void test_empty(void)
+{
+  uint32_t value = 0xDEADBEEF;
+  TEST_ASSERT_FALSE(joybus_mailbox_pending(&mailbox));
+  TEST_ASSERT_FALSE(joybus_mailbox_get(&mailbox, &value));
+  TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, value);
+}
+
+// Test that a published value is taken exactly once
+static void test_put_get(void)
+{
+  uint32_t value = 0x12345678;
+  joybus_mailbox_put(&mailbox, &value);
+  TEST_ASSERT_TRUE(joybus_mailbox_pending(&mailbox));
+
+  value = 0;
+  TEST_ASSERT_TRUE(joybus_mailbox_get(&mailbox, &value));
+  TEST_ASSERT_EQUAL_HEX32(0x12345678, value);
+
+  TEST_ASSERT_FALSE(joybus_mailbox_pending(&mailbox));
+  TEST_ASSERT_FALSE(joybus_mailbox_get(&mailbox, &value));
+}
+
+// Test that values published before a take replace each other
+static void test_latest_value_wins(void)
+{
+  for (uint32_t i = 1; i <= 10; i++)
+    joybus_mailbox_put(&mailbox, &i);
+
+  uint32_t value = 0;
+  TEST_ASSERT_TRUE(joybus_mailbox_get(&mailbox, &value));
+  TEST_ASSERT_EQUAL(10, value);
+  TEST_ASSERT_FALSE(joybus_mailbox_get(&mailbox, &value));
+}
+
+// Test interleaved puts and takes, which walk the slots through every rotation
+static void test_interleaved(void)
+{
+  uint32_t value;
+  for (uint32_t i = 0; i < 100; i++) {
+    uint32_t first = i * 2, second = i * 2 + 1;
+    joybus_mailbox_put(&mailbox, &first);
+    if (i % 3 == 0)
+      joybus_mailbox_put(&mailbox, &second);
+
+    TEST_ASSERT_TRUE(joybus_mailbox_get(&mailbox, &value));
+    TEST_ASSERT_EQUAL(i % 3 == 0 ? second : first, value);
+  }
+}
+
+// Fill a stress test value for a sequence number
+static void fill_stress_value(struct stress_value *value, uint32_t seq)
+{
+  value->seq = seq;
+  for (size_t i = 0; i < sizeof(value->payload); i++)
+    value->payload[i] = (uint8_t)(seq * 31 + i);
+}
+
+static void *stress_producer(void *arg)
+{
+  struct stress_value value;
+  for (uint32_t seq = 1; seq <= STRESS_VALUES; seq++) {
+    fill_stress_value(&value, seq);
+    joybus_mailbox_put(&stress_mailbox, &value);
+  }
+
+  return NULL;
+}
+
+// Test a producer and a consumer thread hammering a mailbox, the consumer must never see a torn value or go back
+// in time, and must end up with the last value
+static void test_stress_threads(void)
+{
+  joybus_mailbox_init(&stress_mailbox, stress_slots, sizeof(stress_slots[0]));
+
+  pthread_t producer;
+  TEST_ASSERT_EQUAL(0, pthread_create(&producer, NULL, stress_producer, NULL));
+
+  struct stress_value value, expected;
+  uint32_t last_seq = 0, taken = 0, torn = 0, reordered = 0;
+  while (last_seq != STRESS_VALUES) {
+    if (!joybus_mailbox_get(&stress_mailbox, &value))
+      continue;
+
+    taken++;
+    fill_stress_value(&expected, value.seq);
+    if (memcmp(&expected, &value, sizeof(value)) != 0)
+      torn++;
+    if (value.seq <= last_seq)
+      reordered++;
+    last_seq = value.seq;
+  }
+
+  pthread_join(producer, NULL);
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, torn, "consumer took a torn value");
+  TEST_ASSERT_EQUAL_MESSAGE(0, reordered, "consumer took a value older than the previous one");
+  TEST_ASSERT_TRUE(taken > 0);
+  TEST_ASSERT_FALSE(joybus_mailbox_get(&stress_mailbox, &value));
+}
+
+// ---------------------------------------------------------------------------
+// Controller targets
+// ---------------------------------------------------------------------------
+
+// Test that a published input state is picked up by the next read, keeping the controller's origin flags
+static void test_gcn_publish_input(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+  joybus_target_gcn_controller_input_valid(&gcn_controller, false);
+
+  // The first read latches use-origin
+  uint8_t read[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_STOP};
+  TEST_ASSERT_EQUAL(0, send_command(read, sizeof(read)));
+
+  // Published origin flags are ignored
+  struct joybus_gcn_controller_state input = gcn_controller.origin;
+  input.buttons                            = JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_NEED_ORIGIN;
+  input.stick_x                            = 0xC0;
+  joybus_target_gcn_controller_publish_input(&gcn_controller, &input);
+
+  // Nothing changes until the next command
+  TEST_ASSERT_FALSE(gcn_controller.input_valid);
+
+  TEST_ASSERT_EQUAL(0, send_command(read, sizeof(read)));
+  TEST_ASSERT_TRUE(gcn_controller.input_valid);
+  TEST_ASSERT_EQUAL_HEX16(JOYBUS_GCN_BUTTON_A | JOYBUS_GCN_USE_ORIGIN, gcn_controller.input.buttons);
+  TEST_ASSERT_EQUAL_HEX8(0xC0, response.data[2]);
+}
+
+// Test that a published origin is applied when the next command starts, and flagged to the console
+static void test_gcn_publish_origin(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+
+  struct joybus_gcn_controller_state origin = gcn_controller.origin;
+  origin.stick_x                            = 0x84;
+  joybus_target_gcn_controller_publish_origin(&gcn_controller, &origin);
+
+  uint8_t command[] = {JOYBUS_CMD_GCN_READ_ORIGIN};
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL_HEX8(0x84, response.data[2]);
+
+  // Reading the origin clears the flag again
+  TEST_ASSERT_FALSE(gcn_controller.input.buttons & JOYBUS_GCN_NEED_ORIGIN);
+}
+
+// Test that motor state changes requested by the console are published
+static void test_gcn_take_motor_state(void)
+{
+  harness_reset(JOYBUS_TARGET(&gcn_controller));
+
+  uint8_t state = 0xFF;
+  TEST_ASSERT_FALSE(joybus_target_gcn_controller_take_motor_state(&gcn_controller, &state));
+
+  uint8_t rumble[] = {JOYBUS_CMD_GCN_READ, JOYBUS_GCN_ANALOG_MODE_3, JOYBUS_GCN_MOTOR_RUMBLE};
+  TEST_ASSERT_EQUAL(0, send_command(rumble, sizeof(rumble)));
+  TEST_ASSERT_TRUE(joybus_target_gcn_controller_take_motor_state(&gcn_controller, &state));
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_RUMBLE, state);
+
+  // Unchanged motor states are not published again
+  TEST_ASSERT_EQUAL(0, send_command(rumble, sizeof(rumble)));
+  TEST_ASSERT_FALSE(joybus_target_gcn_controller_take_motor_state(&gcn_controller, &state));
+
+  // Reset stops the motor
+  uint8_t reset[] = {JOYBUS_CMD_RESET};
+  TEST_ASSERT_EQUAL(0, send_command(reset, sizeof(reset)));
+  TEST_ASSERT_TRUE(joybus_target_gcn_controller_take_motor_state(&gcn_controller, &state));
+  TEST_ASSERT_EQUAL(JOYBUS_GCN_MOTOR_STOP, state);
+}
+
+// Test that a published input state is picked up by the next read
+static void test_n64_publish_input(void)
+{
+  harness_reset(JOYBUS_TARGET(&n64_controller));
+
+  struct joybus_n64_controller_state input = {.buttons = JOYBUS_N64_BUTTON_A, .stick_x = 40, .stick_y = -20};
+  joybus_target_n64_controller_publish_input(&n64_controller, &input);
+
+  uint8_t command[] = {JOYBUS_CMD_N64_READ};
+  TEST_ASSERT_EQUAL(0, send_command(command, sizeof(command)));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(&input, response.data, JOYBUS_CMD_N64_READ_RX);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+
+  // Mailbox
+  RUN_TEST(test_empty);
+  RUN_TEST(test_put_get);
+  RUN_TEST(test_latest_value_wins);
+  RUN_TEST(test_interleaved);
+  RUN_TEST(test_stress_threads);
+
+  // Controller targets
+  RUN_TEST(test_gcn_publish_input);
+  RUN_TEST(test_gcn_publish_origin);
+  RUN_TEST(test_gcn_take_motor_state);
+  RUN_TEST(test_n64_publish_input);
+
+  return UNITY_END();
+}